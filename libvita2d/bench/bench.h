@@ -0,0 +1,107 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Timing harness of the benchmarks using the library. A case runs
+ * in batches grown until one takes BENCH_MIN_TIME, the batch is repeated
+ * bench_runs times and the best time per iteration is reported, so runs
+ * can be compared before and after a change.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __vita__
+#include <psp2/kernel/processmgr.h>
+#endif
+
+#define BENCH_MIN_TIME	0.05	/* seconds */
+
+typedef void (*bench_fn)(void *arg, unsigned int iterations);
+
+static int bench_runs = 5;
+static const char *bench_filter = NULL;
+
+static inline double bench_now()
+{
+#ifdef __vita__
+	return sceKernelGetProcessTimeWide() * 1e-6;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+/* Cases whose name doesn't contain the filter are skipped */
+static inline int bench_enabled(const char *name)
+{
+	return !bench_filter || strstr(name, bench_filter);
+}
+
+/* Returns the best time of an iteration in ns */
+static inline double bench_measure(bench_fn fn, void *arg, unsigned int *out_iterations)
+{
+	unsigned int iterations = 1;
+	double best = 1e30;
+	int r;
+
+	for (;;) {
+		double start = bench_now();
+		fn(arg, iterations);
+		double elapsed = bench_now() - start;
+		if (elapsed >= BENCH_MIN_TIME || iterations >= (1U << 30))
+			break;
+		iterations *= elapsed > BENCH_MIN_TIME / 16 ? 2 : 8;
+	}
+
+	for (r = 0; r < bench_runs; r++) {
+		double start = bench_now();
+		fn(arg, iterations);
+		double elapsed = bench_now() - start;
+		if (elapsed < best)
+			best = elapsed;
+	}
+
+	if (out_iterations)
+		*out_iterations = iterations;
+
+	return best * 1e9 / iterations;
+}
+
+static inline void bench_header()
+{
+	printf("%-44s %12s %10s\n", "case", "ns/iter", "iters");
+}
+
+static inline void bench_run(const char *name, bench_fn fn, void *arg)
+{
+	unsigned int iterations;
+	double ns;
+
+	if (!bench_enabled(name))
+		return;
+
+	ns = bench_measure(fn, arg, &iterations);
+	printf("%-44s %12.1f %10u\n", name, ns, iterations);
+	fflush(stdout);
+}
+
+/* Usage: bench [-r runs] [filter] */
+static inline void bench_parse_args(int argc, char *argv[])
+{
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			bench_runs = atoi(argv[++i]);
+			if (bench_runs < 1)
+				bench_runs = 1;
+		} else {
+			bench_filter = argv[i];
+		}
+	}
+}
+
+#endif
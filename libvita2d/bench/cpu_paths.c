@@ -0,0 +1,332 @@
+/*
+ * CPU side hot paths of the library, run on the host build (../host) where
+ * the sceGxm calls are stubs: vertex generation, font layout, bin packing,
+ * the int hash table, image loading and the matrix utils.
+ *
+ * Usage: cpu_paths [-r runs] [filter]
+ * The FreeType cases use VITA2D_BENCH_FONT, or DejaVu Sans if it's unset.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+#include <jpeglib.h>
+#include <vita2d.h>
+#include "bin_packing_2d.h"
+#include "int_htab.h"
+#include "utils.h"
+#include "bench.h"
+
+#define DEFAULT_FONT	"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
+#define IMAGE_SIZE	256
+
+static const char text[] = "The quick brown fox jumps over the lazy dog 0123456789";
+
+/* Keeps the draws going without running out of pool, a text draw takes a few KB */
+static inline void pool_check()
+{
+	if (vita2d_pool_free_space() < 64 * 1024)
+		vita2d_pool_reset();
+}
+
+static void draw_rectangle(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_draw_rectangle(10, 20, 30, 40, 0xFF00FF00);
+	}
+}
+
+static void draw_fill_circle(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_draw_fill_circle(100, 100, 30, 0xFF00FF00);
+	}
+}
+
+static void draw_texture(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_draw_texture(arg, 10, 20);
+	}
+}
+
+static void draw_texture_tint_scale(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_draw_texture_tint_scale(arg, 10, 20, 1.5f, 2.0f, 0x80FFFFFF);
+	}
+}
+
+static void draw_texture_part_tint_scale_rotate(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_draw_texture_part_tint_scale_rotate(arg, 10, 20, 4, 4, 32, 32, 1.5f, 2.0f, 0.5f, 0x80FFFFFF);
+	}
+}
+
+static void font_text_width(void *arg, unsigned int n)
+{
+	while (n--)
+		vita2d_font_text_width(arg, 20, text);
+}
+
+static void font_draw_text(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_font_draw_text(arg, 10, 40, 0xFFFFFFFF, 20, text);
+	}
+}
+
+/* Glyph-like sizes into a 512x512 page, like a font atlas filling up */
+static void bp2d_fill(void *arg, unsigned int n)
+{
+	bp2d_rectangle rect = {0, 0, 512, 512};
+	bp2d_position pos;
+	bp2d_node *new_node;
+
+	while (n--) {
+		bp2d_node *root = bp2d_create(&rect);
+		unsigned int seed = 1, i;
+
+		for (i = 0; i < 256; i++) {
+			bp2d_size size;
+			seed = seed * 1103515245 + 12345;
+			size.w = 8 + (seed >> 16) % 17;
+			size.h = 12 + (seed >> 24) % 13;
+			bp2d_insert(root, &size, &pos, &new_node);
+		}
+
+		bp2d_free(root);
+	}
+}
+
+/* The table owns the values, like the glyph entries of the fonts */
+static void int_htab_fill_find(void *arg, unsigned int n)
+{
+	unsigned int i;
+
+	while (n--) {
+		int_htab *htab = int_htab_create(256);
+
+		for (i = 0; i < 1024; i++)
+			int_htab_insert(htab, i * 2654435761U, malloc(16));
+		for (i = 0; i < 1024; i++)
+			int_htab_find(htab, i * 2654435761U);
+
+		int_htab_free(htab);
+	}
+}
+
+static void matrix_ortho_mult(void *arg, unsigned int n)
+{
+	float ortho[16], rot[16], out[16];
+	float *sink = arg;
+
+	while (n--) {
+		matrix_init_orthographic(ortho, 0.0f, 960.0f, 544.0f, 0.0f, 0.0f, 1.0f);
+		matrix_set_z_rotation(rot, 0.5f);
+		matrix_mult4x4(ortho, rot, out);
+		sink[0] += out[0];
+	}
+}
+
+typedef struct encoded_image {
+	void *data;
+	unsigned long size;
+} encoded_image;
+
+static unsigned char *generate_rgba(unsigned int w, unsigned int h)
+{
+	unsigned char *pixels = malloc(w * h * 4);
+	unsigned int x, y, seed = 12345;
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			unsigned char *p = pixels + (y * w + x) * 4;
+			seed = seed * 1103515245 + 12345;
+			p[0] = x * 255 / w;
+			p[1] = y * 255 / h;
+			p[2] = ((x / 16 + y / 16) & 1) * 128 + ((seed >> 16) & 15);
+			p[3] = 0xFF;
+		}
+	}
+
+	return pixels;
+}
+
+static void encode_png(encoded_image *img, const unsigned char *rgba)
+{
+	png_image image;
+	png_alloc_size_t size = 0;
+
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	image.width = IMAGE_SIZE;
+	image.height = IMAGE_SIZE;
+	image.format = PNG_FORMAT_RGBA;
+
+	png_image_write_get_memory_size(image, size, 0, rgba, 0, NULL);
+	img->data = malloc(size);
+	png_image_write_to_memory(&image, img->data, &size, 0, rgba, 0, NULL);
+	img->size = size;
+}
+
+static void encode_jpeg(encoded_image *img, const unsigned char *rgba)
+{
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	unsigned char *jpeg = NULL, row[IMAGE_SIZE * 3];
+	unsigned long size = 0;
+	JSAMPROW rows[1] = {row};
+	unsigned int x;
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+	jpeg_mem_dest(&cinfo, &jpeg, &size);
+
+	cinfo.image_width = IMAGE_SIZE;
+	cinfo.image_height = IMAGE_SIZE;
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, 90, TRUE);
+
+	jpeg_start_compress(&cinfo, TRUE);
+	while (cinfo.next_scanline < cinfo.image_height) {
+		const unsigned char *src = rgba + cinfo.next_scanline * IMAGE_SIZE * 4;
+		for (x = 0; x < IMAGE_SIZE; x++)
+			memcpy(row + x * 3, src + x * 4, 3);
+		jpeg_write_scanlines(&cinfo, rows, 1);
+	}
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	img->data = jpeg;
+	img->size = size;
+}
+
+static void put_le(unsigned char *p, unsigned int v, int bytes)
+{
+	while (bytes--) {
+		*p++ = v;
+		v >>= 8;
+	}
+}
+
+/* 32 bpp, bottom-up BGRA */
+static void encode_bmp(encoded_image *img, const unsigned char *rgba)
+{
+	unsigned int data_size = IMAGE_SIZE * IMAGE_SIZE * 4;
+	unsigned char *bmp = calloc(1, 54 + data_size);
+	unsigned int x, y;
+
+	put_le(bmp + 0, 0x4D42, 2);
+	put_le(bmp + 2, 54 + data_size, 4);
+	put_le(bmp + 10, 54, 4);
+	put_le(bmp + 14, 40, 4);
+	put_le(bmp + 18, IMAGE_SIZE, 4);
+	put_le(bmp + 22, IMAGE_SIZE, 4);
+	put_le(bmp + 26, 1, 2);
+	put_le(bmp + 28, 32, 2);
+
+	for (y = 0; y < IMAGE_SIZE; y++) {
+		const unsigned char *src = rgba + (IMAGE_SIZE - 1 - y) * IMAGE_SIZE * 4;
+		unsigned char *dst = bmp + 54 + y * IMAGE_SIZE * 4;
+		for (x = 0; x < IMAGE_SIZE; x++) {
+			dst[x * 4 + 0] = src[x * 4 + 2];
+			dst[x * 4 + 1] = src[x * 4 + 1];
+			dst[x * 4 + 2] = src[x * 4 + 0];
+			dst[x * 4 + 3] = src[x * 4 + 3];
+		}
+	}
+
+	img->data = bmp;
+	img->size = 54 + data_size;
+}
+
+static void load_png(void *arg, unsigned int n)
+{
+	const encoded_image *img = arg;
+	while (n--)
+		vita2d_free_texture(vita2d_load_PNG_buffer(img->data));
+}
+
+static void load_jpeg(void *arg, unsigned int n)
+{
+	const encoded_image *img = arg;
+	while (n--)
+		vita2d_free_texture(vita2d_load_JPEG_buffer(img->data, img->size));
+}
+
+static void load_bmp(void *arg, unsigned int n)
+{
+	const encoded_image *img = arg;
+	while (n--)
+		vita2d_free_texture(vita2d_load_BMP_buffer(img->data));
+}
+
+int main(int argc, char *argv[])
+{
+	const char *font_path = getenv("VITA2D_BENCH_FONT");
+	encoded_image png, jpeg, bmp;
+	vita2d_texture *texture;
+	vita2d_font *font;
+	float sink[1] = {0};
+	unsigned char *rgba;
+
+	bench_parse_args(argc, argv);
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	texture = vita2d_create_empty_texture(64, 64);
+	font = vita2d_load_font_file(font_path ? font_path : DEFAULT_FONT);
+
+	rgba = generate_rgba(IMAGE_SIZE, IMAGE_SIZE);
+	encode_png(&png, rgba);
+	encode_jpeg(&jpeg, rgba);
+	encode_bmp(&bmp, rgba);
+	free(rgba);
+
+	bench_header();
+
+	vita2d_start_drawing();
+	bench_run("draw/rectangle", draw_rectangle, NULL);
+	bench_run("draw/fill_circle", draw_fill_circle, NULL);
+	bench_run("draw/texture", draw_texture, texture);
+	bench_run("draw/texture_tint_scale", draw_texture_tint_scale, texture);
+	bench_run("draw/texture_part_tint_scale_rotate", draw_texture_part_tint_scale_rotate, texture);
+	if (font) {
+		bench_run("font/text_width (54 chars)", font_text_width, font);
+		bench_run("font/draw_text (54 chars)", font_draw_text, font);
+	} else {
+		fprintf(stderr, "No font, skipping the font cases\n");
+	}
+	vita2d_end_drawing();
+
+	bench_run("bp2d/256 glyphs into 512x512", bp2d_fill, NULL);
+	bench_run("int_htab/1024 inserts + finds", int_htab_fill_find, NULL);
+	bench_run("matrix/ortho * z rotation", matrix_ortho_mult, sink);
+	bench_run("load/PNG 256x256", load_png, &png);
+	bench_run("load/JPEG 256x256", load_jpeg, &jpeg);
+	bench_run("load/BMP 256x256", load_bmp, &bmp);
+
+	free(png.data);
+	free(jpeg.data);
+	free(bmp.data);
+	if (font)
+		vita2d_free_font(font);
+	vita2d_free_texture(texture);
+	vita2d_fini();
+
+	return sink[0] == 12345.0f;
+}
@@ -0,0 +1,454 @@
+/*
+ * Cost of every public draw entry point: CPU time per call, bytes of the
+ * temporary pool it takes and the sceGxm calls (and draws) it makes. Runs
+ * on the Vita (Makefile.vita) and on the host build (Makefile), where the
+ * time is that of the vertex generation against stub sceGxm calls.
+ *
+ * Usage: draw_calls [-r runs] [filter]
+ * On the Vita the results go to RESULTS_PATH. The FreeType case needs a
+ * font: VITA2D_BENCH_FONT or DejaVu Sans on the host, FONT_PATH on the
+ * Vita. PGF and PVF text need the system fonts, so only run on the Vita.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vita2d.h>
+#include "gxm_count.h"
+#include "bench.h"
+
+#ifdef __vita__
+#define RESULTS_PATH	"ux0:data/vita2d_draw_calls.txt"
+#define FONT_PATH	"ux0:data/vita2d_bench.ttf"
+#else
+#define FONT_PATH	"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
+#endif
+
+/* Calls the pool and sceGxm counts are averaged over */
+#define COUNT_CALLS	16
+/* Most calls timed between two vita2d_start_drawing() */
+#define MAX_CHUNK	512
+#define CALLS_PER_RUN	20000
+
+static const char text[] = "vita2d 0123456789";
+
+typedef struct draw_objects {
+	vita2d_texture *texture;
+	vita2d_atlas_image image;
+	vita2d_font *font;
+	vita2d_pgf *pgf;
+	vita2d_pvf *pvf;
+} draw_objects;
+
+typedef enum draw_needs {
+	NEEDS_NOTHING,
+	NEEDS_FONT,
+	NEEDS_PGF,
+	NEEDS_PVF
+} draw_needs;
+
+typedef struct draw_case {
+	const char *name;
+	void (*draw)(const draw_objects *o);
+	draw_needs needs;
+} draw_case;
+
+static void draw_pixel(const draw_objects *o)
+{
+	vita2d_draw_pixel(10, 20, 0xFF00FF00);
+}
+
+static void draw_line(const draw_objects *o)
+{
+	vita2d_draw_line(10, 20, 300, 200, 0xFF00FF00);
+}
+
+static void draw_rectangle(const draw_objects *o)
+{
+	vita2d_draw_rectangle(10, 20, 30, 40, 0xFF00FF00);
+}
+
+static void draw_fill_circle(const draw_objects *o)
+{
+	vita2d_draw_fill_circle(100, 100, 30, 0xFF00FF00);
+}
+
+/* Like an application would, the vertices are written to the pool */
+static void draw_array(const draw_objects *o)
+{
+	vita2d_color_vertex *v = vita2d_pool_memalign(4 * sizeof(*v), sizeof(*v));
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		v[i].x = 10 + (i & 1) * 30;
+		v[i].y = 20 + (i >> 1) * 40;
+		v[i].z = 0.5f;
+		v[i].color = 0xFF00FF00;
+	}
+
+	vita2d_draw_array(SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, v, 4);
+}
+
+static void draw_texture(const draw_objects *o)
+{
+	vita2d_draw_texture(o->texture, 10, 20);
+}
+
+static void draw_texture_rotate(const draw_objects *o)
+{
+	vita2d_draw_texture_rotate(o->texture, 10, 20, 0.5f);
+}
+
+static void draw_texture_rotate_hotspot(const draw_objects *o)
+{
+	vita2d_draw_texture_rotate_hotspot(o->texture, 10, 20, 0.5f, 4, 4);
+}
+
+static void draw_texture_scale(const draw_objects *o)
+{
+	vita2d_draw_texture_scale(o->texture, 10, 20, 1.5f, 2.0f);
+}
+
+static void draw_texture_part(const draw_objects *o)
+{
+	vita2d_draw_texture_part(o->texture, 10, 20, 4, 4, 32, 32);
+}
+
+static void draw_texture_part_scale(const draw_objects *o)
+{
+	vita2d_draw_texture_part_scale(o->texture, 10, 20, 4, 4, 32, 32, 1.5f, 2.0f);
+}
+
+static void draw_texture_scale_rotate_hotspot(const draw_objects *o)
+{
+	vita2d_draw_texture_scale_rotate_hotspot(o->texture, 10, 20, 1.5f, 2.0f, 0.5f, 4, 4);
+}
+
+static void draw_texture_scale_rotate(const draw_objects *o)
+{
+	vita2d_draw_texture_scale_rotate(o->texture, 10, 20, 1.5f, 2.0f, 0.5f);
+}
+
+static void draw_texture_part_scale_rotate(const draw_objects *o)
+{
+	vita2d_draw_texture_part_scale_rotate(o->texture, 10, 20, 4, 4, 32, 32, 1.5f, 2.0f, 0.5f);
+}
+
+static void draw_texture_tint(const draw_objects *o)
+{
+	vita2d_draw_texture_tint(o->texture, 10, 20, 0x80FFFFFF);
+}
+
+static void draw_texture_tint_rotate(const draw_objects *o)
+{
+	vita2d_draw_texture_tint_rotate(o->texture, 10, 20, 0.5f, 0x80FFFFFF);
+}
+
+static void draw_texture_tint_rotate_hotspot(const draw_objects *o)
+{
+	vita2d_draw_texture_tint_rotate_hotspot(o->texture, 10, 20, 0.5f, 4, 4, 0x80FFFFFF);
+}
+
+static void draw_texture_tint_scale(const draw_objects *o)
+{
+	vita2d_draw_texture_tint_scale(o->texture, 10, 20, 1.5f, 2.0f, 0x80FFFFFF);
+}
+
+static void draw_texture_tint_part(const draw_objects *o)
+{
+	vita2d_draw_texture_tint_part(o->texture, 10, 20, 4, 4, 32, 32, 0x80FFFFFF);
+}
+
+static void draw_texture_tint_part_scale(const draw_objects *o)
+{
+	vita2d_draw_texture_tint_part_scale(o->texture, 10, 20, 4, 4, 32, 32, 1.5f, 2.0f, 0x80FFFFFF);
+}
+
+static void draw_texture_tint_scale_rotate_hotspot(const draw_objects *o)
+{
+	vita2d_draw_texture_tint_scale_rotate_hotspot(o->texture, 10, 20, 1.5f, 2.0f, 0.5f, 4, 4, 0x80FFFFFF);
+}
+
+static void draw_texture_tint_scale_rotate(const draw_objects *o)
+{
+	vita2d_draw_texture_tint_scale_rotate(o->texture, 10, 20, 1.5f, 2.0f, 0.5f, 0x80FFFFFF);
+}
+
+static void draw_texture_part_tint_scale_rotate(const draw_objects *o)
+{
+	vita2d_draw_texture_part_tint_scale_rotate(o->texture, 10, 20, 4, 4, 32, 32, 1.5f, 2.0f, 0.5f, 0x80FFFFFF);
+}
+
+static void draw_array_textured(const draw_objects *o)
+{
+	vita2d_texture_vertex *v = vita2d_pool_memalign(4 * sizeof(*v), sizeof(*v));
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		v[i].x = 10 + (i & 1) * 64;
+		v[i].y = 20 + (i >> 1) * 64;
+		v[i].z = 0.5f;
+		v[i].u = i & 1;
+		v[i].v = i >> 1;
+	}
+
+	vita2d_draw_array_textured(o->texture, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, v, 4, 0xFFFFFFFF);
+}
+
+static void draw_atlas_image(const draw_objects *o)
+{
+	vita2d_draw_atlas_image(&o->image, 10, 20);
+}
+
+static void draw_atlas_image_scale(const draw_objects *o)
+{
+	vita2d_draw_atlas_image_scale(&o->image, 10, 20, 1.5f, 2.0f);
+}
+
+static void font_draw_text(const draw_objects *o)
+{
+	vita2d_font_draw_text(o->font, 10, 40, 0xFFFFFFFF, 20, text);
+}
+
+static void pgf_draw_text(const draw_objects *o)
+{
+	vita2d_pgf_draw_text(o->pgf, 10, 40, 0xFFFFFFFF, 1.0f, text);
+}
+
+static void pvf_draw_text(const draw_objects *o)
+{
+	vita2d_pvf_draw_text(o->pvf, 10, 40, 0xFFFFFFFF, 1.0f, text);
+}
+
+/* A list item: a clip rectangle around one draw, tile aligned or not */
+static void clip_rectangle_aligned(const draw_objects *o)
+{
+	vita2d_set_clip_rectangle(32, 64, 288, 96);
+	vita2d_enable_clipping();
+	vita2d_draw_rectangle(10, 50, 300, 60, 0xFF00FF00);
+	vita2d_disable_clipping();
+}
+
+static void clip_rectangle(const draw_objects *o)
+{
+	vita2d_set_clip_rectangle(30, 60, 290, 100);
+	vita2d_enable_clipping();
+	vita2d_draw_rectangle(10, 50, 300, 60, 0xFF00FF00);
+	vita2d_disable_clipping();
+}
+
+static void clip_fill_circle(const draw_objects *o)
+{
+	vita2d_set_clip_rectangle(30, 60, 290, 100);
+	vita2d_enable_clipping();
+	vita2d_draw_fill_circle(100, 80, 50, 0xFF00FF00);
+	vita2d_disable_clipping();
+}
+
+static void clip_font_draw_text(const draw_objects *o)
+{
+	vita2d_set_clip_rectangle(30, 60, 290, 100);
+	vita2d_enable_clipping();
+	vita2d_font_draw_text(o->font, 10, 90, 0xFFFFFFFF, 40, text);
+	vita2d_disable_clipping();
+}
+
+static const draw_case cases[] = {
+	{"draw_pixel", draw_pixel},
+	{"draw_line", draw_line},
+	{"draw_rectangle", draw_rectangle},
+	{"draw_fill_circle", draw_fill_circle},
+	{"draw_array (4 vertices)", draw_array},
+	{"draw_texture", draw_texture},
+	{"draw_texture_rotate", draw_texture_rotate},
+	{"draw_texture_rotate_hotspot", draw_texture_rotate_hotspot},
+	{"draw_texture_scale", draw_texture_scale},
+	{"draw_texture_part", draw_texture_part},
+	{"draw_texture_part_scale", draw_texture_part_scale},
+	{"draw_texture_scale_rotate_hotspot", draw_texture_scale_rotate_hotspot},
+	{"draw_texture_scale_rotate", draw_texture_scale_rotate},
+	{"draw_texture_part_scale_rotate", draw_texture_part_scale_rotate},
+	{"draw_texture_tint", draw_texture_tint},
+	{"draw_texture_tint_rotate", draw_texture_tint_rotate},
+	{"draw_texture_tint_rotate_hotspot", draw_texture_tint_rotate_hotspot},
+	{"draw_texture_tint_scale", draw_texture_tint_scale},
+	{"draw_texture_tint_part", draw_texture_tint_part},
+	{"draw_texture_tint_part_scale", draw_texture_tint_part_scale},
+	{"draw_texture_tint_scale_rotate_hotspot", draw_texture_tint_scale_rotate_hotspot},
+	{"draw_texture_tint_scale_rotate", draw_texture_tint_scale_rotate},
+	{"draw_texture_part_tint_scale_rotate", draw_texture_part_tint_scale_rotate},
+	{"draw_array_textured (4 vertices)", draw_array_textured},
+	{"draw_atlas_image", draw_atlas_image},
+	{"draw_atlas_image_scale", draw_atlas_image_scale},
+	{"font_draw_text (17 chars)", font_draw_text, NEEDS_FONT},
+	{"pgf_draw_text (17 chars)", pgf_draw_text, NEEDS_PGF},
+	{"pvf_draw_text (17 chars)", pvf_draw_text, NEEDS_PVF},
+	{"clip + draw_rectangle (tile aligned)", clip_rectangle_aligned},
+	{"clip + draw_rectangle", clip_rectangle},
+	{"clip + draw_fill_circle", clip_fill_circle},
+	{"clip + font_draw_text (17 chars)", clip_font_draw_text, NEEDS_FONT},
+};
+
+#define NUM_CASES	(sizeof(cases) / sizeof(*cases))
+
+static int case_available(const draw_case *c, const draw_objects *o)
+{
+	switch (c->needs) {
+	case NEEDS_FONT:
+		return o->font != NULL;
+	case NEEDS_PGF:
+		return o->pgf != NULL;
+	case NEEDS_PVF:
+		return o->pvf != NULL;
+	default:
+		return 1;
+	}
+}
+
+typedef struct draw_result {
+	double ns;
+	double pool_bytes;
+	double gxm_calls;
+	double draws;
+} draw_result;
+
+static void run_case(const draw_case *c, const draw_objects *o, draw_result *result)
+{
+	unsigned int pool_total, chunk, done, i;
+	double best = 1e30;
+	int r;
+
+	/*
+	 * Counts over a few calls in a row, after a first one that caches the
+	 * glyphs of the text cases and sets the state a run of such draws keeps.
+	 */
+	vita2d_start_drawing();
+	pool_total = vita2d_pool_free_space();
+	c->draw(o);
+
+	unsigned int pool_start = vita2d_pool_free_space();
+	memset(&gxm_counts, 0, sizeof(gxm_counts));
+	for (i = 0; i < COUNT_CALLS; i++)
+		c->draw(o);
+
+	result->pool_bytes = (double)(pool_start - vita2d_pool_free_space()) / COUNT_CALLS;
+	result->gxm_calls = (double)gxm_counts.calls / COUNT_CALLS;
+	result->draws = (double)gxm_counts.draws / COUNT_CALLS;
+
+	vita2d_end_drawing();
+	vita2d_wait_rendering_done();
+
+	/* Only the calls are timed, not the scenes they are drawn in */
+	chunk = result->pool_bytes > 0 ? pool_total / 2 / result->pool_bytes : MAX_CHUNK;
+	if (chunk > MAX_CHUNK)
+		chunk = MAX_CHUNK;
+	if (chunk == 0)
+		chunk = 1;
+
+	for (r = 0; r < bench_runs; r++) {
+		double elapsed = 0;
+
+		for (done = 0; done < CALLS_PER_RUN; done += chunk) {
+			vita2d_start_drawing();
+
+			double start = bench_now();
+			for (i = 0; i < chunk; i++)
+				c->draw(o);
+			elapsed += bench_now() - start;
+
+			vita2d_end_drawing();
+			vita2d_wait_rendering_done();
+		}
+
+		if (elapsed / done < best)
+			best = elapsed / done;
+	}
+
+	result->ns = best * 1e9;
+}
+
+static void create_objects(draw_objects *o, vita2d_image_atlas **atlas)
+{
+	const char *font_path = FONT_PATH;
+	unsigned int pixels[32 * 32];
+
+#ifndef __vita__
+	if (getenv("VITA2D_BENCH_FONT"))
+		font_path = getenv("VITA2D_BENCH_FONT");
+#endif
+
+	memset(o, 0, sizeof(*o));
+	memset(pixels, 0xFF, sizeof(pixels));
+
+	o->texture = vita2d_create_empty_texture(64, 64);
+	o->font = vita2d_load_font_file(font_path);
+	o->pgf = vita2d_load_default_pgf();
+	o->pvf = vita2d_load_default_pvf();
+
+	*atlas = vita2d_image_atlas_create(256, 256);
+	if (*atlas)
+		vita2d_image_atlas_add(*atlas, pixels, 32, 32, 32 * 4, &o->image);
+}
+
+static void free_objects(draw_objects *o, vita2d_image_atlas *atlas)
+{
+	if (atlas)
+		vita2d_image_atlas_free(atlas);
+	if (o->pvf)
+		vita2d_free_pvf(o->pvf);
+	if (o->pgf)
+		vita2d_free_pgf(o->pgf);
+	if (o->font)
+		vita2d_free_font(o->font);
+	vita2d_free_texture(o->texture);
+}
+
+int main(int argc, char *argv[])
+{
+	vita2d_image_atlas *atlas;
+	draw_objects objects;
+	draw_result result;
+	unsigned int i;
+
+	bench_parse_args(argc, argv);
+
+#ifdef __vita__
+	if (!freopen(RESULTS_PATH, "w", stdout))
+		return 1;
+#endif
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	create_objects(&objects, &atlas);
+	if (!objects.texture || !objects.image.texture) {
+		fprintf(stderr, "Can't create the textures\n");
+		return 1;
+	}
+
+	printf("%-40s %10s %10s %10s %8s\n", "call", "ns/call", "pool B", "sceGxm", "draws");
+
+	for (i = 0; i < NUM_CASES; i++) {
+		const draw_case *c = &cases[i];
+
+		if (!bench_enabled(c->name))
+			continue;
+
+		if (!case_available(c, &objects)) {
+			printf("%-40s %10s\n", c->name, "skipped");
+			continue;
+		}
+
+		run_case(c, &objects, &result);
+		printf("%-40s %10.1f %10.1f %10.2f %8.2f\n", c->name,
+		       result.ns, result.pool_bytes, result.gxm_calls, result.draws);
+		fflush(stdout);
+	}
+
+	free_objects(&objects, atlas);
+	vita2d_fini();
+
+	return 0;
+}
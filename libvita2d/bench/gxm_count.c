@@ -0,0 +1,129 @@
+#include <psp2/gxm.h>
+#include "gxm_count.h"
+
+gxm_count gxm_counts;
+
+#define COUNT_CALL()	(gxm_counts.calls++)
+
+int __real_sceGxmBeginScene(SceGxmContext *context, unsigned int flags, const SceGxmRenderTarget *renderTarget,
+			    const void *validRegion, SceGxmSyncObject *vertexSyncObject, SceGxmSyncObject *fragmentSyncObject,
+			    const SceGxmColorSurface *colorSurface, const SceGxmDepthStencilSurface *depthStencil);
+int __wrap_sceGxmBeginScene(SceGxmContext *context, unsigned int flags, const SceGxmRenderTarget *renderTarget,
+			    const void *validRegion, SceGxmSyncObject *vertexSyncObject, SceGxmSyncObject *fragmentSyncObject,
+			    const SceGxmColorSurface *colorSurface, const SceGxmDepthStencilSurface *depthStencil)
+{
+	COUNT_CALL();
+	return __real_sceGxmBeginScene(context, flags, renderTarget, validRegion, vertexSyncObject,
+				       fragmentSyncObject, colorSurface, depthStencil);
+}
+
+int __real_sceGxmEndScene(SceGxmContext *context, const SceGxmNotification *vertexNotification,
+			  const SceGxmNotification *fragmentNotification);
+int __wrap_sceGxmEndScene(SceGxmContext *context, const SceGxmNotification *vertexNotification,
+			  const SceGxmNotification *fragmentNotification)
+{
+	COUNT_CALL();
+	return __real_sceGxmEndScene(context, vertexNotification, fragmentNotification);
+}
+
+void __real_sceGxmSetVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram);
+void __wrap_sceGxmSetVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram)
+{
+	COUNT_CALL();
+	__real_sceGxmSetVertexProgram(context, vertexProgram);
+}
+
+void __real_sceGxmSetFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram);
+void __wrap_sceGxmSetFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram)
+{
+	COUNT_CALL();
+	__real_sceGxmSetFragmentProgram(context, fragmentProgram);
+}
+
+int __real_sceGxmSetVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData);
+int __wrap_sceGxmSetVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData)
+{
+	COUNT_CALL();
+	return __real_sceGxmSetVertexStream(context, streamIndex, streamData);
+}
+
+int __real_sceGxmSetFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture);
+int __wrap_sceGxmSetFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture)
+{
+	COUNT_CALL();
+	return __real_sceGxmSetFragmentTexture(context, textureIndex, texture);
+}
+
+int __real_sceGxmReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int __wrap_sceGxmReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer)
+{
+	COUNT_CALL();
+	return __real_sceGxmReserveVertexDefaultUniformBuffer(context, uniformBuffer);
+}
+
+int __real_sceGxmReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int __wrap_sceGxmReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer)
+{
+	COUNT_CALL();
+	return __real_sceGxmReserveFragmentDefaultUniformBuffer(context, uniformBuffer);
+}
+
+int __real_sceGxmSetUniformDataF(void *uniformBuffer, const SceGxmProgramParameter *parameter,
+				 unsigned int componentOffset, unsigned int componentCount, const float *sourceData);
+int __wrap_sceGxmSetUniformDataF(void *uniformBuffer, const SceGxmProgramParameter *parameter,
+				 unsigned int componentOffset, unsigned int componentCount, const float *sourceData)
+{
+	COUNT_CALL();
+	return __real_sceGxmSetUniformDataF(uniformBuffer, parameter, componentOffset, componentCount, sourceData);
+}
+
+int __real_sceGxmDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType,
+		      const void *indexData, unsigned int indexCount);
+int __wrap_sceGxmDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType,
+		      const void *indexData, unsigned int indexCount)
+{
+	COUNT_CALL();
+	gxm_counts.draws++;
+	return __real_sceGxmDraw(context, primType, indexType, indexData, indexCount);
+}
+
+void __real_sceGxmSetFrontPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode);
+void __wrap_sceGxmSetFrontPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode)
+{
+	COUNT_CALL();
+	__real_sceGxmSetFrontPolygonMode(context, mode);
+}
+
+void __real_sceGxmSetBackPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode);
+void __wrap_sceGxmSetBackPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode)
+{
+	COUNT_CALL();
+	__real_sceGxmSetBackPolygonMode(context, mode);
+}
+
+void __real_sceGxmSetFrontStencilFunc(SceGxmContext *context, SceGxmStencilFunc func, SceGxmStencilOp stencilFail,
+				      SceGxmStencilOp depthFail, SceGxmStencilOp depthPass,
+				      unsigned char compareMask, unsigned char writeMask);
+void __wrap_sceGxmSetFrontStencilFunc(SceGxmContext *context, SceGxmStencilFunc func, SceGxmStencilOp stencilFail,
+				      SceGxmStencilOp depthFail, SceGxmStencilOp depthPass,
+				      unsigned char compareMask, unsigned char writeMask)
+{
+	COUNT_CALL();
+	__real_sceGxmSetFrontStencilFunc(context, func, stencilFail, depthFail, depthPass, compareMask, writeMask);
+}
+
+void __real_sceGxmSetFrontStencilRef(SceGxmContext *context, unsigned int sref);
+void __wrap_sceGxmSetFrontStencilRef(SceGxmContext *context, unsigned int sref)
+{
+	COUNT_CALL();
+	__real_sceGxmSetFrontStencilRef(context, sref);
+}
+
+void __real_sceGxmSetRegionClip(SceGxmContext *context, SceGxmRegionClipMode mode, unsigned int xMin,
+				unsigned int yMin, unsigned int xMax, unsigned int yMax);
+void __wrap_sceGxmSetRegionClip(SceGxmContext *context, SceGxmRegionClipMode mode, unsigned int xMin,
+				unsigned int yMin, unsigned int xMax, unsigned int yMax)
+{
+	COUNT_CALL();
+	__real_sceGxmSetRegionClip(context, mode, xMin, yMin, xMax, yMax);
+}
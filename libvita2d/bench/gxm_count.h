@@ -0,0 +1,16 @@
+#ifndef GXM_COUNT_H
+#define GXM_COUNT_H
+
+/*
+ * Counts of the sceGxm calls libvita2d makes on its context. The calls go
+ * through the wrappers of gxm_count.c when the program is linked with the
+ * --wrap flags of GXM_WRAP (see Makefile), on the Vita as on the host.
+ */
+typedef struct gxm_count {
+	unsigned int calls;
+	unsigned int draws;
+} gxm_count;
+
+extern gxm_count gxm_counts;
+
+#endif
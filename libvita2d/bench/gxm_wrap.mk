@@ -0,0 +1,7 @@
+# Routes the sceGxm calls of the library through gxm_count.c (GNU ld --wrap)
+GXM_WRAPPED = sceGxmBeginScene sceGxmEndScene sceGxmSetVertexProgram sceGxmSetFragmentProgram \
+	sceGxmSetVertexStream sceGxmSetFragmentTexture sceGxmReserveVertexDefaultUniformBuffer \
+	sceGxmReserveFragmentDefaultUniformBuffer sceGxmSetUniformDataF sceGxmDraw \
+	sceGxmSetFrontPolygonMode sceGxmSetBackPolygonMode sceGxmSetFrontStencilFunc \
+	sceGxmSetFrontStencilRef sceGxmSetRegionClip
+GXM_WRAP = $(foreach f,$(GXM_WRAPPED),-Wl,--wrap=$(f))
@@ -0,0 +1,249 @@
+/*
+ * JPEG decode benchmark: runs the decode loops used by the vita2d JPEG
+ * loader on a fixed, synthetic corpus (generated and encoded in memory at
+ * startup, so every run decodes the exact same bitstreams).
+ *
+ * Usage: jpeg_decode [runs]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <jpeglib.h>
+
+#define DEFAULT_RUNS 5
+
+typedef struct corpus_image {
+	const char *name;
+	unsigned int width;
+	unsigned int height;
+	int gray;
+	int subsample; /* 1: 4:2:0, 0: 4:4:4 */
+	unsigned char *jpeg;
+	unsigned long jpeg_size;
+} corpus_image;
+
+static corpus_image corpus[] = {
+	{"640x480 4:2:0",    640,  480, 0, 1},
+	{"1920x1080 4:2:0", 1920, 1080, 0, 1},
+	{"1920x1080 4:4:4", 1920, 1080, 0, 0},
+	{"4000x3000 4:2:0", 4000, 3000, 0, 1},
+	{"1024x1024 gray",  1024, 1024, 1, 0},
+};
+
+#define CORPUS_SIZE (sizeof(corpus) / sizeof(*corpus))
+
+typedef enum {
+	MODE_ROWS1_RGB,
+	MODE_BATCH_RGB,
+	MODE_BATCH_RGBA_EXPAND,
+#ifdef JCS_EXTENSIONS
+	MODE_BATCH_RGBA_EXT,
+#endif
+	MODE_THUMB_256,
+	MODE_COUNT
+} decode_mode;
+
+static const char *mode_names[] = {
+	"1 row/call, 3 bpp",
+	"batched, 3 bpp",
+	"batched, RGBA expand",
+#ifdef JCS_EXTENSIONS
+	"batched, JCS_EXT_RGBA",
+#endif
+	"thumbnail <= 256px",
+};
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Smooth gradients plus some LCG noise, roughly photo-like entropy */
+static void generate_image(const corpus_image *img, unsigned char *pixels)
+{
+	unsigned int x, y, c;
+	unsigned int seed = 12345;
+	int comps = img->gray ? 1 : 3;
+
+	for (y = 0; y < img->height; y++) {
+		for (x = 0; x < img->width; x++) {
+			for (c = 0; c < comps; c++) {
+				seed = seed * 1103515245 + 12345;
+				int v = (x * (c + 1) * 255) / img->width / 2 +
+					(y * (3 - c) * 255) / img->height / 4 +
+					((x / 16 + y / 16) & 1) * 32 +
+					(int)((seed >> 16) & 15);
+				pixels[(y * img->width + x) * comps + c] = v > 255 ? 255 : v;
+			}
+		}
+	}
+}
+
+static void encode_image(corpus_image *img)
+{
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	int comps = img->gray ? 1 : 3;
+	unsigned char *pixels = malloc(img->width * img->height * comps);
+	JSAMPROW row;
+
+	generate_image(img, pixels);
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+
+	img->jpeg = NULL;
+	img->jpeg_size = 0;
+	jpeg_mem_dest(&cinfo, &img->jpeg, &img->jpeg_size);
+
+	cinfo.image_width = img->width;
+	cinfo.image_height = img->height;
+	cinfo.input_components = comps;
+	cinfo.in_color_space = img->gray ? JCS_GRAYSCALE : JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, 90, TRUE);
+
+	if (!img->gray && !img->subsample) {
+		cinfo.comp_info[0].h_samp_factor = 1;
+		cinfo.comp_info[0].v_samp_factor = 1;
+	}
+
+	jpeg_start_compress(&cinfo, TRUE);
+	while (cinfo.next_scanline < cinfo.image_height) {
+		row = pixels + cinfo.next_scanline * img->width * comps;
+		jpeg_write_scanlines(&cinfo, &row, 1);
+	}
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	free(pixels);
+}
+
+/* Same as _vita2d_JPEG_expand_rgba() */
+static void expand_rgba(unsigned char *row, unsigned int width, int components)
+{
+	unsigned char *src = row + width * components;
+	unsigned char *dst = row + width * 4;
+
+	while (dst > row) {
+		src -= components;
+		dst -= 4;
+		if (components == 1) {
+			unsigned char l = src[0];
+			dst[0] = l;
+			dst[1] = l;
+			dst[2] = l;
+		} else {
+			unsigned char r = src[0], g = src[1], b = src[2];
+			dst[0] = r;
+			dst[1] = g;
+			dst[2] = b;
+		}
+		dst[3] = 0xFF;
+	}
+}
+
+/* Decodes into a buffer laid out like a vita2d texture */
+static void decode_image(const corpus_image *img, decode_mode mode)
+{
+	struct jpeg_decompress_struct jinfo;
+	struct jpeg_error_mgr jerr;
+	unsigned int bpp, stride, num;
+	int i, rgba = 0;
+
+	jinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_decompress(&jinfo);
+	jpeg_mem_src(&jinfo, img->jpeg, img->jpeg_size);
+	jpeg_read_header(&jinfo, TRUE);
+
+	if (mode == MODE_BATCH_RGBA_EXPAND)
+		rgba = 1;
+#ifdef JCS_EXTENSIONS
+	if (mode == MODE_BATCH_RGBA_EXT) {
+		jinfo.out_color_space = JCS_EXT_RGBA;
+		rgba = 1;
+	}
+#endif
+
+	if (mode == MODE_THUMB_256) {
+		jinfo.scale_denom = 8;
+		for (num = 8; num > 1; num--) {
+			jinfo.scale_num = num;
+			jpeg_calc_output_dimensions(&jinfo);
+			if (jinfo.output_width <= 256 && jinfo.output_height <= 256)
+				break;
+		}
+		jinfo.scale_num = num;
+		jinfo.dct_method = JDCT_IFAST;
+		jinfo.do_fancy_upsampling = FALSE;
+	}
+
+	jpeg_start_decompress(&jinfo);
+
+	bpp = rgba ? 4 : jinfo.output_components;
+	stride = ((jinfo.output_width + 7) & ~7) * bpp;
+	unsigned char *data = malloc(stride * jinfo.output_height);
+	JSAMPROW rows[jinfo.rec_outbuf_height];
+
+	while (jinfo.output_scanline < jinfo.output_height) {
+		if (mode == MODE_ROWS1_RGB) {
+			rows[0] = data + jinfo.output_scanline * stride;
+			jpeg_read_scanlines(&jinfo, rows, 1);
+			continue;
+		}
+
+		for (i = 0; i < jinfo.rec_outbuf_height; i++)
+			rows[i] = data + (jinfo.output_scanline + i) * stride;
+
+		int num_rows = jpeg_read_scanlines(&jinfo, rows, jinfo.rec_outbuf_height);
+
+		if (rgba && jinfo.output_components != 4) {
+			for (i = 0; i < num_rows; i++)
+				expand_rgba(rows[i], jinfo.output_width, jinfo.output_components);
+		}
+	}
+
+	jpeg_finish_decompress(&jinfo);
+	jpeg_destroy_decompress(&jinfo);
+	free(data);
+}
+
+int main(int argc, char *argv[])
+{
+	int runs = argc > 1 ? atoi(argv[1]) : DEFAULT_RUNS;
+	unsigned int i, m;
+	int r;
+
+	if (runs < 1)
+		runs = 1;
+
+	for (i = 0; i < CORPUS_SIZE; i++)
+		encode_image(&corpus[i]);
+
+	printf("%-18s %-24s %10s %10s\n", "image", "mode", "best ms", "MPix/s");
+
+	for (i = 0; i < CORPUS_SIZE; i++) {
+		for (m = 0; m < MODE_COUNT; m++) {
+			double best = 1e9;
+
+			for (r = 0; r < runs; r++) {
+				double start = now();
+				decode_image(&corpus[i], m);
+				double elapsed = now() - start;
+				if (elapsed < best)
+					best = elapsed;
+			}
+
+			/* Rate in source pixels, so scaled decodes are comparable */
+			printf("%-18s %-24s %10.2f %10.1f\n", corpus[i].name, mode_names[m],
+			       best * 1e3, corpus[i].width * corpus[i].height / best / 1e6);
+		}
+		free(corpus[i].jpeg);
+	}
+
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Fill rate of the reference rasterizer of the host build (../host), per
+ * kind of draw vita2d makes: the time of a draw and the pixels it writes.
+ * It measures the rasterizer, not the Vita, the GPU runs these in hardware.
+ *
+ * Usage: raster [-r runs] [filter]
+ * The font case uses VITA2D_BENCH_FONT, or DejaVu Sans if it's unset.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vita2d.h>
+#include "vita2d_host.h"
+#include "bench.h"
+
+#define DEFAULT_FONT	"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
+#define TEXTURE_SIZE	64
+
+static vita2d_texture *texture;
+static vita2d_font *font;
+
+static inline void pool_check()
+{
+	if (vita2d_pool_free_space() < 64 * 1024)
+		vita2d_pool_reset();
+}
+
+static void clear_screen(void *arg, unsigned int n)
+{
+	while (n--)
+		vita2d_clear_screen();
+}
+
+static void rectangle_opaque(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_draw_rectangle(100, 100, 256, 256, 0xFF00FF00);
+	}
+}
+
+static void rectangle_translucent(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_draw_rectangle(100, 100, 256, 256, 0x8000FF00);
+	}
+}
+
+static void rectangle_additive(void *arg, unsigned int n)
+{
+	vita2d_set_blend_mode_add(1);
+	while (n--) {
+		pool_check();
+		vita2d_draw_rectangle(100, 100, 256, 256, 0x80102030);
+	}
+	vita2d_set_blend_mode_add(0);
+}
+
+static void fill_circle(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_draw_fill_circle(228, 228, 128, 0xFF00FF00);
+	}
+}
+
+static void texture_scale(void *arg, unsigned int n)
+{
+	SceGxmTextureFilter filter = *(SceGxmTextureFilter *)arg;
+
+	vita2d_texture_set_filters(texture, filter, filter);
+	while (n--) {
+		pool_check();
+		vita2d_draw_texture_scale(texture, 100, 100, 4.0f, 4.0f);
+	}
+}
+
+static void texture_tint_rotate(void *arg, unsigned int n)
+{
+	vita2d_texture_set_filters(texture, SCE_GXM_TEXTURE_FILTER_LINEAR, SCE_GXM_TEXTURE_FILTER_LINEAR);
+	while (n--) {
+		pool_check();
+		vita2d_draw_texture_tint_scale_rotate(texture, 228, 228, 4.0f, 4.0f, 0.5f, 0x80FFFFFF);
+	}
+}
+
+static void font_draw_text(void *arg, unsigned int n)
+{
+	while (n--) {
+		pool_check();
+		vita2d_font_draw_text(font, 20, 200, 0xFFFFFFFF, 32, "The quick brown fox jumps");
+	}
+}
+
+/* Not on tiles: the rectangle is clipped on the CPU, the circle by the stencil mask */
+static void rectangle_clipped(void *arg, unsigned int n)
+{
+	vita2d_set_clip_rectangle(150, 150, 300, 300);
+	vita2d_enable_clipping();
+	while (n--) {
+		pool_check();
+		vita2d_draw_rectangle(100, 100, 256, 256, 0xFF00FF00);
+	}
+	vita2d_disable_clipping();
+}
+
+static void fill_circle_clipped(void *arg, unsigned int n)
+{
+	vita2d_set_clip_rectangle(150, 150, 300, 300);
+	vita2d_enable_clipping();
+	while (n--) {
+		pool_check();
+		vita2d_draw_fill_circle(228, 228, 128, 0xFF00FF00);
+	}
+	vita2d_disable_clipping();
+}
+
+/* Like bench_run, with the pixels a draw writes and the fill rate */
+static void raster_run(const char *name, bench_fn fn, void *arg)
+{
+	vita2d_host_gxm_stats stats;
+	unsigned int iterations;
+	double ns;
+
+	if (!bench_enabled(name))
+		return;
+
+	vita2d_host_reset_gxm_stats();
+	fn(arg, 1);
+	vita2d_host_get_gxm_stats(&stats);
+
+	ns = bench_measure(fn, arg, &iterations);
+	printf("%-36s %12.1f %10u %10.1f\n", name, ns, stats.fragments, stats.fragments * 1e3 / ns);
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *font_path = getenv("VITA2D_BENCH_FONT");
+	SceGxmTextureFilter point = SCE_GXM_TEXTURE_FILTER_POINT;
+	SceGxmTextureFilter linear = SCE_GXM_TEXTURE_FILTER_LINEAR;
+	unsigned int *data;
+	unsigned int stride;
+	int x, y;
+
+	bench_parse_args(argc, argv);
+
+	vita2d_host_set_rasterizer(1);
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	texture = vita2d_create_empty_texture(TEXTURE_SIZE, TEXTURE_SIZE);
+	data = vita2d_texture_get_datap(texture);
+	stride = vita2d_texture_get_stride(texture) / 4;
+	for (y = 0; y < TEXTURE_SIZE; y++) {
+		for (x = 0; x < TEXTURE_SIZE; x++)
+			data[y * stride + x] = ((x ^ y) & 8) ? 0xFF0000FF : 0xC0FFFF00;
+	}
+
+	font = vita2d_load_font_file(font_path ? font_path : DEFAULT_FONT);
+
+	printf("%-36s %12s %10s %10s\n", "case", "ns/draw", "pixels", "Mpixel/s");
+
+	vita2d_start_drawing();
+	raster_run("clear_screen", clear_screen, NULL);
+	raster_run("rectangle/opaque 256x256", rectangle_opaque, NULL);
+	raster_run("rectangle/translucent 256x256", rectangle_translucent, NULL);
+	raster_run("rectangle/additive 256x256", rectangle_additive, NULL);
+	raster_run("rectangle/clipped (unaligned)", rectangle_clipped, NULL);
+	raster_run("fill_circle/r128", fill_circle, NULL);
+	raster_run("fill_circle/stencil clipped", fill_circle_clipped, NULL);
+	raster_run("texture/point 4x", texture_scale, &point);
+	raster_run("texture/linear 4x", texture_scale, &linear);
+	raster_run("texture/linear tint rotate 4x", texture_tint_rotate, NULL);
+	if (font)
+		raster_run("font/draw_text 32px", font_draw_text, NULL);
+	else
+		fprintf(stderr, "No font, skipping the font case\n");
+	vita2d_end_drawing();
+
+	if (font)
+		vita2d_free_font(font);
+	vita2d_free_texture(texture);
+	vita2d_fini();
+
+	return 0;
+}
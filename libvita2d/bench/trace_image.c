@@ -0,0 +1,167 @@
+/*
+ * Renders the last frame of a trace (see trace_replay.c) with the reference
+ * rasterizer of the host build, and compares it with a golden image: a
+ * change that should only make the library faster (batching, state caching,
+ * atlas packing...) must render the same pixels.
+ *
+ * Usage: trace_image [-w] trace_file golden.png [font.ttf]
+ * With -w the golden image is written instead. On a mismatch the frame is
+ * written to golden.png.actual.png and the exit status is 1.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+#include <vita2d.h>
+#include "vita2d_host.h"
+
+#define FRAME_WIDTH	960
+#define FRAME_HEIGHT	544
+
+static int write_png(const char *path, const void *pixels)
+{
+	png_image image;
+
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	image.width = FRAME_WIDTH;
+	image.height = FRAME_HEIGHT;
+	image.format = PNG_FORMAT_RGBA;
+
+	return png_image_write_to_file(&image, path, 0, pixels, FRAME_WIDTH * 4, NULL);
+}
+
+static void *read_png(const char *path)
+{
+	png_image image;
+	void *pixels;
+
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+
+	if (!png_image_begin_read_from_file(&image, path))
+		return NULL;
+
+	if (image.width != FRAME_WIDTH || image.height != FRAME_HEIGHT) {
+		png_image_free(&image);
+		return NULL;
+	}
+
+	image.format = PNG_FORMAT_RGBA;
+	pixels = malloc(PNG_IMAGE_SIZE(image));
+	if (!pixels) {
+		png_image_free(&image);
+		return NULL;
+	}
+
+	if (!png_image_finish_read(&image, NULL, pixels, FRAME_WIDTH * 4, NULL)) {
+		free(pixels);
+		return NULL;
+	}
+
+	return pixels;
+}
+
+/* Returns the number of pixels that differ, and the largest channel difference */
+static unsigned int compare(const unsigned char *a, const unsigned char *b, int *max_diff)
+{
+	unsigned int differ = 0;
+	int i, c;
+
+	*max_diff = 0;
+
+	for (i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; i++) {
+		int pixel_diff = 0;
+		for (c = 0; c < 4; c++) {
+			int diff = abs(a[i * 4 + c] - b[i * 4 + c]);
+			if (diff > pixel_diff)
+				pixel_diff = diff;
+		}
+		if (pixel_diff) {
+			differ++;
+			if (pixel_diff > *max_diff)
+				*max_diff = pixel_diff;
+		}
+	}
+
+	return differ;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *trace_path, *golden_path;
+	char actual_path[1024];
+	vita2d_font *font = NULL;
+	unsigned char *golden;
+	const void *frame;
+	unsigned int differ;
+	int write = 0, max_diff, arg = 1, ret = 1;
+
+	if (argc > 1 && strcmp(argv[1], "-w") == 0) {
+		write = 1;
+		arg++;
+	}
+
+	if (argc - arg < 2) {
+		fprintf(stderr, "Usage: %s [-w] trace_file golden.png [font.ttf]\n", argv[0]);
+		return 1;
+	}
+
+	trace_path = argv[arg];
+	golden_path = argv[arg + 1];
+
+	vita2d_host_set_rasterizer(1);
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	if (argc - arg > 2 && !(font = vita2d_load_font_file(argv[arg + 2])))
+		fprintf(stderr, "Can't load %s, skipping the FreeType text\n", argv[arg + 2]);
+
+	if (!vita2d_trace_replay_file(trace_path, font)) {
+		fprintf(stderr, "%s is not a valid trace\n", trace_path);
+		goto exit;
+	}
+
+	/* The trace ends with the vita2d_swap_buffers() of its last frame */
+	frame = vita2d_get_current_fb();
+
+	if (write) {
+		if (!write_png(golden_path, frame)) {
+			fprintf(stderr, "Can't write %s\n", golden_path);
+			goto exit;
+		}
+		ret = 0;
+		goto exit;
+	}
+
+	golden = read_png(golden_path);
+	if (!golden) {
+		fprintf(stderr, "Can't read %s as a %dx%d image\n", golden_path, FRAME_WIDTH, FRAME_HEIGHT);
+		goto exit;
+	}
+
+	differ = compare(frame, golden, &max_diff);
+	free(golden);
+
+	if (differ) {
+		snprintf(actual_path, sizeof(actual_path), "%s.actual.png", golden_path);
+		write_png(actual_path, frame);
+		printf("%u pixels differ (max difference %d), frame written to %s\n",
+		       differ, max_diff, actual_path);
+		goto exit;
+	}
+
+	printf("frame matches %s\n", golden_path);
+	ret = 0;
+
+exit:
+	if (font)
+		vita2d_free_font(font);
+	vita2d_fini();
+
+	return ret;
+}
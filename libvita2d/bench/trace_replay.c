@@ -0,0 +1,70 @@
+/*
+ * Replays a trace recorded with vita2d_trace_start() on the host build, to
+ * time the CPU side of a real frame mix and count the sceGxm work it makes.
+ *
+ * Usage: trace_replay trace_file [runs] [font.ttf]
+ * The font stands in for the FreeType fonts of the trace, their text is
+ * skipped without one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vita2d.h>
+#include "vita2d_host.h"
+#include "bench.h"
+
+int main(int argc, char *argv[])
+{
+	vita2d_host_gxm_stats stats;
+	vita2d_font *font = NULL;
+	double best = 1e30;
+	int runs, r;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s trace_file [runs] [font.ttf]\n", argv[0]);
+		return 1;
+	}
+
+	runs = argc > 2 ? atoi(argv[2]) : 10;
+	if (runs < 1)
+		runs = 1;
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	if (argc > 3 && !(font = vita2d_load_font_file(argv[3])))
+		fprintf(stderr, "Can't load %s, skipping the FreeType text\n", argv[3]);
+
+	for (r = 0; r < runs; r++) {
+		vita2d_host_reset_gxm_stats();
+
+		double start = bench_now();
+		if (!vita2d_trace_replay_file(argv[1], font)) {
+			fprintf(stderr, "%s is not a valid trace\n", argv[1]);
+			return 1;
+		}
+		double elapsed = bench_now() - start;
+
+		if (elapsed < best)
+			best = elapsed;
+	}
+
+	/* The counts are the same every run, these are from the last one */
+	vita2d_host_get_gxm_stats(&stats);
+
+	printf("best of %d: %.3f ms\n", runs, best * 1e3);
+	printf("scenes %u, draws %u, indices %u, sceGxm calls %u\n",
+	       stats.scenes, stats.draws, stats.indices, stats.calls);
+	if (stats.scenes)
+		printf("per scene: %.1f us, %.1f draws, %.1f sceGxm calls\n",
+		       best * 1e6 / stats.scenes, (double)stats.draws / stats.scenes,
+		       (double)stats.calls / stats.scenes);
+
+	if (font)
+		vita2d_free_font(font);
+	vita2d_fini();
+
+	return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef _PSP2_APPMGR_H_
+#define _PSP2_APPMGR_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SceAppMgrBudgetInfo {
+	int size;
+	int mode;
+	int unk0;
+	int budgetLPDDR2;
+	int freeLPDDR2;
+	int allow0x0E208060;
+	int unk1;
+	int budgetCDRAM;
+	int freeCDRAM;
+	int reserved[0x18];
+} SceAppMgrBudgetInfo;
+
+int sceAppMgrGetBudgetInfo(SceAppMgrBudgetInfo *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
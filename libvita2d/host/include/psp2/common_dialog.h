@@ -0,0 +1,34 @@
+#ifndef _PSP2_COMMON_DIALOG_H_
+#define _PSP2_COMMON_DIALOG_H_
+
+#include <psp2/types.h>
+#include <psp2/gxm.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SceCommonDialogRenderTargetInfo {
+	void *depthSurfaceData;
+	void *colorSurfaceData;
+	SceGxmColorSurfaceType surfaceType;
+	SceGxmColorFormat colorFormat;
+	SceUInt32 width;
+	SceUInt32 height;
+	SceUInt32 strideInPixels;
+	SceUInt8 reserved[32];
+} SceCommonDialogRenderTargetInfo;
+
+typedef struct SceCommonDialogUpdateParam {
+	SceCommonDialogRenderTargetInfo renderTarget;
+	SceGxmSyncObject *displaySyncObject;
+	SceUInt8 reserved[32];
+} SceCommonDialogUpdateParam;
+
+int sceCommonDialogUpdate(const SceCommonDialogUpdateParam *updateParam);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
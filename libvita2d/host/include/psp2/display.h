@@ -0,0 +1,30 @@
+#ifndef _PSP2_DISPLAY_H_
+#define _PSP2_DISPLAY_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCE_DISPLAY_PIXELFORMAT_A8B8G8R8	0x00000000
+#define SCE_DISPLAY_SETBUF_IMMEDIATE		0
+#define SCE_DISPLAY_SETBUF_NEXTFRAME		1
+
+typedef struct SceDisplayFrameBuf {
+	SceSize size;
+	void *base;
+	unsigned int pitch;
+	unsigned int pixelformat;
+	unsigned int width;
+	unsigned int height;
+} SceDisplayFrameBuf;
+
+int sceDisplaySetFrameBuf(const SceDisplayFrameBuf *pParam, int sync);
+int sceDisplayWaitVblankStart(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
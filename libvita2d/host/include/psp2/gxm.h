@@ -0,0 +1,520 @@
+#ifndef _PSP2_GXM_H_
+#define _PSP2_GXM_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCE_GXM_DEFAULT_PARAMETER_BUFFER_SIZE		0x01000000
+#define SCE_GXM_DEFAULT_VDM_RING_BUFFER_SIZE		0x00020000
+#define SCE_GXM_DEFAULT_VERTEX_RING_BUFFER_SIZE		0x00200000
+#define SCE_GXM_DEFAULT_FRAGMENT_RING_BUFFER_SIZE	0x00080000
+#define SCE_GXM_DEFAULT_FRAGMENT_USSE_RING_BUFFER_SIZE	0x00010000
+#define SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE		0x00000800
+
+#define SCE_GXM_TILE_SIZEX				32
+#define SCE_GXM_TILE_SIZEY				32
+
+#define SCE_GXM_COLOR_SURFACE_ALIGNMENT			4
+#define SCE_GXM_DEPTHSTENCIL_SURFACE_ALIGNMENT		16
+#define SCE_GXM_TEXTURE_ALIGNMENT			16
+#define SCE_GXM_PALETTE_ALIGNMENT			64
+
+typedef enum SceGxmMemoryAttribFlags {
+	SCE_GXM_MEMORY_ATTRIB_READ	= 1,
+	SCE_GXM_MEMORY_ATTRIB_WRITE	= 2,
+	SCE_GXM_MEMORY_ATTRIB_RW	= (SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE)
+} SceGxmMemoryAttribFlags;
+
+typedef enum SceGxmMultisampleMode {
+	SCE_GXM_MULTISAMPLE_NONE,
+	SCE_GXM_MULTISAMPLE_2X,
+	SCE_GXM_MULTISAMPLE_4X
+} SceGxmMultisampleMode;
+
+typedef enum SceGxmPrimitiveType {
+	SCE_GXM_PRIMITIVE_TRIANGLES		= 0x00000000,
+	SCE_GXM_PRIMITIVE_LINES			= 0x04000000,
+	SCE_GXM_PRIMITIVE_POINTS		= 0x08000000,
+	SCE_GXM_PRIMITIVE_TRIANGLE_STRIP	= 0x0C000000,
+	SCE_GXM_PRIMITIVE_TRIANGLE_FAN		= 0x10000000,
+	SCE_GXM_PRIMITIVE_TRIANGLE_EDGES	= 0x14000000
+} SceGxmPrimitiveType;
+
+typedef enum SceGxmIndexFormat {
+	SCE_GXM_INDEX_FORMAT_U16 = 0x00000000,
+	SCE_GXM_INDEX_FORMAT_U32 = 0x01000000
+} SceGxmIndexFormat;
+
+typedef enum SceGxmIndexSource {
+	SCE_GXM_INDEX_SOURCE_INDEX_16BIT	= 0x00000000,
+	SCE_GXM_INDEX_SOURCE_INDEX_32BIT	= 0x00000001,
+	SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT	= 0x00000002,
+	SCE_GXM_INDEX_SOURCE_INSTANCE_32BIT	= 0x00000003
+} SceGxmIndexSource;
+
+typedef enum SceGxmAttributeFormat {
+	SCE_GXM_ATTRIBUTE_FORMAT_U8,
+	SCE_GXM_ATTRIBUTE_FORMAT_S8,
+	SCE_GXM_ATTRIBUTE_FORMAT_U16,
+	SCE_GXM_ATTRIBUTE_FORMAT_S16,
+	SCE_GXM_ATTRIBUTE_FORMAT_U8N,
+	SCE_GXM_ATTRIBUTE_FORMAT_S8N,
+	SCE_GXM_ATTRIBUTE_FORMAT_U16N,
+	SCE_GXM_ATTRIBUTE_FORMAT_S16N,
+	SCE_GXM_ATTRIBUTE_FORMAT_F16,
+	SCE_GXM_ATTRIBUTE_FORMAT_F32
+} SceGxmAttributeFormat;
+
+typedef enum SceGxmPolygonMode {
+	SCE_GXM_POLYGON_MODE_TRIANGLE_FILL	= 0x00000000,
+	SCE_GXM_POLYGON_MODE_LINE		= 0x00008000,
+	SCE_GXM_POLYGON_MODE_POINT_10UV		= 0x00010000,
+	SCE_GXM_POLYGON_MODE_POINT		= 0x00018000,
+	SCE_GXM_POLYGON_MODE_POINT_01UV		= 0x00020000,
+	SCE_GXM_POLYGON_MODE_TRIANGLE_LINE	= 0x00028000,
+	SCE_GXM_POLYGON_MODE_TRIANGLE_POINT	= 0x00030000
+} SceGxmPolygonMode;
+
+typedef enum SceGxmStencilFunc {
+	SCE_GXM_STENCIL_FUNC_NEVER		= 0x00000000,
+	SCE_GXM_STENCIL_FUNC_LESS		= 0x02000000,
+	SCE_GXM_STENCIL_FUNC_EQUAL		= 0x04000000,
+	SCE_GXM_STENCIL_FUNC_LESS_EQUAL		= 0x06000000,
+	SCE_GXM_STENCIL_FUNC_GREATER		= 0x08000000,
+	SCE_GXM_STENCIL_FUNC_NOT_EQUAL		= 0x0A000000,
+	SCE_GXM_STENCIL_FUNC_GREATER_EQUAL	= 0x0C000000,
+	SCE_GXM_STENCIL_FUNC_ALWAYS		= 0x0E000000
+} SceGxmStencilFunc;
+
+typedef enum SceGxmStencilOp {
+	SCE_GXM_STENCIL_OP_KEEP			= 0x00000000,
+	SCE_GXM_STENCIL_OP_ZERO			= 0x00000001,
+	SCE_GXM_STENCIL_OP_REPLACE		= 0x00000002,
+	SCE_GXM_STENCIL_OP_INCR			= 0x00000003,
+	SCE_GXM_STENCIL_OP_DECR			= 0x00000004,
+	SCE_GXM_STENCIL_OP_INVERT		= 0x00000005,
+	SCE_GXM_STENCIL_OP_INCR_WRAP		= 0x00000006,
+	SCE_GXM_STENCIL_OP_DECR_WRAP		= 0x00000007
+} SceGxmStencilOp;
+
+typedef enum SceGxmRegionClipMode {
+	SCE_GXM_REGION_CLIP_NONE	= 0x00000000,
+	SCE_GXM_REGION_CLIP_ALL		= 0x40000000,
+	SCE_GXM_REGION_CLIP_OUTSIDE	= 0x80000000,
+	SCE_GXM_REGION_CLIP_INSIDE	= 0xC0000000
+} SceGxmRegionClipMode;
+
+typedef enum SceGxmBlendFunc {
+	SCE_GXM_BLEND_FUNC_NONE,
+	SCE_GXM_BLEND_FUNC_ADD,
+	SCE_GXM_BLEND_FUNC_SUBTRACT,
+	SCE_GXM_BLEND_FUNC_REVERSE_SUBTRACT
+} SceGxmBlendFunc;
+
+typedef enum SceGxmBlendFactor {
+	SCE_GXM_BLEND_FACTOR_ZERO,
+	SCE_GXM_BLEND_FACTOR_ONE,
+	SCE_GXM_BLEND_FACTOR_SRC_COLOR,
+	SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_COLOR,
+	SCE_GXM_BLEND_FACTOR_SRC_ALPHA,
+	SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+	SCE_GXM_BLEND_FACTOR_DST_COLOR,
+	SCE_GXM_BLEND_FACTOR_ONE_MINUS_DST_COLOR,
+	SCE_GXM_BLEND_FACTOR_DST_ALPHA,
+	SCE_GXM_BLEND_FACTOR_ONE_MINUS_DST_ALPHA
+} SceGxmBlendFactor;
+
+typedef enum SceGxmColorMask {
+	SCE_GXM_COLOR_MASK_NONE	= 0,
+	SCE_GXM_COLOR_MASK_A	= (1 << 0),
+	SCE_GXM_COLOR_MASK_R	= (1 << 1),
+	SCE_GXM_COLOR_MASK_G	= (1 << 2),
+	SCE_GXM_COLOR_MASK_B	= (1 << 3),
+	SCE_GXM_COLOR_MASK_ALL	= (SCE_GXM_COLOR_MASK_A | SCE_GXM_COLOR_MASK_B | SCE_GXM_COLOR_MASK_G | SCE_GXM_COLOR_MASK_R)
+} SceGxmColorMask;
+
+typedef struct SceGxmBlendInfo {
+	SceGxmColorMask colorMask;
+	SceGxmBlendFunc colorFunc : 4;
+	SceGxmBlendFunc alphaFunc : 4;
+	SceGxmBlendFactor colorSrc : 4;
+	SceGxmBlendFactor colorDst : 4;
+	SceGxmBlendFactor alphaSrc : 4;
+	SceGxmBlendFactor alphaDst : 4;
+} SceGxmBlendInfo;
+
+typedef enum SceGxmColorFormat {
+	SCE_GXM_COLOR_FORMAT_A8B8G8R8 = 0x00000000
+} SceGxmColorFormat;
+
+typedef enum SceGxmColorSurfaceType {
+	SCE_GXM_COLOR_SURFACE_LINEAR	= 0x00000000,
+	SCE_GXM_COLOR_SURFACE_TILED	= 0x04000000,
+	SCE_GXM_COLOR_SURFACE_SWIZZLED	= 0x08000000
+} SceGxmColorSurfaceType;
+
+typedef enum SceGxmColorSurfaceScaleMode {
+	SCE_GXM_COLOR_SURFACE_SCALE_NONE		= 0x00000000,
+	SCE_GXM_COLOR_SURFACE_SCALE_MSAA_DOWNSCALE	= 0x00000001
+} SceGxmColorSurfaceScaleMode;
+
+typedef enum SceGxmOutputRegisterSize {
+	SCE_GXM_OUTPUT_REGISTER_SIZE_32BIT,
+	SCE_GXM_OUTPUT_REGISTER_SIZE_64BIT
+} SceGxmOutputRegisterSize;
+
+typedef enum SceGxmOutputRegisterFormat {
+	SCE_GXM_OUTPUT_REGISTER_FORMAT_DECLARED,
+	SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4
+} SceGxmOutputRegisterFormat;
+
+typedef enum SceGxmDepthStencilFormat {
+	SCE_GXM_DEPTH_STENCIL_FORMAT_DF32	= 0x00044000,
+	SCE_GXM_DEPTH_STENCIL_FORMAT_S8		= 0x00022000,
+	SCE_GXM_DEPTH_STENCIL_FORMAT_D16	= 0x02444000,
+	SCE_GXM_DEPTH_STENCIL_FORMAT_S8D24	= 0x01266000
+} SceGxmDepthStencilFormat;
+
+typedef enum SceGxmDepthStencilSurfaceType {
+	SCE_GXM_DEPTH_STENCIL_SURFACE_LINEAR	= 0x00000000,
+	SCE_GXM_DEPTH_STENCIL_SURFACE_TILED	= 0x00011000
+} SceGxmDepthStencilSurfaceType;
+
+typedef enum SceGxmTextureSwizzle4Mode {
+	SCE_GXM_TEXTURE_SWIZZLE4_ABGR	= 0x00000000,
+	SCE_GXM_TEXTURE_SWIZZLE4_ARGB	= 0x00001000,
+	SCE_GXM_TEXTURE_SWIZZLE4_RGBA	= 0x00002000,
+	SCE_GXM_TEXTURE_SWIZZLE4_BGRA	= 0x00003000,
+	SCE_GXM_TEXTURE_SWIZZLE4_1BGR	= 0x00004000,
+	SCE_GXM_TEXTURE_SWIZZLE4_1RGB	= 0x00005000
+} SceGxmTextureSwizzle4Mode;
+
+typedef enum SceGxmTextureSwizzle3Mode {
+	SCE_GXM_TEXTURE_SWIZZLE3_BGR	= 0x00000000,
+	SCE_GXM_TEXTURE_SWIZZLE3_RGB	= 0x00001000
+} SceGxmTextureSwizzle3Mode;
+
+typedef enum SceGxmTextureSwizzle1Mode {
+	SCE_GXM_TEXTURE_SWIZZLE1_R	= 0x00000000,
+	SCE_GXM_TEXTURE_SWIZZLE1_000R	= 0x00001000,
+	SCE_GXM_TEXTURE_SWIZZLE1_111R	= 0x00002000,
+	SCE_GXM_TEXTURE_SWIZZLE1_RRRR	= 0x00003000,
+	SCE_GXM_TEXTURE_SWIZZLE1_0RRR	= 0x00004000,
+	SCE_GXM_TEXTURE_SWIZZLE1_1RRR	= 0x00005000,
+	SCE_GXM_TEXTURE_SWIZZLE1_R000	= 0x00006000,
+	SCE_GXM_TEXTURE_SWIZZLE1_R111	= 0x00007000
+} SceGxmTextureSwizzle1Mode;
+
+typedef enum SceGxmTextureBaseFormat {
+	SCE_GXM_TEXTURE_BASE_FORMAT_U8		= 0x00000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_S8		= 0x01000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U4U4U4U4	= 0x02000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U8U3U3U2	= 0x03000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U1U5U5U5	= 0x04000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U5U6U5	= 0x05000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_S5S5U6	= 0x06000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U8U8	= 0x07000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_S8S8	= 0x08000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U16		= 0x09000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_S16		= 0x0A000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_F16		= 0x0B000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8	= 0x0C000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_S8S8S8S8	= 0x0D000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U2U10U10U10	= 0x0E000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U16U16	= 0x0F000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_S16S16	= 0x10000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_F16F16	= 0x11000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_F32		= 0x12000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U32		= 0x13000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_S32		= 0x14000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP	= 0x80000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_PVRT4BPP	= 0x81000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP	= 0x82000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP	= 0x83000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_UBC1	= 0x85000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_UBC2	= 0x86000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_UBC3	= 0x87000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_P4		= 0x94000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_P8		= 0x95000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8	= 0x98000000,
+	SCE_GXM_TEXTURE_BASE_FORMAT_S8S8S8	= 0x99000000
+} SceGxmTextureBaseFormat;
+
+typedef enum SceGxmTextureFormat {
+	SCE_GXM_TEXTURE_FORMAT_U8_R111		= SCE_GXM_TEXTURE_BASE_FORMAT_U8 | SCE_GXM_TEXTURE_SWIZZLE1_R111,
+	SCE_GXM_TEXTURE_FORMAT_U8_R		= SCE_GXM_TEXTURE_BASE_FORMAT_U8 | SCE_GXM_TEXTURE_SWIZZLE1_R,
+	SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR	= SCE_GXM_TEXTURE_BASE_FORMAT_U4U4U4U4 | SCE_GXM_TEXTURE_SWIZZLE4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_U1U5U5U5_ABGR	= SCE_GXM_TEXTURE_BASE_FORMAT_U1U5U5U5 | SCE_GXM_TEXTURE_SWIZZLE4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR	= SCE_GXM_TEXTURE_BASE_FORMAT_U5U6U5 | SCE_GXM_TEXTURE_SWIZZLE3_BGR,
+	SCE_GXM_TEXTURE_FORMAT_U5U6U5_RGB	= SCE_GXM_TEXTURE_BASE_FORMAT_U5U6U5 | SCE_GXM_TEXTURE_SWIZZLE3_RGB,
+	SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR	= SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8 | SCE_GXM_TEXTURE_SWIZZLE4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_U8U8U8_BGR	= SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8 | SCE_GXM_TEXTURE_SWIZZLE3_BGR,
+	SCE_GXM_TEXTURE_FORMAT_U8U8U8_RGB	= SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8 | SCE_GXM_TEXTURE_SWIZZLE3_RGB,
+	SCE_GXM_TEXTURE_FORMAT_PVRT2BPP_ABGR	= SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP | SCE_GXM_TEXTURE_SWIZZLE4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_PVRT4BPP_ABGR	= SCE_GXM_TEXTURE_BASE_FORMAT_PVRT4BPP | SCE_GXM_TEXTURE_SWIZZLE4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_UBC1_ABGR	= SCE_GXM_TEXTURE_BASE_FORMAT_UBC1 | SCE_GXM_TEXTURE_SWIZZLE4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_UBC2_ABGR	= SCE_GXM_TEXTURE_BASE_FORMAT_UBC2 | SCE_GXM_TEXTURE_SWIZZLE4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_UBC3_ABGR	= SCE_GXM_TEXTURE_BASE_FORMAT_UBC3 | SCE_GXM_TEXTURE_SWIZZLE4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_P8_ABGR		= SCE_GXM_TEXTURE_BASE_FORMAT_P8 | SCE_GXM_TEXTURE_SWIZZLE4_ABGR,
+	SCE_GXM_TEXTURE_FORMAT_A8B8G8R8		= SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR
+} SceGxmTextureFormat;
+
+typedef enum SceGxmTextureType {
+	SCE_GXM_TEXTURE_SWIZZLED		= 0x00000000,
+	SCE_GXM_TEXTURE_CUBE			= 0x40000000,
+	SCE_GXM_TEXTURE_LINEAR			= 0x60000000,
+	SCE_GXM_TEXTURE_TILED			= 0x80000000,
+	SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY	= 0xA0000000,
+	SCE_GXM_TEXTURE_LINEAR_STRIDED		= 0xC0000000,
+	SCE_GXM_TEXTURE_CUBE_ARBITRARY		= 0xE0000000
+} SceGxmTextureType;
+
+typedef enum SceGxmTextureFilter {
+	SCE_GXM_TEXTURE_FILTER_POINT		= 0x00000000,
+	SCE_GXM_TEXTURE_FILTER_LINEAR		= 0x00000001,
+	SCE_GXM_TEXTURE_FILTER_MIPMAP_LINEAR	= 0x00000002,
+	SCE_GXM_TEXTURE_FILTER_MIPMAP_POINT	= 0x00000003
+} SceGxmTextureFilter;
+
+typedef enum SceGxmTextureMipFilter {
+	SCE_GXM_TEXTURE_MIP_FILTER_DISABLED	= 0x00000000,
+	SCE_GXM_TEXTURE_MIP_FILTER_ENABLED	= 0x00000200
+} SceGxmTextureMipFilter;
+
+typedef enum SceGxmTextureAddrMode {
+	SCE_GXM_TEXTURE_ADDR_REPEAT	= 0x00000000,
+	SCE_GXM_TEXTURE_ADDR_MIRROR	= 0x00000001,
+	SCE_GXM_TEXTURE_ADDR_CLAMP	= 0x00000002
+} SceGxmTextureAddrMode;
+
+/*
+ * The real SceGxmTexture packs everything into four control words, which
+ * can't hold 64-bit host pointers, so the shim keeps the fields unpacked.
+ */
+typedef struct SceGxmTexture {
+	uint32_t format;
+	uint32_t type;
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;
+	uint32_t mip_count;
+	uint32_t min_filter;
+	uint32_t mag_filter;
+	uint32_t mip_filter;
+	uint32_t u_addr_mode;
+	uint32_t v_addr_mode;
+	const void *data;
+	const void *palette;
+} SceGxmTexture;
+
+typedef struct SceGxmColorSurface {
+	unsigned int pbeSidebandWord;
+	unsigned int pbeEmitWords[6];
+	unsigned int outputRegisterSize;
+	SceGxmTexture backgroundTex;
+} SceGxmColorSurface;
+
+typedef struct SceGxmDepthStencilSurface {
+	unsigned int zlsControl;
+	void *depthData;
+	void *stencilData;
+	float backgroundDepth;
+	unsigned int backgroundControl;
+} SceGxmDepthStencilSurface;
+
+typedef struct SceGxmContext SceGxmContext;
+typedef struct SceGxmRenderTarget SceGxmRenderTarget;
+typedef struct SceGxmSyncObject SceGxmSyncObject;
+typedef struct SceGxmVertexProgram SceGxmVertexProgram;
+typedef struct SceGxmFragmentProgram SceGxmFragmentProgram;
+typedef struct SceGxmProgram SceGxmProgram;
+typedef struct SceGxmProgramParameter SceGxmProgramParameter;
+typedef struct SceGxmShaderPatcher SceGxmShaderPatcher;
+typedef struct SceGxmRegisteredProgram SceGxmRegisteredProgram;
+typedef SceGxmRegisteredProgram *SceGxmShaderPatcherId;
+typedef struct SceGxmNotification SceGxmNotification;
+
+typedef void (SceGxmDisplayQueueCallback)(const void *callbackData);
+
+typedef struct SceGxmInitializeParams {
+	unsigned int flags;
+	unsigned int displayQueueMaxPendingCount;
+	SceGxmDisplayQueueCallback *displayQueueCallback;
+	unsigned int displayQueueCallbackDataSize;
+	SceSize parameterBufferSize;
+} SceGxmInitializeParams;
+
+typedef struct SceGxmContextParams {
+	void *hostMem;
+	SceSize hostMemSize;
+	void *vdmRingBufferMem;
+	SceSize vdmRingBufferMemSize;
+	void *vertexRingBufferMem;
+	SceSize vertexRingBufferMemSize;
+	void *fragmentRingBufferMem;
+	SceSize fragmentRingBufferMemSize;
+	void *fragmentUsseRingBufferMem;
+	SceSize fragmentUsseRingBufferMemSize;
+	unsigned int fragmentUsseRingBufferOffset;
+} SceGxmContextParams;
+
+typedef struct SceGxmRenderTargetParams {
+	uint32_t flags;
+	uint16_t width;
+	uint16_t height;
+	uint16_t scenesPerFrame;
+	uint16_t multisampleMode;
+	uint32_t multisampleLocations;
+	SceUID driverMemBlock;
+} SceGxmRenderTargetParams;
+
+typedef struct SceGxmVertexAttribute {
+	unsigned short streamIndex;
+	unsigned short offset;
+	unsigned char format;
+	unsigned char componentCount;
+	unsigned short regIndex;
+} SceGxmVertexAttribute;
+
+typedef struct SceGxmVertexStream {
+	unsigned short stride;
+	unsigned short indexSource;
+} SceGxmVertexStream;
+
+typedef void *(SceGxmShaderPatcherHostAllocCallback)(void *userData, SceSize size);
+typedef void (SceGxmShaderPatcherHostFreeCallback)(void *userData, void *mem);
+typedef void *(SceGxmShaderPatcherBufferAllocCallback)(void *userData, SceSize size);
+typedef void (SceGxmShaderPatcherBufferFreeCallback)(void *userData, void *mem);
+typedef void *(SceGxmShaderPatcherUsseAllocCallback)(void *userData, SceSize size, unsigned int *usseOffset);
+typedef void (SceGxmShaderPatcherUsseFreeCallback)(void *userData, void *mem);
+
+typedef struct SceGxmShaderPatcherParams {
+	void *userData;
+	SceGxmShaderPatcherHostAllocCallback *hostAllocCallback;
+	SceGxmShaderPatcherHostFreeCallback *hostFreeCallback;
+	SceGxmShaderPatcherBufferAllocCallback *bufferAllocCallback;
+	SceGxmShaderPatcherBufferFreeCallback *bufferFreeCallback;
+	void *bufferMem;
+	SceSize bufferMemSize;
+	SceGxmShaderPatcherUsseAllocCallback *vertexUsseAllocCallback;
+	SceGxmShaderPatcherUsseFreeCallback *vertexUsseFreeCallback;
+	void *vertexUsseMem;
+	SceSize vertexUsseMemSize;
+	unsigned int vertexUsseOffset;
+	SceGxmShaderPatcherUsseAllocCallback *fragmentUsseAllocCallback;
+	SceGxmShaderPatcherUsseFreeCallback *fragmentUsseFreeCallback;
+	void *fragmentUsseMem;
+	SceSize fragmentUsseMemSize;
+	unsigned int fragmentUsseOffset;
+} SceGxmShaderPatcherParams;
+
+int sceGxmInitialize(const SceGxmInitializeParams *params);
+int sceGxmVshInitialize(const SceGxmInitializeParams *params);
+int sceGxmTerminate(void);
+
+int sceGxmMapMemory(void *base, SceSize size, SceGxmMemoryAttribFlags attr);
+int sceGxmUnmapMemory(void *base);
+int sceGxmMapVertexUsseMemory(void *base, SceSize size, unsigned int *offset);
+int sceGxmUnmapVertexUsseMemory(void *base);
+int sceGxmMapFragmentUsseMemory(void *base, SceSize size, unsigned int *offset);
+int sceGxmUnmapFragmentUsseMemory(void *base);
+
+int sceGxmCreateContext(const SceGxmContextParams *params, SceGxmContext **context);
+int sceGxmDestroyContext(SceGxmContext *context);
+int sceGxmCreateRenderTarget(const SceGxmRenderTargetParams *params, SceGxmRenderTarget **renderTarget);
+int sceGxmDestroyRenderTarget(SceGxmRenderTarget *renderTarget);
+int sceGxmSyncObjectCreate(SceGxmSyncObject **syncObject);
+int sceGxmSyncObjectDestroy(SceGxmSyncObject *syncObject);
+
+int sceGxmColorSurfaceInit(SceGxmColorSurface *surface, SceGxmColorFormat colorFormat, SceGxmColorSurfaceType surfaceType,
+			   SceGxmColorSurfaceScaleMode scaleMode, SceGxmOutputRegisterSize outputRegisterSize,
+			   unsigned int width, unsigned int height, unsigned int strideInPixels, void *data);
+int sceGxmDepthStencilSurfaceInit(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilFormat depthStencilFormat,
+				  SceGxmDepthStencilSurfaceType surfaceType, unsigned int strideInSamples,
+				  void *depthData, void *stencilData);
+
+int sceGxmBeginScene(SceGxmContext *context, unsigned int flags, const SceGxmRenderTarget *renderTarget,
+		     const void *validRegion, SceGxmSyncObject *vertexSyncObject, SceGxmSyncObject *fragmentSyncObject,
+		     const SceGxmColorSurface *colorSurface, const SceGxmDepthStencilSurface *depthStencil);
+int sceGxmEndScene(SceGxmContext *context, const SceGxmNotification *vertexNotification,
+		   const SceGxmNotification *fragmentNotification);
+void sceGxmFinish(SceGxmContext *context);
+int sceGxmDisplayQueueAddEntry(SceGxmSyncObject *oldBuffer, SceGxmSyncObject *newBuffer, const void *callbackData);
+int sceGxmDisplayQueueFinish(void);
+
+void sceGxmSetVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram);
+void sceGxmSetFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram);
+int sceGxmSetVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData);
+int sceGxmSetFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture);
+int sceGxmReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int sceGxmReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int sceGxmSetUniformDataF(void *uniformBuffer, const SceGxmProgramParameter *parameter,
+			  unsigned int componentOffset, unsigned int componentCount, const float *sourceData);
+int sceGxmDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType,
+	       const void *indexData, unsigned int indexCount);
+void sceGxmSetFrontPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode);
+void sceGxmSetBackPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode);
+void sceGxmSetFrontStencilFunc(SceGxmContext *context, SceGxmStencilFunc func, SceGxmStencilOp stencilFail,
+			       SceGxmStencilOp depthFail, SceGxmStencilOp depthPass,
+			       unsigned char compareMask, unsigned char writeMask);
+void sceGxmSetFrontStencilRef(SceGxmContext *context, unsigned int sref);
+void sceGxmSetRegionClip(SceGxmContext *context, SceGxmRegionClipMode mode, unsigned int xMin,
+			 unsigned int yMin, unsigned int xMax, unsigned int yMax);
+
+int sceGxmProgramCheck(const SceGxmProgram *program);
+const SceGxmProgramParameter *sceGxmProgramFindParameterByName(const SceGxmProgram *program, const char *name);
+unsigned int sceGxmProgramParameterGetResourceIndex(const SceGxmProgramParameter *parameter);
+
+int sceGxmShaderPatcherCreate(const SceGxmShaderPatcherParams *params, SceGxmShaderPatcher **shaderPatcher);
+int sceGxmShaderPatcherDestroy(SceGxmShaderPatcher *shaderPatcher);
+int sceGxmShaderPatcherRegisterProgram(SceGxmShaderPatcher *shaderPatcher, const SceGxmProgram *programHeader,
+				       SceGxmShaderPatcherId *programId);
+int sceGxmShaderPatcherUnregisterProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId);
+int sceGxmShaderPatcherCreateVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId,
+					   const SceGxmVertexAttribute *attributes, unsigned int attributeCount,
+					   const SceGxmVertexStream *streams, unsigned int streamCount,
+					   SceGxmVertexProgram **vertexProgram);
+int sceGxmShaderPatcherCreateFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId,
+					     SceGxmOutputRegisterFormat outputFormat, SceGxmMultisampleMode multisampleMode,
+					     const SceGxmBlendInfo *blendInfo, const SceGxmProgram *vertexProgram,
+					     SceGxmFragmentProgram **fragmentProgram);
+int sceGxmShaderPatcherReleaseVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmVertexProgram *vertexProgram);
+int sceGxmShaderPatcherReleaseFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmFragmentProgram *fragmentProgram);
+
+int sceGxmTextureInitLinear(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+			    unsigned int width, unsigned int height, unsigned int mipCount);
+int sceGxmTextureInitLinearStrided(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+				   unsigned int width, unsigned int height, unsigned int byteStride);
+int sceGxmTextureInitSwizzled(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+			      unsigned int width, unsigned int height, unsigned int mipCount);
+int sceGxmTextureInitSwizzledArbitrary(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+				       unsigned int width, unsigned int height, unsigned int mipCount);
+int sceGxmTextureInitTiled(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+			   unsigned int width, unsigned int height, unsigned int mipCount);
+SceGxmTextureType sceGxmTextureGetType(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetWidth(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetHeight(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetStride(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetMipmapCount(const SceGxmTexture *texture);
+SceGxmTextureFormat sceGxmTextureGetFormat(const SceGxmTexture *texture);
+void *sceGxmTextureGetData(const SceGxmTexture *texture);
+int sceGxmTextureSetData(SceGxmTexture *texture, const void *data);
+void *sceGxmTextureGetPalette(const SceGxmTexture *texture);
+int sceGxmTextureSetPalette(SceGxmTexture *texture, const void *paletteData);
+SceGxmTextureFilter sceGxmTextureGetMinFilter(const SceGxmTexture *texture);
+SceGxmTextureFilter sceGxmTextureGetMagFilter(const SceGxmTexture *texture);
+int sceGxmTextureSetMinFilter(SceGxmTexture *texture, SceGxmTextureFilter minFilter);
+int sceGxmTextureSetMagFilter(SceGxmTexture *texture, SceGxmTextureFilter magFilter);
+SceGxmTextureMipFilter sceGxmTextureGetMipFilter(const SceGxmTexture *texture);
+int sceGxmTextureSetMipFilter(SceGxmTexture *texture, SceGxmTextureMipFilter mipFilter);
+int sceGxmTextureSetUAddrMode(SceGxmTexture *texture, SceGxmTextureAddrMode mode);
+int sceGxmTextureSetVAddrMode(SceGxmTexture *texture, SceGxmTextureAddrMode mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _PSP2_IO_STAT_H_
+#define _PSP2_IO_STAT_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SceDateTime {
+	unsigned short year, month, day, hour, minute, second;
+	unsigned int microsecond;
+} SceDateTime;
+
+typedef struct SceIoStat {
+	int st_mode;
+	unsigned int st_attr;
+	SceOff st_size;
+	SceDateTime st_ctime;
+	SceDateTime st_atime;
+	SceDateTime st_mtime;
+	unsigned int st_private[6];
+} SceIoStat;
+
+int sceIoGetstat(const char *file, SceIoStat *stat);
+int sceIoGetstatByFd(SceUID fd, SceIoStat *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef _PSP2_KERNEL_PROCESSMGR_H_
+#define _PSP2_KERNEL_PROCESSMGR_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int sceKernelExitProcess(int res);
+SceUInt32 sceKernelGetProcessTimeLow(void);
+SceUInt64 sceKernelGetProcessTimeWide(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _PSP2_KERNEL_SYSMEM_H_
+#define _PSP2_KERNEL_SYSMEM_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum SceKernelMemBlockType {
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW          = 0x09408060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE        = 0x0C208060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_PHYCONT_RW   = 0x0C80D060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_PHYCONT_NC_RW = 0x0D808060,
+	SCE_KERNEL_MEMBLOCK_TYPE_USER_RW                = 0x0C20D060
+} SceKernelMemBlockType;
+
+typedef struct SceKernelAllocMemBlockOpt SceKernelAllocMemBlockOpt;
+
+SceUID sceKernelAllocMemBlock(const char *name, SceKernelMemBlockType type, SceSize size, SceKernelAllocMemBlockOpt *opt);
+int sceKernelFreeMemBlock(SceUID uid);
+int sceKernelGetMemBlockBase(SceUID uid, void **base);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
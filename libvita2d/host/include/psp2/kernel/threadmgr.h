@@ -0,0 +1,46 @@
+#ifndef _PSP2_KERNEL_THREADMGR_H_
+#define _PSP2_KERNEL_THREADMGR_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void *argp);
+
+typedef struct SceKernelLwMutexWork {
+	SceInt64 data[4];
+} SceKernelLwMutexWork;
+
+typedef struct SceKernelLwMutexOptParam SceKernelLwMutexOptParam;
+typedef struct SceKernelThreadOptParam SceKernelThreadOptParam;
+typedef struct SceKernelSemaOptParam SceKernelSemaOptParam;
+
+#define SCE_KERNEL_THREAD_CPU_AFFINITY_MASK_DEFAULT 0
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority,
+			     SceSize stackSize, SceUInt32 attr, int cpuAffinityMask,
+			     const SceKernelThreadOptParam *option);
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp);
+int sceKernelExitDeleteThread(int status);
+int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt32 *timeout);
+int sceKernelDeleteThread(SceUID thid);
+
+SceUID sceKernelCreateSema(const char *name, SceUInt32 attr, int initVal, int maxVal, SceKernelSemaOptParam *option);
+int sceKernelDeleteSema(SceUID semaid);
+int sceKernelSignalSema(SceUID semaid, int signal);
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt32 *timeout);
+
+int sceKernelCreateLwMutex(SceKernelLwMutexWork *pWork, const char *pName, unsigned int attr, int initCount, const SceKernelLwMutexOptParam *pOptParam);
+int sceKernelDeleteLwMutex(SceKernelLwMutexWork *pWork);
+int sceKernelLockLwMutex(SceKernelLwMutexWork *pWork, int lockCount, unsigned int *pTimeout);
+int sceKernelUnlockLwMutex(SceKernelLwMutexWork *pWork, int unlockCount);
+
+int sceKernelDelayThread(SceUInt32 delay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _PSP2_MESSAGE_DIALOG_H_
+#define _PSP2_MESSAGE_DIALOG_H_
+
+#include <psp2/common_dialog.h>
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef _PSP2_PGF_H_
+#define _PSP2_PGF_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum SceFontLanguageCode {
+	SCE_FONT_LANGUAGE_DEFAULT	= 0,
+	SCE_FONT_LANGUAGE_JAPANESE	= 1,
+	SCE_FONT_LANGUAGE_LATIN		= 2,
+	SCE_FONT_LANGUAGE_KOREAN	= 3,
+	SCE_FONT_LANGUAGE_CHINESE	= 4
+} SceFontLanguageCode;
+
+typedef enum SceFontPixelFormatCode {
+	SCE_FONT_PIXELFORMAT_4		= 0,
+	SCE_FONT_PIXELFORMAT_4_REV	= 1,
+	SCE_FONT_PIXELFORMAT_8		= 2,
+	SCE_FONT_PIXELFORMAT_24		= 3,
+	SCE_FONT_PIXELFORMAT_32		= 4
+} SceFontPixelFormatCode;
+
+typedef void *SceFontLibHandle;
+typedef void *SceFontHandle;
+
+typedef void *(*SceFontAllocFunc)(void *data, unsigned int size);
+typedef void (*SceFontFreeFunc)(void *data, void *p);
+
+typedef struct SceFontNewLibParams {
+	void *userDataAddr;
+	unsigned int numFonts;
+	void *cacheDataAddr;
+	SceFontAllocFunc allocFunc;
+	SceFontFreeFunc freeFunc;
+	void *openFunc;
+	void *closeFunc;
+	void *readFunc;
+	void *seekFunc;
+	void *errorFunc;
+	void *ioFinishFunc;
+} SceFontNewLibParams;
+
+typedef struct SceFontStyle {
+	float fontH;
+	float fontV;
+	float fontHRes;
+	float fontVRes;
+	float fontWeight;
+	unsigned short fontFamily;
+	unsigned short fontStyle;
+	unsigned short fontStyleSub;
+	unsigned short fontLanguage;
+	unsigned short fontRegion;
+	unsigned short fontCountry;
+	char fontName[64];
+	char fontFileName[64];
+	unsigned int fontAttributes;
+	unsigned int fontExpire;
+} SceFontStyle;
+
+typedef struct SceFontInfo {
+	int maxGlyphWidthI;
+	int maxGlyphHeightI;
+	int maxGlyphAscenderI;
+	int maxGlyphDescenderI;
+	int maxGlyphLeftXI;
+	int maxGlyphBaseYI;
+	int minGlyphCenterXI;
+	int maxGlyphTopYI;
+	int maxGlyphAdvanceXI;
+	int maxGlyphAdvanceYI;
+	float maxGlyphWidthF;
+	float maxGlyphHeightF;
+	float maxGlyphAscenderF;
+	float maxGlyphDescenderF;
+	float maxGlyphLeftXF;
+	float maxGlyphBaseYF;
+	float minGlyphCenterXF;
+	float maxGlyphTopYF;
+	float maxGlyphAdvanceXF;
+	float maxGlyphAdvanceYF;
+	short maxGlyphWidth;
+	short maxGlyphHeight;
+	unsigned short numChars;
+	short shadowMapLength;
+	SceFontStyle fontStyle;
+	unsigned char BPP;
+	unsigned char pad[3];
+} SceFontInfo;
+
+typedef struct SceFontCharInfo {
+	unsigned int bitmapWidth;
+	unsigned int bitmapHeight;
+	unsigned int bitmapLeft;
+	unsigned int bitmapTop;
+	unsigned int sfp26Width;
+	unsigned int sfp26Height;
+	int sfp26Ascender;
+	int sfp26Descender;
+	int sfp26BearingHX;
+	int sfp26BearingHY;
+	int sfp26BearingVX;
+	int sfp26BearingVY;
+	int sfp26AdvanceH;
+	int sfp26AdvanceV;
+	short shadowFlags;
+	short shadowId;
+} SceFontCharInfo;
+
+typedef struct SceFontGlyphImage {
+	SceFontPixelFormatCode pixelFormat;
+	int xPos64;
+	int yPos64;
+	unsigned short bufWidth;
+	unsigned short bufHeight;
+	unsigned short bytesPerLine;
+	unsigned short pad;
+	uintptr_t bufferPtr;		/* an unsigned int on the Vita, widened for 64 bit hosts */
+} SceFontGlyphImage;
+
+SceFontLibHandle sceFontNewLib(SceFontNewLibParams *params, unsigned int *errorCode);
+int sceFontDoneLib(SceFontLibHandle libHandle);
+int sceFontFindOptimumFont(SceFontLibHandle libHandle, SceFontStyle *fontStyle, unsigned int *errorCode);
+SceFontHandle sceFontOpen(SceFontLibHandle libHandle, int index, int mode, unsigned int *errorCode);
+SceFontHandle sceFontOpenUserFile(SceFontLibHandle libHandle, char *file, int mode, unsigned int *errorCode);
+int sceFontClose(SceFontHandle fontHandle);
+int sceFontGetFontInfo(SceFontHandle fontHandle, SceFontInfo *fontInfo);
+int sceFontGetCharInfo(SceFontHandle fontHandle, unsigned int charCode, SceFontCharInfo *charInfo);
+int sceFontGetCharGlyphImage(SceFontHandle fontHandle, unsigned int charCode, SceFontGlyphImage *glyphImage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
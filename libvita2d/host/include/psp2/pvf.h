@@ -0,0 +1,123 @@
+#ifndef _PSP2_PVF_H_
+#define _PSP2_PVF_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int ScePvfError;
+typedef void *ScePvfLibId;
+typedef void *ScePvfFontId;
+typedef int ScePvfFontIndex;
+typedef unsigned char ScePvfU8;
+typedef unsigned short ScePvfLanguageCode;
+
+#define SCE_PVF_DEFAULT_LANGUAGE_CODE	0
+#define SCE_PVF_DEFAULT_FAMILY_CODE	0
+#define SCE_PVF_DEFAULT_STYLE_CODE	0
+#define SCE_PVF_USERIMAGE_DIRECT8	0
+
+typedef void *(*ScePvfAllocFunc)(void *userData, unsigned int size);
+typedef void *(*ScePvfReallocFunc)(void *userData, void *old_ptr, unsigned int size);
+typedef void (*ScePvfFreeFunc)(void *userData, void *ptr);
+
+typedef struct ScePvfInitRec {
+	void *userData;
+	unsigned int maxNumFonts;
+	void *cache;
+	void *reserved;
+	ScePvfAllocFunc allocFunc;
+	ScePvfReallocFunc reallocFunc;
+	ScePvfFreeFunc freeFunc;
+} ScePvfInitRec;
+
+typedef struct ScePvfFontStyleInfo {
+	float weight;
+	unsigned short familyCode;
+	unsigned short style;
+	unsigned short subStyle;
+	unsigned short languageCode;
+	unsigned short regionCode;
+	unsigned short countryCode;
+	unsigned char fontName[64];
+	unsigned char styleName[64];
+	unsigned char fileName[64];
+	unsigned int extraAttributes;
+	unsigned int expireDate;
+} ScePvfFontStyleInfo;
+
+typedef struct ScePvfFontInfo {
+	int maxIGlyphMetrics[10];
+	float maxFGlyphMetrics[10];
+	unsigned short numChars;
+	ScePvfFontStyleInfo fontStyleInfo;
+	unsigned char reserved[4];
+} ScePvfFontInfo;
+
+typedef struct ScePvfIGlyphMetricsInfo {
+	unsigned int width64;
+	unsigned int height64;
+	int ascender64;
+	int descender64;
+	int horizontalBearingX64;
+	int horizontalBearingY64;
+	int verticalBearingX64;
+	int verticalBearingY64;
+	int horizontalAdvance64;
+	int verticalAdvance64;
+} ScePvfIGlyphMetricsInfo;
+
+typedef struct ScePvfCharInfo {
+	unsigned int bitmapWidth;
+	unsigned int bitmapHeight;
+	unsigned int bitmapLeft;
+	unsigned int bitmapTop;
+	ScePvfIGlyphMetricsInfo glyphMetrics;
+	unsigned char reserved0[4];
+	unsigned short reserved1;
+} ScePvfCharInfo;
+
+typedef struct ScePvfIrect {
+	unsigned short width;
+	unsigned short height;
+} ScePvfIrect;
+
+typedef struct ScePvfUserImageBufferRec {
+	unsigned int pixelFormat;
+	int xPos64;
+	int yPos64;
+	ScePvfIrect rect;
+	unsigned short bytesPerLine;
+	unsigned short reserved;
+	ScePvfU8 *buffer;
+} ScePvfUserImageBufferRec;
+
+typedef struct ScePvfKerningInfo {
+	struct {
+		float xOffset;
+		float yOffset;
+	} fKerningInfo;
+} ScePvfKerningInfo;
+
+ScePvfLibId scePvfNewLib(ScePvfInitRec *initParam, ScePvfError *errorCode);
+ScePvfError scePvfDoneLib(ScePvfLibId libID);
+ScePvfError scePvfSetEM(ScePvfLibId libID, float emValue);
+ScePvfError scePvfSetResolution(ScePvfLibId libID, float hResolution, float vResolution);
+ScePvfFontIndex scePvfFindOptimumFont(ScePvfLibId libID, ScePvfFontStyleInfo *fontStyleInfo, ScePvfError *errorCode);
+ScePvfFontId scePvfOpen(ScePvfLibId libID, ScePvfFontIndex fontIndex, unsigned int mode, ScePvfError *errorCode);
+ScePvfFontId scePvfOpenUserFile(ScePvfLibId libID, void *filename, unsigned int mode, ScePvfError *errorCode);
+ScePvfError scePvfClose(ScePvfFontId fontID);
+ScePvfError scePvfSetCharSize(ScePvfFontId fontID, float hSize, float vSize);
+ScePvfError scePvfGetFontInfo(ScePvfFontId fontID, ScePvfFontInfo *fontInfo);
+ScePvfError scePvfGetCharInfo(ScePvfFontId fontID, unsigned int character, ScePvfCharInfo *charInfo);
+ScePvfError scePvfGetCharImageRect(ScePvfFontId fontID, unsigned int character, ScePvfIrect *rect);
+ScePvfError scePvfGetCharGlyphImage(ScePvfFontId fontID, unsigned int character, ScePvfUserImageBufferRec *imageBuffer);
+ScePvfError scePvfGetKerningInfo(ScePvfFontId fontID, unsigned int leftCharacter, unsigned int rightCharacter, ScePvfKerningInfo *kerningInfo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _PSP2_SYSMODULE_H_
+#define _PSP2_SYSMODULE_H_
+
+#include <psp2/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCE_SYSMODULE_LOADED	0
+#define SCE_SYSMODULE_PGF	0x001E
+
+int sceSysmoduleLoadModule(SceUInt16 id);
+int sceSysmoduleUnloadModule(SceUInt16 id);
+int sceSysmoduleIsLoaded(SceUInt16 id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _PSP2_TYPES_H_
+#define _PSP2_TYPES_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int32_t SceUID;
+typedef int32_t SceInt32;
+typedef uint32_t SceUInt32;
+typedef int64_t SceInt64;
+typedef uint64_t SceUInt64;
+typedef uint8_t SceUInt8;
+typedef uint16_t SceUInt16;
+typedef int SceBool;
+typedef unsigned int SceSize;
+typedef int SceSSize;
+typedef int64_t SceOff;
+typedef int64_t SceIores;
+typedef uint16_t SceWChar16;
+typedef float SceFloat;
+typedef float SceFloat32;
+typedef char SceChar8;
+typedef SceUInt64 SceKernelSysClock;
+
+#endif
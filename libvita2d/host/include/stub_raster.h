@@ -0,0 +1,88 @@
+#ifndef STUB_RASTER_H
+#define STUB_RASTER_H
+
+#include <psp2/gxm.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reference rasterizer of the host build: runs the draws made on the stub
+ * sceGxm context on the CPU, into the color surface of the scene. The
+ * programs can't be run, so the ones of libvita2d are recognized by name
+ * (see stub_gxm.c) and their shading is done here.
+ */
+
+typedef enum raster_program {
+	RASTER_PROGRAM_UNKNOWN,
+	RASTER_PROGRAM_CLEAR,
+	RASTER_PROGRAM_COLOR,
+	RASTER_PROGRAM_TEXTURE,
+	RASTER_PROGRAM_TEXTURE_TINT
+} raster_program;
+
+typedef struct raster_attribute {
+	unsigned int offset;
+	unsigned int format;	/* SceGxmAttributeFormat */
+	unsigned int count;	/* 0 when the program has no such input */
+} raster_attribute;
+
+/* Where a vertex program reads its position and its color or texcoord */
+typedef struct raster_vertex_format {
+	raster_attribute position;
+	raster_attribute varying;
+	unsigned int stride;
+} raster_vertex_format;
+
+/* There's no depth test, so the depth fail op of sceGxm is never used */
+typedef struct raster_stencil {
+	SceGxmStencilFunc func;
+	SceGxmStencilOp fail_op;
+	SceGxmStencilOp pass_op;
+	unsigned char compare_mask;
+	unsigned char write_mask;
+	unsigned char ref;
+} raster_stencil;
+
+typedef struct raster_region_clip {
+	SceGxmRegionClipMode mode;
+	unsigned int x_min;
+	unsigned int y_min;
+	unsigned int x_max;
+	unsigned int y_max;
+} raster_region_clip;
+
+typedef struct raster_state {
+	raster_program vertex_program;
+	raster_program fragment_program;
+	raster_vertex_format format;
+	const SceGxmBlendInfo *blend;	/* NULL to write the fragment color as is */
+	const void *stream;
+	const float *vertex_uniforms;
+	const float *fragment_uniforms;
+	const SceGxmTexture *texture;
+	raster_stencil stencil;
+	raster_region_clip clip;
+} raster_state;
+
+raster_program raster_program_from_name(const char *name);
+
+/*
+ * The viewport covers the width x height of the render target. The stencil
+ * buffer starts at 0 every scene, like the hardware does when it isn't loaded.
+ */
+int raster_begin_scene(unsigned int width, unsigned int height, const SceGxmColorSurface *surface);
+void raster_end_scene();
+
+/* Returns 0 if the draw can't be run (unknown program or primitive) */
+int raster_draw(const raster_state *state, SceGxmPrimitiveType type, SceGxmIndexFormat index_format,
+		const void *indices, unsigned int count, unsigned int *fragments);
+
+void raster_fini();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
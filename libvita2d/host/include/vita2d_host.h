@@ -0,0 +1,36 @@
+#ifndef VITA2D_HOST_H
+#define VITA2D_HOST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Only in the host build (make host): counts of what the library asked
+ * the stub sceGxm for, to compare CPU-side changes without a Vita.
+ */
+typedef struct vita2d_host_gxm_stats {
+	unsigned int calls;	/* every sceGxm call made on the context */
+	unsigned int draws;
+	unsigned int indices;
+	unsigned int scenes;
+	unsigned int fragments;		/* pixels written by the rasterizer */
+	unsigned int skipped_draws;	/* draws the rasterizer couldn't run */
+} vita2d_host_gxm_stats;
+
+void vita2d_host_get_gxm_stats(vita2d_host_gxm_stats *stats);
+void vita2d_host_reset_gxm_stats();
+
+/*
+ * Runs the draws on the CPU into the color surfaces (display buffers and
+ * render target textures), to compare images rendered by different builds
+ * of the library. Off by default, the draws are then only counted.
+ */
+void vita2d_host_set_rasterizer(int enable);
+int vita2d_host_get_rasterizer();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,494 @@
+#include <stdlib.h>
+#include <string.h>
+#include <psp2/gxm.h>
+#include "vita2d_host.h"
+#include "stub_raster.h"
+
+/*
+ * No GPU: the context keeps the last state set on it, draws and scenes are
+ * counted and, with vita2d_host_set_rasterizer(), run by stub_raster.c.
+ * Textures and surfaces live in the memblocks of stub_kernel.c.
+ */
+
+struct SceGxmProgram {
+	const char *name;
+};
+
+struct SceGxmProgramParameter {
+	const char *name;
+	unsigned int resource_index;
+};
+
+struct SceGxmRegisteredProgram {
+	const SceGxmProgram *program;
+};
+
+struct SceGxmVertexProgram {
+	const SceGxmProgram *program;
+	raster_program kind;
+	raster_vertex_format format;
+};
+
+struct SceGxmFragmentProgram {
+	const SceGxmProgram *program;
+	raster_program kind;
+	SceGxmBlendInfo blend_info;
+	int has_blend;
+};
+
+struct SceGxmContext {
+	raster_state raster;
+	SceGxmTexture texture;
+	float vertex_uniforms[64];
+	float fragment_uniforms[64];
+};
+
+struct SceGxmRenderTarget {
+	SceGxmRenderTargetParams params;
+	struct SceGxmRenderTarget *next;
+};
+
+/* Only destroy render targets we handed out, callers may pass garbage */
+static SceGxmRenderTarget *render_targets;
+
+struct SceGxmSyncObject {
+	int dummy;
+};
+
+struct SceGxmShaderPatcher {
+	SceGxmShaderPatcherParams params;
+};
+
+const SceGxmProgram clear_v_gxp_start = {"clear_v"};
+const SceGxmProgram clear_f_gxp_start = {"clear_f"};
+const SceGxmProgram color_v_gxp_start = {"color_v"};
+const SceGxmProgram color_f_gxp_start = {"color_f"};
+const SceGxmProgram texture_v_gxp_start = {"texture_v"};
+const SceGxmProgram texture_f_gxp_start = {"texture_f"};
+const SceGxmProgram texture_tint_f_gxp_start = {"texture_tint_f"};
+
+static vita2d_host_gxm_stats stats;
+static int rasterize = 0;
+
+static const SceGxmProgramParameter parameters[] = {
+	{"aPosition", 0},
+	{"aColor", 1},
+	{"aTexcoord", 1},
+	{"wvp", 0},
+	{"uClearColor", 0},
+	{"uTintColor", 0},
+};
+
+int sceGxmInitialize(const SceGxmInitializeParams *params) { return 0; }
+int sceGxmVshInitialize(const SceGxmInitializeParams *params) { return 0; }
+int sceGxmTerminate(void)
+{
+	raster_fini();
+	return 0;
+}
+
+int sceGxmMapMemory(void *base, SceSize size, SceGxmMemoryAttribFlags attr) { return 0; }
+int sceGxmUnmapMemory(void *base) { return 0; }
+int sceGxmMapVertexUsseMemory(void *base, SceSize size, unsigned int *offset) { *offset = 0; return 0; }
+int sceGxmUnmapVertexUsseMemory(void *base) { return 0; }
+int sceGxmMapFragmentUsseMemory(void *base, SceSize size, unsigned int *offset) { *offset = 0; return 0; }
+int sceGxmUnmapFragmentUsseMemory(void *base) { return 0; }
+
+int sceGxmCreateContext(const SceGxmContextParams *params, SceGxmContext **context)
+{
+	*context = calloc(1, sizeof(**context));
+	if (!*context)
+		return -1;
+
+	(*context)->raster.vertex_uniforms = (*context)->vertex_uniforms;
+	(*context)->raster.fragment_uniforms = (*context)->fragment_uniforms;
+	(*context)->raster.stencil.func = SCE_GXM_STENCIL_FUNC_ALWAYS;
+	(*context)->raster.stencil.fail_op = SCE_GXM_STENCIL_OP_KEEP;
+	(*context)->raster.stencil.pass_op = SCE_GXM_STENCIL_OP_KEEP;
+	(*context)->raster.stencil.compare_mask = 0xFF;
+	(*context)->raster.stencil.write_mask = 0xFF;
+	(*context)->raster.clip.mode = SCE_GXM_REGION_CLIP_NONE;
+	return 0;
+}
+
+int sceGxmDestroyContext(SceGxmContext *context)
+{
+	free(context);
+	return 0;
+}
+
+int sceGxmCreateRenderTarget(const SceGxmRenderTargetParams *params, SceGxmRenderTarget **renderTarget)
+{
+	*renderTarget = calloc(1, sizeof(**renderTarget));
+	if (!*renderTarget)
+		return -1;
+	(*renderTarget)->params = *params;
+	(*renderTarget)->next = render_targets;
+	render_targets = *renderTarget;
+	return 0;
+}
+
+int sceGxmDestroyRenderTarget(SceGxmRenderTarget *renderTarget)
+{
+	SceGxmRenderTarget **p;
+	for (p = &render_targets; *p; p = &(*p)->next) {
+		if (*p == renderTarget) {
+			*p = renderTarget->next;
+			free(renderTarget);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+int sceGxmSyncObjectCreate(SceGxmSyncObject **syncObject)
+{
+	*syncObject = calloc(1, sizeof(**syncObject));
+	return 0;
+}
+
+int sceGxmSyncObjectDestroy(SceGxmSyncObject *syncObject)
+{
+	free(syncObject);
+	return 0;
+}
+
+int sceGxmColorSurfaceInit(SceGxmColorSurface *surface, SceGxmColorFormat colorFormat, SceGxmColorSurfaceType surfaceType,
+			   SceGxmColorSurfaceScaleMode scaleMode, SceGxmOutputRegisterSize outputRegisterSize,
+			   unsigned int width, unsigned int height, unsigned int strideInPixels, void *data)
+{
+	memset(surface, 0, sizeof(*surface));
+	surface->backgroundTex.data = data;
+	surface->backgroundTex.width = width;
+	surface->backgroundTex.height = height;
+	surface->backgroundTex.stride = strideInPixels * 4;
+	return 0;
+}
+
+int sceGxmDepthStencilSurfaceInit(SceGxmDepthStencilSurface *surface, SceGxmDepthStencilFormat depthStencilFormat,
+				  SceGxmDepthStencilSurfaceType surfaceType, unsigned int strideInSamples,
+				  void *depthData, void *stencilData)
+{
+	memset(surface, 0, sizeof(*surface));
+	surface->depthData = depthData;
+	surface->stencilData = stencilData;
+	return 0;
+}
+
+int sceGxmBeginScene(SceGxmContext *context, unsigned int flags, const SceGxmRenderTarget *renderTarget,
+		     const void *validRegion, SceGxmSyncObject *vertexSyncObject, SceGxmSyncObject *fragmentSyncObject,
+		     const SceGxmColorSurface *colorSurface, const SceGxmDepthStencilSurface *depthStencil)
+{
+	stats.calls++;
+	stats.scenes++;
+	if (rasterize)
+		raster_begin_scene(renderTarget->params.width, renderTarget->params.height, colorSurface);
+	return 0;
+}
+
+int sceGxmEndScene(SceGxmContext *context, const SceGxmNotification *vertexNotification,
+		   const SceGxmNotification *fragmentNotification)
+{
+	stats.calls++;
+	raster_end_scene();
+	return 0;
+}
+
+void sceGxmFinish(SceGxmContext *context) { }
+
+
+int sceGxmDisplayQueueAddEntry(SceGxmSyncObject *oldBuffer, SceGxmSyncObject *newBuffer, const void *callbackData)
+{
+	return 0;
+}
+
+int sceGxmDisplayQueueFinish(void) { return 0; }
+
+void sceGxmSetVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram)
+{
+	stats.calls++;
+	context->raster.vertex_program = vertexProgram->kind;
+	context->raster.format = vertexProgram->format;
+}
+
+void sceGxmSetFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram)
+{
+	stats.calls++;
+	context->raster.fragment_program = fragmentProgram->kind;
+	context->raster.blend = fragmentProgram->has_blend ? &fragmentProgram->blend_info : NULL;
+}
+
+int sceGxmSetVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData)
+{
+	stats.calls++;
+	context->raster.stream = streamData;
+	return 0;
+}
+
+int sceGxmSetFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture)
+{
+	stats.calls++;
+	context->texture = *texture;
+	context->raster.texture = &context->texture;
+	return 0;
+}
+
+int sceGxmReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer)
+{
+	stats.calls++;
+	*uniformBuffer = context->vertex_uniforms;
+	return 0;
+}
+
+int sceGxmReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer)
+{
+	stats.calls++;
+	*uniformBuffer = context->fragment_uniforms;
+	return 0;
+}
+
+int sceGxmSetUniformDataF(void *uniformBuffer, const SceGxmProgramParameter *parameter,
+			  unsigned int componentOffset, unsigned int componentCount, const float *sourceData)
+{
+	stats.calls++;
+	memcpy((float *)uniformBuffer + componentOffset, sourceData, componentCount * sizeof(float));
+	return 0;
+}
+
+int sceGxmDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType,
+	       const void *indexData, unsigned int indexCount)
+{
+	unsigned int fragments;
+
+	stats.calls++;
+	stats.draws++;
+	stats.indices += indexCount;
+
+	if (rasterize) {
+		if (raster_draw(&context->raster, primType, indexType, indexData, indexCount, &fragments))
+			stats.fragments += fragments;
+		else
+			stats.skipped_draws++;
+	}
+	return 0;
+}
+
+void sceGxmSetFrontPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode)
+{
+	stats.calls++;
+}
+
+void sceGxmSetBackPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode)
+{
+	stats.calls++;
+}
+
+void sceGxmSetFrontStencilFunc(SceGxmContext *context, SceGxmStencilFunc func, SceGxmStencilOp stencilFail,
+			       SceGxmStencilOp depthFail, SceGxmStencilOp depthPass,
+			       unsigned char compareMask, unsigned char writeMask)
+{
+	stats.calls++;
+	context->raster.stencil.func = func;
+	context->raster.stencil.fail_op = stencilFail;
+	context->raster.stencil.pass_op = depthPass;
+	context->raster.stencil.compare_mask = compareMask;
+	context->raster.stencil.write_mask = writeMask;
+}
+
+void sceGxmSetFrontStencilRef(SceGxmContext *context, unsigned int sref)
+{
+	stats.calls++;
+	context->raster.stencil.ref = sref;
+}
+
+void sceGxmSetRegionClip(SceGxmContext *context, SceGxmRegionClipMode mode, unsigned int xMin,
+			 unsigned int yMin, unsigned int xMax, unsigned int yMax)
+{
+	stats.calls++;
+	context->raster.clip.mode = mode;
+	context->raster.clip.x_min = xMin;
+	context->raster.clip.y_min = yMin;
+	context->raster.clip.x_max = xMax;
+	context->raster.clip.y_max = yMax;
+}
+
+int sceGxmProgramCheck(const SceGxmProgram *program) { return 0; }
+
+const SceGxmProgramParameter *sceGxmProgramFindParameterByName(const SceGxmProgram *program, const char *name)
+{
+	unsigned int i;
+	for (i = 0; i < sizeof(parameters) / sizeof(*parameters); i++) {
+		if (strcmp(parameters[i].name, name) == 0)
+			return &parameters[i];
+	}
+	return NULL;
+}
+
+unsigned int sceGxmProgramParameterGetResourceIndex(const SceGxmProgramParameter *parameter)
+{
+	return parameter->resource_index;
+}
+
+int sceGxmShaderPatcherCreate(const SceGxmShaderPatcherParams *params, SceGxmShaderPatcher **shaderPatcher)
+{
+	*shaderPatcher = calloc(1, sizeof(**shaderPatcher));
+	(*shaderPatcher)->params = *params;
+	return 0;
+}
+
+int sceGxmShaderPatcherDestroy(SceGxmShaderPatcher *shaderPatcher)
+{
+	free(shaderPatcher);
+	return 0;
+}
+
+int sceGxmShaderPatcherRegisterProgram(SceGxmShaderPatcher *shaderPatcher, const SceGxmProgram *programHeader,
+				       SceGxmShaderPatcherId *programId)
+{
+	*programId = calloc(1, sizeof(**programId));
+	(*programId)->program = programHeader;
+	return 0;
+}
+
+int sceGxmShaderPatcherUnregisterProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId)
+{
+	free(programId);
+	return 0;
+}
+
+int sceGxmShaderPatcherCreateVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId,
+					   const SceGxmVertexAttribute *attributes, unsigned int attributeCount,
+					   const SceGxmVertexStream *streams, unsigned int streamCount,
+					   SceGxmVertexProgram **vertexProgram)
+{
+	unsigned int i;
+
+	*vertexProgram = calloc(1, sizeof(**vertexProgram));
+	(*vertexProgram)->program = programId->program;
+	(*vertexProgram)->kind = raster_program_from_name(programId->program->name);
+
+	/* The position is resource 0, the color or texcoord resource 1 (see parameters) */
+	for (i = 0; i < attributeCount; i++) {
+		raster_attribute *attribute = attributes[i].regIndex == 0 ?
+			&(*vertexProgram)->format.position : &(*vertexProgram)->format.varying;
+		attribute->offset = attributes[i].offset;
+		attribute->format = attributes[i].format;
+		attribute->count = attributes[i].componentCount;
+	}
+	if (streamCount > 0)
+		(*vertexProgram)->format.stride = streams[0].stride;
+	return 0;
+}
+
+int sceGxmShaderPatcherCreateFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmShaderPatcherId programId,
+					     SceGxmOutputRegisterFormat outputFormat, SceGxmMultisampleMode multisampleMode,
+					     const SceGxmBlendInfo *blendInfo, const SceGxmProgram *vertexProgram,
+					     SceGxmFragmentProgram **fragmentProgram)
+{
+	*fragmentProgram = calloc(1, sizeof(**fragmentProgram));
+	(*fragmentProgram)->program = programId->program;
+	(*fragmentProgram)->kind = raster_program_from_name(programId->program->name);
+	if (blendInfo) {
+		(*fragmentProgram)->blend_info = *blendInfo;
+		(*fragmentProgram)->has_blend = 1;
+	}
+	return 0;
+}
+
+int sceGxmShaderPatcherReleaseVertexProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmVertexProgram *vertexProgram)
+{
+	free(vertexProgram);
+	return 0;
+}
+
+int sceGxmShaderPatcherReleaseFragmentProgram(SceGxmShaderPatcher *shaderPatcher, SceGxmFragmentProgram *fragmentProgram)
+{
+	free(fragmentProgram);
+	return 0;
+}
+
+static int texture_init(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+			unsigned int width, unsigned int height, unsigned int mipCount, SceGxmTextureType type)
+{
+	memset(texture, 0, sizeof(*texture));
+	texture->data = data;
+	texture->format = texFormat;
+	texture->width = width;
+	texture->height = height;
+	texture->mip_count = mipCount;
+	texture->type = type;
+	return 0;
+}
+
+int sceGxmTextureInitLinear(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+			    unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	return texture_init(texture, data, texFormat, width, height, mipCount, SCE_GXM_TEXTURE_LINEAR);
+}
+
+int sceGxmTextureInitLinearStrided(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+				   unsigned int width, unsigned int height, unsigned int byteStride)
+{
+	texture_init(texture, data, texFormat, width, height, 0, SCE_GXM_TEXTURE_LINEAR_STRIDED);
+	texture->stride = byteStride;
+	return 0;
+}
+
+int sceGxmTextureInitSwizzled(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+			      unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	return texture_init(texture, data, texFormat, width, height, mipCount, SCE_GXM_TEXTURE_SWIZZLED);
+}
+
+int sceGxmTextureInitSwizzledArbitrary(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+				       unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	return texture_init(texture, data, texFormat, width, height, mipCount, SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY);
+}
+
+int sceGxmTextureInitTiled(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat,
+			   unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	return texture_init(texture, data, texFormat, width, height, mipCount, SCE_GXM_TEXTURE_TILED);
+}
+
+SceGxmTextureType sceGxmTextureGetType(const SceGxmTexture *texture) { return texture->type; }
+unsigned int sceGxmTextureGetWidth(const SceGxmTexture *texture) { return texture->width; }
+unsigned int sceGxmTextureGetHeight(const SceGxmTexture *texture) { return texture->height; }
+unsigned int sceGxmTextureGetStride(const SceGxmTexture *texture) { return texture->stride; }
+unsigned int sceGxmTextureGetMipmapCount(const SceGxmTexture *texture) { return texture->mip_count; }
+SceGxmTextureFormat sceGxmTextureGetFormat(const SceGxmTexture *texture) { return texture->format; }
+void *sceGxmTextureGetData(const SceGxmTexture *texture) { return (void *)texture->data; }
+int sceGxmTextureSetData(SceGxmTexture *texture, const void *data) { texture->data = data; return 0; }
+void *sceGxmTextureGetPalette(const SceGxmTexture *texture) { return (void *)texture->palette; }
+int sceGxmTextureSetPalette(SceGxmTexture *texture, const void *paletteData) { texture->palette = paletteData; return 0; }
+SceGxmTextureFilter sceGxmTextureGetMinFilter(const SceGxmTexture *texture) { return texture->min_filter; }
+SceGxmTextureFilter sceGxmTextureGetMagFilter(const SceGxmTexture *texture) { return texture->mag_filter; }
+int sceGxmTextureSetMinFilter(SceGxmTexture *texture, SceGxmTextureFilter minFilter) { texture->min_filter = minFilter; return 0; }
+int sceGxmTextureSetMagFilter(SceGxmTexture *texture, SceGxmTextureFilter magFilter) { texture->mag_filter = magFilter; return 0; }
+SceGxmTextureMipFilter sceGxmTextureGetMipFilter(const SceGxmTexture *texture) { return texture->mip_filter; }
+int sceGxmTextureSetMipFilter(SceGxmTexture *texture, SceGxmTextureMipFilter mipFilter) { texture->mip_filter = mipFilter; return 0; }
+int sceGxmTextureSetUAddrMode(SceGxmTexture *texture, SceGxmTextureAddrMode mode) { texture->u_addr_mode = mode; return 0; }
+int sceGxmTextureSetVAddrMode(SceGxmTexture *texture, SceGxmTextureAddrMode mode) { texture->v_addr_mode = mode; return 0; }
+
+void vita2d_host_get_gxm_stats(vita2d_host_gxm_stats *out)
+{
+	*out = stats;
+}
+
+void vita2d_host_reset_gxm_stats()
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+void vita2d_host_set_rasterizer(int enable)
+{
+	rasterize = enable;
+	if (!enable)
+		raster_fini();
+}
+
+int vita2d_host_get_rasterizer()
+{
+	return rasterize;
+}
@@ -0,0 +1,81 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <psp2/io/fcntl.h>
+/* The POSIX st_* time macros clash with the SceIoStat field names */
+#undef st_atime
+#undef st_mtime
+#undef st_ctime
+#include <psp2/io/stat.h>
+
+/* File IO maps straight onto POSIX, UIDs are host file descriptors + 1 */
+
+SceUID sceIoOpen(const char *file, int flags, int mode)
+{
+	int oflags = 0;
+
+	if ((flags & SCE_O_RDWR) == SCE_O_RDWR)
+		oflags = O_RDWR;
+	else if (flags & SCE_O_WRONLY)
+		oflags = O_WRONLY;
+	else
+		oflags = O_RDONLY;
+	if (flags & SCE_O_CREAT)
+		oflags |= O_CREAT;
+	if (flags & SCE_O_TRUNC)
+		oflags |= O_TRUNC;
+	if (flags & SCE_O_APPEND)
+		oflags |= O_APPEND;
+
+	int fd = open(file, oflags, mode);
+	return fd < 0 ? 0x80010002 : fd + 1;
+}
+
+int sceIoClose(SceUID fd)
+{
+	return close(fd - 1);
+}
+
+int sceIoRead(SceUID fd, void *data, SceSize size)
+{
+	return read(fd - 1, data, size);
+}
+
+int sceIoWrite(SceUID fd, const void *data, SceSize size)
+{
+	return write(fd - 1, data, size);
+}
+
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence)
+{
+	return lseek(fd - 1, offset, whence);
+}
+
+static void fill_stat(SceIoStat *stat, const struct stat *st)
+{
+	memset(stat, 0, sizeof(*stat));
+	stat->st_mode = st->st_mode;
+	stat->st_size = st->st_size;
+	stat->st_mtime.year = 1970;
+	stat->st_mtime.second = st->st_mtim.tv_sec % 60;
+	stat->st_mtime.microsecond = (unsigned int)(st->st_mtim.tv_sec / 60);
+}
+
+int sceIoGetstat(const char *file, SceIoStat *stat)
+{
+	struct stat st;
+	if (lstat(file, &st) < 0)
+		return 0x80010002;
+	fill_stat(stat, &st);
+	return 0;
+}
+
+int sceIoGetstatByFd(SceUID fd, SceIoStat *stat)
+{
+	struct stat st;
+	if (fstat(fd - 1, &st) < 0)
+		return 0x80010002;
+	fill_stat(stat, &st);
+	return 0;
+}
@@ -0,0 +1,262 @@
+#include <sys/mman.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+#include <psp2/kernel/sysmem.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/kernel/processmgr.h>
+
+/*
+ * Kernel objects are kept in a small UID table, memblocks are backed by
+ * aligned host memory.
+ */
+
+#define MAX_UIDS 4096
+
+typedef enum { UID_FREE, UID_MEMBLOCK, UID_THREAD, UID_SEMA } uid_kind;
+
+typedef struct uid_object {
+	uid_kind kind;
+	union {
+		struct {
+			void *base;
+			SceSize size;
+		} memblock;
+		struct {
+			pthread_t thread;
+			SceKernelThreadEntry entry;
+			void *argp;
+			SceSize arglen;
+		} thread;
+		sem_t sema;
+	};
+} uid_object;
+
+static uid_object uids[MAX_UIDS];
+static pthread_mutex_t uid_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static SceUID uid_new(uid_kind kind)
+{
+	SceUID i;
+	pthread_mutex_lock(&uid_lock);
+	for (i = 1; i < MAX_UIDS; i++) {
+		if (uids[i].kind == UID_FREE) {
+			memset(&uids[i], 0, sizeof(uids[i]));
+			uids[i].kind = kind;
+			pthread_mutex_unlock(&uid_lock);
+			return i;
+		}
+	}
+	pthread_mutex_unlock(&uid_lock);
+	return -1;
+}
+
+static uid_object *uid_get(SceUID uid, uid_kind kind)
+{
+	if (uid <= 0 || uid >= MAX_UIDS || uids[uid].kind != kind)
+		return NULL;
+	return &uids[uid];
+}
+
+SceUID sceKernelAllocMemBlock(const char *name, SceKernelMemBlockType type, SceSize size, SceKernelAllocMemBlockOpt *opt)
+{
+	SceUID uid = uid_new(UID_MEMBLOCK);
+	if (uid < 0)
+		return 0x80020000;
+	uids[uid].memblock.base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (uids[uid].memblock.base == MAP_FAILED) {
+		uids[uid].kind = UID_FREE;
+		return 0x80020000;
+	}
+	uids[uid].memblock.size = size;
+	return uid;
+}
+
+int sceKernelFreeMemBlock(SceUID uid)
+{
+	uid_object *obj = uid_get(uid, UID_MEMBLOCK);
+	if (!obj)
+		return -1;
+	munmap(obj->memblock.base, obj->memblock.size);
+	obj->kind = UID_FREE;
+	return 0;
+}
+
+int sceKernelGetMemBlockBase(SceUID uid, void **base)
+{
+	uid_object *obj = uid_get(uid, UID_MEMBLOCK);
+	if (!obj)
+		return -1;
+	*base = obj->memblock.base;
+	return 0;
+}
+
+static void *thread_entry(void *arg)
+{
+	uid_object *obj = arg;
+	int ret = obj->thread.entry(obj->thread.arglen, obj->thread.argp);
+	return (void *)(intptr_t)ret;
+}
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority,
+			     SceSize stackSize, SceUInt32 attr, int cpuAffinityMask,
+			     const SceKernelThreadOptParam *option)
+{
+	SceUID uid = uid_new(UID_THREAD);
+	if (uid < 0)
+		return -1;
+	uids[uid].thread.entry = entry;
+	return uid;
+}
+
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp)
+{
+	uid_object *obj = uid_get(thid, UID_THREAD);
+	if (!obj)
+		return -1;
+	/* Like the kernel, copy the arguments to the new thread */
+	obj->thread.argp = malloc(arglen ? arglen : 1);
+	memcpy(obj->thread.argp, argp, arglen);
+	obj->thread.arglen = arglen;
+	return pthread_create(&obj->thread.thread, NULL, thread_entry, obj) == 0 ? 0 : -1;
+}
+
+int sceKernelExitDeleteThread(int status)
+{
+	pthread_exit((void *)(intptr_t)status);
+	return 0;
+}
+
+int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt32 *timeout)
+{
+	void *ret;
+	uid_object *obj = uid_get(thid, UID_THREAD);
+	if (!obj)
+		return -1;
+	pthread_join(obj->thread.thread, &ret);
+	if (stat)
+		*stat = (int)(intptr_t)ret;
+	return 0;
+}
+
+int sceKernelDeleteThread(SceUID thid)
+{
+	uid_object *obj = uid_get(thid, UID_THREAD);
+	if (!obj)
+		return -1;
+	free(obj->thread.argp);
+	obj->kind = UID_FREE;
+	return 0;
+}
+
+SceUID sceKernelCreateSema(const char *name, SceUInt32 attr, int initVal, int maxVal, SceKernelSemaOptParam *option)
+{
+	SceUID uid = uid_new(UID_SEMA);
+	if (uid < 0)
+		return -1;
+	sem_init(&uids[uid].sema, 0, initVal);
+	return uid;
+}
+
+int sceKernelDeleteSema(SceUID semaid)
+{
+	uid_object *obj = uid_get(semaid, UID_SEMA);
+	if (!obj)
+		return -1;
+	sem_destroy(&obj->sema);
+	obj->kind = UID_FREE;
+	return 0;
+}
+
+int sceKernelSignalSema(SceUID semaid, int signal)
+{
+	uid_object *obj = uid_get(semaid, UID_SEMA);
+	if (!obj)
+		return -1;
+	while (signal-- > 0)
+		sem_post(&obj->sema);
+	return 0;
+}
+
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt32 *timeout)
+{
+	uid_object *obj = uid_get(semaid, UID_SEMA);
+	if (!obj)
+		return -1;
+	while (signal-- > 0)
+		while (sem_wait(&obj->sema) != 0)
+			;
+	return 0;
+}
+
+/* LwMutexes are recursive pthread mutexes living in the work area */
+
+typedef struct lw_mutex {
+	pthread_mutex_t *mutex;
+} lw_mutex;
+
+int sceKernelCreateLwMutex(SceKernelLwMutexWork *pWork, const char *pName, unsigned int attr, int initCount, const SceKernelLwMutexOptParam *pOptParam)
+{
+	pthread_mutexattr_t mattr;
+	lw_mutex *m = (lw_mutex *)pWork;
+
+	m->mutex = malloc(sizeof(*m->mutex));
+	pthread_mutexattr_init(&mattr);
+	pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(m->mutex, &mattr);
+	pthread_mutexattr_destroy(&mattr);
+	while (initCount-- > 0)
+		pthread_mutex_lock(m->mutex);
+	return 0;
+}
+
+int sceKernelDeleteLwMutex(SceKernelLwMutexWork *pWork)
+{
+	lw_mutex *m = (lw_mutex *)pWork;
+	pthread_mutex_destroy(m->mutex);
+	free(m->mutex);
+	return 0;
+}
+
+int sceKernelLockLwMutex(SceKernelLwMutexWork *pWork, int lockCount, unsigned int *pTimeout)
+{
+	lw_mutex *m = (lw_mutex *)pWork;
+	while (lockCount-- > 0)
+		pthread_mutex_lock(m->mutex);
+	return 0;
+}
+
+int sceKernelUnlockLwMutex(SceKernelLwMutexWork *pWork, int unlockCount)
+{
+	lw_mutex *m = (lw_mutex *)pWork;
+	while (unlockCount-- > 0)
+		pthread_mutex_unlock(m->mutex);
+	return 0;
+}
+
+int sceKernelDelayThread(SceUInt32 delay)
+{
+	usleep(delay);
+	return 0;
+}
+
+int sceKernelExitProcess(int res)
+{
+	exit(res);
+}
+
+SceUInt64 sceKernelGetProcessTimeWide(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (SceUInt64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+SceUInt32 sceKernelGetProcessTimeLow(void)
+{
+	return (SceUInt32)sceKernelGetProcessTimeWide();
+}
@@ -0,0 +1,54 @@
+#include <string.h>
+#include <psp2/appmgr.h>
+#include <psp2/display.h>
+#include <psp2/sysmodule.h>
+#include <psp2/sharedfb.h>
+#include <psp2/common_dialog.h>
+#include <psp2/pgf.h>
+#include <psp2/pvf.h>
+
+/* Not a system app: a non-zero return keeps vita2d in regular mode */
+int sceAppMgrGetBudgetInfo(SceAppMgrBudgetInfo *info) { return -1; }
+
+int sceDisplaySetFrameBuf(const SceDisplayFrameBuf *pParam, int sync) { return 0; }
+int sceDisplayWaitVblankStart(void) { return 0; }
+
+int sceSysmoduleLoadModule(SceUInt16 id) { return 0; }
+int sceSysmoduleUnloadModule(SceUInt16 id) { return 0; }
+int sceSysmoduleIsLoaded(SceUInt16 id) { return SCE_SYSMODULE_LOADED; }
+
+SceUID sceSharedFbOpen(int index) { return -1; }
+int sceSharedFbClose(SceUID fb_id) { return 0; }
+int sceSharedFbBegin(SceUID fb_id, SceSharedFbInfo *info) { return 0; }
+int sceSharedFbEnd(SceUID fb_id) { return 0; }
+int sceSharedFbGetInfo(SceUID fb_id, SceSharedFbInfo *info) { return -1; }
+
+int sceCommonDialogUpdate(const SceCommonDialogUpdateParam *updateParam) { return 0; }
+
+/* The system font libraries are not available on the host */
+#define ERROR_NOT_AVAILABLE 0x80460001
+
+SceFontLibHandle sceFontNewLib(SceFontNewLibParams *params, unsigned int *errorCode) { *errorCode = ERROR_NOT_AVAILABLE; return NULL; }
+int sceFontDoneLib(SceFontLibHandle libHandle) { return 0; }
+int sceFontFindOptimumFont(SceFontLibHandle libHandle, SceFontStyle *fontStyle, unsigned int *errorCode) { *errorCode = ERROR_NOT_AVAILABLE; return -1; }
+SceFontHandle sceFontOpen(SceFontLibHandle libHandle, int index, int mode, unsigned int *errorCode) { *errorCode = ERROR_NOT_AVAILABLE; return NULL; }
+SceFontHandle sceFontOpenUserFile(SceFontLibHandle libHandle, char *file, int mode, unsigned int *errorCode) { *errorCode = ERROR_NOT_AVAILABLE; return NULL; }
+int sceFontClose(SceFontHandle fontHandle) { return 0; }
+int sceFontGetFontInfo(SceFontHandle fontHandle, SceFontInfo *fontInfo) { return ERROR_NOT_AVAILABLE; }
+int sceFontGetCharInfo(SceFontHandle fontHandle, unsigned int charCode, SceFontCharInfo *charInfo) { return ERROR_NOT_AVAILABLE; }
+int sceFontGetCharGlyphImage(SceFontHandle fontHandle, unsigned int charCode, SceFontGlyphImage *glyphImage) { return ERROR_NOT_AVAILABLE; }
+
+ScePvfLibId scePvfNewLib(ScePvfInitRec *initParam, ScePvfError *errorCode) { *errorCode = ERROR_NOT_AVAILABLE; return NULL; }
+ScePvfError scePvfDoneLib(ScePvfLibId libID) { return 0; }
+ScePvfError scePvfSetEM(ScePvfLibId libID, float emValue) { return 0; }
+ScePvfError scePvfSetResolution(ScePvfLibId libID, float hResolution, float vResolution) { return 0; }
+ScePvfFontIndex scePvfFindOptimumFont(ScePvfLibId libID, ScePvfFontStyleInfo *fontStyleInfo, ScePvfError *errorCode) { *errorCode = ERROR_NOT_AVAILABLE; return -1; }
+ScePvfFontId scePvfOpen(ScePvfLibId libID, ScePvfFontIndex fontIndex, unsigned int mode, ScePvfError *errorCode) { *errorCode = ERROR_NOT_AVAILABLE; return NULL; }
+ScePvfFontId scePvfOpenUserFile(ScePvfLibId libID, void *filename, unsigned int mode, ScePvfError *errorCode) { *errorCode = ERROR_NOT_AVAILABLE; return NULL; }
+ScePvfError scePvfClose(ScePvfFontId fontID) { return 0; }
+ScePvfError scePvfSetCharSize(ScePvfFontId fontID, float hSize, float vSize) { return 0; }
+ScePvfError scePvfGetFontInfo(ScePvfFontId fontID, ScePvfFontInfo *fontInfo) { return ERROR_NOT_AVAILABLE; }
+ScePvfError scePvfGetCharInfo(ScePvfFontId fontID, unsigned int character, ScePvfCharInfo *charInfo) { return ERROR_NOT_AVAILABLE; }
+ScePvfError scePvfGetCharImageRect(ScePvfFontId fontID, unsigned int character, ScePvfIrect *rect) { return ERROR_NOT_AVAILABLE; }
+ScePvfError scePvfGetCharGlyphImage(ScePvfFontId fontID, unsigned int character, ScePvfUserImageBufferRec *imageBuffer) { return ERROR_NOT_AVAILABLE; }
+ScePvfError scePvfGetKerningInfo(ScePvfFontId fontID, unsigned int leftCharacter, unsigned int rightCharacter, ScePvfKerningInfo *kerningInfo) { return ERROR_NOT_AVAILABLE; }
@@ -0,0 +1,1132 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stub_raster.h"
+#include "texture_layout.h"
+
+/*
+ * Triangles are set up in fixed point and walked a row at a time, the
+ * covered span of a row is found from the edge equations (top-left fill
+ * rule, pixel centers at +0.5). Spans are shaded SPAN_MAX pixels at a time
+ * through arrays of one channel each, so that every stage (interpolation,
+ * texture addressing and filtering, stencil, blending) is a plain loop the
+ * compiler can vectorize.
+ *
+ * It is a reference for comparing images across changes of the library, not
+ * a model of the GPU: no multisampling, no mip levels (the base level is
+ * sampled), interpolation is affine (vita2d's w is always 1) and points and
+ * lines are one pixel wide.
+ */
+
+#define SUBPIXEL_BITS	4
+#define SUBPIXEL_ONE	(1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF	(SUBPIXEL_ONE / 2)
+/* Vertices are clamped to this many pixels around the target, to stay in 64 bit */
+#define COORD_LIMIT	32768.0f
+#define SPAN_MAX	64
+#define MAX_ATTRIBUTES	4
+
+typedef struct raster_target {
+	uint32_t *pixels;
+	unsigned int width;
+	unsigned int height;
+	unsigned int stride;		/* in pixels */
+	float viewport_w;
+	float viewport_h;
+	unsigned char *stencil;
+	unsigned int stencil_size;
+} raster_target;
+
+typedef struct raster_vertex {
+	int64_t fx, fy;			/* window coordinates in subpixels */
+	float attr[MAX_ATTRIBUTES];
+	int valid;
+} raster_vertex;
+
+/* Attribute planes of a primitive, and the pixels it may write to */
+typedef struct raster_setup {
+	float origin_x;
+	float origin_y;
+	float attr[MAX_ATTRIBUTES];
+	float dx[MAX_ATTRIBUTES];
+	float dy[MAX_ATTRIBUTES];
+	SceGxmTextureFilter filter;
+	int x_min, y_min, x_max, y_max;	/* inclusive */
+} raster_setup;
+
+static raster_target target;
+static int scene_active = 0;
+
+static raster_vertex *vertices = NULL;
+static unsigned int max_vertices = 0;
+
+static const struct {
+	const char *name;
+	raster_program program;
+} program_names[] = {
+	{"clear_v", RASTER_PROGRAM_CLEAR},
+	{"clear_f", RASTER_PROGRAM_CLEAR},
+	{"color_v", RASTER_PROGRAM_COLOR},
+	{"color_f", RASTER_PROGRAM_COLOR},
+	{"texture_v", RASTER_PROGRAM_TEXTURE},
+	{"texture_f", RASTER_PROGRAM_TEXTURE},
+	{"texture_tint_f", RASTER_PROGRAM_TEXTURE_TINT},
+};
+
+raster_program raster_program_from_name(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(program_names) / sizeof(*program_names); i++) {
+		if (strcmp(program_names[i].name, name) == 0)
+			return program_names[i].program;
+	}
+
+	return RASTER_PROGRAM_UNKNOWN;
+}
+
+static inline int64_t floor_div(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+	if ((a % b) != 0 && a < 0)
+		q--;
+	return q;
+}
+
+static inline int64_t ceil_div(int64_t a, int64_t b)
+{
+	return -floor_div(-a, b);
+}
+
+/* floorf() that vectorizes without SSE4.1 */
+static inline int ifloor(float x)
+{
+	int i = (int)x;
+	return i - (x < i);
+}
+
+static inline float clamp01(float x)
+{
+	return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+static inline float clamp_coord(float x)
+{
+	return x < -COORD_LIMIT ? -COORD_LIMIT : (x > COORD_LIMIT ? COORD_LIMIT : x);
+}
+
+int raster_begin_scene(unsigned int width, unsigned int height, const SceGxmColorSurface *surface)
+{
+	unsigned int size;
+
+	if (!surface || !surface->backgroundTex.data)
+		return 0;
+
+	target.pixels = (uint32_t *)surface->backgroundTex.data;
+	target.width = surface->backgroundTex.width;
+	target.height = surface->backgroundTex.height;
+	target.stride = surface->backgroundTex.stride / 4;
+	target.viewport_w = width;
+	target.viewport_h = height;
+
+	size = target.width * target.height;
+	if (size > target.stencil_size) {
+		unsigned char *stencil = realloc(target.stencil, size);
+		if (!stencil)
+			return 0;
+		target.stencil = stencil;
+		target.stencil_size = size;
+	}
+	memset(target.stencil, 0, size);
+
+	scene_active = 1;
+	return 1;
+}
+
+void raster_end_scene()
+{
+	scene_active = 0;
+}
+
+void raster_fini()
+{
+	free(target.stencil);
+	free(vertices);
+	memset(&target, 0, sizeof(target));
+	vertices = NULL;
+	max_vertices = 0;
+	scene_active = 0;
+}
+
+/* Vertex fetch and the vertex programs */
+
+static float half_to_float(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1F;
+	uint32_t mant = h & 0x3FF;
+	uint32_t bits;
+	float f;
+
+	if (exp == 0) {
+		f = mant / 16777216.0f;	/* subnormal: mant * 2^-24 */
+		return sign ? -f : f;
+	}
+
+	if (exp == 31)
+		bits = sign | 0x7F800000 | (mant << 13);
+	else
+		bits = sign | ((exp + 112) << 23) | (mant << 13);
+
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static float read_component(const unsigned char *p, unsigned int format, unsigned int i)
+{
+	switch (format) {
+	case SCE_GXM_ATTRIBUTE_FORMAT_U8:
+		return p[i];
+	case SCE_GXM_ATTRIBUTE_FORMAT_S8:
+		return (signed char)p[i];
+	case SCE_GXM_ATTRIBUTE_FORMAT_U8N:
+		return p[i] / 255.0f;
+	case SCE_GXM_ATTRIBUTE_FORMAT_S8N:
+		return (signed char)p[i] / 127.0f;
+	case SCE_GXM_ATTRIBUTE_FORMAT_U16: {
+		uint16_t v;
+		memcpy(&v, p + 2 * i, sizeof(v));
+		return v;
+	}
+	case SCE_GXM_ATTRIBUTE_FORMAT_S16: {
+		int16_t v;
+		memcpy(&v, p + 2 * i, sizeof(v));
+		return v;
+	}
+	case SCE_GXM_ATTRIBUTE_FORMAT_U16N: {
+		uint16_t v;
+		memcpy(&v, p + 2 * i, sizeof(v));
+		return v / 65535.0f;
+	}
+	case SCE_GXM_ATTRIBUTE_FORMAT_S16N: {
+		int16_t v;
+		memcpy(&v, p + 2 * i, sizeof(v));
+		return v / 32767.0f;
+	}
+	case SCE_GXM_ATTRIBUTE_FORMAT_F16: {
+		uint16_t v;
+		memcpy(&v, p + 2 * i, sizeof(v));
+		return half_to_float(v);
+	}
+	case SCE_GXM_ATTRIBUTE_FORMAT_F32: {
+		float v;
+		memcpy(&v, p + 4 * i, sizeof(v));
+		return v;
+	}
+	default:
+		return 0.0f;
+	}
+}
+
+static void run_vertex_program(const raster_state *state, unsigned int index, raster_vertex *out)
+{
+	const raster_vertex_format *format = &state->format;
+	const unsigned char *p = (const unsigned char *)state->stream + index * format->stride;
+	float in[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+	float pos[4];
+	unsigned int i;
+
+	for (i = 0; i < format->position.count && i < 4; i++)
+		in[i] = read_component(p + format->position.offset, format->position.format, i);
+
+	if (state->vertex_program == RASTER_PROGRAM_CLEAR) {
+		/* float4(aPosition, 1.f, 1.f) */
+		pos[0] = in[0];
+		pos[1] = in[1];
+		pos[2] = 1.0f;
+		pos[3] = 1.0f;
+	} else {
+		/* mul(float4(aPosition, 1.f), wvp) */
+		const float *m = state->vertex_uniforms;
+		if (format->position.count < 4)
+			in[3] = 1.0f;
+		for (i = 0; i < 4; i++)
+			pos[i] = in[0] * m[i] + in[1] * m[4 + i] + in[2] * m[8 + i] + in[3] * m[12 + i];
+	}
+
+	for (i = 0; i < MAX_ATTRIBUTES; i++)
+		out->attr[i] = i < format->varying.count ?
+			read_component(p + format->varying.offset, format->varying.format, i) : 0.0f;
+
+	out->valid = pos[3] > 0.0f;
+	if (!out->valid)
+		return;
+
+	float x = (pos[0] / pos[3] + 1.0f) * 0.5f * target.viewport_w;
+	float y = (1.0f - pos[1] / pos[3]) * 0.5f * target.viewport_h;
+
+	/* Round to the subpixel grid */
+	out->fx = ifloor(clamp_coord(x) * SUBPIXEL_ONE + 0.5f);
+	out->fy = ifloor(clamp_coord(y) * SUBPIXEL_ONE + 0.5f);
+}
+
+/* Texture sampling */
+
+static void wrap_coords(int *c, int n, int size, SceGxmTextureAddrMode mode)
+{
+	int i;
+
+	switch (mode) {
+	case SCE_GXM_TEXTURE_ADDR_CLAMP:
+		for (i = 0; i < n; i++)
+			c[i] = c[i] < 0 ? 0 : (c[i] >= size ? size - 1 : c[i]);
+		break;
+	case SCE_GXM_TEXTURE_ADDR_MIRROR:
+		for (i = 0; i < n; i++) {
+			int m = c[i] % (2 * size);
+			if (m < 0)
+				m += 2 * size;
+			c[i] = m < size ? m : 2 * size - 1 - m;
+		}
+		break;
+	default:
+		if ((size & (size - 1)) == 0) {
+			for (i = 0; i < n; i++)
+				c[i] &= size - 1;
+		} else {
+			for (i = 0; i < n; i++) {
+				int m = c[i] % size;
+				c[i] = m < 0 ? m + size : m;
+			}
+		}
+		break;
+	}
+}
+
+static unsigned int texel_size(uint32_t format)
+{
+	switch (format & 0x9f000000U) {
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_P8:
+		return 1;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U4U4U4U4:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U1U5U5U5:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U5U6U5:
+		return 2;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8:
+		return 3;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static void texel_offsets(const SceGxmTexture *tex, const int *x, const int *y, unsigned int *offset, int n)
+{
+	unsigned int row, aligned_h;
+	int i;
+
+	switch (tex->type) {
+	case SCE_GXM_TEXTURE_LINEAR_STRIDED:
+		row = tex->stride / texel_size(tex->format);
+		break;
+	case SCE_GXM_TEXTURE_LINEAR:
+		texture_layout_dimensions(tex->type, tex->width, tex->height, &row, &aligned_h);
+		break;
+	default:
+		for (i = 0; i < n; i++)
+			offset[i] = texture_layout_offset(tex->type, tex->width, tex->height, x[i], y[i]);
+		return;
+	}
+
+	for (i = 0; i < n; i++)
+		offset[i] = y[i] * row + x[i];
+}
+
+/* Expands a channel of `bits` bits to 8 */
+static inline uint32_t expand_bits(uint32_t v, unsigned int bits)
+{
+	return (v * 255 + ((1U << bits) - 1) / 2) / ((1U << bits) - 1);
+}
+
+static uint32_t swizzle1(uint32_t format, uint32_t r)
+{
+	switch (format & 0x7000) {
+	case SCE_GXM_TEXTURE_SWIZZLE1_000R:
+		return r;
+	case SCE_GXM_TEXTURE_SWIZZLE1_111R:
+		return 0x00FFFFFF | (r << 24);
+	case SCE_GXM_TEXTURE_SWIZZLE1_RRRR:
+		return r * 0x01010101U;
+	case SCE_GXM_TEXTURE_SWIZZLE1_0RRR:
+		return r * 0x010101U;
+	case SCE_GXM_TEXTURE_SWIZZLE1_1RRR:
+		return 0xFF000000 | r * 0x010101U;
+	case SCE_GXM_TEXTURE_SWIZZLE1_R000:
+		return r << 24;
+	case SCE_GXM_TEXTURE_SWIZZLE1_R111:
+		return (r << 24) | 0x00FFFFFF;
+	default:	/* R */
+		return 0xFF000000 | r;
+	}
+}
+
+/*
+ * Texels as A8B8G8R8 (R in the low byte). The component names of the
+ * formats go from the most to the least significant bits. Formats the
+ * library doesn't create come out magenta.
+ */
+static void fetch_texels(const SceGxmTexture *tex, const unsigned int *offset, uint32_t *out, int n)
+{
+	const unsigned char *data = tex->data;
+	uint32_t format = tex->format;
+	int i;
+
+	switch (format & 0x9f000000U) {
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8:
+		for (i = 0; i < n; i++)
+			memcpy(&out[i], data + offset[i] * 4, 4);
+		if ((format & 0x7000) == SCE_GXM_TEXTURE_SWIZZLE4_ARGB) {
+			for (i = 0; i < n; i++)
+				out[i] = (out[i] & 0xFF00FF00) | ((out[i] >> 16) & 0xFF) | ((out[i] & 0xFF) << 16);
+		}
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8:
+		for (i = 0; i < n; i++) {
+			const unsigned char *p = data + offset[i] * 3;
+			if ((format & 0x7000) == SCE_GXM_TEXTURE_SWIZZLE3_RGB)
+				out[i] = 0xFF000000 | (p[0] << 16) | (p[1] << 8) | p[2];
+			else
+				out[i] = 0xFF000000 | (p[2] << 16) | (p[1] << 8) | p[0];
+		}
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8:
+		for (i = 0; i < n; i++)
+			out[i] = swizzle1(format, data[offset[i]]);
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_P8: {
+		const uint32_t *palette = tex->palette;
+		for (i = 0; i < n; i++)
+			out[i] = palette ? palette[data[offset[i]]] : 0;
+		break;
+	}
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U5U6U5:
+		for (i = 0; i < n; i++) {
+			uint16_t v;
+			uint32_t hi, lo;
+			memcpy(&v, data + offset[i] * 2, 2);
+			hi = expand_bits(v >> 11, 5);
+			lo = expand_bits(v & 0x1F, 5);
+			if ((format & 0x7000) == SCE_GXM_TEXTURE_SWIZZLE3_RGB)
+				out[i] = 0xFF000000 | (lo << 16) | (expand_bits((v >> 5) & 0x3F, 6) << 8) | hi;
+			else
+				out[i] = 0xFF000000 | (hi << 16) | (expand_bits((v >> 5) & 0x3F, 6) << 8) | lo;
+		}
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U4U4U4U4:
+		for (i = 0; i < n; i++) {
+			uint16_t v;
+			memcpy(&v, data + offset[i] * 2, 2);
+			out[i] = ((v >> 12) & 0xF) * 0x11000000U | ((v >> 8) & 0xF) * 0x110000U |
+				 ((v >> 4) & 0xF) * 0x1100U | (v & 0xF) * 0x11U;
+		}
+		break;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U1U5U5U5:
+		for (i = 0; i < n; i++) {
+			uint16_t v;
+			memcpy(&v, data + offset[i] * 2, 2);
+			out[i] = ((v & 0x8000) ? 0xFF000000 : 0) | (expand_bits((v >> 10) & 0x1F, 5) << 16) |
+				 (expand_bits((v >> 5) & 0x1F, 5) << 8) | expand_bits(v & 0x1F, 5);
+		}
+		break;
+	default:
+		for (i = 0; i < n; i++)
+			out[i] = 0xFFFF00FF;
+		break;
+	}
+}
+
+static void unpack_rgba(const uint32_t *texels, float *rgba[4], int n)
+{
+	int i, c;
+
+	for (c = 0; c < 4; c++) {
+		float *out = rgba[c];
+		for (i = 0; i < n; i++)
+			out[i] = ((texels[i] >> (8 * c)) & 0xFF) * (1.0f / 255.0f);
+	}
+}
+
+static void sample_texture(const SceGxmTexture *tex, SceGxmTextureFilter filter,
+			   const float *u, const float *v, float *rgba[4], int n)
+{
+	const int w = tex->width, h = tex->height;
+	int x0[SPAN_MAX], y0[SPAN_MAX], x1[SPAN_MAX], y1[SPAN_MAX];
+	unsigned int offset[SPAN_MAX];
+	uint32_t texels[SPAN_MAX];
+	int i, c;
+
+	if (!tex->data || !texel_size(tex->format)) {
+		for (c = 0; c < 4; c++) {
+			for (i = 0; i < n; i++)
+				rgba[c][i] = (c == 1) ? 0.0f : 1.0f;
+		}
+		return;
+	}
+
+	if (filter == SCE_GXM_TEXTURE_FILTER_POINT || filter == SCE_GXM_TEXTURE_FILTER_MIPMAP_POINT) {
+		for (i = 0; i < n; i++) {
+			x0[i] = ifloor(u[i] * w);
+			y0[i] = ifloor(v[i] * h);
+		}
+		wrap_coords(x0, n, w, tex->u_addr_mode);
+		wrap_coords(y0, n, h, tex->v_addr_mode);
+		texel_offsets(tex, x0, y0, offset, n);
+		fetch_texels(tex, offset, texels, n);
+		unpack_rgba(texels, rgba, n);
+		return;
+	}
+
+	/* Bilinear: the four texels around the sample, weighted by its position between their centers */
+	float fx[SPAN_MAX], fy[SPAN_MAX];
+	float t00[4][SPAN_MAX], t10[4][SPAN_MAX], t01[4][SPAN_MAX], t11[4][SPAN_MAX];
+	float *p00[4] = {t00[0], t00[1], t00[2], t00[3]};
+	float *p10[4] = {t10[0], t10[1], t10[2], t10[3]};
+	float *p01[4] = {t01[0], t01[1], t01[2], t01[3]};
+	float *p11[4] = {t11[0], t11[1], t11[2], t11[3]};
+
+	for (i = 0; i < n; i++) {
+		float su = u[i] * w - 0.5f;
+		float sv = v[i] * h - 0.5f;
+		x0[i] = ifloor(su);
+		y0[i] = ifloor(sv);
+		fx[i] = su - x0[i];
+		fy[i] = sv - y0[i];
+		x1[i] = x0[i] + 1;
+		y1[i] = y0[i] + 1;
+	}
+
+	wrap_coords(x0, n, w, tex->u_addr_mode);
+	wrap_coords(x1, n, w, tex->u_addr_mode);
+	wrap_coords(y0, n, h, tex->v_addr_mode);
+	wrap_coords(y1, n, h, tex->v_addr_mode);
+
+	texel_offsets(tex, x0, y0, offset, n);
+	fetch_texels(tex, offset, texels, n);
+	unpack_rgba(texels, p00, n);
+	texel_offsets(tex, x1, y0, offset, n);
+	fetch_texels(tex, offset, texels, n);
+	unpack_rgba(texels, p10, n);
+	texel_offsets(tex, x0, y1, offset, n);
+	fetch_texels(tex, offset, texels, n);
+	unpack_rgba(texels, p01, n);
+	texel_offsets(tex, x1, y1, offset, n);
+	fetch_texels(tex, offset, texels, n);
+	unpack_rgba(texels, p11, n);
+
+	for (c = 0; c < 4; c++) {
+		float *out = rgba[c];
+		for (i = 0; i < n; i++) {
+			float top = t00[c][i] + (t10[c][i] - t00[c][i]) * fx[i];
+			float bottom = t01[c][i] + (t11[c][i] - t01[c][i]) * fx[i];
+			out[i] = top + (bottom - top) * fy[i];
+		}
+	}
+}
+
+/* The region clip works on whole tiles, the ones the rectangle touches */
+static void region_clip_rect(const raster_region_clip *clip, int *x_min, int *y_min, int *x_max, int *y_max)
+{
+	*x_min = clip->x_min & ~(SCE_GXM_TILE_SIZEX - 1);
+	*y_min = clip->y_min & ~(SCE_GXM_TILE_SIZEY - 1);
+	*x_max = clip->x_max | (SCE_GXM_TILE_SIZEX - 1);
+	*y_max = clip->y_max | (SCE_GXM_TILE_SIZEY - 1);
+}
+
+/* Stencil */
+
+static void stencil_compare(SceGxmStencilFunc func, unsigned int ref, unsigned char compare_mask,
+			    const unsigned char *values, unsigned char *pass, int n)
+{
+	int i;
+
+	switch (func) {
+	case SCE_GXM_STENCIL_FUNC_NEVER:
+		for (i = 0; i < n; i++)
+			pass[i] = 0;
+		break;
+	case SCE_GXM_STENCIL_FUNC_LESS:
+		for (i = 0; i < n; i++)
+			pass[i] = ref < (values[i] & compare_mask);
+		break;
+	case SCE_GXM_STENCIL_FUNC_EQUAL:
+		for (i = 0; i < n; i++)
+			pass[i] = ref == (values[i] & compare_mask);
+		break;
+	case SCE_GXM_STENCIL_FUNC_LESS_EQUAL:
+		for (i = 0; i < n; i++)
+			pass[i] = ref <= (values[i] & compare_mask);
+		break;
+	case SCE_GXM_STENCIL_FUNC_GREATER:
+		for (i = 0; i < n; i++)
+			pass[i] = ref > (values[i] & compare_mask);
+		break;
+	case SCE_GXM_STENCIL_FUNC_NOT_EQUAL:
+		for (i = 0; i < n; i++)
+			pass[i] = ref != (values[i] & compare_mask);
+		break;
+	case SCE_GXM_STENCIL_FUNC_GREATER_EQUAL:
+		for (i = 0; i < n; i++)
+			pass[i] = ref >= (values[i] & compare_mask);
+		break;
+	default:	/* ALWAYS */
+		for (i = 0; i < n; i++)
+			pass[i] = 1;
+		break;
+	}
+}
+
+static void stencil_op(SceGxmStencilOp op, unsigned char ref, const unsigned char *values, unsigned char *out, int n)
+{
+	int i;
+
+	switch (op) {
+	case SCE_GXM_STENCIL_OP_ZERO:
+		for (i = 0; i < n; i++)
+			out[i] = 0;
+		break;
+	case SCE_GXM_STENCIL_OP_REPLACE:
+		for (i = 0; i < n; i++)
+			out[i] = ref;
+		break;
+	case SCE_GXM_STENCIL_OP_INCR:
+		for (i = 0; i < n; i++)
+			out[i] = values[i] < 0xFF ? values[i] + 1 : 0xFF;
+		break;
+	case SCE_GXM_STENCIL_OP_DECR:
+		for (i = 0; i < n; i++)
+			out[i] = values[i] > 0 ? values[i] - 1 : 0;
+		break;
+	case SCE_GXM_STENCIL_OP_INVERT:
+		for (i = 0; i < n; i++)
+			out[i] = ~values[i];
+		break;
+	case SCE_GXM_STENCIL_OP_INCR_WRAP:
+		for (i = 0; i < n; i++)
+			out[i] = values[i] + 1;
+		break;
+	case SCE_GXM_STENCIL_OP_DECR_WRAP:
+		for (i = 0; i < n; i++)
+			out[i] = values[i] - 1;
+		break;
+	default:	/* KEEP */
+		for (i = 0; i < n; i++)
+			out[i] = values[i];
+		break;
+	}
+}
+
+/* One switch per span rather than per pixel, so that the loops vectorize */
+static void stencil_test(const raster_stencil *stencil, unsigned char *values, unsigned char *mask, int n)
+{
+	const unsigned char write_mask = stencil->write_mask;
+	unsigned char pass[SPAN_MAX], pass_values[SPAN_MAX], fail_values[SPAN_MAX];
+	int i;
+
+	if (stencil->func == SCE_GXM_STENCIL_FUNC_ALWAYS && stencil->pass_op == SCE_GXM_STENCIL_OP_KEEP)
+		return;
+
+	stencil_compare(stencil->func, stencil->ref & stencil->compare_mask, stencil->compare_mask, values, pass, n);
+	stencil_op(stencil->pass_op, stencil->ref, values, pass_values, n);
+	stencil_op(stencil->fail_op, stencil->ref, values, fail_values, n);
+
+	for (i = 0; i < n; i++) {
+		unsigned char result = pass[i] ? pass_values[i] : fail_values[i];
+		result = mask[i] ? result : values[i];
+		values[i] = (values[i] & ~write_mask) | (result & write_mask);
+		mask[i] &= pass[i];
+	}
+}
+
+/* Blending */
+
+static void blend_factor(SceGxmBlendFactor factor, int channel, float *src[4], float *dst[4], float *out, int n)
+{
+	int i;
+
+	switch (factor) {
+	case SCE_GXM_BLEND_FACTOR_ZERO:
+		for (i = 0; i < n; i++)
+			out[i] = 0.0f;
+		break;
+	case SCE_GXM_BLEND_FACTOR_SRC_COLOR:
+		for (i = 0; i < n; i++)
+			out[i] = src[channel][i];
+		break;
+	case SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_COLOR:
+		for (i = 0; i < n; i++)
+			out[i] = 1.0f - src[channel][i];
+		break;
+	case SCE_GXM_BLEND_FACTOR_SRC_ALPHA:
+		for (i = 0; i < n; i++)
+			out[i] = src[3][i];
+		break;
+	case SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA:
+		for (i = 0; i < n; i++)
+			out[i] = 1.0f - src[3][i];
+		break;
+	case SCE_GXM_BLEND_FACTOR_DST_COLOR:
+		for (i = 0; i < n; i++)
+			out[i] = dst[channel][i];
+		break;
+	case SCE_GXM_BLEND_FACTOR_ONE_MINUS_DST_COLOR:
+		for (i = 0; i < n; i++)
+			out[i] = 1.0f - dst[channel][i];
+		break;
+	case SCE_GXM_BLEND_FACTOR_DST_ALPHA:
+		for (i = 0; i < n; i++)
+			out[i] = dst[3][i];
+		break;
+	case SCE_GXM_BLEND_FACTOR_ONE_MINUS_DST_ALPHA:
+		for (i = 0; i < n; i++)
+			out[i] = 1.0f - dst[3][i];
+		break;
+	default:	/* ONE */
+		for (i = 0; i < n; i++)
+			out[i] = 1.0f;
+		break;
+	}
+}
+
+static void blend(const SceGxmBlendInfo *info, float *src[4], float *dst[4], int n)
+{
+	float sf[4][SPAN_MAX], df[4][SPAN_MAX];
+	int i, c;
+
+	for (c = 0; c < 4; c++) {
+		blend_factor(c < 3 ? info->colorSrc : info->alphaSrc, c, src, dst, sf[c], n);
+		blend_factor(c < 3 ? info->colorDst : info->alphaDst, c, src, dst, df[c], n);
+	}
+
+	/* Computed into src, which the factors above were taken from */
+	for (c = 0; c < 4; c++) {
+		float *s = src[c];
+		const float *d = dst[c];
+
+		switch (c < 3 ? info->colorFunc : info->alphaFunc) {
+		case SCE_GXM_BLEND_FUNC_ADD:
+			for (i = 0; i < n; i++)
+				s[i] = s[i] * sf[c][i] + d[i] * df[c][i];
+			break;
+		case SCE_GXM_BLEND_FUNC_SUBTRACT:
+			for (i = 0; i < n; i++)
+				s[i] = s[i] * sf[c][i] - d[i] * df[c][i];
+			break;
+		case SCE_GXM_BLEND_FUNC_REVERSE_SUBTRACT:
+			for (i = 0; i < n; i++)
+				s[i] = d[i] * df[c][i] - s[i] * sf[c][i];
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/*
+ * Shades n pixels of row y from x, returns the number written. The
+ * attributes are interpolated at the pixel centers.
+ */
+static unsigned int shade_span(const raster_state *state, const raster_setup *setup, int x, int y, int n)
+{
+	float src_data[4][SPAN_MAX], dst_data[4][SPAN_MAX];
+	float *src[4] = {src_data[0], src_data[1], src_data[2], src_data[3]};
+	float *dst[4] = {dst_data[0], dst_data[1], dst_data[2], dst_data[3]};
+	float attr[MAX_ATTRIBUTES][SPAN_MAX];
+	unsigned char mask[SPAN_MAX];
+	uint32_t *pixels = target.pixels + y * target.stride + x;
+	unsigned int written = 0;
+	int i, c;
+
+	for (c = 0; c < MAX_ATTRIBUTES; c++) {
+		float start = setup->attr[c] + setup->dx[c] * (x + 0.5f - setup->origin_x) +
+			      setup->dy[c] * (y + 0.5f - setup->origin_y);
+		float step = setup->dx[c];
+		for (i = 0; i < n; i++)
+			attr[c][i] = start + step * i;
+	}
+
+	switch (state->fragment_program) {
+	case RASTER_PROGRAM_CLEAR:
+		for (c = 0; c < 4; c++) {
+			for (i = 0; i < n; i++)
+				src[c][i] = state->fragment_uniforms[c];
+		}
+		break;
+	case RASTER_PROGRAM_COLOR:
+		for (c = 0; c < 4; c++) {
+			for (i = 0; i < n; i++)
+				src[c][i] = attr[c][i];
+		}
+		break;
+	case RASTER_PROGRAM_TEXTURE:
+	case RASTER_PROGRAM_TEXTURE_TINT:
+		sample_texture(state->texture, setup->filter, attr[0], attr[1], src, n);
+		if (state->fragment_program == RASTER_PROGRAM_TEXTURE_TINT) {
+			for (c = 0; c < 4; c++) {
+				for (i = 0; i < n; i++)
+					src[c][i] *= state->fragment_uniforms[c];
+			}
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	memset(mask, 1, n);
+
+	if (state->clip.mode == SCE_GXM_REGION_CLIP_INSIDE) {
+		int clip_x_min, clip_y_min, clip_x_max, clip_y_max;
+		region_clip_rect(&state->clip, &clip_x_min, &clip_y_min, &clip_x_max, &clip_y_max);
+		if (y >= clip_y_min && y <= clip_y_max) {
+			for (i = 0; i < n; i++)
+				mask[i] = x + i < clip_x_min || x + i > clip_x_max;
+		}
+	}
+
+	stencil_test(&state->stencil, target.stencil + y * target.width + x, mask, n);
+
+	for (c = 0; c < 4; c++) {
+		for (i = 0; i < n; i++)
+			src[c][i] = clamp01(src[c][i]);
+	}
+
+	if (state->blend) {
+		for (c = 0; c < 4; c++) {
+			for (i = 0; i < n; i++)
+				dst[c][i] = ((pixels[i] >> (8 * c)) & 0xFF) * (1.0f / 255.0f);
+		}
+		blend(state->blend, src, dst, n);
+		for (c = 0; c < 4; c++) {
+			for (i = 0; i < n; i++)
+				src[c][i] = clamp01(src[c][i]);
+		}
+	}
+
+	uint32_t keep = 0;
+	if (state->blend) {
+		SceGxmColorMask color_mask = state->blend->colorMask;
+		keep = ((color_mask & SCE_GXM_COLOR_MASK_R) ? 0 : 0x000000FF) |
+		       ((color_mask & SCE_GXM_COLOR_MASK_G) ? 0 : 0x0000FF00) |
+		       ((color_mask & SCE_GXM_COLOR_MASK_B) ? 0 : 0x00FF0000) |
+		       ((color_mask & SCE_GXM_COLOR_MASK_A) ? 0 : 0xFF000000);
+	}
+
+	/* Branchless and through int, so that the loop vectorizes */
+	for (i = 0; i < n; i++) {
+		uint32_t color = (uint32_t)(int)(src[0][i] * 255.0f + 0.5f) |
+				 ((uint32_t)(int)(src[1][i] * 255.0f + 0.5f) << 8) |
+				 ((uint32_t)(int)(src[2][i] * 255.0f + 0.5f) << 16) |
+				 ((uint32_t)(int)(src[3][i] * 255.0f + 0.5f) << 24);
+		uint32_t select = (uint32_t)0 - mask[i];
+		color = (color & ~keep) | (pixels[i] & keep);
+		pixels[i] = (color & select) | (pixels[i] & ~select);
+		written += mask[i];
+	}
+
+	return written;
+}
+
+/* Primitives */
+
+/* Pixels a draw can touch: the target, within the region clip when it clips outside */
+static int draw_bounds(const raster_state *state, raster_setup *setup)
+{
+	int clip_x_min, clip_y_min, clip_x_max, clip_y_max;
+
+	setup->x_min = 0;
+	setup->y_min = 0;
+	setup->x_max = target.width - 1;
+	setup->y_max = target.height - 1;
+
+	switch (state->clip.mode) {
+	case SCE_GXM_REGION_CLIP_ALL:
+		return 0;
+	case SCE_GXM_REGION_CLIP_OUTSIDE:
+		region_clip_rect(&state->clip, &clip_x_min, &clip_y_min, &clip_x_max, &clip_y_max);
+		if (clip_x_min > setup->x_min)
+			setup->x_min = clip_x_min;
+		if (clip_y_min > setup->y_min)
+			setup->y_min = clip_y_min;
+		if (clip_x_max < setup->x_max)
+			setup->x_max = clip_x_max;
+		if (clip_y_max < setup->y_max)
+			setup->y_max = clip_y_max;
+		break;
+	default:
+		break;
+	}
+
+	return setup->x_min <= setup->x_max && setup->y_min <= setup->y_max;
+}
+
+/* Whether the texture is minified, from the texel steps of a pixel */
+static SceGxmTextureFilter texture_filter(const raster_state *state, const raster_setup *setup)
+{
+	const SceGxmTexture *tex = state->texture;
+	float du_dx, dv_dx, du_dy, dv_dy;
+
+	if (!tex)
+		return SCE_GXM_TEXTURE_FILTER_POINT;
+
+	du_dx = setup->dx[0] * tex->width;
+	dv_dx = setup->dx[1] * tex->height;
+	du_dy = setup->dy[0] * tex->width;
+	dv_dy = setup->dy[1] * tex->height;
+
+	if (du_dx * du_dx + dv_dx * dv_dx > 1.0f || du_dy * du_dy + dv_dy * dv_dy > 1.0f)
+		return tex->min_filter;
+	return tex->mag_filter;
+}
+
+static unsigned int draw_triangle(const raster_state *state, const raster_vertex *v0,
+				  const raster_vertex *v1, const raster_vertex *v2)
+{
+	const raster_vertex *v[3];
+	raster_setup setup;
+	int64_t area, min_x, min_y, max_x, max_y;
+	int64_t edge_dx[3], edge_dy[3], edge_x[3], edge_y[3], bias[3];
+	unsigned int written = 0;
+	int64_t x_start, x_end, y_start, y_end, y;
+	int i, c;
+
+	if (!v0->valid || !v1->valid || !v2->valid)
+		return 0;
+
+	area = (v1->fx - v0->fx) * (v2->fy - v0->fy) - (v1->fy - v0->fy) * (v2->fx - v0->fx);
+	if (area == 0)
+		return 0;
+
+	/* Both windings are drawn, make it positive */
+	v[0] = v0;
+	v[1] = area > 0 ? v1 : v2;
+	v[2] = area > 0 ? v2 : v1;
+	if (area < 0)
+		area = -area;
+
+	if (!draw_bounds(state, &setup))
+		return 0;
+
+	min_x = max_x = v[0]->fx;
+	min_y = max_y = v[0]->fy;
+	for (i = 1; i < 3; i++) {
+		if (v[i]->fx < min_x) min_x = v[i]->fx;
+		if (v[i]->fx > max_x) max_x = v[i]->fx;
+		if (v[i]->fy < min_y) min_y = v[i]->fy;
+		if (v[i]->fy > max_y) max_y = v[i]->fy;
+	}
+
+	/* Pixels whose center is in the bounding box */
+	x_start = ceil_div(min_x - SUBPIXEL_HALF, SUBPIXEL_ONE);
+	x_end = floor_div(max_x - SUBPIXEL_HALF, SUBPIXEL_ONE);
+	y_start = ceil_div(min_y - SUBPIXEL_HALF, SUBPIXEL_ONE);
+	y_end = floor_div(max_y - SUBPIXEL_HALF, SUBPIXEL_ONE);
+	if (x_start < setup.x_min) x_start = setup.x_min;
+	if (x_end > setup.x_max) x_end = setup.x_max;
+	if (y_start < setup.y_min) y_start = setup.y_min;
+	if (y_end > setup.y_max) y_end = setup.y_max;
+	if (x_start > x_end || y_start > y_end)
+		return 0;
+
+	/*
+	 * E(p) = dx * (p.y - a.y) - dy * (p.x - a.x) is positive inside. Pixels
+	 * exactly on an edge belong to the triangle if it's a top or left edge.
+	 */
+	for (i = 0; i < 3; i++) {
+		const raster_vertex *a = v[i], *b = v[(i + 1) % 3];
+		edge_dx[i] = b->fx - a->fx;
+		edge_dy[i] = b->fy - a->fy;
+		edge_x[i] = a->fx;
+		edge_y[i] = a->fy;
+		bias[i] = (edge_dy[i] < 0 || (edge_dy[i] == 0 && edge_dx[i] > 0)) ? 0 : 1;
+	}
+
+	/* Attribute planes from the snapped positions */
+	{
+		float x0 = (float)v[0]->fx / SUBPIXEL_ONE, y0 = (float)v[0]->fy / SUBPIXEL_ONE;
+		float e1x = (float)(v[1]->fx - v[0]->fx) / SUBPIXEL_ONE, e1y = (float)(v[1]->fy - v[0]->fy) / SUBPIXEL_ONE;
+		float e2x = (float)(v[2]->fx - v[0]->fx) / SUBPIXEL_ONE, e2y = (float)(v[2]->fy - v[0]->fy) / SUBPIXEL_ONE;
+		float inv_area = 1.0f / (e1x * e2y - e2x * e1y);
+
+		setup.origin_x = x0;
+		setup.origin_y = y0;
+		for (c = 0; c < MAX_ATTRIBUTES; c++) {
+			float d1 = v[1]->attr[c] - v[0]->attr[c];
+			float d2 = v[2]->attr[c] - v[0]->attr[c];
+			setup.attr[c] = v[0]->attr[c];
+			setup.dx[c] = (d1 * e2y - d2 * e1y) * inv_area;
+			setup.dy[c] = (d2 * e1x - d1 * e2x) * inv_area;
+		}
+	}
+	setup.filter = texture_filter(state, &setup);
+
+	for (y = y_start; y <= y_end; y++) {
+		int64_t lo = x_start, hi = x_end;
+		int64_t cy = y * SUBPIXEL_ONE + SUBPIXEL_HALF;
+
+		for (i = 0; i < 3 && lo <= hi; i++) {
+			/* E at the center of pixel x of the row is e + a * x */
+			int64_t a = -SUBPIXEL_ONE * edge_dy[i];
+			int64_t e = edge_dx[i] * (cy - edge_y[i]) - edge_dy[i] * (SUBPIXEL_HALF - edge_x[i]);
+
+			if (a > 0) {
+				int64_t first = ceil_div(bias[i] - e, a);
+				if (first > lo)
+					lo = first;
+			} else if (a < 0) {
+				int64_t last = floor_div(e - bias[i], -a);
+				if (last < hi)
+					hi = last;
+			} else if (e < bias[i]) {
+				hi = lo - 1;
+			}
+		}
+
+		while (lo <= hi) {
+			int n = hi - lo + 1 > SPAN_MAX ? SPAN_MAX : hi - lo + 1;
+			written += shade_span(state, &setup, lo, y, n);
+			lo += n;
+		}
+	}
+
+	return written;
+}
+
+/* Attributes of a point or line pixel, constant over it */
+static unsigned int draw_pixel(const raster_state *state, const raster_setup *bounds,
+			       int x, int y, const float *attr)
+{
+	raster_setup setup = *bounds;
+	int c;
+
+	if (x < setup.x_min || x > setup.x_max || y < setup.y_min || y > setup.y_max)
+		return 0;
+
+	setup.origin_x = x + 0.5f;
+	setup.origin_y = y + 0.5f;
+	for (c = 0; c < MAX_ATTRIBUTES; c++) {
+		setup.attr[c] = attr[c];
+		setup.dx[c] = 0.0f;
+		setup.dy[c] = 0.0f;
+	}
+	setup.filter = state->texture ? state->texture->mag_filter : SCE_GXM_TEXTURE_FILTER_POINT;
+
+	return shade_span(state, &setup, x, y, 1);
+}
+
+/* The pixel the point is in */
+static unsigned int draw_point(const raster_state *state, const raster_vertex *v)
+{
+	raster_setup bounds;
+
+	if (!v->valid || !draw_bounds(state, &bounds))
+		return 0;
+
+	return draw_pixel(state, &bounds, floor_div(v->fx, SUBPIXEL_ONE), floor_div(v->fy, SUBPIXEL_ONE), v->attr);
+}
+
+/* DDA along the major axis, the last pixel is left out so that strips of lines join */
+static unsigned int draw_line(const raster_state *state, const raster_vertex *v0, const raster_vertex *v1)
+{
+	raster_setup bounds;
+	int64_t dx, dy, steps, i;
+	unsigned int written = 0;
+	float attr[MAX_ATTRIBUTES];
+	int c;
+
+	if (!v0->valid || !v1->valid || !draw_bounds(state, &bounds))
+		return 0;
+
+	dx = v1->fx - v0->fx;
+	dy = v1->fy - v0->fy;
+	steps = ceil_div((dx < 0 ? -dx : dx) > (dy < 0 ? -dy : dy) ? (dx < 0 ? -dx : dx) : (dy < 0 ? -dy : dy),
+			 SUBPIXEL_ONE);
+
+	for (i = 0; i < steps; i++) {
+		float t = (float)i / steps;
+		int64_t x = floor_div(v0->fx + dx * i / steps, SUBPIXEL_ONE);
+		int64_t y = floor_div(v0->fy + dy * i / steps, SUBPIXEL_ONE);
+
+		for (c = 0; c < MAX_ATTRIBUTES; c++)
+			attr[c] = v0->attr[c] + (v1->attr[c] - v0->attr[c]) * t;
+
+		written += draw_pixel(state, &bounds, x, y, attr);
+	}
+
+	return written;
+}
+
+static inline unsigned int read_index(const void *indices, SceGxmIndexFormat format, unsigned int i)
+{
+	if (format == SCE_GXM_INDEX_FORMAT_U32)
+		return ((const uint32_t *)indices)[i];
+	return ((const uint16_t *)indices)[i];
+}
+
+int raster_draw(const raster_state *state, SceGxmPrimitiveType type, SceGxmIndexFormat index_format,
+		const void *indices, unsigned int count, unsigned int *fragments)
+{
+	unsigned int i, written = 0;
+
+	*fragments = 0;
+
+	if (!scene_active)
+		return 1;
+
+	if (state->vertex_program == RASTER_PROGRAM_UNKNOWN || state->fragment_program == RASTER_PROGRAM_UNKNOWN ||
+	    !state->stream || !indices)
+		return 0;
+
+	if ((state->fragment_program == RASTER_PROGRAM_TEXTURE || state->fragment_program == RASTER_PROGRAM_TEXTURE_TINT) &&
+	    !state->texture)
+		return 0;
+
+	if (count > max_vertices) {
+		raster_vertex *v = realloc(vertices, count * sizeof(*v));
+		if (!v)
+			return 0;
+		vertices = v;
+		max_vertices = count;
+	}
+
+	for (i = 0; i < count; i++)
+		run_vertex_program(state, read_index(indices, index_format, i), &vertices[i]);
+
+	switch (type) {
+	case SCE_GXM_PRIMITIVE_TRIANGLES:
+		for (i = 0; i + 2 < count; i += 3)
+			written += draw_triangle(state, &vertices[i], &vertices[i + 1], &vertices[i + 2]);
+		break;
+	case SCE_GXM_PRIMITIVE_TRIANGLE_STRIP:
+		for (i = 0; i + 2 < count; i++)
+			written += draw_triangle(state, &vertices[i], &vertices[i + 1], &vertices[i + 2]);
+		break;
+	case SCE_GXM_PRIMITIVE_TRIANGLE_FAN:
+		for (i = 1; i + 1 < count; i++)
+			written += draw_triangle(state, &vertices[0], &vertices[i], &vertices[i + 1]);
+		break;
+	case SCE_GXM_PRIMITIVE_LINES:
+		for (i = 0; i + 1 < count; i += 2)
+			written += draw_line(state, &vertices[i], &vertices[i + 1]);
+		break;
+	case SCE_GXM_PRIMITIVE_POINTS:
+		for (i = 0; i < count; i++)
+			written += draw_point(state, &vertices[i]);
+		break;
+	default:
+		return 0;
+	}
+
+	*fragments = written;
+	return 1;
+}
@@ -0,0 +1,27 @@
+#ifndef TEST_H
+#define TEST_H
+
+/*
+ * Unit tests of the host build (make test): each test_*.c is a program
+ * that checks what it can and exits with 1 if anything failed.
+ */
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			test_failures++; \
+		} \
+	} while (0)
+
+static inline int test_result(const char *name)
+{
+	printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+	return test_failures != 0;
+}
+
+#endif
@@ -0,0 +1,328 @@
+/*
+ * Files baked by tools/vita2d_bake, loaded back with vita2d_load_baked(): the
+ * texels of every image in every format and layout, and the rejection of
+ * truncated and corrupted files. Needs the tool built, which make test does.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+#include <vita2d.h>
+#include "baked.h"
+#include "pixel_convert.h"
+#include "texture_layout.h"
+#include "test.h"
+
+#define BAKE		"../tools/vita2d_bake"
+#define DIR		"test/bin/baked/"
+#define BAKED_PATH	DIR "images.v2dk"
+#define NUM_COLORS	200
+
+/* The last one is bigger than a page, and not a power of two */
+static const struct {
+	const char *name;
+	unsigned int w;
+	unsigned int h;
+} images[] = {
+	{DIR "a.png", 20, 30},
+	{DIR "b.png", 40, 10},
+	{DIR "c.png", 7, 7},
+	{DIR "big.png", 100, 70},
+};
+
+#define NUM_IMAGES	(sizeof(images) / sizeof(*images))
+
+static const struct {
+	const char *name;
+	SceGxmTextureFormat format;
+	unsigned int bpp;
+	pixel_pack_fn pack;
+} formats[] = {
+	{"rgba8888", SCE_GXM_TEXTURE_FORMAT_A8B8G8R8, 4, NULL},
+	{"rgb565", SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR, 2, pixel_pack_rgba8888_to_bgr565},
+	{"rgba4444", SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR, 2, pixel_pack_rgba8888_to_abgr4444},
+	{"rgba5551", SCE_GXM_TEXTURE_FORMAT_U1U5U5U5_ABGR, 2, pixel_pack_rgba8888_to_abgr1555},
+	{"p8", SCE_GXM_TEXTURE_FORMAT_P8_ABGR, 1, NULL},
+};
+
+static const struct {
+	const char *name;
+	SceGxmTextureType type;
+} layouts[] = {
+	{"linear", SCE_GXM_TEXTURE_LINEAR},
+	{"swizzled", SCE_GXM_TEXTURE_SWIZZLED},
+	{"tiled", SCE_GXM_TEXTURE_TILED},
+};
+
+static unsigned int colors[NUM_COLORS];
+static unsigned int *pixels[NUM_IMAGES];
+
+/* Few enough colors that P8 pages hold them exactly */
+static int write_images()
+{
+	png_image png;
+	unsigned int i, j;
+
+	for (i = 0; i < NUM_COLORS; i++)
+		colors[i] = (rand() & 0xFFFF) | ((unsigned int)(rand() & 0xFFFF) << 16);
+
+	for (i = 0; i < NUM_IMAGES; i++) {
+		pixels[i] = malloc(images[i].w * images[i].h * 4);
+		if (!pixels[i])
+			return 0;
+		for (j = 0; j < images[i].w * images[i].h; j++)
+			pixels[i][j] = colors[rand() % NUM_COLORS];
+
+		memset(&png, 0, sizeof(png));
+		png.version = PNG_IMAGE_VERSION;
+		png.width = images[i].w;
+		png.height = images[i].h;
+		png.format = PNG_FORMAT_RGBA;
+		if (!png_image_write_to_file(&png, images[i].name, 0, pixels[i], 0, NULL))
+			return 0;
+	}
+
+	return 1;
+}
+
+static int bake(const char *format, const char *layout)
+{
+	char command[1024];
+	unsigned int i;
+
+	snprintf(command, sizeof(command), BAKE " -f %s -l %s -s 64x64 -o " BAKED_PATH, format, layout);
+	for (i = 0; i < NUM_IMAGES; i++) {
+		strcat(command, " ");
+		strcat(command, images[i].name);
+	}
+	strcat(command, " > /dev/null");
+
+	return system(command) == 0;
+}
+
+/* Compares the texels of the image in its texture with the PNG, packed to the format */
+static void check_image(unsigned int i, const vita2d_atlas_image *image, unsigned int f, unsigned int l)
+{
+	SceGxmTextureType layout = layouts[l].type;
+	vita2d_texture *texture = image->texture;
+	unsigned int bpp = formats[f].bpp;
+	unsigned int w = vita2d_texture_get_width(texture), h = vita2d_texture_get_height(texture);
+	SceGxmTextureType type = sceGxmTextureGetType(&texture->gxm_tex);
+	unsigned int x, y, bad = 0;
+
+	CHECK(vita2d_texture_get_format(texture) == formats[f].format);
+	/* Non power of two swizzled textures get the arbitrary swizzled type */
+	if (layout == SCE_GXM_TEXTURE_SWIZZLED && (texture_layout_pot(w) != w || texture_layout_pot(h) != h))
+		CHECK(type == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY);
+	else
+		CHECK(type == layout);
+
+	CHECK(image->w == images[i].w && image->h == images[i].h);
+	if (image->x + images[i].w > w || image->y + images[i].h > h)
+		return;
+
+	unsigned char *row = malloc(w * bpp);
+	unsigned char *ref = malloc(images[i].w * bpp);
+	const unsigned int *palette = vita2d_texture_get_palette(texture);
+
+	for (y = 0; y < images[i].h; y++) {
+		const unsigned int *src = pixels[i] + y * images[i].w;
+
+		texture_layout_read_row(type, vita2d_texture_get_datap(texture), w, h, bpp, image->y + y, row, w);
+
+		if (formats[f].format == SCE_GXM_TEXTURE_FORMAT_P8_ABGR) {
+			for (x = 0; x < images[i].w; x++)
+				bad += palette[row[image->x + x]] != src[x];
+			continue;
+		}
+
+		if (formats[f].pack)
+			formats[f].pack(src, ref, images[i].w, y, 0);
+		else
+			memcpy(ref, src, images[i].w * bpp);
+		bad += memcmp(row + image->x * bpp, ref, images[i].w * bpp) != 0;
+	}
+
+	if (bad)
+		fprintf(stderr, "%s %s %s: %u bad rows\n", images[i].name, formats[f].name, layouts[l].name, bad);
+	CHECK(bad == 0);
+
+	free(row);
+	free(ref);
+}
+
+static void test_round_trip(unsigned int f, unsigned int l)
+{
+	vita2d_atlas_image image;
+	unsigned int i;
+
+	CHECK(bake(formats[f].name, layouts[l].name));
+
+	vita2d_baked *baked = vita2d_load_baked(BAKED_PATH);
+	CHECK(baked != NULL);
+	if (!baked)
+		return;
+
+	/* A page of the small images, and a texture of its own for the big one */
+	CHECK(vita2d_baked_get_num_textures(baked) == 2);
+	CHECK(vita2d_baked_get_texture(baked, 2) == NULL);
+
+	for (i = 0; i < NUM_IMAGES; i++) {
+		int found = vita2d_baked_get_image(baked, images[i].name, &image);
+		CHECK(found);
+		if (found)
+			check_image(i, &image, f, l);
+	}
+	CHECK(!vita2d_baked_get_image(baked, DIR "missing.png", &image));
+
+	vita2d_free_baked(baked);
+}
+
+static unsigned char *read_file(const char *path, unsigned long *size)
+{
+	unsigned char *data = NULL;
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return NULL;
+
+	fseek(fp, 0, SEEK_END);
+	*size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	data = malloc(*size);
+	if (data && fread(data, 1, *size, fp) != *size) {
+		free(data);
+		data = NULL;
+	}
+
+	fclose(fp);
+	return data;
+}
+
+static int load_rejected(const unsigned char *data, unsigned long size)
+{
+	vita2d_baked *baked = vita2d_load_baked_buffer(data, size);
+	vita2d_free_baked(baked);
+	return baked == NULL;
+}
+
+static void test_truncated(const unsigned char *data, unsigned long size)
+{
+	unsigned long length;
+	unsigned int bad = 0;
+
+	/* Every length within the tables, then a few in the texture data */
+	for (length = 0; length < size; length += length < 512 ? 1 : 997)
+		bad += !load_rejected(data, length);
+	bad += !load_rejected(data, size - 1);
+	CHECK(bad == 0);
+
+	/* A file read stops at its end too */
+	FILE *fp = fopen(BAKED_PATH, "wb");
+	CHECK(fp != NULL && fwrite(data, 1, size - 1, fp) == size - 1);
+	if (fp)
+		fclose(fp);
+	CHECK(vita2d_load_baked(BAKED_PATH) == NULL);
+}
+
+/* Whether a copy of the file with the unsigned int at offset set to value is rejected */
+static int corrupt_rejected(const unsigned char *data, unsigned long size, unsigned int offset, unsigned int value)
+{
+	unsigned char *copy = malloc(size);
+	int rejected;
+
+	memcpy(copy, data, size);
+	memcpy(copy + offset, &value, sizeof(value));
+	rejected = load_rejected(copy, size);
+
+	free(copy);
+	return rejected;
+}
+
+static void test_corrupted(const unsigned char *data, unsigned long size)
+{
+	baked_header header;
+	baked_texture texture, image_texture;
+	baked_image image;
+
+	memcpy(&header, data, sizeof(header));
+	unsigned int textures_at = sizeof(header);
+	unsigned int images_at = textures_at + header.num_textures * sizeof(texture);
+	unsigned int names_at = images_at + header.num_images * sizeof(image);
+	memcpy(&texture, data + textures_at, sizeof(texture));
+	memcpy(&image, data + images_at, sizeof(image));
+	memcpy(&image_texture, data + textures_at + image.texture * sizeof(texture), sizeof(texture));
+
+	CHECK(!load_rejected(data, size));
+
+	CHECK(corrupt_rejected(data, size, offsetof(baked_header, magic), BAKED_MAGIC + 1));
+	CHECK(corrupt_rejected(data, size, offsetof(baked_header, version), BAKED_VERSION + 1));
+	CHECK(corrupt_rejected(data, size, offsetof(baked_header, num_textures), 0xFFFFFFFF));
+	CHECK(corrupt_rejected(data, size, offsetof(baked_header, num_images), 0xFFFFFFFF));
+	CHECK(corrupt_rejected(data, size, offsetof(baked_header, names_size), 0));
+	CHECK(corrupt_rejected(data, size, offsetof(baked_header, names_size), 0xFFFFFFFF));
+
+	/* The names must end with a NUL */
+	CHECK(corrupt_rejected(data, size, names_at + header.names_size - 4, 0x41414141));
+
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, width), 0));
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, width), 8192));
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, height), 0xFFFFFFFF));
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, type), 0x12345678));
+	/* A P8 texture without its palette, and an 8888 one with a palette */
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, format), SCE_GXM_TEXTURE_FORMAT_P8_ABGR));
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, palette_offset), names_at));
+	/* The data must be the size of the texture, and within the file */
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, data_size), texture.data_size - 4));
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, data_size), texture.data_size + 4));
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, data_offset), size - texture.data_size + 1));
+	CHECK(corrupt_rejected(data, size, textures_at + offsetof(baked_texture, data_offset), 0xFFFFFFF0));
+
+	CHECK(corrupt_rejected(data, size, images_at + offsetof(baked_image, name_offset), header.names_size));
+	CHECK(corrupt_rejected(data, size, images_at + offsetof(baked_image, texture), header.num_textures));
+	/* One texel past the edges, x and y share an unsigned int */
+	CHECK(corrupt_rejected(data, size, images_at + offsetof(baked_image, x),
+			       (image.y << 16) | (image_texture.width - image.w + 1)));
+	CHECK(corrupt_rejected(data, size, images_at + offsetof(baked_image, x),
+			       ((image_texture.height - image.h + 1) << 16) | image.x));
+	CHECK(!corrupt_rejected(data, size, images_at + offsetof(baked_image, x),
+				((image_texture.height - image.h) << 16) | (image_texture.width - image.w)));
+}
+
+int main()
+{
+	unsigned long size;
+	unsigned int f, l, i;
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	srand(1);
+	system("mkdir -p " DIR);
+	CHECK(write_images());
+
+	for (f = 0; f < sizeof(formats) / sizeof(*formats); f++)
+		for (l = 0; l < sizeof(layouts) / sizeof(*layouts); l++)
+			test_round_trip(f, l);
+
+	CHECK(bake("rgba8888", "linear"));
+	unsigned char *data = read_file(BAKED_PATH, &size);
+	CHECK(data != NULL);
+	if (data) {
+		test_truncated(data, size);
+		test_corrupted(data, size);
+		free(data);
+	}
+
+	for (i = 0; i < NUM_IMAGES; i++)
+		free(pixels[i]);
+	system("rm -rf " DIR);
+
+	vita2d_fini();
+
+	return test_result("baked");
+}
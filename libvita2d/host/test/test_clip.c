@@ -0,0 +1,234 @@
+/*
+ * The clip rectangle on the CPU (clip.h) against the stencil mask, which
+ * vita2d_set_region_clip() forces: every kind of draw must cover the same
+ * pixels both ways, in colors a texel step apart at most since the CPU
+ * clip moves the texture coordinates. Runs the reference rasterizer.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vita2d.h>
+#include "vita2d_host.h"
+#include "test.h"
+
+#define FRAME_WIDTH	960
+#define FRAME_HEIGHT	544
+#define FONT		"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
+
+#define TEXTURE_SIZE	64
+/* Difference between neighbour texels, the most a shifted sample can change */
+#define TEXEL_STEP	4
+
+static unsigned int expected[FRAME_HEIGHT * FRAME_WIDTH];
+static unsigned int actual[FRAME_HEIGHT * FRAME_WIDTH];
+static vita2d_host_gxm_stats stats;
+
+static vita2d_texture *texture;
+static vita2d_font *font;
+
+static const struct {
+	const char *name;
+	int x_min, y_min, x_max, y_max;
+} rects[] = {
+	{"aligned", 64, 96, 320, 288},
+	{"unaligned", 101, 77, 333, 299},
+	{"negative", -50, -30, 141, 93},
+	{"off screen", 1000, 600, 1200, 700},
+	{"empty", 200, 150, 200, 300},
+	{"flipped", 333, 299, 101, 77},
+};
+
+static void draw_rectangle()
+{
+	vita2d_draw_rectangle(20, 30, 400, 300, RGBA8(0xF0, 0x80, 0x20, 0xFF));
+	vita2d_draw_rectangle(90.3f, 60.7f, 250.4f, 250.6f, RGBA8(0x20, 0x80, 0xF0, 0x80));
+}
+
+static void draw_texture()
+{
+	vita2d_draw_texture(texture, 80, 70);
+	vita2d_draw_texture_tint(texture, 290.5f, 250.25f, RGBA8(0xFF, 0xC0, 0x80, 0xFF));
+}
+
+static void draw_texture_scale()
+{
+	vita2d_draw_texture_scale(texture, 10.5f, 20.5f, 5.3f, 4.7f);
+}
+
+/* Negative scales flip the quad */
+static void draw_texture_flipped()
+{
+	vita2d_draw_texture_tint_scale(texture, 380, 330, -5.1f, -4.9f, RGBA8(0xC0, 0xFF, 0xFF, 0xFF));
+}
+
+static void draw_texture_part()
+{
+	vita2d_draw_texture_part(texture, 60, 50, 10, 5, 40, 50);
+	vita2d_draw_texture_part_scale(texture, 120.5f, 90.5f, 3, 7, 50, 41, 5.5f, 4.25f);
+	vita2d_draw_texture_tint_part_scale(texture, 320, 250, 8, 8, 32, 32, -3.0f, 3.0f, RGBA8(0xFF, 0xFF, 0xFF, 0xC0));
+}
+
+static void draw_texture_rotate()
+{
+	vita2d_draw_texture_scale_rotate(texture, 210, 190, 4.0f, 3.0f, 0.6f);
+}
+
+static void draw_text()
+{
+	vita2d_font_draw_text(font, 20, 120, RGBA8(0xFF, 0xFF, 0xFF, 0xFF), 40, "Clipped text,\nand more of it");
+}
+
+static void draw_shapes()
+{
+	vita2d_draw_fill_circle(200, 180, 160, RGBA8(0x30, 0xF0, 0x60, 0xFF));
+	vita2d_draw_line(0, 0, 400, 350, RGBA8(0xFF, 0xFF, 0x00, 0xFF));
+	vita2d_draw_line(350, 10, 20, 330, RGBA8(0xFF, 0x00, 0xFF, 0xFF));
+	vita2d_draw_pixel(101, 77, RGBA8(0xFF, 0xFF, 0xFF, 0xFF));
+	vita2d_draw_pixel(332, 298, RGBA8(0xFF, 0xFF, 0xFF, 0xFF));
+}
+
+static void draw_array()
+{
+	vita2d_color_vertex *vertices = vita2d_pool_memalign(3 * sizeof(*vertices), sizeof(*vertices));
+
+	vertices[0] = (vita2d_color_vertex){-40, 20, 0.5f, RGBA8(0xFF, 0, 0, 0xFF)};
+	vertices[1] = (vita2d_color_vertex){420, 60, 0.5f, RGBA8(0, 0xFF, 0, 0xFF)};
+	vertices[2] = (vita2d_color_vertex){150, 380, 0.5f, RGBA8(0, 0, 0xFF, 0xFF)};
+	vita2d_draw_array(SCE_GXM_PRIMITIVE_TRIANGLES, vertices, 3);
+}
+
+static const struct {
+	const char *name;
+	void (*draw)();
+} draws[] = {
+	{"rectangle", draw_rectangle},
+	{"texture", draw_texture},
+	{"texture scale", draw_texture_scale},
+	{"texture flipped", draw_texture_flipped},
+	{"texture part", draw_texture_part},
+	{"texture rotate", draw_texture_rotate},
+	{"text", draw_text},
+	{"shapes", draw_shapes},
+	{"array", draw_array},
+};
+
+/* Renders a frame of the draw clipped to the rectangle, with the stencil or not */
+static void render(unsigned int *out, unsigned int d, unsigned int r, int stencil)
+{
+	vita2d_start_drawing();
+	vita2d_clear_screen();
+
+	if (stencil)
+		vita2d_set_region_clip(SCE_GXM_REGION_CLIP_OUTSIDE, 0, 0, FRAME_WIDTH - 1, FRAME_HEIGHT - 1);
+	vita2d_set_clip_rectangle(rects[r].x_min, rects[r].y_min, rects[r].x_max, rects[r].y_max);
+	vita2d_enable_clipping();
+
+	vita2d_host_reset_gxm_stats();
+	draws[d].draw();
+	vita2d_host_get_gxm_stats(&stats);
+
+	vita2d_disable_clipping();
+	vita2d_set_region_clip(SCE_GXM_REGION_CLIP_NONE, 0, 0, 0, 0);
+
+	vita2d_end_drawing();
+	vita2d_swap_buffers();
+
+	memcpy(out, vita2d_get_current_fb(), sizeof(expected));
+}
+
+static void test_clip(unsigned int d, unsigned int r)
+{
+	unsigned int fragments, coverage = 0, outside = 0, drawn = 0, i;
+	int max_diff = 0, c;
+	/* The stencil mask of a flipped rectangle is the rectangle between its corners */
+	int x_min = rects[r].x_min < rects[r].x_max ? rects[r].x_min : rects[r].x_max;
+	int x_max = rects[r].x_min < rects[r].x_max ? rects[r].x_max : rects[r].x_min;
+	int y_min = rects[r].y_min < rects[r].y_max ? rects[r].y_min : rects[r].y_max;
+	int y_max = rects[r].y_min < rects[r].y_max ? rects[r].y_max : rects[r].y_min;
+
+	render(expected, d, r, 0);
+	fragments = stats.fragments;
+	render(actual, d, r, 1);
+
+	/* The clear color is 0, every draw writes some alpha */
+	for (i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; i++) {
+		int x = i % FRAME_WIDTH, y = i / FRAME_WIDTH;
+
+		drawn += expected[i] != 0;
+		coverage += (expected[i] != 0) != (actual[i] != 0);
+		outside += actual[i] != 0 && (x < x_min || x >= x_max || y < y_min || y >= y_max);
+
+		for (c = 0; c < 32; c += 8) {
+			int diff = abs((int)((expected[i] >> c) & 0xFF) - (int)((actual[i] >> c) & 0xFF));
+			if (diff > max_diff)
+				max_diff = diff;
+		}
+	}
+
+	if (coverage || outside || max_diff > TEXEL_STEP || stats.fragments != fragments)
+		fprintf(stderr, "%s, %s clip: %u pixels covered one way only, %u outside, "
+			"max difference %d, %u and %u fragments\n", draws[d].name, rects[r].name,
+			coverage, outside, max_diff, fragments, stats.fragments);
+
+	/* Every draw crosses the rectangles that are on screen */
+	CHECK((drawn > 0) == (x_min < x_max && y_min < y_max && x_min < FRAME_WIDTH && y_min < FRAME_HEIGHT));
+	CHECK(coverage == 0);
+	CHECK(outside == 0);
+	CHECK(max_diff <= TEXEL_STEP);
+	CHECK(stats.fragments == fragments);
+	CHECK(stats.skipped_draws == 0);
+}
+
+/* A gradient, so that a sample moved by less than a texel changes by TEXEL_STEP at most */
+static vita2d_texture *create_texture()
+{
+	vita2d_texture *texture = vita2d_create_empty_texture(TEXTURE_SIZE, TEXTURE_SIZE);
+	unsigned int row[TEXTURE_SIZE], x, y;
+
+	if (!texture)
+		return NULL;
+
+	for (y = 0; y < TEXTURE_SIZE; y++) {
+		for (x = 0; x < TEXTURE_SIZE; x++)
+			row[x] = RGBA8(x * TEXEL_STEP, y * TEXEL_STEP, 0x80 + (x + y) * TEXEL_STEP / 2, 0xFF - x);
+		vita2d_texture_write_row(texture, y, row);
+	}
+
+	vita2d_texture_set_filters(texture, SCE_GXM_TEXTURE_FILTER_LINEAR, SCE_GXM_TEXTURE_FILTER_LINEAR);
+	return texture;
+}
+
+int main()
+{
+	unsigned int d, r;
+
+	vita2d_host_set_rasterizer(1);
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	vita2d_set_clear_color(0);
+
+	texture = create_texture();
+	CHECK(texture != NULL);
+	font = vita2d_load_font_file(FONT);
+
+	for (d = 0; d < sizeof(draws) / sizeof(*draws); d++) {
+		if (!texture && strncmp(draws[d].name, "texture", 7) == 0)
+			continue;
+		/* Not every machine has the font */
+		if (!font && draws[d].draw == draw_text)
+			continue;
+		for (r = 0; r < sizeof(rects) / sizeof(*rects); r++)
+			test_clip(d, r);
+	}
+
+	if (font)
+		vita2d_free_font(font);
+	vita2d_free_texture(texture);
+	vita2d_fini();
+
+	return test_result("clip");
+}
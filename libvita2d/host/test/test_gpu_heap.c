@@ -0,0 +1,204 @@
+/*
+ * Buddy allocator of gpu_heap.c: splitting, merging of the buddies, new
+ * memblocks when one is full, running out of memory and bad frees.
+ */
+
+#include <string.h>
+#include <psp2/gxm.h>
+#include <vita2d.h>
+#include "gpu_heap.h"
+#include "utils.h"
+#include "test.h"
+
+#define TYPE		SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_PHYCONT_RW
+#define ATTRIBS		(SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE)
+#define MIN_SIZE	(1U << GPU_HEAP_MIN_ORDER)
+#define NUM_MIN_CHUNKS	(GPU_HEAP_BLOCK_SIZE / MIN_SIZE)
+
+static SceUID uids[NUM_MIN_CHUNKS];
+static unsigned char *mems[NUM_MIN_CHUNKS];
+
+static unsigned char *alloc(unsigned int size, unsigned int alignment, SceUID *uid)
+{
+	return gpu_heap_alloc(TYPE, size, alignment, ATTRIBS, VITA2D_MEM_TEXTURE, uid);
+}
+
+static void test_split_and_coalesce()
+{
+	vita2d_gpu_heap_stats stats;
+	SceUID a_uid, b_uid, c_uid, d_uid;
+
+	unsigned char *a = alloc(100, 0, &a_uid);
+	CHECK(a != NULL);
+	vita2d_gpu_heap_get_stats(&stats);
+	/* The 2 MiB chunk got split down to 1 KiB, one free buddy per order */
+	CHECK(stats.num_blocks == 1);
+	CHECK(stats.num_allocs == 1);
+	CHECK(stats.used_size == MIN_SIZE);
+	CHECK(stats.requested_size == 100);
+	CHECK(stats.num_free_chunks == GPU_HEAP_NUM_ORDERS - 1);
+	CHECK(stats.largest_free == GPU_HEAP_BLOCK_SIZE / 2);
+
+	/* The next chunk of the same size is the buddy */
+	unsigned char *b = alloc(MIN_SIZE, 0, &b_uid);
+	CHECK(b == a + MIN_SIZE && b_uid == a_uid);
+
+	/* Rounded up to a power of two, and aligned to it */
+	unsigned char *c = alloc(3000, 0, &c_uid);
+	CHECK(c != NULL && (c - a) % 4096 == 0);
+	unsigned char *d = alloc(MIN_SIZE, 4096, &d_uid);
+	CHECK(d != NULL && (d - a) % 4096 == 0);
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.used_size == 2 * MIN_SIZE + 4096 + 4096);
+	CHECK(stats.requested_size == 100 + MIN_SIZE + 3000 + MIN_SIZE);
+
+	/* Freed in an order where the buddies only merge at the end */
+	gpu_heap_free(a_uid, a);
+	gpu_heap_free(c_uid, c);
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.num_allocs == 2);
+	CHECK(stats.largest_free == GPU_HEAP_BLOCK_SIZE / 2);
+	gpu_heap_free(d_uid, d);
+	gpu_heap_free(b_uid, b);
+
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.num_blocks == 1);
+	CHECK(stats.num_allocs == 0);
+	CHECK(stats.used_size == 0 && stats.requested_size == 0);
+	CHECK(stats.num_free_chunks == 1);
+	CHECK(stats.largest_free == GPU_HEAP_BLOCK_SIZE);
+}
+
+static void test_fragmentation()
+{
+	vita2d_gpu_heap_stats stats;
+	unsigned int i;
+
+	for (i = 0; i < NUM_MIN_CHUNKS; i++) {
+		mems[i] = alloc(MIN_SIZE, 0, &uids[i]);
+		CHECK(mems[i] != NULL);
+	}
+
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.num_blocks == 1);
+	CHECK(stats.free_size == 0 && stats.num_free_chunks == 0);
+
+	/* Every other chunk free: no two buddies can merge */
+	for (i = 0; i < NUM_MIN_CHUNKS; i += 2)
+		gpu_heap_free(uids[i], mems[i]);
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.free_size == GPU_HEAP_BLOCK_SIZE / 2);
+	CHECK(stats.num_free_chunks == NUM_MIN_CHUNKS / 2);
+	CHECK(stats.largest_free == MIN_SIZE);
+
+	for (i = 1; i < NUM_MIN_CHUNKS; i += 2)
+		gpu_heap_free(uids[i], mems[i]);
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.num_free_chunks == 1);
+	CHECK(stats.largest_free == GPU_HEAP_BLOCK_SIZE);
+}
+
+static void test_new_block()
+{
+	vita2d_gpu_heap_stats stats;
+	SceUID uid;
+	unsigned int i, count = GPU_HEAP_BLOCK_SIZE / (1U << GPU_HEAP_MAX_ORDER);
+
+	for (i = 0; i < count; i++)
+		CHECK((mems[i] = alloc(1U << GPU_HEAP_MAX_ORDER, 0, &uids[i])) != NULL);
+
+	/* A full memblock gets a second one */
+	unsigned char *mem = alloc(MIN_SIZE, 0, &uid);
+	CHECK(mem != NULL && uid != uids[0]);
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.num_blocks == 2);
+
+	/* Given back once empty, since another one is left */
+	gpu_heap_free(uid, mem);
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.num_blocks == 1);
+
+	for (i = 0; i < count; i++)
+		gpu_heap_free(uids[i], mems[i]);
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.num_blocks == 1 && stats.num_allocs == 0);
+}
+
+static void test_out_of_memory()
+{
+	vita2d_gpu_heap_stats stats;
+	SceUID uid;
+	unsigned int i, count = GPU_HEAP_BLOCK_SIZE / (1U << GPU_HEAP_MAX_ORDER);
+
+	/* Room for the memblock the heap already has, and nothing else */
+	CHECK(vita2d_set_mem_budget(TYPE, GPU_HEAP_BLOCK_SIZE));
+
+	for (i = 0; i < count; i++)
+		CHECK((mems[i] = alloc(1U << GPU_HEAP_MAX_ORDER, 0, &uids[i])) != NULL);
+
+	CHECK(alloc(MIN_SIZE, 0, &uid) == NULL);
+	/* Bigger than the heap chunks, straight to gpu_alloc() */
+	CHECK(alloc(2U << GPU_HEAP_MAX_ORDER, 0, &uid) == NULL);
+	vita2d_gpu_heap_get_stats(&stats);
+	CHECK(stats.num_blocks == 1 && stats.num_allocs == count);
+
+	/* Usable again once something is freed */
+	gpu_heap_free(uids[0], mems[0]);
+	CHECK((mems[0] = alloc(MIN_SIZE, 0, &uids[0])) != NULL);
+
+	for (i = 0; i < count; i++)
+		gpu_heap_free(uids[i], mems[i]);
+
+	CHECK(vita2d_set_mem_budget(TYPE, 0));
+}
+
+static void test_bad_free()
+{
+	vita2d_gpu_heap_stats before, after;
+	SceUID a_uid, b_uid, c_uid;
+
+	unsigned char *a = alloc(MIN_SIZE, 0, &a_uid);
+	unsigned char *b = alloc(MIN_SIZE, 0, &b_uid);
+	CHECK(a != NULL && b != NULL);
+
+	gpu_heap_free(a_uid, a);
+	vita2d_gpu_heap_get_stats(&before);
+
+	/* Freed twice, and a pointer inside a chunk */
+	gpu_heap_free(a_uid, a);
+	gpu_heap_free(b_uid, b + 16);
+	vita2d_gpu_heap_get_stats(&after);
+	CHECK(memcmp(&before, &after, sizeof(before)) == 0);
+
+	/* The free lists are still sane: the chunk comes back only once */
+	unsigned char *c = alloc(MIN_SIZE, 0, &c_uid);
+	unsigned char *d = alloc(MIN_SIZE, 0, &uids[0]);
+	CHECK(c == a);
+	CHECK(d != NULL && d != a && d != b);
+
+	gpu_heap_free(b_uid, b);
+	gpu_heap_free(c_uid, c);
+	gpu_heap_free(uids[0], d);
+
+	vita2d_gpu_heap_get_stats(&after);
+	CHECK(after.num_allocs == 0 && after.num_free_chunks == 1);
+}
+
+int main()
+{
+	if (!gpu_mem_init() || !gpu_heap_init()) {
+		fprintf(stderr, "Can't initialize the GPU heap\n");
+		return 1;
+	}
+
+	test_split_and_coalesce();
+	test_fragmentation();
+	test_new_block();
+	test_out_of_memory();
+	test_bad_free();
+
+	gpu_heap_fini();
+	gpu_mem_fini();
+
+	return test_result("gpu_heap");
+}
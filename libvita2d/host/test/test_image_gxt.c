@@ -0,0 +1,94 @@
+/*
+ * Validation of the GXT headers: the texture data and the palettes have to
+ * be inside the buffer and big enough for what the texture declares.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <psp2/gxm.h>
+#include <vita2d.h>
+#include "test.h"
+
+#define SIZE		16
+#define PALETTE_SIZE	(256 * 4)
+
+/* Same layout as in vita2d_image_gxt.c */
+typedef struct {
+	unsigned int magic, version, num_textures, data_offset, data_size;
+	unsigned int num_p4_palettes, num_p8_palettes, reserved;
+	struct {
+		unsigned int data_offset, data_size;
+		int palette_index;
+		unsigned int flags, type, format;
+		unsigned short width, height;
+		unsigned char mip_count, pad[3];
+	} info;
+	unsigned char data[SIZE * SIZE * 4 + PALETTE_SIZE];
+} __attribute__((packed)) gxt_file;
+
+static gxt_file gxt;
+
+static void make_gxt(SceGxmTextureFormat format, unsigned int texture_size, unsigned int num_p8_palettes)
+{
+	memset(&gxt, 0, sizeof(gxt));
+	gxt.magic = 0x00545847;
+	gxt.version = 0x10000003;
+	gxt.num_textures = 1;
+	gxt.data_offset = offsetof(gxt_file, data);
+	gxt.data_size = texture_size + num_p8_palettes * PALETTE_SIZE;
+	gxt.num_p8_palettes = num_p8_palettes;
+	gxt.info.data_offset = gxt.data_offset;
+	gxt.info.data_size = texture_size;
+	gxt.info.type = SCE_GXM_TEXTURE_LINEAR;
+	gxt.info.format = format;
+	gxt.info.width = SIZE;
+	gxt.info.height = SIZE;
+	gxt.info.mip_count = 1;
+}
+
+static int loads()
+{
+	vita2d_texture *texture = vita2d_load_GXT_buffer(&gxt, sizeof(gxt), 0);
+
+	if (!texture)
+		return 0;
+
+	vita2d_free_texture(texture);
+	return 1;
+}
+
+int main()
+{
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	make_gxt(SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR, SIZE * SIZE * 4, 0);
+	CHECK(loads());
+
+	/* Less data than a 16x16 RGBA texture */
+	gxt.info.data_size = SIZE * SIZE;
+	CHECK(!loads());
+
+	/* Nor its mips */
+	make_gxt(SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR, SIZE * SIZE * 4, 0);
+	gxt.info.mip_count = 5;
+	CHECK(!loads());
+
+	make_gxt(SCE_GXM_TEXTURE_FORMAT_P8_ABGR, SIZE * SIZE, 1);
+	CHECK(loads());
+
+	/* Palettes that would start before the data region */
+	gxt.num_p8_palettes = 0x00400001;
+	gxt.info.palette_index = 0;
+	CHECK(!loads());
+
+	make_gxt(SCE_GXM_TEXTURE_FORMAT_P8_ABGR, SIZE * SIZE, 1);
+	gxt.info.palette_index = 1;
+	CHECK(!loads());
+
+	vita2d_fini();
+
+	return test_result("image_gxt");
+}
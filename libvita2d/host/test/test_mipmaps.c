@@ -0,0 +1,169 @@
+/*
+ * The 2x2 box filter and the mip levels vita2d_texture_generate_mipmaps()
+ * builds with it, against a naive filter: odd sizes, 1xN and Nx1 levels,
+ * every layout and 1 to 4 bytes per pixel.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vita2d.h>
+#include "pixel_convert.h"
+#include "texture_layout.h"
+#include "test.h"
+
+/* Rounded average of the 2x2 block at (x, y), repeating the last row or column of 1 pixel wide levels */
+static unsigned char naive_box(const unsigned char *src, unsigned int w, unsigned int h, unsigned int bpp,
+			       unsigned int x, unsigned int y, unsigned int c)
+{
+	unsigned int x0 = 2 * x, x1 = w > 1 ? 2 * x + 1 : 2 * x;
+	unsigned int y0 = 2 * y, y1 = h > 1 ? 2 * y + 1 : 2 * y;
+
+	return (src[(y0 * w + x0) * bpp + c] + src[(y0 * w + x1) * bpp + c] +
+		src[(y1 * w + x0) * bpp + c] + src[(y1 * w + x1) * bpp + c] + 2) / 4;
+}
+
+static void fill_random(unsigned char *data, unsigned int size)
+{
+	unsigned int i;
+
+	for (i = 0; i < size; i++)
+		data[i] = rand() & 0xFF;
+}
+
+static void test_downsample()
+{
+	unsigned char src[2 * 64 * 4], dst[33 * 4], ref[33 * 4];
+	unsigned int count, bpp, x, c;
+
+	for (bpp = 1; bpp <= 4; bpp++) {
+		for (count = 1; count <= 64; count++) {
+			unsigned int dst_count = count > 1 ? count / 2 : 1;
+
+			/* Two rows of count pixels */
+			fill_random(src, sizeof(src));
+			memset(dst, 0xEE, sizeof(dst));
+
+			pixel_downsample_2x2(src, src + count * bpp, dst, count, bpp);
+
+			for (x = 0; x < dst_count; x++)
+				for (c = 0; c < bpp; c++)
+					ref[x * bpp + c] = naive_box(src, count, 2, bpp, x, 0, c);
+
+			CHECK(memcmp(dst, ref, dst_count * bpp) == 0);
+			/* Nothing written past the last pixel */
+			CHECK(dst[dst_count * bpp] == 0xEE);
+		}
+	}
+}
+
+static void test_mipmaps(SceGxmTextureFormat format, unsigned int bpp, SceGxmTextureType layout,
+			 unsigned int w, unsigned int h)
+{
+	unsigned int level_w = w, level_h = h, y, x, c, bad = 0;
+	unsigned int pw = texture_layout_pot(w), ph = texture_layout_pot(h);
+	unsigned int levels = 1, level;
+
+	while ((w >> levels) > 0 || (h >> levels) > 0)
+		levels++;
+
+	vita2d_texture *texture = vita2d_create_empty_texture_mipmapped(w, h, format, layout, 0);
+	CHECK(texture != NULL);
+	if (!texture)
+		return;
+
+	int swizzled = layout == SCE_GXM_TEXTURE_SWIZZLED;
+	/* Non power of two swizzled textures get the arbitrary swizzled type */
+	SceGxmTextureType type = swizzled && (w != pw || h != ph) ? SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY : layout;
+	unsigned char *ref = malloc(w * h * bpp);
+	unsigned char *next = malloc(w * h * bpp);
+	unsigned char *row = malloc(w * bpp);
+
+	fill_random(ref, w * h * bpp);
+	for (y = 0; y < h; y++)
+		vita2d_texture_write_row(texture, y, ref + y * w * bpp);
+
+	CHECK(vita2d_texture_generate_mipmaps(texture));
+
+	/* The levels follow each other, each in the layout of its padded size */
+	unsigned char *data = vita2d_texture_get_datap(texture);
+
+	for (level = 0; level < levels; level++) {
+		unsigned int stored_w = swizzled ? pw >> level : w >> level;
+		unsigned int stored_h = swizzled ? ph >> level : h >> level;
+		unsigned int aligned_w, aligned_h;
+
+		if (!stored_w)
+			stored_w = 1;
+		if (!stored_h)
+			stored_h = 1;
+
+		if (level > 0) {
+			unsigned int next_w = level_w > 1 ? level_w / 2 : 1;
+			unsigned int next_h = level_h > 1 ? level_h / 2 : 1;
+
+			for (y = 0; y < next_h; y++)
+				for (x = 0; x < next_w; x++)
+					for (c = 0; c < bpp; c++)
+						next[(y * next_w + x) * bpp + c] = naive_box(ref, level_w, level_h, bpp, x, y, c);
+
+			memcpy(ref, next, next_w * next_h * bpp);
+			level_w = next_w;
+			level_h = next_h;
+		}
+
+		for (y = 0; y < level_h; y++) {
+			texture_layout_read_row(type, data, stored_w, stored_h, bpp, y, row, level_w);
+			bad += memcmp(row, ref + y * level_w * bpp, level_w * bpp) != 0;
+		}
+
+		texture_layout_dimensions(type, stored_w, stored_h, &aligned_w, &aligned_h);
+		data += aligned_w * aligned_h * bpp;
+	}
+
+	if (bad)
+		fprintf(stderr, "format 0x%08x layout 0x%08x %ux%u: %u bad rows\n", format, layout, w, h, bad);
+	CHECK(bad == 0);
+	CHECK(level_w == 1 && level_h == 1);
+
+	free(ref);
+	free(next);
+	free(row);
+	vita2d_free_texture(texture);
+}
+
+int main()
+{
+	static const struct {
+		SceGxmTextureFormat format;
+		unsigned int bpp;
+	} formats[] = {
+		{SCE_GXM_TEXTURE_FORMAT_U8_R111, 1},
+		{(SceGxmTextureFormat)SCE_GXM_TEXTURE_BASE_FORMAT_U8U8, 2},
+		{SCE_GXM_TEXTURE_FORMAT_U8U8U8_BGR, 3},
+		{SCE_GXM_TEXTURE_FORMAT_A8B8G8R8, 4},
+	};
+	static const SceGxmTextureType layouts[] = {
+		SCE_GXM_TEXTURE_LINEAR, SCE_GXM_TEXTURE_SWIZZLED, SCE_GXM_TEXTURE_TILED
+	};
+	static const unsigned int sizes[][2] = {
+		{1, 1}, {1, 9}, {9, 1}, {7, 5}, {13, 13}, {16, 3}, {3, 16}, {64, 64}, {37, 70}
+	};
+	unsigned int f, l, s;
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	srand(1);
+	test_downsample();
+
+	for (f = 0; f < sizeof(formats) / sizeof(*formats); f++)
+		for (l = 0; l < sizeof(layouts) / sizeof(*layouts); l++)
+			for (s = 0; s < sizeof(sizes) / sizeof(*sizes); s++)
+				test_mipmaps(formats[f].format, formats[f].bpp, layouts[l], sizes[s][0], sizes[s][1]);
+
+	vita2d_fini();
+
+	return test_result("mipmaps");
+}
@@ -0,0 +1,169 @@
+/*
+ * Palettes of palette.c: images of at most 256 colors must come back
+ * exactly, bigger ones get valid indices and a bounded error.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "palette.h"
+#include "test.h"
+
+#define W	64
+#define H	64
+
+static unsigned int image[H][W];
+static unsigned char indices[H][W];
+
+static unsigned int random_color()
+{
+	return (rand() & 0xFFFF) | ((unsigned int)(rand() & 0xFFFF) << 16);
+}
+
+static int channel_error(unsigned int a, unsigned int b)
+{
+	int error = 0, c;
+
+	for (c = 0; c < 32; c += 8) {
+		int diff = abs((int)((a >> c) & 0xFF) - (int)((b >> c) & 0xFF));
+		if (diff > error)
+			error = diff;
+	}
+
+	return error;
+}
+
+static void test_exact(unsigned int num_colors)
+{
+	unsigned int colors[PALETTE_MAX_COLORS];
+	unsigned int i, j, x, y, bad = 0;
+	static palette pal;
+
+	/* Distinct colors, including the ones that look like empty hash slots */
+	for (i = 0; i < num_colors; i++) {
+		do {
+			colors[i] = i == 0 ? 0 : i == 1 ? 0xFFFFFFFF : random_color();
+			for (j = 0; j < i && colors[j] != colors[i]; j++)
+				;
+		} while (j < i);
+	}
+
+	for (y = 0; y < H; y++)
+		for (x = 0; x < W; x++)
+			image[y][x] = colors[(y * W + x) < num_colors ? y * W + x : rand() % num_colors];
+
+	palette_init(&pal);
+	for (y = 0; y < H; y++)
+		CHECK(palette_add_row(&pal, image[y], W));
+	CHECK(pal.num_colors == num_colors);
+
+	for (y = 0; y < H; y++) {
+		palette_map_row(&pal, image[y], indices[y], W);
+		for (x = 0; x < W; x++)
+			bad += indices[y][x] >= pal.num_colors || pal.colors[indices[y][x]] != image[y][x];
+	}
+	CHECK(bad == 0);
+}
+
+static void test_too_many_colors()
+{
+	static palette pal;
+	unsigned int row[PALETTE_MAX_COLORS + 1];
+	unsigned int i;
+
+	for (i = 0; i <= PALETTE_MAX_COLORS; i++)
+		row[i] = 0xFF000000 | i * 0x010101;
+
+	palette_init(&pal);
+	CHECK(palette_add_row(&pal, row, PALETTE_MAX_COLORS));
+	CHECK(!palette_add_row(&pal, row + PALETTE_MAX_COLORS, 1));
+}
+
+/* Returns the largest channel error of the image quantized to max_colors, and the total one */
+static int quantize(unsigned int max_colors, unsigned int *num_colors, unsigned long long *total)
+{
+	unsigned int colors[PALETTE_MAX_COLORS];
+	palette_quantizer q;
+	unsigned int x, y, bad = 0;
+	int max_error = 0;
+
+	*total = 0;
+
+	CHECK(palette_quantizer_init(&q));
+	for (y = 0; y < H; y++)
+		palette_quantizer_add_row(&q, image[y], W);
+
+	*num_colors = palette_quantizer_build(&q, colors, max_colors);
+	CHECK(*num_colors > 0 && *num_colors <= max_colors && *num_colors <= PALETTE_MAX_COLORS);
+
+	for (y = 0; y < H; y++) {
+		palette_quantizer_map_row(&q, image[y], indices[y], W);
+		for (x = 0; x < W; x++) {
+			if (indices[y][x] >= *num_colors) {
+				bad++;
+				continue;
+			}
+			int error = channel_error(colors[indices[y][x]], image[y][x]);
+			if (error > max_error)
+				max_error = error;
+			*total += error;
+		}
+	}
+	CHECK(bad == 0);
+
+	palette_quantizer_fini(&q);
+
+	return max_error;
+}
+
+static void test_quantize()
+{
+	unsigned long long total, total_16;
+	unsigned int num_colors, x, y;
+
+	/* 4096 colors in 256 histogram bins: each one gets its own color, only the low bits are lost */
+	for (y = 0; y < H; y++)
+		for (x = 0; x < W; x++)
+			image[y][x] = 0xFF000000 | (0x80 << 16) | ((y * 4) << 8) | (x * 4);
+
+	CHECK(quantize(PALETTE_MAX_COLORS, &num_colors, &total) <= 15);
+	CHECK(num_colors == 256);
+
+	/* Random colors everywhere, many more bins than colors */
+	for (y = 0; y < H; y++)
+		for (x = 0; x < W; x++)
+			image[y][x] = random_color();
+
+	quantize(PALETTE_MAX_COLORS, &num_colors, &total);
+	CHECK(num_colors == PALETTE_MAX_COLORS);
+	/* Each box of the median cut is a small part of the color space */
+	CHECK(total / (W * H) < 64);
+
+	quantize(16, &num_colors, &total_16);
+	CHECK(num_colors == 16);
+	CHECK(total < total_16);
+
+	/* More than a palette holds is clamped */
+	quantize(1000, &num_colors, &total);
+	CHECK(num_colors == PALETTE_MAX_COLORS);
+
+	/* A single color */
+	for (y = 0; y < H; y++)
+		for (x = 0; x < W; x++)
+			image[y][x] = 0x80402010;
+	CHECK(quantize(PALETTE_MAX_COLORS, &num_colors, &total) <= 15);
+	CHECK(num_colors == 1);
+}
+
+int main()
+{
+	srand(1);
+
+	test_exact(1);
+	test_exact(2);
+	test_exact(17);
+	test_exact(PALETTE_MAX_COLORS);
+	test_too_many_colors();
+	test_quantize();
+
+	return test_result("palette");
+}
@@ -0,0 +1,95 @@
+/*
+ * The 16 bit packers of pixel_convert.c: every channel value comes back
+ * within half a step once expanded the way the GPU does, and the values a
+ * format holds exactly come back as themselves.
+ */
+
+#include <stdlib.h>
+#include "pixel_convert.h"
+#include "test.h"
+
+typedef struct pack_format {
+	pixel_pack_fn pack;
+	unsigned char bits[4];	/* of R, G, B and A, 0 if dropped */
+	unsigned char shift[4];
+} pack_format;
+
+static const pack_format formats[] = {
+	{pixel_pack_rgba8888_to_bgr565, {5, 6, 5, 0}, {0, 5, 11, 0}},
+	{pixel_pack_rgba8888_to_abgr4444, {4, 4, 4, 4}, {0, 4, 8, 12}},
+	{pixel_pack_rgba8888_to_abgr1555, {5, 5, 5, 1}, {0, 5, 10, 15}},
+};
+
+static unsigned int expand(unsigned int q, unsigned int bits)
+{
+	return (q * 255 + ((1U << bits) - 1) / 2) / ((1U << bits) - 1);
+}
+
+/* Every value in each channel, more than a NEON block of 8 */
+static void test_error(const pack_format *format)
+{
+	unsigned char src[256 * 4];
+	unsigned short dst[256];
+	unsigned int v, c, bad = 0;
+
+	for (v = 0; v < 256; v++)
+		for (c = 0; c < 4; c++)
+			src[v * 4 + c] = v;
+
+	format->pack(src, dst, 256, 0, 0);
+
+	for (c = 0; c < 4; c++) {
+		unsigned int bits = format->bits[c], max = (1U << bits) - 1;
+
+		if (!bits)
+			continue;
+
+		/* Half a step, rounded up */
+		int max_error = (255 + 2 * max - 1) / (2 * max);
+
+		for (v = 0; v < 256; v++) {
+			unsigned int q = (dst[v] >> format->shift[c]) & max;
+			bad += abs((int)expand(q, bits) - (int)v) > max_error;
+		}
+	}
+
+	CHECK(bad == 0);
+}
+
+static void test_exact(const pack_format *format)
+{
+	unsigned char src[64 * 4];
+	unsigned short dst[64];
+	unsigned int q, c, bad = 0;
+
+	for (c = 0; c < 4; c++) {
+		unsigned int bits = format->bits[c], max = (1U << bits) - 1;
+
+		if (!bits)
+			continue;
+
+		for (q = 0; q <= max; q++) {
+			src[q * 4 + 0] = src[q * 4 + 1] = src[q * 4 + 2] = src[q * 4 + 3] = 0;
+			src[q * 4 + c] = expand(q, bits);
+		}
+
+		format->pack(src, dst, max + 1, 0, 0);
+
+		for (q = 0; q <= max; q++)
+			bad += ((dst[q] >> format->shift[c]) & max) != q;
+	}
+
+	CHECK(bad == 0);
+}
+
+int main()
+{
+	unsigned int f;
+
+	for (f = 0; f < sizeof(formats) / sizeof(*formats); f++) {
+		test_error(&formats[f]);
+		test_exact(&formats[f]);
+	}
+
+	return test_result("pixel_pack");
+}
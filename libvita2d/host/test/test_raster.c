@@ -0,0 +1,311 @@
+/*
+ * The reference rasterizer of the host build (stub_raster.c), through the
+ * draws of the library: a distorted mesh covers every pixel once, the
+ * texture layouts and formats sample the same texels, and the region clip
+ * works on whole tiles.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vita2d.h>
+#include "vita2d_host.h"
+#include "pixel_convert.h"
+#include "test.h"
+
+#define FRAME_WIDTH	960
+#define FRAME_HEIGHT	544
+
+#define MESH_X		100
+#define MESH_Y		60
+#define MESH_COLS	24
+#define MESH_ROWS	16
+#define MESH_CELL	16
+
+#define TEXTURE_W	37
+#define TEXTURE_H	21
+
+static unsigned int expected[FRAME_HEIGHT * FRAME_WIDTH];
+static unsigned int actual[FRAME_HEIGHT * FRAME_WIDTH];
+static vita2d_host_gxm_stats stats;
+
+typedef void (*draw_fn)(void *arg);
+
+/* Renders a frame of draw into out, stats has what the draw did */
+static void render(unsigned int *out, draw_fn draw, void *arg)
+{
+	vita2d_start_drawing();
+	vita2d_clear_screen();
+	vita2d_host_reset_gxm_stats();
+	draw(arg);
+	vita2d_host_get_gxm_stats(&stats);
+	vita2d_end_drawing();
+	vita2d_swap_buffers();
+
+	memcpy(out, vita2d_get_current_fb(), sizeof(expected));
+}
+
+/* The largest channel difference between the frames */
+static int frame_diff(const unsigned int *a, const unsigned int *b)
+{
+	int max_diff = 0, i, c;
+
+	for (i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; i++) {
+		for (c = 0; c < 32; c += 8) {
+			int diff = abs((int)((a[i] >> c) & 0xFF) - (int)((b[i] >> c) & 0xFF));
+			if (diff > max_diff)
+				max_diff = diff;
+		}
+	}
+
+	return max_diff;
+}
+
+static float jitter()
+{
+	return (rand() % 1000 - 500) / 1000.0f * MESH_CELL / 2;
+}
+
+/*
+ * A grid of quads whose inner corners are moved by up to a quarter cell, in
+ * two triangles each. The quads stay convex, so the triangles tile the
+ * rectangle of the grid.
+ */
+static void draw_mesh(void *arg)
+{
+	static float x[MESH_ROWS + 1][MESH_COLS + 1], y[MESH_ROWS + 1][MESH_COLS + 1];
+	unsigned int count = MESH_ROWS * MESH_COLS * 6, r, c, i = 0;
+	int k;
+
+	for (r = 0; r <= MESH_ROWS; r++) {
+		for (c = 0; c <= MESH_COLS; c++) {
+			int inner = r > 0 && r < MESH_ROWS && c > 0 && c < MESH_COLS;
+			x[r][c] = MESH_X + c * MESH_CELL + (inner ? jitter() : 0.0f);
+			y[r][c] = MESH_Y + r * MESH_CELL + (inner ? jitter() : 0.0f);
+		}
+	}
+
+	vita2d_color_vertex *vertices = vita2d_pool_memalign(count * sizeof(*vertices), sizeof(*vertices));
+	CHECK(vertices != NULL);
+	if (!vertices)
+		return;
+
+	for (r = 0; r < MESH_ROWS; r++) {
+		for (c = 0; c < MESH_COLS; c++) {
+			static const int corners[6][2] = {{0, 0}, {0, 1}, {1, 1}, {0, 0}, {1, 1}, {1, 0}};
+			for (k = 0; k < 6; k++, i++) {
+				vertices[i].x = x[r + corners[k][0]][c + corners[k][1]];
+				vertices[i].y = y[r + corners[k][0]][c + corners[k][1]];
+				vertices[i].z = 0.5f;
+				vertices[i].color = RGBA8(0xFF, 0xFF, 0xFF, 0xFF);
+			}
+		}
+	}
+
+	vita2d_draw_array(SCE_GXM_PRIMITIVE_TRIANGLES, vertices, count);
+}
+
+static void test_mesh()
+{
+	unsigned int x, y, bad = 0;
+
+	render(actual, draw_mesh, NULL);
+	CHECK(stats.skipped_draws == 0);
+
+	/* Every pixel of the grid is written, as many as there are: none was written twice */
+	CHECK(stats.fragments == MESH_COLS * MESH_CELL * MESH_ROWS * MESH_CELL);
+	for (y = 0; y < FRAME_HEIGHT; y++) {
+		for (x = 0; x < FRAME_WIDTH; x++) {
+			int inside = x >= MESH_X && x < MESH_X + MESH_COLS * MESH_CELL &&
+				     y >= MESH_Y && y < MESH_Y + MESH_ROWS * MESH_CELL;
+			bad += (actual[y * FRAME_WIDTH + x] == 0xFFFFFFFF) != inside;
+		}
+	}
+	CHECK(bad == 0);
+}
+
+static unsigned int random_color()
+{
+	return (rand() & 0xFFFF) | ((unsigned int)(rand() & 0xFFFF) << 16);
+}
+
+/* Scaled, rotated and tinted, with bilinear filtering: every texel takes part */
+static void draw_texture(void *arg)
+{
+	vita2d_texture *texture = arg;
+
+	vita2d_texture_set_filters(texture, SCE_GXM_TEXTURE_FILTER_LINEAR, SCE_GXM_TEXTURE_FILTER_LINEAR);
+	vita2d_draw_texture_tint_scale_rotate(texture, 300, 250, 7.3f, 5.1f, 0.4f, RGBA8(0xFF, 0xC0, 0x80, 0xF0));
+	vita2d_draw_texture_scale(texture, 600, 20, 0.7f, 0.6f);
+}
+
+/* Point sampled at 1:1, every texel is a pixel */
+static void draw_texture_point(void *arg)
+{
+	vita2d_texture *texture = arg;
+
+	vita2d_texture_set_filters(texture, SCE_GXM_TEXTURE_FILTER_POINT, SCE_GXM_TEXTURE_FILTER_POINT);
+	vita2d_draw_texture(texture, 10, 10);
+}
+
+static vita2d_texture *create_texture(SceGxmTextureFormat format, SceGxmTextureType layout,
+				      unsigned int w, unsigned int h, const void *data, unsigned int bpp)
+{
+	unsigned int y;
+
+	vita2d_texture *texture = vita2d_create_empty_texture_format_layout(w, h, format, layout);
+	CHECK(texture != NULL);
+	if (!texture)
+		return NULL;
+
+	for (y = 0; y < h; y++)
+		vita2d_texture_write_row(texture, y, (const unsigned char *)data + y * w * bpp);
+
+	return texture;
+}
+
+static void test_layouts(unsigned int w, unsigned int h)
+{
+	static const SceGxmTextureType layouts[] = {SCE_GXM_TEXTURE_SWIZZLED, SCE_GXM_TEXTURE_TILED};
+	unsigned int *texels = malloc(w * h * 4);
+	unsigned int i;
+
+	for (i = 0; i < w * h; i++)
+		texels[i] = random_color();
+
+	vita2d_texture *linear = create_texture(SCE_GXM_TEXTURE_FORMAT_A8B8G8R8, SCE_GXM_TEXTURE_LINEAR, w, h, texels, 4);
+	if (linear) {
+		render(expected, draw_texture, linear);
+		CHECK(stats.skipped_draws == 0 && stats.fragments > 0);
+		vita2d_free_texture(linear);
+	}
+
+	for (i = 0; i < sizeof(layouts) / sizeof(*layouts); i++) {
+		vita2d_texture *texture = create_texture(SCE_GXM_TEXTURE_FORMAT_A8B8G8R8, layouts[i], w, h, texels, 4);
+		if (!texture)
+			continue;
+		render(actual, draw_texture, texture);
+		CHECK(frame_diff(expected, actual) == 0);
+		vita2d_free_texture(texture);
+	}
+
+	free(texels);
+}
+
+/*
+ * 16 bit formats against A8B8G8R8: half a step of the narrowest channel off
+ * at most. The alphas are ones the format holds exactly, so that blending
+ * doesn't add to the error.
+ */
+static void test_format(SceGxmTextureFormat format, pixel_pack_fn pack, unsigned int alpha_bits, int max_diff)
+{
+	unsigned int texels[TEXTURE_W * TEXTURE_H];
+	unsigned short packed[TEXTURE_W * TEXTURE_H];
+	unsigned int i;
+
+	for (i = 0; i < TEXTURE_W * TEXTURE_H; i++) {
+		unsigned int alpha = alpha_bits ? (rand() % (1 << alpha_bits)) * 255 / ((1 << alpha_bits) - 1) : 0xFF;
+		texels[i] = (random_color() & 0x00FFFFFF) | (alpha << 24);
+	}
+	pack(texels, packed, TEXTURE_W * TEXTURE_H, 0, 0);
+
+	vita2d_texture *reference = create_texture(SCE_GXM_TEXTURE_FORMAT_A8B8G8R8, SCE_GXM_TEXTURE_LINEAR,
+						   TEXTURE_W, TEXTURE_H, texels, 4);
+	vita2d_texture *texture = create_texture(format, SCE_GXM_TEXTURE_LINEAR, TEXTURE_W, TEXTURE_H, packed, 2);
+
+	if (reference && texture) {
+		render(expected, draw_texture_point, reference);
+		render(actual, draw_texture_point, texture);
+		CHECK(stats.skipped_draws == 0 && stats.fragments == TEXTURE_W * TEXTURE_H);
+		int diff = frame_diff(expected, actual);
+		if (diff > max_diff)
+			fprintf(stderr, "format 0x%08x: difference %d\n", format, diff);
+		CHECK(diff <= max_diff);
+	}
+
+	vita2d_free_texture(reference);
+	vita2d_free_texture(texture);
+}
+
+/* P8 against the A8B8G8R8 texture of its palette colors, filtered the same */
+static void test_palette()
+{
+	unsigned int texels[TEXTURE_W * TEXTURE_H];
+	unsigned char indices[TEXTURE_W * TEXTURE_H];
+	unsigned int palette[256], i;
+
+	for (i = 0; i < 256; i++)
+		palette[i] = random_color();
+	for (i = 0; i < TEXTURE_W * TEXTURE_H; i++) {
+		indices[i] = rand() & 0xFF;
+		texels[i] = palette[indices[i]];
+	}
+
+	vita2d_texture *reference = create_texture(SCE_GXM_TEXTURE_FORMAT_A8B8G8R8, SCE_GXM_TEXTURE_LINEAR,
+						   TEXTURE_W, TEXTURE_H, texels, 4);
+	vita2d_texture *texture = create_texture(SCE_GXM_TEXTURE_FORMAT_P8_ABGR, SCE_GXM_TEXTURE_SWIZZLED,
+						 TEXTURE_W, TEXTURE_H, indices, 1);
+
+	if (reference && texture) {
+		memcpy(vita2d_texture_get_palette(texture), palette, sizeof(palette));
+		render(expected, draw_texture, reference);
+		render(actual, draw_texture, texture);
+		CHECK(stats.skipped_draws == 0);
+		CHECK(frame_diff(expected, actual) == 0);
+	}
+
+	vita2d_free_texture(reference);
+	vita2d_free_texture(texture);
+}
+
+static void draw_region_clipped(void *arg)
+{
+	SceGxmRegionClipMode mode = *(SceGxmRegionClipMode *)arg;
+
+	vita2d_set_region_clip(mode, 40, 50, 100, 90);
+	vita2d_draw_rectangle(0, 0, FRAME_WIDTH, FRAME_HEIGHT, 0xFFFFFFFF);
+	vita2d_set_region_clip(SCE_GXM_REGION_CLIP_NONE, 0, 0, 0, 0);
+}
+
+/* The tiles of 40,50 - 100,90 are 32,32 - 127,95 */
+static void test_region_clip(SceGxmRegionClipMode mode)
+{
+	unsigned int x, y, bad = 0;
+
+	render(actual, draw_region_clipped, &mode);
+
+	for (y = 0; y < FRAME_HEIGHT; y++) {
+		for (x = 0; x < FRAME_WIDTH; x++) {
+			int tile = x >= 32 && x <= 127 && y >= 32 && y <= 95;
+			int drawn = mode == SCE_GXM_REGION_CLIP_OUTSIDE ? tile : !tile;
+			bad += (actual[y * FRAME_WIDTH + x] == 0xFFFFFFFF) != drawn;
+		}
+	}
+	CHECK(bad == 0);
+}
+
+int main()
+{
+	vita2d_host_set_rasterizer(1);
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	srand(1);
+	vita2d_set_clear_color(RGBA8(0, 0, 0, 0));
+
+	test_mesh();
+	test_layouts(64, 64);
+	test_layouts(TEXTURE_W, TEXTURE_H);
+	test_format(SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR, pixel_pack_rgba8888_to_bgr565, 0, 5);
+	test_format(SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR, pixel_pack_rgba8888_to_abgr4444, 4, 9);
+	test_format(SCE_GXM_TEXTURE_FORMAT_U1U5U5U5_ABGR, pixel_pack_rgba8888_to_abgr1555, 1, 5);
+	test_palette();
+	test_region_clip(SCE_GXM_REGION_CLIP_OUTSIDE);
+	test_region_clip(SCE_GXM_REGION_CLIP_INSIDE);
+
+	vita2d_fini();
+
+	return test_result("raster");
+}
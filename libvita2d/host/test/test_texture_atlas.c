@@ -0,0 +1,210 @@
+/*
+ * Glyph eviction from the shared font atlas and the bin packing tree
+ * underneath it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vita2d.h>
+#include "texture_atlas.h"
+#include "test.h"
+
+#define ATLAS_SIZE	64
+
+static const texture_atlas_entry_data no_data;
+
+/* Replaces the glibc malloc() so the next allocation can be made to fail */
+extern void *__libc_malloc(size_t size);
+static int fail_next_malloc = 0;
+
+void *malloc(size_t size)
+{
+	if (fail_next_malloc) {
+		fail_next_malloc = 0;
+		return NULL;
+	}
+	return __libc_malloc(size);
+}
+
+static int overlap(const bp2d_rectangle *a, const bp2d_rectangle *b)
+{
+	return a->x < b->x + b->w && b->x < a->x + a->w &&
+	       a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+static int insert(texture_atlas *atlas, unsigned int owner, unsigned int key, int w, int h)
+{
+	bp2d_size size = {w, h};
+	bp2d_position pos;
+
+	return texture_atlas_insert(atlas, TEXTURE_ATLAS_KEY(owner, key), &size, &no_data, &pos);
+}
+
+static int get_rect(texture_atlas *atlas, unsigned int owner, unsigned int key, bp2d_rectangle *rect)
+{
+	texture_atlas_entry_data data;
+
+	return texture_atlas_get(atlas, TEXTURE_ATLAS_KEY(owner, key), rect, &data);
+}
+
+/* An empty glyph of one font must not take a live glyph of another one with it */
+static void test_evict_empty_glyph()
+{
+	unsigned int owner1, owner2, owner3;
+	bp2d_rectangle a, c;
+
+	texture_atlas *atlas = texture_atlas_acquire(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, &owner1);
+	CHECK(texture_atlas_is_shared(atlas));
+	CHECK(texture_atlas_acquire(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, &owner2) == atlas);
+
+	CHECK(insert(atlas, owner1, 'A', 10, 10));
+	CHECK(insert(atlas, owner2, ' ', 0, 0));
+	CHECK(get_rect(atlas, owner1, 'A', &a));
+
+	texture_atlas_release(atlas, owner2);
+
+	CHECK(texture_atlas_acquire(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, &owner3) == atlas);
+	CHECK(insert(atlas, owner3, 'C', 10, 10));
+	CHECK(get_rect(atlas, owner1, 'A', &a));
+	CHECK(get_rect(atlas, owner3, 'C', &c));
+	CHECK(!overlap(&a, &c));
+
+	texture_atlas_release(atlas, owner3);
+	texture_atlas_release(atlas, owner1);
+}
+
+/* Once a font is gone, its space is whole again for the next ones */
+static void test_evict_coalesces()
+{
+	unsigned int keeper, owner, next;
+	int glyphs = 0;
+
+	texture_atlas *atlas = texture_atlas_acquire(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, &keeper);
+	CHECK(texture_atlas_acquire(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, &owner) == atlas);
+
+	while (insert(atlas, owner, glyphs, 7, 9))
+		glyphs++;
+	CHECK(glyphs > 0);
+	CHECK(insert(atlas, owner, ' ', 0, 0));
+
+	texture_atlas_release(atlas, owner);
+	CHECK(atlas->bp_root->left == NULL && atlas->bp_root->right == NULL);
+
+	CHECK(texture_atlas_acquire(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, &next) == atlas);
+	CHECK(insert(atlas, next, 'W', ATLAS_SIZE, ATLAS_SIZE));
+
+	texture_atlas_release(atlas, next);
+	texture_atlas_release(atlas, keeper);
+}
+
+/* An owner id whose glyphs couldn't be evicted must not be handed out again */
+static void test_evict_out_of_memory()
+{
+	unsigned int keeper, owner, next;
+
+	texture_atlas *atlas = texture_atlas_acquire(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, &keeper);
+	CHECK(texture_atlas_acquire(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, &owner) == atlas);
+	CHECK(insert(atlas, owner, 'A', 10, 10));
+
+	/* The htab the eviction rebuilds */
+	fail_next_malloc = 1;
+	texture_atlas_release(atlas, owner);
+	CHECK(!fail_next_malloc);
+
+	CHECK(texture_atlas_acquire(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, &next) == atlas);
+	CHECK(next != owner);
+	CHECK(!texture_atlas_exists(atlas, TEXTURE_ATLAS_KEY(next, 'A')));
+
+	texture_atlas_release(atlas, next);
+	texture_atlas_release(atlas, keeper);
+}
+
+static void test_bp2d_delete_merges()
+{
+	bp2d_rectangle rect = {0, 0, 32, 32};
+	bp2d_size size = {16, 16};
+	bp2d_node *root = bp2d_create(&rect);
+	bp2d_node *nodes[4];
+	bp2d_position pos;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		CHECK(bp2d_insert(root, &size, &pos, &nodes[i]));
+	CHECK(!bp2d_insert(root, &size, &pos, NULL));
+
+	/* Only merged when both halves are free */
+	CHECK(bp2d_delete(root, nodes[1]));
+	CHECK(root->left != NULL);
+	CHECK(bp2d_insert(root, &size, &pos, &nodes[1]));
+
+	CHECK(bp2d_delete(root, nodes[3]));
+	CHECK(bp2d_delete(root, nodes[0]));
+	CHECK(bp2d_delete(root, nodes[2]));
+	CHECK(root->left != NULL);
+	CHECK(bp2d_delete(root, nodes[1]));
+	CHECK(root->left == NULL && root->right == NULL && !root->filled);
+
+	CHECK(!bp2d_delete(root, NULL));
+
+	bp2d_free(root);
+}
+
+/* num_entries of a snapshot is the 8th word of its header */
+static int patch_num_entries(const char *path, unsigned int num_entries)
+{
+	FILE *fp = fopen(path, "r+b");
+	int ret;
+
+	if (!fp)
+		return 0;
+
+	ret = fseek(fp, 7 * sizeof(unsigned int), SEEK_SET) == 0 &&
+	      fwrite(&num_entries, sizeof(num_entries), 1, fp) == 1;
+	fclose(fp);
+
+	return ret;
+}
+
+static void test_load_rejects_huge_counts()
+{
+	const char *path = "test/bin/atlas.v2da";
+	bp2d_rectangle rect;
+	texture_atlas *atlas = texture_atlas_create(ATLAS_SIZE, ATLAS_SIZE, SCE_GXM_TEXTURE_FORMAT_U8_R111, VITA2D_MEM_FONT_ATLAS);
+
+	CHECK(atlas != NULL);
+	if (!atlas)
+		return;
+
+	CHECK(insert(atlas, 0, 'A', 10, 10));
+	CHECK(texture_atlas_save(atlas, path, 1234));
+	CHECK(texture_atlas_load(atlas, path, 1234));
+	CHECK(get_rect(atlas, 0, 'A', &rect));
+
+	/* Its size in bytes wraps around on 32 bit */
+	CHECK(patch_num_entries(path, 0x40000001));
+	CHECK(!texture_atlas_load(atlas, path, 1234));
+	CHECK(get_rect(atlas, 0, 'A', &rect));
+
+	remove(path);
+	texture_atlas_free(atlas);
+}
+
+int main()
+{
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	vita2d_set_shared_font_atlas_size(ATLAS_SIZE, ATLAS_SIZE);
+
+	test_evict_empty_glyph();
+	test_evict_coalesces();
+	test_evict_out_of_memory();
+	test_bp2d_delete_merges();
+	test_load_rejects_huge_counts();
+
+	vita2d_fini();
+
+	return test_result("texture_atlas");
+}
@@ -0,0 +1,105 @@
+/*
+ * Texture cache hits: the same image loaded with other load settings must
+ * give another texture, and the first one again once they're restored.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+#include <vita2d.h>
+#include "test.h"
+
+#define SIZE	16
+
+static void *make_png(png_alloc_size_t *size)
+{
+	unsigned int pixels[SIZE * SIZE];
+	png_image image;
+	void *png;
+	int i;
+
+	/* A few colors, so that it can be palettized */
+	for (i = 0; i < SIZE * SIZE; i++)
+		pixels[i] = 0xFF000000 | (i % 3) * 0x7F;
+
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	image.width = SIZE;
+	image.height = SIZE;
+	image.format = PNG_FORMAT_RGBA;
+
+	if (!png_image_write_get_memory_size(image, *size, 0, pixels, 0, NULL))
+		return NULL;
+	png = malloc(*size);
+	if (png && !png_image_write_to_memory(&image, png, size, 0, pixels, 0, NULL)) {
+		free(png);
+		return NULL;
+	}
+
+	return png;
+}
+
+int main()
+{
+	vita2d_texture_cache_stats stats;
+	png_alloc_size_t size;
+	void *png;
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	png = make_png(&size);
+	CHECK(png != NULL);
+	if (!png)
+		return test_result("texture_cache");
+
+	vita2d_texture *plain = vita2d_texture_cache_load_buffer(png, size);
+	CHECK(plain != NULL);
+	CHECK(vita2d_texture_cache_load_buffer(png, size) == plain);
+
+	CHECK(vita2d_texture_set_load_format(SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR));
+	vita2d_texture *packed = vita2d_texture_cache_load_buffer(png, size);
+	CHECK(packed != NULL && packed != plain);
+	CHECK(vita2d_texture_get_format(packed) == SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR);
+	CHECK(vita2d_texture_set_load_format(SCE_GXM_TEXTURE_FORMAT_A8B8G8R8));
+
+	vita2d_texture_set_load_palette(VITA2D_PALETTE_EXACT);
+	vita2d_texture *p8 = vita2d_texture_cache_load_buffer(png, size);
+	CHECK(p8 != NULL && p8 != plain && p8 != packed);
+	vita2d_texture_set_load_palette(VITA2D_PALETTE_NONE);
+
+	vita2d_texture_set_load_layout(SCE_GXM_TEXTURE_SWIZZLED);
+	vita2d_texture *swizzled = vita2d_texture_cache_load_buffer(png, size);
+	CHECK(swizzled != NULL && swizzled != plain);
+	vita2d_texture_set_load_layout(SCE_GXM_TEXTURE_LINEAR);
+
+	vita2d_texture_set_load_mipmaps(1);
+	vita2d_texture *mipmapped = vita2d_texture_cache_load_buffer(png, size);
+	CHECK(mipmapped != NULL && mipmapped != plain);
+	vita2d_texture_set_load_mipmaps(0);
+
+	/* Back to the first settings */
+	CHECK(vita2d_texture_cache_load_buffer(png, size) == plain);
+
+	vita2d_texture_cache_get_stats(&stats);
+	CHECK(stats.num_textures == 5);
+	CHECK(stats.hits == 2 && stats.misses == 5);
+
+	vita2d_texture_cache_release(plain);
+	vita2d_texture_cache_release(plain);
+	vita2d_texture_cache_release(plain);
+	vita2d_texture_cache_release(packed);
+	vita2d_texture_cache_release(p8);
+	vita2d_texture_cache_release(swizzled);
+	vita2d_texture_cache_release(mipmapped);
+
+	vita2d_texture_cache_get_stats(&stats);
+	CHECK(stats.num_textures == 0);
+
+	free(png);
+	vita2d_fini();
+
+	return test_result("texture_cache");
+}
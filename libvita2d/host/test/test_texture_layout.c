@@ -0,0 +1,133 @@
+/*
+ * Row copies of texture_layout.c against naive texel index functions, for
+ * power of two and arbitrary sizes, square or not, and every texel size.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "texture_layout.h"
+#include "test.h"
+
+#define PAD	0xEE
+
+static unsigned int naive_pot(unsigned int x)
+{
+	unsigned int pot = 1;
+	while (pot < x)
+		pot *= 2;
+	return pot;
+}
+
+/* Morton order within squares of the shorter side, the squares one after the other */
+static unsigned int naive_swizzle(unsigned int pw, unsigned int ph, unsigned int x, unsigned int y)
+{
+	unsigned int side = pw < ph ? pw : ph;
+	unsigned int offset = 0, b;
+
+	for (b = 0; (1U << b) < side; b++) {
+		offset |= ((x >> b) & 1) << (2 * b);
+		offset |= ((y >> b) & 1) << (2 * b + 1);
+	}
+
+	return offset + (pw > ph ? x / side : y / side) * side * side;
+}
+
+static unsigned int naive_index(SceGxmTextureType type, unsigned int w, unsigned int h,
+				unsigned int x, unsigned int y, unsigned int *size)
+{
+	unsigned int aw, ah;
+
+	switch (type) {
+	case SCE_GXM_TEXTURE_SWIZZLED:
+		aw = naive_pot(w);
+		ah = naive_pot(h);
+		*size = aw * ah;
+		return naive_swizzle(aw, ah, x, y);
+	case SCE_GXM_TEXTURE_TILED:
+		aw = (w + 31) / 32 * 32;
+		ah = (h + 31) / 32 * 32;
+		*size = aw * ah;
+		return ((y / 32) * (aw / 32) + x / 32) * 32 * 32 + (y % 32) * 32 + x % 32;
+	default:
+		aw = (w + 7) / 8 * 8;
+		*size = aw * h;
+		return y * aw + x;
+	}
+}
+
+static unsigned char texel_byte(unsigned int x, unsigned int y, unsigned int k)
+{
+	unsigned int v = (x * 0x9E3779B1U) ^ (y * 0x85EBCA77U) ^ (k * 0xC2B2AE3DU);
+	return (v >> 24) ^ (v >> 13) ^ v;
+}
+
+static void test_layout(SceGxmTextureType type, unsigned int w, unsigned int h, unsigned int bpp)
+{
+	unsigned int size, aligned_w, aligned_h, x, y, k, bad = 0;
+
+	naive_index(type, w, h, 0, 0, &size);
+	texture_layout_dimensions(type, w, h, &aligned_w, &aligned_h);
+	CHECK(aligned_w * aligned_h == size);
+
+	unsigned char *data = malloc(size * bpp);
+	unsigned char *written = calloc(size, 1);
+	unsigned char *row = malloc(w * bpp);
+	unsigned char *back = malloc(w * bpp);
+	memset(data, PAD, size * bpp);
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++)
+			for (k = 0; k < bpp; k++)
+				row[x * bpp + k] = texel_byte(x, y, k);
+		texture_layout_write_row(type, data, w, h, bpp, y, row, w);
+	}
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			unsigned int index = naive_index(type, w, h, x, y, &size);
+			bad += texture_layout_offset(type, w, h, x, y) != index;
+			for (k = 0; k < bpp; k++)
+				bad += data[index * bpp + k] != texel_byte(x, y, k);
+			written[index] = 1;
+		}
+
+		texture_layout_read_row(type, data, w, h, bpp, y, back, w);
+		for (x = 0; x < w; x++)
+			for (k = 0; k < bpp; k++)
+				bad += back[x * bpp + k] != texel_byte(x, y, k);
+	}
+
+	/* The padding is left alone */
+	for (x = 0; x < size; x++)
+		for (k = 0; !written[x] && k < bpp; k++)
+			bad += data[x * bpp + k] != PAD;
+
+	if (bad)
+		fprintf(stderr, "type 0x%08x %ux%u %u bpp: %u bad bytes\n", type, w, h, bpp, bad);
+	CHECK(bad == 0);
+
+	free(data);
+	free(written);
+	free(row);
+	free(back);
+}
+
+int main()
+{
+	static const SceGxmTextureType types[] = {
+		SCE_GXM_TEXTURE_LINEAR, SCE_GXM_TEXTURE_SWIZZLED, SCE_GXM_TEXTURE_TILED
+	};
+	static const unsigned int sizes[][2] = {
+		{1, 1}, {8, 8}, {64, 64}, {128, 16}, {16, 128}, {2, 256},
+		{3, 5}, {33, 17}, {100, 7}, {7, 100}, {65, 64}, {257, 3}
+	};
+	static const unsigned int bpps[] = {1, 2, 3, 4, 8};
+	unsigned int t, s, b;
+
+	for (t = 0; t < sizeof(types) / sizeof(*types); t++)
+		for (s = 0; s < sizeof(sizes) / sizeof(*sizes); s++)
+			for (b = 0; b < sizeof(bpps) / sizeof(*bpps); b++)
+				test_layout(types[t], sizes[s][0], sizes[s][1], bpps[b]);
+
+	return test_result("texture_layout");
+}
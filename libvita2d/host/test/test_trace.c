@@ -0,0 +1,98 @@
+/*
+ * Trace recording while other threads free traced textures, the way the
+ * async loading threads can. Needs a build with VITA2D_TRACE defined, and
+ * finds the races best with ThreadSanitizer:
+ * make -C host clean test DEFINES="-DVITA2D_TRACE -fsanitize=thread"
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <vita2d.h>
+#include "test.h"
+
+#define TRACE_PATH	"test/bin/threads.v2dt"
+#define NUM_THREADS	4
+#define PER_THREAD	64
+#define NUM_DRAWN	256
+#define NUM_FRAMES	8
+
+static vita2d_texture *freed[NUM_THREADS][PER_THREAD];
+static vita2d_texture *drawn[NUM_DRAWN];
+
+static void *free_textures(void *arg)
+{
+	vita2d_texture **textures = arg;
+	int i;
+
+	for (i = 0; i < PER_THREAD; i++)
+		vita2d_free_texture(textures[i]);
+
+	return NULL;
+}
+
+static vita2d_texture *create_texture()
+{
+	vita2d_texture *texture = vita2d_create_empty_texture(8, 8);
+	CHECK(texture != NULL);
+	return texture;
+}
+
+int main()
+{
+	pthread_t threads[NUM_THREADS];
+	int i, j, frame;
+
+	if (!vita2d_init()) {
+		fprintf(stderr, "vita2d_init failed\n");
+		return 1;
+	}
+
+	if (!vita2d_trace_start(TRACE_PATH, 0)) {
+		printf("trace: skipped, needs a build with VITA2D_TRACE\n");
+		vita2d_fini();
+		return 0;
+	}
+
+	for (i = 0; i < NUM_DRAWN; i++)
+		drawn[i] = create_texture();
+
+	/* The textures the threads free are in the trace already */
+	vita2d_start_drawing();
+	for (i = 0; i < NUM_THREADS; i++) {
+		for (j = 0; j < PER_THREAD; j++) {
+			freed[i][j] = create_texture();
+			vita2d_draw_texture(freed[i][j], j, i);
+		}
+	}
+	vita2d_end_drawing();
+	vita2d_swap_buffers();
+
+	for (i = 0; i < NUM_THREADS; i++)
+		CHECK(pthread_create(&threads[i], NULL, free_textures, freed[i]) == 0);
+
+	/* Meanwhile, new textures keep growing the object table */
+	for (frame = 0; frame < NUM_FRAMES; frame++) {
+		vita2d_start_drawing();
+		for (i = 0; i < NUM_DRAWN * (frame + 1) / NUM_FRAMES; i++)
+			vita2d_draw_texture(drawn[i], i % 960, frame);
+		vita2d_end_drawing();
+		vita2d_swap_buffers();
+	}
+
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	vita2d_trace_stop();
+	CHECK(!vita2d_trace_is_active());
+
+	for (i = 0; i < NUM_DRAWN; i++)
+		vita2d_free_texture(drawn[i]);
+
+	/* Every freed texture was defined before, and is freed only once */
+	CHECK(vita2d_trace_replay_file(TRACE_PATH, NULL));
+	remove(TRACE_PATH);
+
+	vita2d_fini();
+
+	return test_result("trace");
+}
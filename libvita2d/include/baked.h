@@ -0,0 +1,52 @@
+#ifndef BAKED_H
+#define BAKED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Baked texture files, written by tools/vita2d_bake and read by
+ * vita2d_load_baked(). The texture data is stored in its final GXM format
+ * and layout, so loading is just reading it into the GPU memory.
+ *
+ * Layout: header, texture table, image table (sorted by name), names
+ * (NUL terminated) and then the data of each texture, followed by its
+ * palette for P8 textures. All offsets are from the start of the file.
+ */
+#define BAKED_MAGIC		0x4B443256 /* "V2DK" */
+#define BAKED_VERSION		1
+#define BAKED_PALETTE_SIZE	(256 * 4)
+
+typedef struct baked_header {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int num_textures;
+	unsigned int num_images;
+	unsigned int names_size;
+} baked_header;
+
+typedef struct baked_texture {
+	unsigned int format;		/* SceGxmTextureFormat */
+	unsigned int type;		/* SceGxmTextureType */
+	unsigned int width;
+	unsigned int height;
+	unsigned int data_offset;
+	unsigned int data_size;
+	unsigned int palette_offset;	/* 0 if the texture has no palette */
+} baked_texture;
+
+typedef struct baked_image {
+	unsigned int name_offset;	/* in the names */
+	unsigned int texture;
+	unsigned short x;
+	unsigned short y;
+	unsigned short w;
+	unsigned short h;
+} baked_image;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -28,6 +28,7 @@ bp2d_node *bp2d_create(const bp2d_rectangle *rect);
 void bp2d_free(bp2d_node *node);
 // 1 success, 0 failure
 int bp2d_insert(bp2d_node *node, const bp2d_size *in_size, bp2d_position *out_pos, bp2d_node **out_node);
+// Frees the node and merges the free halves above it, 1 if it was in the tree
 int bp2d_delete(bp2d_node *root, bp2d_node *node);
 
 #ifdef __cplusplus
@@ -0,0 +1,69 @@
+#ifndef CLIP_H
+#define CLIP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Clip rectangle (see vita2d_set_clip_rectangle()). The GPU region clip
+ * cuts the draws to the 32x32 tiles the rectangle touches, which is exact
+ * when it's tile aligned. Otherwise the axis aligned quads (rectangles,
+ * unrotated textures and text) are clipped on the CPU here, and the other
+ * draws use the stencil mask, only drawn once the first of them comes.
+ */
+extern int _vita2d_clip_quads;
+extern int _vita2d_clip_stencil_pending;
+extern float _vita2d_clip_x_min, _vita2d_clip_y_min, _vita2d_clip_x_max, _vita2d_clip_y_max;
+
+void _vita2d_clip_draw_stencil();
+
+/* Before setting the state of a draw that isn't an axis aligned quad */
+static inline void clip_prepare_draw()
+{
+	if (_vita2d_clip_stencil_pending)
+		_vita2d_clip_draw_stencil();
+}
+
+/* Clips the a0-a1 side of a quad and its texture coordinates t0-t1 to min-max */
+static inline int clip_quad_axis(float *a0, float *a1, float *t0, float *t1, float min, float max)
+{
+	float lo = *a0 < *a1 ? *a0 : *a1;
+	float hi = *a0 < *a1 ? *a1 : *a0;
+
+	if (lo >= max || hi <= min)
+		return 0;
+	if (lo >= min && hi <= max)
+		return 1;
+
+	float c0 = *a0 < min ? min : (*a0 > max ? max : *a0);
+	float c1 = *a1 < min ? min : (*a1 > max ? max : *a1);
+	float dt = (*t1 - *t0) / (*a1 - *a0);
+
+	*t1 = *t0 + (c1 - *a0) * dt;
+	*t0 = *t0 + (c0 - *a0) * dt;
+	*a0 = c0;
+	*a1 = c1;
+
+	return 1;
+}
+
+/*
+ * Clips the quad x0,y0 - x1,y1 (flipped if x1 < x0 or y1 < y0) with its
+ * texture coordinates to the clip rectangle. Returns 0 if nothing's left of
+ * it, the draw can then be skipped.
+ */
+static inline int clip_quad(float *x0, float *y0, float *x1, float *y1, float *u0, float *v0, float *u1, float *v1)
+{
+	if (!_vita2d_clip_quads)
+		return 1;
+
+	return clip_quad_axis(x0, x1, u0, u1, _vita2d_clip_x_min, _vita2d_clip_x_max) &&
+	       clip_quad_axis(y0, y1, v0, v1, _vita2d_clip_y_min, _vita2d_clip_y_max);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef GPU_HEAP_H
+#define GPU_HEAP_H
+
+#include <psp2/types.h>
+#include <psp2/kernel/sysmem.h>
+#include "vita2d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Buddy allocator that carves small GPU allocations out of a few big mapped
+ * memblocks, instead of one memblock (rounded up to 256 KiB in CDRAM) each.
+ */
+#define GPU_HEAP_BLOCK_ORDER	21	/* 2 MiB memblocks */
+#define GPU_HEAP_MIN_ORDER	10	/* 1 KiB smallest chunk */
+#define GPU_HEAP_MAX_ORDER	18	/* 256 KiB, bigger allocations get their own memblock */
+#define GPU_HEAP_BLOCK_SIZE	(1U << GPU_HEAP_BLOCK_ORDER)
+#define GPU_HEAP_NUM_ORDERS	(GPU_HEAP_BLOCK_ORDER - GPU_HEAP_MIN_ORDER + 1)
+#define GPU_HEAP_NUM_UNITS	(GPU_HEAP_BLOCK_SIZE >> GPU_HEAP_MIN_ORDER)
+
+int gpu_heap_init();
+void gpu_heap_fini();
+
+/*
+ * Same as gpu_alloc(), uid is set to the memblock holding the allocation,
+ * which is shared with other allocations if it came from the heap.
+ */
+void *gpu_heap_alloc(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attribs, vita2d_mem_category category, SceUID *uid);
+/* Releases memory from gpu_heap_alloc(), or from gpu_alloc() if uid isn't a heap memblock */
+void gpu_heap_free(SceUID uid, void *mem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
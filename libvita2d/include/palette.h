@@ -0,0 +1,51 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Conversion of RGBA8888 images to 256 color palettes. Images with at most
+ * 256 colors keep them exactly, found through a hash table. Others can be
+ * reduced with a median cut over a histogram of the colors at 4 bits per channel.
+ */
+#define PALETTE_MAX_COLORS	256
+#define PALETTE_HASH_SIZE	1024	/* Power of two, well above the max colors */
+#define PALETTE_HIST_BITS	4
+#define PALETTE_HIST_SIZE	(1U << (4 * PALETTE_HIST_BITS))
+
+typedef struct palette {
+	unsigned int colors[PALETTE_MAX_COLORS];
+	unsigned int num_colors;
+	unsigned int keys[PALETTE_HASH_SIZE];
+	/* Color index + 1, 0 for empty slots */
+	unsigned short values[PALETTE_HASH_SIZE];
+	unsigned int last_color;
+	unsigned int last_index;
+} palette;
+
+typedef struct palette_quantizer {
+	unsigned int *histogram;
+	/* Palette index of every histogram bin, once quantized */
+	unsigned char *bin_index;
+} palette_quantizer;
+
+void palette_init(palette *pal);
+/* Returns 0 if the colors don't fit in the palette anymore */
+int palette_add_row(palette *pal, const unsigned int *row, unsigned int count);
+/* All the colors of the row must have been added */
+void palette_map_row(palette *pal, const unsigned int *row, unsigned char *out, unsigned int count);
+
+int palette_quantizer_init(palette_quantizer *q);
+void palette_quantizer_fini(palette_quantizer *q);
+void palette_quantizer_add_row(palette_quantizer *q, const unsigned int *row, unsigned int count);
+/* Median cut of the colors added so far into at most max_colors colors */
+unsigned int palette_quantizer_build(palette_quantizer *q, unsigned int *colors, unsigned int max_colors);
+void palette_quantizer_map_row(const palette_quantizer *q, const unsigned int *row, unsigned char *out, unsigned int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Row converters to RGBA8888 (A8B8G8R8 texture byte order). NEON versions
+ * are used when available, otherwise plain C loops the compiler can vectorize.
+ * src doesn't need to be aligned.
+ */
+typedef void (*pixel_convert_fn)(const void *src, void *dst, unsigned int count);
+
+void pixel_convert_bgra8888_to_rgba8888(const void *src, void *dst, unsigned int count);
+void pixel_convert_bgr888_to_rgba8888(const void *src, void *dst, unsigned int count);
+// 5 and 6 bit channels are expanded by bit replication
+void pixel_convert_bgr565_to_rgba8888(const void *src, void *dst, unsigned int count);
+
+/*
+ * Packers of RGBA8888 rows to 16 bit texture formats (named from the most
+ * significant bits down), ordered dithered by row y if dither is set and
+ * rounded otherwise. dst may be the same buffer as src.
+ */
+typedef void (*pixel_pack_fn)(const void *src, void *dst, unsigned int count, unsigned int y, int dither);
+
+void pixel_pack_rgba8888_to_bgr565(const void *src, void *dst, unsigned int count, unsigned int y, int dither);
+void pixel_pack_rgba8888_to_abgr4444(const void *src, void *dst, unsigned int count, unsigned int y, int dither);
+void pixel_pack_rgba8888_to_abgr1555(const void *src, void *dst, unsigned int count, unsigned int y, int dither);
+
+/*
+ * 2x2 box filter of two rows of src_count pixels of bpp 8 bit channels, into
+ * src_count / 2 pixels (1 if src_count is 1). Used to build mip levels.
+ */
+void pixel_downsample_2x2(const void *src0, const void *src1, void *dst, unsigned int src_count, unsigned int bpp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
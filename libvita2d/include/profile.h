@@ -0,0 +1,51 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <psp2/gxm.h>
+#include <psp2/kernel/processmgr.h>
+#include "vita2d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Frame profiler hooks, they compile to nothing unless VITA2D_PROFILE is
+ * defined. Times and counts are added up over the frame, which ends (and
+ * is recorded) in vita2d_swap_buffers().
+ */
+#ifdef VITA2D_PROFILE
+#  define PROFILE_BEGIN(start)			SceUInt64 start = sceKernelGetProcessTimeWide()
+#  define PROFILE_END(section, start)		profile_add_time(section, sceKernelGetProcessTimeWide() - (start))
+#  define PROFILE_COUNT(counter, n)		profile_add_count(counter, n)
+#  define PROFILE_MAX(counter, n)		profile_max_count(counter, n)
+#  define PROFILE_END_FRAME()			profile_end_frame()
+#else
+#  define PROFILE_BEGIN(start)
+#  define PROFILE_END(section, start)
+#  define PROFILE_COUNT(counter, n)
+#  define PROFILE_MAX(counter, n)
+#  define PROFILE_END_FRAME()
+#endif
+
+void profile_add_time(vita2d_profile_section section, unsigned int us);
+void profile_add_count(vita2d_profile_counter counter, unsigned int n);
+void profile_max_count(vita2d_profile_counter counter, unsigned int n);
+void profile_end_frame();
+
+/* sceGxmDraw, timed and counted */
+static inline void profile_draw(SceGxmContext *context, SceGxmPrimitiveType type, SceGxmIndexFormat index_type,
+				const void *index_data, unsigned int index_count)
+{
+	PROFILE_BEGIN(start);
+	sceGxmDraw(context, type, index_type, index_data, index_count);
+	PROFILE_END(VITA2D_PROFILE_DRAW, start);
+	PROFILE_COUNT(VITA2D_PROFILE_DRAW_CALLS, 1);
+	PROFILE_COUNT(VITA2D_PROFILE_VERTICES, index_count);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
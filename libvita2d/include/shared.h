@@ -13,5 +13,20 @@ extern const SceGxmProgramParameter *_vita2d_colorWvpParam;
 extern const SceGxmProgramParameter *_vita2d_textureWvpParam;
 extern SceGxmProgramParameter *_vita2d_textureTintColorParam;
 
+/* For textures whose memory is accounted for under another category (font atlases) */
+vita2d_texture *_vita2d_create_empty_texture_format_category(unsigned int w, unsigned int h, SceGxmTextureFormat format, vita2d_mem_category category);
+/* Uninitialized texture of any type, size bytes big (including all the mip levels) */
+vita2d_texture *_vita2d_create_empty_texture_type(unsigned int w, unsigned int h, SceGxmTextureFormat format, SceGxmTextureType type, unsigned int mip_count, unsigned int size);
+/* For the image loaders, in the layout set with vita2d_texture_set_load_layout() */
+vita2d_texture *_vita2d_create_empty_texture_load(unsigned int w, unsigned int h, SceGxmTextureFormat format, int clear);
+/* If A8B8G8R8 rows can be decoded straight into the texture memory */
+int _vita2d_texture_load_direct(const vita2d_texture *texture);
+/* Stores an A8B8G8R8 row in the texture format and layout, tmp is a row of scratch space (can be rgba) */
+void _vita2d_texture_store_rgba_row(vita2d_texture *texture, unsigned int y, const void *rgba, void *tmp);
+/* GPU memory used by the texture data, all its mip levels and palette included */
+unsigned int _vita2d_texture_get_size(const vita2d_texture *texture);
+/* Last step of the loaders: palettizes the texture or fills its mip levels, returns the texture to use */
+vita2d_texture *_vita2d_texture_load_done(vita2d_texture *texture);
+
 
 #endif
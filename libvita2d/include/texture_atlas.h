@@ -20,6 +20,7 @@ typedef struct texture_atlas_entry_data {
 typedef struct texture_atlas_htab_entry {
 	bp2d_rectangle rect;
 	texture_atlas_entry_data data;
+	bp2d_node *node;	/* NULL for empty glyphs and the ones loaded from a file */
 } atlas_htab_entry;
 
 typedef struct texture_atlas {
@@ -28,7 +29,17 @@ typedef struct texture_atlas {
 	int_htab *htab;
 } texture_atlas;
 
-texture_atlas *texture_atlas_create(int width, int height, SceGxmTextureFormat format);
+/* Keys of the shared atlas carry the owner id in the top 8 bits */
+#define TEXTURE_ATLAS_OWNER_SHIFT	24
+#define TEXTURE_ATLAS_MAX_OWNERS	256
+#define TEXTURE_ATLAS_KEY(owner, key)	(((owner) << TEXTURE_ATLAS_OWNER_SHIFT) | (key))
+
+// Called by vita2d_init() and vita2d_fini()
+int texture_atlas_init();
+void texture_atlas_fini();
+
+texture_atlas *texture_atlas_create(int width, int height, SceGxmTextureFormat format,
+				    vita2d_mem_category category);
 void texture_atlas_free(texture_atlas *atlas);
 int texture_atlas_insert(texture_atlas *atlas, unsigned int character,
 			 const bp2d_size *size,
@@ -39,6 +50,24 @@ int texture_atlas_exists(texture_atlas *atlas, unsigned int character);
 int texture_atlas_get(texture_atlas *atlas, unsigned int character,
 		      bp2d_rectangle *rect, texture_atlas_entry_data *data);
 
+// 1 success, 0 failure (the atlas is left untouched unless the pixels fail to load)
+// The shared atlas can't be saved nor loaded since it mixes several fonts
+int texture_atlas_save(const texture_atlas *atlas, const char *filename, unsigned int hash);
+int texture_atlas_load(texture_atlas *atlas, const char *filename, unsigned int hash);
+
+/*
+ * Returns the shared font atlas (and a new owner id) if it's enabled,
+ * otherwise a new private atlas of the given size with owner id 0.
+ */
+texture_atlas *texture_atlas_acquire(int width, int height, SceGxmTextureFormat format,
+				     unsigned int *owner);
+// Frees a private atlas or evicts the owner glyphs from the shared one
+void texture_atlas_release(texture_atlas *atlas, unsigned int owner);
+int texture_atlas_is_shared(const texture_atlas *atlas);
+// Only the shared atlas is actually locked
+void texture_atlas_lock(texture_atlas *atlas);
+void texture_atlas_unlock(texture_atlas *atlas);
+
 
 #ifdef __cplusplus
 }
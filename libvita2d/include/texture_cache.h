@@ -0,0 +1,16 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The cache itself is public (vita2d_texture_cache_*), these set it up with vita2d */
+int texture_cache_init();
+void texture_cache_fini();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
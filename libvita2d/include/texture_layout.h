@@ -0,0 +1,36 @@
+#ifndef TEXTURE_LAYOUT_H
+#define TEXTURE_LAYOUT_H
+
+#include <psp2/gxm.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Swizzled textures are stored in Morton order (x in the lowest bit), padded
+ * to power of two sizes. When the texture isn't square, the extra bits of the
+ * longer side go above the interleaved ones. Tiled textures are stored as
+ * 32x32 texel tiles in row order, each tile being linear.
+ */
+#define TEXTURE_LAYOUT_TILE_SIZE 32
+
+unsigned int texture_layout_pot(unsigned int x);
+/* Padded size of the texture in texels */
+void texture_layout_dimensions(SceGxmTextureType type, unsigned int w, unsigned int h,
+			       unsigned int *aligned_w, unsigned int *aligned_h);
+/* Offset in texels of (x, y), straightforward but slow */
+unsigned int texture_layout_offset(SceGxmTextureType type, unsigned int w, unsigned int h,
+				   unsigned int x, unsigned int y);
+
+/* Copies count texels from a linear row to row y of the texture and back */
+void texture_layout_write_row(SceGxmTextureType type, void *data, unsigned int w, unsigned int h,
+			      unsigned int bpp, unsigned int y, const void *row, unsigned int count);
+void texture_layout_read_row(SceGxmTextureType type, const void *data, unsigned int w, unsigned int h,
+			     unsigned int bpp, unsigned int y, void *row, unsigned int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * API call traces, recorded by vita2d_trace_start() when built with
+ * VITA2D_TRACE defined, and replayed with vita2d_trace_replay_*().
+ *
+ * Stream layout: trace_header, then records of an op byte, the number of
+ * 32 bit argument words, the id of the texture or font the call uses
+ * (0 for none), the words and, for ops with data, its size and the data
+ * padded to 4 bytes. All values are little endian, stored unaligned.
+ * Objects are defined by a TEXTURE or FONT record the first time they
+ * are used, so the replay can create stand-ins for them.
+ */
+#define TRACE_MAGIC	0x54443256 /* "V2DT" */
+#define TRACE_VERSION	1
+
+typedef struct trace_header {
+	unsigned int magic;
+	unsigned int version;
+} trace_header;
+
+typedef enum trace_op {
+	/* Object definitions */
+	TRACE_OP_TEXTURE = 1,		/* w, h, format, type, render target */
+	TRACE_OP_TEXTURE_FREE,
+	TRACE_OP_FONT,			/* trace_font_kind */
+	TRACE_OP_FONT_FREE,
+	/* Frame and state */
+	TRACE_OP_START_DRAWING,
+	TRACE_OP_START_DRAWING_ADVANCED,
+	TRACE_OP_END_DRAWING,
+	TRACE_OP_CLEAR_SCREEN,
+	TRACE_OP_SWAP_BUFFERS,
+	TRACE_OP_SET_CLEAR_COLOR,
+	TRACE_OP_SET_VBLANK_WAIT,
+	TRACE_OP_SET_REGION_CLIP,
+	TRACE_OP_ENABLE_CLIPPING,
+	TRACE_OP_DISABLE_CLIPPING,
+	TRACE_OP_SET_CLIP_RECTANGLE,
+	TRACE_OP_SET_BLEND_MODE_ADD,
+	TRACE_OP_POOL_RESET,
+	TRACE_OP_TEXTURE_SET_FILTERS,
+	/* Shapes */
+	TRACE_OP_DRAW_PIXEL,
+	TRACE_OP_DRAW_LINE,
+	TRACE_OP_DRAW_RECTANGLE,
+	TRACE_OP_DRAW_FILL_CIRCLE,
+	TRACE_OP_DRAW_ARRAY,		/* data: the vertices */
+	/* Textures */
+	TRACE_OP_DRAW_TEXTURE,
+	TRACE_OP_DRAW_TEXTURE_ROTATE,
+	TRACE_OP_DRAW_TEXTURE_ROTATE_HOTSPOT,
+	TRACE_OP_DRAW_TEXTURE_SCALE,
+	TRACE_OP_DRAW_TEXTURE_PART,
+	TRACE_OP_DRAW_TEXTURE_PART_SCALE,
+	TRACE_OP_DRAW_TEXTURE_SCALE_ROTATE_HOTSPOT,
+	TRACE_OP_DRAW_TEXTURE_SCALE_ROTATE,
+	TRACE_OP_DRAW_TEXTURE_PART_SCALE_ROTATE,
+	TRACE_OP_DRAW_TEXTURE_TINT,
+	TRACE_OP_DRAW_TEXTURE_TINT_ROTATE,
+	TRACE_OP_DRAW_TEXTURE_TINT_ROTATE_HOTSPOT,
+	TRACE_OP_DRAW_TEXTURE_TINT_SCALE,
+	TRACE_OP_DRAW_TEXTURE_TINT_PART,
+	TRACE_OP_DRAW_TEXTURE_TINT_PART_SCALE,
+	TRACE_OP_DRAW_TEXTURE_TINT_SCALE_ROTATE_HOTSPOT,
+	TRACE_OP_DRAW_TEXTURE_TINT_SCALE_ROTATE,
+	TRACE_OP_DRAW_TEXTURE_PART_TINT_SCALE_ROTATE,
+	TRACE_OP_DRAW_ARRAY_TEXTURED,	/* data: the vertices */
+	/* Text, data: the string with its terminator */
+	TRACE_OP_FONT_DRAW_TEXT,	/* x, y, color, size, linespace */
+	TRACE_OP_PGF_DRAW_TEXT,		/* x, y, color, scale, linespace */
+	TRACE_OP_PVF_DRAW_TEXT,		/* x, y, color, scale, linespace */
+	TRACE_OP_COUNT
+} trace_op;
+
+typedef enum trace_font_kind {
+	TRACE_FONT_FREETYPE,
+	TRACE_FONT_PGF,
+	TRACE_FONT_PVF
+} trace_font_kind;
+
+typedef union trace_word {
+	float f;
+	unsigned int u;
+	int i;
+} trace_word;
+
+#define TRACE_F(v)	{.f = (v)}
+#define TRACE_U(v)	{.u = (v)}
+#define TRACE_I(v)	{.i = (v)}
+
+/*
+ * Records the call, unless it's made from inside another traced call.
+ * The nesting depth goes back down when the calling function returns.
+ */
+#ifdef VITA2D_TRACE
+#  define TRACE_WORDS(...)	((const trace_word[]){__VA_ARGS__})
+#  define TRACE_NUM_WORDS(...)	(sizeof(TRACE_WORDS(__VA_ARGS__)) / sizeof(trace_word))
+#  define TRACE_CALL_DATA(op, object, data, size, ...) \
+	int _trace_scope __attribute__((cleanup(trace_leave), unused)) = \
+		trace_enter(op, object, data, size, TRACE_WORDS(__VA_ARGS__), TRACE_NUM_WORDS(__VA_ARGS__))
+#  define TRACE_CALL(op, object, ...)	TRACE_CALL_DATA(op, object, NULL, 0, __VA_ARGS__)
+#  define TRACE_CALL_NOARGS(op, object) \
+	int _trace_scope __attribute__((cleanup(trace_leave), unused)) = \
+		trace_enter(op, object, NULL, 0, NULL, 0)
+#  define TRACE_FORGET(object)		trace_forget(object)
+#else
+#  define TRACE_CALL_DATA(op, object, data, size, ...)
+#  define TRACE_CALL(op, object, ...)
+#  define TRACE_CALL_NOARGS(op, object)
+#  define TRACE_FORGET(object)
+#endif
+
+// Called by vita2d_init() and vita2d_fini(), the latter stops the trace
+int trace_init();
+void trace_fini();
+
+int trace_enter(trace_op op, const void *object, const void *data, unsigned int size,
+		const trace_word *words, unsigned int num_words);
+void trace_leave(int *scope);
+/* The object is being freed, its address may be reused by another one */
+void trace_forget(const void *object);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
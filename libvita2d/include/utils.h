@@ -4,6 +4,7 @@
 #include <psp2/gxm.h>
 #include <psp2/types.h>
 #include <psp2/kernel/sysmem.h>
+#include "vita2d.h"
 
 /* Misc utils */
 #define ALIGN(x, a)	(((x) + ((a) - 1)) & ~((a) - 1))
@@ -13,13 +14,24 @@
 /* Font utils */
 int utf8_to_ucs2(const char *utf8, unsigned int *character);
 
+/* Hash utils */
+#define FNV1A_INIT	2166136261U
+/* Another offset basis, for a second hash independent of the first one */
+#define FNV1A_INIT_ALT	(FNV1A_INIT ^ 0x5BD1E995U)
+unsigned int fnv1a_hash(const void *data, unsigned int size, unsigned int hash);
+
 /* GPU utils */
-void *gpu_alloc(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attribs, SceUID *uid);
+int gpu_mem_init();
+void gpu_mem_fini();
+void *gpu_alloc(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attribs, vita2d_mem_category category, SceUID *uid);
 void gpu_free(SceUID uid);
-void *vertex_usse_alloc(unsigned int size, SceUID *uid, unsigned int *usse_offset);
+void *vertex_usse_alloc(unsigned int size, vita2d_mem_category category, SceUID *uid, unsigned int *usse_offset);
 void vertex_usse_free(SceUID uid);
-void *fragment_usse_alloc(unsigned int size, SceUID *uid, unsigned int *usse_offset);
+void *fragment_usse_alloc(unsigned int size, vita2d_mem_category category, SceUID *uid, unsigned int *usse_offset);
 void fragment_usse_free(SceUID uid);
+/* Moves part of a memblock's accounting from VITA2D_MEM_HEAP_FREE to category and back */
+void gpu_mem_account_suballoc(SceUID uid, vita2d_mem_category category, unsigned int requested, unsigned int reserved);
+void gpu_mem_account_subfree(SceUID uid, vita2d_mem_category category, unsigned int requested, unsigned int reserved);
 
 /* Math utils */
 
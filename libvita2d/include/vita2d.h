@@ -53,9 +53,104 @@ typedef struct vita2d_system_pvf_config {
 	int (*in_font_group)(unsigned int c);
 } vita2d_system_pvf_config;
 
+typedef enum vita2d_mem_category {
+	VITA2D_MEM_ALL = -1,
+	VITA2D_MEM_DISPLAY,
+	VITA2D_MEM_DEPTH_STENCIL,
+	VITA2D_MEM_RING_BUFFER,
+	VITA2D_MEM_SHADER,
+	VITA2D_MEM_POOL,
+	VITA2D_MEM_GEOMETRY,
+	VITA2D_MEM_TEXTURE,
+	VITA2D_MEM_RENDER_TARGET_DEPTH,
+	VITA2D_MEM_FONT_ATLAS,
+	VITA2D_MEM_HEAP_FREE,	/* space in the GPU heap memblocks not handed out yet */
+	VITA2D_MEM_CATEGORY_COUNT
+} vita2d_mem_category;
+
+typedef struct vita2d_mem_usage {
+	unsigned int requested;	/* bytes asked for */
+	unsigned int reserved;	/* bytes actually taken, after alignment and rounding */
+	unsigned int count;	/* number of allocations */
+} vita2d_mem_usage;
+
+/* Small textures are sub-allocated from a few big GPU memblocks */
+typedef struct vita2d_gpu_heap_stats {
+	unsigned int num_blocks;	/* memblocks owned by the heap */
+	unsigned int total_size;	/* bytes in those memblocks */
+	unsigned int used_size;		/* bytes handed out, rounded up to powers of two */
+	unsigned int requested_size;	/* bytes actually requested, the rest of used_size is internal fragmentation */
+	unsigned int free_size;
+	unsigned int largest_free;	/* if much smaller than free_size the heap is fragmented */
+	unsigned int num_free_chunks;
+	unsigned int num_allocs;
+} vita2d_gpu_heap_stats;
+
+typedef struct vita2d_texture_cache_stats {
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int evictions;		/* unreferenced textures freed to stay under the budget */
+	unsigned int num_textures;
+	unsigned int num_unreferenced;
+	unsigned int size;		/* GPU memory of all the cached textures */
+} vita2d_texture_cache_stats;
+
+/* What the image loaders do with A8B8G8R8 images that could be P8 */
+typedef enum vita2d_palette_mode {
+	VITA2D_PALETTE_NONE,		/* always A8B8G8R8 */
+	VITA2D_PALETTE_EXACT,		/* P8 if the image has at most 256 colors */
+	VITA2D_PALETTE_QUANTIZE		/* always P8, reducing the colors if there are more */
+} vita2d_palette_mode;
+
+/* Sections of the frame timed by the profiler, in microseconds */
+typedef enum vita2d_profile_section {
+	VITA2D_PROFILE_START_DRAWING,	/* vita2d_start_drawing*() */
+	VITA2D_PROFILE_DRAW,		/* submitting the draws (sceGxmDraw) */
+	VITA2D_PROFILE_END_DRAWING,	/* vita2d_end_drawing() */
+	VITA2D_PROFILE_SWAP_BUFFERS,	/* vita2d_swap_buffers() */
+	VITA2D_PROFILE_VBLANK_WAIT,	/* waiting for vblank, in the display queue callback */
+	VITA2D_PROFILE_FINISH,		/* sceGxmFinish() in vita2d_wait_rendering_done() */
+	VITA2D_PROFILE_FRAME,		/* from one vita2d_swap_buffers() to the next */
+	VITA2D_PROFILE_SECTION_COUNT
+} vita2d_profile_section;
+
+/* Counts per frame */
+typedef enum vita2d_profile_counter {
+	VITA2D_PROFILE_DRAW_CALLS,
+	VITA2D_PROFILE_VERTICES,
+	VITA2D_PROFILE_POOL_BYTES,	/* temporary pool used, at its highest */
+	VITA2D_PROFILE_COUNTER_COUNT
+} vita2d_profile_counter;
+
+/* Over the last frames (up to the profiler window) */
+typedef struct vita2d_profile_stats {
+	unsigned int frames;
+	float average;
+	unsigned int min;
+	unsigned int max;
+	unsigned int p50;
+	unsigned int p90;
+	unsigned int p99;
+} vita2d_profile_stats;
+
+/* Part of an image atlas page, to draw with vita2d_draw_texture_part() */
+typedef struct vita2d_atlas_image {
+	vita2d_texture *texture;
+	int x;
+	int y;
+	int w;
+	int h;
+} vita2d_atlas_image;
+
 typedef struct vita2d_font vita2d_font;
 typedef struct vita2d_pgf vita2d_pgf;
 typedef struct vita2d_pvf vita2d_pvf;
+typedef struct vita2d_png_loader vita2d_png_loader;
+typedef struct vita2d_async_load vita2d_async_load;
+typedef struct vita2d_image_atlas vita2d_image_atlas;
+typedef struct vita2d_baked vita2d_baked;
+
+typedef void (*vita2d_async_load_cb)(vita2d_texture *texture, void *user_data);
 
 int vita2d_init();
 int vita2d_init_advanced(unsigned int temp_pool_size);
@@ -81,6 +176,13 @@ SceGxmShaderPatcher *vita2d_get_shader_patcher();
 const uint16_t *vita2d_get_linear_indices();
 
 void vita2d_set_region_clip(SceGxmRegionClipMode mode, unsigned int x_min, unsigned int y_min, unsigned int x_max, unsigned int y_max);
+/*
+ * The clip rectangle uses the GPU region clip. When it isn't on 32 pixel
+ * tiles, rectangles, text and unrotated textures are clipped on the CPU, and
+ * the stencil buffer is only filled once something else is drawn. Draws made
+ * straight on vita2d_get_context() are then only clipped to the tiles. While
+ * vita2d_set_region_clip() is in use, the stencil buffer clips everything.
+ */
 void vita2d_enable_clipping();
 void vita2d_disable_clipping();
 int vita2d_get_clipping_enabled();
@@ -88,6 +190,31 @@ void vita2d_set_clip_rectangle(int x_min, int y_min, int x_max, int y_max);
 void vita2d_get_clip_rectangle(int *x_min, int *y_min, int *x_max, int *y_max);
 void vita2d_set_blend_mode_add(int enable);
 
+/*
+ * Frame profiler, only compiled in with VITA2D_PROFILE defined (make profile).
+ * Otherwise these return 0 and the stats are all zero. Frames end at
+ * vita2d_swap_buffers().
+ */
+int vita2d_profile_get_section(vita2d_profile_section section, vita2d_profile_stats *stats);
+int vita2d_profile_get_counter(vita2d_profile_counter counter, vita2d_profile_stats *stats);
+void vita2d_profile_reset();
+
+/*
+ * Records the drawing calls of the next frames (until vita2d_trace_stop() if
+ * frames is 0) to a file. Only compiled in with VITA2D_TRACE defined (make
+ * trace), otherwise vita2d_trace_start() returns 0.
+ */
+int vita2d_trace_start(const char *filename, unsigned int frames);
+void vita2d_trace_stop();
+int vita2d_trace_is_active();
+/*
+ * Replays a trace with blank textures of the same size, format and layout.
+ * FreeType text is drawn with font (skipped if NULL), PGF and PVF text with
+ * the default system fonts.
+ */
+int vita2d_trace_replay_file(const char *filename, vita2d_font *font);
+int vita2d_trace_replay_buffer(const void *buffer, unsigned long buffer_size, vita2d_font *font);
+
 void *vita2d_pool_malloc(unsigned int size);
 void *vita2d_pool_memalign(unsigned int size, unsigned int alignment);
 unsigned int vita2d_pool_free_space();
@@ -101,15 +228,98 @@ void vita2d_draw_array(SceGxmPrimitiveType mode, const vita2d_color_vertex *vert
 
 void vita2d_texture_set_alloc_memblock_type(SceKernelMemBlockType type);
 SceKernelMemBlockType vita2d_texture_get_alloc_memblock_type();
+/*
+ * Layout of the textures created by the PNG, JPEG and BMP loaders. Swizzled and
+ * tiled textures sample faster when drawn rotated or scaled down, but their
+ * data isn't stored in rows: use vita2d_texture_write_row() to fill them.
+ */
+void vita2d_texture_set_load_layout(SceGxmTextureType layout);
+SceGxmTextureType vita2d_texture_get_load_layout();
+/* Makes the image loaders create all the mip levels, filled from the image */
+void vita2d_texture_set_load_mipmaps(int enable);
+int vita2d_texture_get_load_mipmaps();
+/* P8 textures can't have mip levels, so loads that end up palettized only get the first one */
+void vita2d_texture_set_load_palette(vita2d_palette_mode mode);
+vita2d_palette_mode vita2d_texture_get_load_palette();
+/*
+ * Format of the textures from the PNG and BMP loaders: A8B8G8R8 (default),
+ * U5U6U5_BGR, U4U4U4U4_ABGR or U1U5U5U5_ABGR. The palette mode only applies
+ * to A8B8G8R8. Dithering uses a 4x4 ordered pattern, otherwise channels are rounded.
+ */
+int vita2d_texture_set_load_format(SceGxmTextureFormat format);
+SceGxmTextureFormat vita2d_texture_get_load_format();
+void vita2d_texture_set_load_dither(int enable);
+int vita2d_texture_get_load_dither();
 vita2d_texture *vita2d_create_empty_texture(unsigned int w, unsigned int h);
 vita2d_texture *vita2d_create_empty_texture_format(unsigned int w, unsigned int h, SceGxmTextureFormat format);
+/* Same as vita2d_create_empty_texture_format() but the data is not cleared, for callers that fill all of it */
+vita2d_texture *vita2d_create_empty_texture_format_uninitialized(unsigned int w, unsigned int h, SceGxmTextureFormat format);
+/* SCE_GXM_TEXTURE_SWIZZLED (padded to a power of two if needed), TILED or LINEAR */
+vita2d_texture *vita2d_create_empty_texture_format_layout(unsigned int w, unsigned int h, SceGxmTextureFormat format, SceGxmTextureType layout);
+/* With levels mip levels (0 for all of them down to 1x1), the GPU blends between them when minifying */
+vita2d_texture *vita2d_create_empty_texture_mipmapped(unsigned int w, unsigned int h, SceGxmTextureFormat format, SceGxmTextureType layout, unsigned int levels);
 vita2d_texture *vita2d_create_empty_texture_rendertarget(unsigned int w, unsigned int h, SceGxmTextureFormat format);
+/*
+ * Wraps GPU mapped memory owned by the caller without copying it. A stride of
+ * 0 means the default (width aligned to 8) one. If data_UID is not 0 the texture
+ * takes ownership of that memblock and vita2d_free_texture() unmaps and frees it.
+ */
+vita2d_texture *vita2d_create_texture_from_data(void *data, unsigned int w, unsigned int h, unsigned int stride, SceGxmTextureFormat format, SceUID data_UID);
 
 void vita2d_free_texture(vita2d_texture *texture);
 
+/*
+ * Shared textures, keyed by path or by the contents of the buffer, and by the
+ * load settings (vita2d_texture_set_load_*, vita2d_JPEG_set_output_rgba). Each
+ * load takes a reference and must be matched by a release (not vita2d_free_texture).
+ * Unreferenced textures are kept while the cache size stays under the budget,
+ * which is 0 by default, and freed least recently released first.
+ */
+vita2d_texture *vita2d_texture_cache_load_file(const char *path);
+vita2d_texture *vita2d_texture_cache_load_buffer(const void *buffer, unsigned long size);
+void vita2d_texture_cache_release(vita2d_texture *texture);
+void vita2d_texture_cache_set_budget(unsigned int budget);
+unsigned int vita2d_texture_cache_get_budget();
+/* Frees all the unreferenced textures */
+void vita2d_texture_cache_purge();
+void vita2d_texture_cache_get_stats(vita2d_texture_cache_stats *stats);
+
+/*
+ * Packs many small A8B8G8R8 images into a few shared textures (pages) of the
+ * given size, a new page is created when the others are full. Images are
+ * copied in, so their source can be freed right after adding them. Each one
+ * gets a 1 pixel border of its edge pixels so linear filtering doesn't bleed.
+ */
+vita2d_image_atlas *vita2d_image_atlas_create(unsigned int page_width, unsigned int page_height);
+void vita2d_image_atlas_free(vita2d_image_atlas *atlas);
+/* 1 success, 0 failure (the image doesn't fit in a page or out of memory) */
+int vita2d_image_atlas_add(vita2d_image_atlas *atlas, const void *rgba, unsigned int w, unsigned int h, unsigned int stride, vita2d_atlas_image *image);
+/* The texture has to be A8B8G8R8, in any layout */
+int vita2d_image_atlas_add_texture(vita2d_image_atlas *atlas, const vita2d_texture *texture, vita2d_atlas_image *image);
+unsigned int vita2d_image_atlas_get_num_pages(const vita2d_image_atlas *atlas);
+vita2d_texture *vita2d_image_atlas_get_page(const vita2d_image_atlas *atlas, unsigned int index);
+
+void vita2d_gpu_heap_get_stats(vita2d_gpu_heap_stats *stats);
+
+/* The category can be VITA2D_MEM_ALL and the type 0 to add up all of them */
+void vita2d_get_mem_usage(vita2d_mem_category category, SceKernelMemBlockType type, vita2d_mem_usage *usage);
+/*
+ * Limits the bytes reserved in memblocks of the given type, 0 means no limit.
+ * Allocations that would go over it fail instead of falling back to another type.
+ */
+int vita2d_set_mem_budget(SceKernelMemBlockType type, unsigned int budget);
+unsigned int vita2d_get_mem_budget(SceKernelMemBlockType type);
+
 unsigned int vita2d_texture_get_width(const vita2d_texture *texture);
 unsigned int vita2d_texture_get_height(const vita2d_texture *texture);
+/* For swizzled and tiled textures, the bytes per row of the padded texture */
 unsigned int vita2d_texture_get_stride(const vita2d_texture *texture);
+int vita2d_texture_is_linear(const vita2d_texture *texture);
+/* Copies a row of width pixels to/from the texture, whatever its layout */
+void vita2d_texture_write_row(vita2d_texture *texture, unsigned int y, const void *row);
+void vita2d_texture_read_row(const vita2d_texture *texture, unsigned int y, void *row);
+/* Box filters each mip level from the previous one, only for formats with 8 bit unsigned channels */
+int vita2d_texture_generate_mipmaps(vita2d_texture *texture);
 SceGxmTextureFormat vita2d_texture_get_format(const vita2d_texture *texture);
 void *vita2d_texture_get_datap(const vita2d_texture *texture);
 void *vita2d_texture_get_palette(const vita2d_texture *texture);
@@ -123,6 +333,8 @@ void vita2d_draw_texture_rotate_hotspot(const vita2d_texture *texture, float x,
 void vita2d_draw_texture_scale(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale);
 void vita2d_draw_texture_part(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h);
 void vita2d_draw_texture_part_scale(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale);
+void vita2d_draw_atlas_image(const vita2d_atlas_image *image, float x, float y);
+void vita2d_draw_atlas_image_scale(const vita2d_atlas_image *image, float x, float y, float x_scale, float y_scale);
 void vita2d_draw_texture_scale_rotate_hotspot(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad, float center_x, float center_y);
 void vita2d_draw_texture_scale_rotate(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad);
 void vita2d_draw_texture_part_scale_rotate(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, float rad);
@@ -141,12 +353,74 @@ void vita2d_draw_array_textured(const vita2d_texture *texture, SceGxmPrimitiveTy
 vita2d_texture *vita2d_load_PNG_file(const char *filename);
 vita2d_texture *vita2d_load_PNG_buffer(const void *buffer);
 
+/*
+ * Incremental PNG decoding: the texture is created (cleared) by begin and
+ * every step decodes up to num_rows rows into it, so it can be drawn while
+ * it fills. Step returns 1 when the image is complete, 0 if rows remain and
+ * -1 on error. Finish frees the loader and returns the texture, or NULL
+ * (freeing it) if the decode failed or didn't complete.
+ */
+vita2d_png_loader *vita2d_load_PNG_file_begin(const char *filename);
+vita2d_png_loader *vita2d_load_PNG_buffer_begin(const void *buffer);
+int vita2d_load_PNG_step(vita2d_png_loader *loader, unsigned int num_rows);
+vita2d_texture *vita2d_png_loader_get_texture(const vita2d_png_loader *loader);
+vita2d_texture *vita2d_load_PNG_finish(vita2d_png_loader *loader);
+
 vita2d_texture *vita2d_load_JPEG_file(const char *filename);
 vita2d_texture *vita2d_load_JPEG_buffer(const void *buffer, unsigned long buffer_size);
+/* Decodes at the largest M/8 scale that fits max_width x max_height (capped to 4096), 1/8 at most */
+vita2d_texture *vita2d_load_JPEG_file_scaled(const char *filename, unsigned int max_width, unsigned int max_height);
+vita2d_texture *vita2d_load_JPEG_buffer_scaled(const void *buffer, unsigned long buffer_size, unsigned int max_width, unsigned int max_height);
+/* JPEGs are loaded as A8B8G8R8 textures instead of U8U8U8_BGR / U8_R111 when enabled */
+void vita2d_JPEG_set_output_rgba(int enable);
+int vita2d_JPEG_get_output_rgba();
 
 vita2d_texture *vita2d_load_BMP_file(const char *filename);
 vita2d_texture *vita2d_load_BMP_buffer(const void *buffer);
 
+/* Loads texture number index of a GXT container, compressed formats are uploaded as they are */
+vita2d_texture *vita2d_load_GXT_file(const char *filename, unsigned int index);
+vita2d_texture *vita2d_load_GXT_buffer(const void *buffer, unsigned long buffer_size, unsigned int index);
+
+/*
+ * Loads the textures baked offline by tools/vita2d_bake, already in their GXM
+ * format and layout so there is nothing to decode. The images packed in them
+ * are looked up by the name they were baked with.
+ */
+vita2d_baked *vita2d_load_baked(const char *filename);
+vita2d_baked *vita2d_load_baked_buffer(const void *buffer, unsigned long buffer_size);
+void vita2d_free_baked(vita2d_baked *baked);
+unsigned int vita2d_baked_get_num_textures(const vita2d_baked *baked);
+vita2d_texture *vita2d_baked_get_texture(const vita2d_baked *baked, unsigned int index);
+/* 1 success, 0 if there is no image with that name */
+int vita2d_baked_get_image(const vita2d_baked *baked, const char *name, vita2d_atlas_image *image);
+
+/*
+ * Asynchronous image loading: the images are decoded by a pool of worker
+ * threads started with vita2d_async_init (without it, loads complete on
+ * submission). Buffers must stay valid until the load completes.
+ * Loads without a callback are polled with vita2d_async_load_done and
+ * collected with vita2d_async_load_finish, which waits if needed and frees
+ * the handle. Loads with a callback are reported by vita2d_async_dispatch,
+ * which runs the callbacks on the calling (render) thread and frees their
+ * handles. A NULL texture means the load failed.
+ */
+int vita2d_async_init(int num_threads);
+void vita2d_async_fini();
+vita2d_async_load *vita2d_load_PNG_file_async(const char *filename, vita2d_async_load_cb cb, void *user_data);
+vita2d_async_load *vita2d_load_PNG_buffer_async(const void *buffer, vita2d_async_load_cb cb, void *user_data);
+vita2d_async_load *vita2d_load_JPEG_file_async(const char *filename, vita2d_async_load_cb cb, void *user_data);
+vita2d_async_load *vita2d_load_JPEG_buffer_async(const void *buffer, unsigned long buffer_size, vita2d_async_load_cb cb, void *user_data);
+vita2d_async_load *vita2d_load_BMP_file_async(const char *filename, vita2d_async_load_cb cb, void *user_data);
+vita2d_async_load *vita2d_load_BMP_buffer_async(const void *buffer, vita2d_async_load_cb cb, void *user_data);
+int vita2d_async_load_done(const vita2d_async_load *load);
+vita2d_texture *vita2d_async_load_finish(vita2d_async_load *load);
+void vita2d_async_load_cancel(vita2d_async_load *load);
+int vita2d_async_dispatch();
+
+/* Fonts loaded afterwards share a single glyph atlas of this size, 0 disables sharing (default) */
+void vita2d_set_shared_font_atlas_size(int width, int height);
+
 vita2d_font *vita2d_load_font_file(const char *filename);
 vita2d_font *vita2d_load_font_mem(const void *buffer, unsigned int size);
 void vita2d_free_font(vita2d_font *font);
@@ -157,6 +431,8 @@ int vita2d_font_draw_textf_ls(vita2d_font *font, int x, int y, float linespace,
 void vita2d_font_text_dimensions(vita2d_font *font, unsigned int size, const char *text, int *width, int *height);
 int vita2d_font_text_width(vita2d_font *font, unsigned int size, const char *text);
 int vita2d_font_text_height(vita2d_font *font, unsigned int size, const char *text);
+int vita2d_font_save_atlas(vita2d_font *font, const char *filename);
+int vita2d_font_load_atlas(vita2d_font *font, const char *filename);
 
 /* PGF functions are weak imports at the moment, they have to be resolved manually */
 vita2d_pgf *vita2d_load_system_pgf(int numFonts, const vita2d_system_pgf_config *configs);
@@ -170,6 +446,8 @@ int vita2d_pgf_draw_textf_ls(vita2d_pgf *font, int x, int y, float linespace, un
 void vita2d_pgf_text_dimensions(vita2d_pgf *font, float scale, const char *text, int *width, int *height);
 int vita2d_pgf_text_width(vita2d_pgf *font, float scale, const char *text);
 int vita2d_pgf_text_height(vita2d_pgf *font, float scale, const char *text);
+int vita2d_pgf_save_atlas(vita2d_pgf *font, const char *filename);
+int vita2d_pgf_load_atlas(vita2d_pgf *font, const char *filename);
 
 
 vita2d_pvf *vita2d_load_system_pvf(int numFonts, const vita2d_system_pvf_config *configs);
@@ -183,6 +461,8 @@ int vita2d_pvf_draw_textf_ls(vita2d_pvf *font, int x, int y, float linespace, un
 void vita2d_pvf_text_dimensions(vita2d_pvf *font, float scale, const char *text, int *width, int *height);
 int vita2d_pvf_text_width(vita2d_pvf *font, float scale, const char *text);
 int vita2d_pvf_text_height(vita2d_pvf *font, float scale, const char *text);
+int vita2d_pvf_save_atlas(vita2d_pvf *font, const char *filename);
+int vita2d_pvf_load_atlas(vita2d_pvf *font, const char *filename);
 
 #ifdef __cplusplus
 }
@@ -89,6 +89,11 @@ int bp2d_insert(bp2d_node *node, const bp2d_size *in_size, bp2d_position *out_po
 	}
 }
 
+static int bp2d_is_free_leaf(const bp2d_node *node)
+{
+	return !node->left && !node->right && !node->filled;
+}
+
 int bp2d_delete(bp2d_node *root, bp2d_node *node)
 {
 	if (root == NULL || node == NULL)
@@ -102,5 +107,16 @@ int bp2d_delete(bp2d_node *root, bp2d_node *node)
 		return 1;
 	}
 
-	return bp2d_delete(root->left, node) || bp2d_delete(root->right, node);
+	if (!bp2d_delete(root->left, node) && !bp2d_delete(root->right, node))
+		return 0;
+
+	/* Merge the halves back once both are free, so the space doesn't stay fragmented */
+	if (root->left && root->right && bp2d_is_free_leaf(root->left) && bp2d_is_free_leaf(root->right)) {
+		bp2d_free(root->left);
+		bp2d_free(root->right);
+		root->left = NULL;
+		root->right = NULL;
+	}
+
+	return 1;
 }
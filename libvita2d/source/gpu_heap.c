@@ -0,0 +1,308 @@
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/gxm.h>
+#include <string.h>
+#include <stdlib.h>
+#include "gpu_heap.h"
+#include "utils.h"
+#include "vita2d.h"
+
+#define GPU_HEAP_NIL		0xFFFF
+/* Set in the state of a unit that starts a free chunk */
+#define GPU_HEAP_CHUNK_FREE	0x80
+
+typedef struct gpu_heap_block {
+	struct gpu_heap_block *next;
+	SceUID uid;
+	SceKernelMemBlockType type;
+	unsigned char *base;
+	unsigned int used_size;
+	unsigned int requested_size;
+	unsigned int num_allocs;
+	/* Free lists per order, linked through the units the chunks start at */
+	unsigned short free_head[GPU_HEAP_NUM_ORDERS];
+	unsigned short link_next[GPU_HEAP_NUM_UNITS];
+	unsigned short link_prev[GPU_HEAP_NUM_UNITS];
+	/* 0 if the unit doesn't start a chunk, otherwise the chunk order + 1 (and GPU_HEAP_CHUNK_FREE) */
+	unsigned char state[GPU_HEAP_NUM_UNITS];
+	unsigned int requested[GPU_HEAP_NUM_UNITS];
+	unsigned char category[GPU_HEAP_NUM_UNITS];
+} gpu_heap_block;
+
+static int heap_initialized = 0;
+static SceKernelLwMutexWork heap_mutex;
+static gpu_heap_block *heap_blocks = NULL;
+
+static void heap_list_push(gpu_heap_block *block, unsigned int order, unsigned int unit)
+{
+	unsigned short head = block->free_head[order];
+
+	block->state[unit] = GPU_HEAP_CHUNK_FREE | (order + 1);
+	block->link_prev[unit] = GPU_HEAP_NIL;
+	block->link_next[unit] = head;
+	if (head != GPU_HEAP_NIL)
+		block->link_prev[head] = unit;
+	block->free_head[order] = unit;
+}
+
+static void heap_list_remove(gpu_heap_block *block, unsigned int order, unsigned int unit)
+{
+	unsigned short prev = block->link_prev[unit];
+	unsigned short next = block->link_next[unit];
+
+	if (prev != GPU_HEAP_NIL)
+		block->link_next[prev] = next;
+	else
+		block->free_head[order] = next;
+	if (next != GPU_HEAP_NIL)
+		block->link_prev[next] = prev;
+	block->state[unit] = 0;
+}
+
+static unsigned int heap_size_to_order(unsigned int size)
+{
+	unsigned int order = 0;
+	while ((1U << (order + GPU_HEAP_MIN_ORDER)) < size)
+		order++;
+	return order;
+}
+
+static gpu_heap_block *heap_block_create(SceKernelMemBlockType type)
+{
+	unsigned int i;
+
+	gpu_heap_block *block = malloc(sizeof(*block));
+	if (!block)
+		return NULL;
+
+	block->base = gpu_alloc(type, GPU_HEAP_BLOCK_SIZE, 4 * 1024,
+		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+		VITA2D_MEM_HEAP_FREE, &block->uid);
+	if (!block->base) {
+		free(block);
+		return NULL;
+	}
+
+	block->type = type;
+	block->used_size = 0;
+	block->requested_size = 0;
+	block->num_allocs = 0;
+	for (i = 0; i < GPU_HEAP_NUM_ORDERS; i++)
+		block->free_head[i] = GPU_HEAP_NIL;
+	memset(block->state, 0, sizeof(block->state));
+
+	/* The whole memblock starts as a single free chunk */
+	heap_list_push(block, GPU_HEAP_NUM_ORDERS - 1, 0);
+
+	block->next = heap_blocks;
+	heap_blocks = block;
+
+	return block;
+}
+
+static void heap_block_destroy(gpu_heap_block *block)
+{
+	gpu_heap_block **link = &heap_blocks;
+	unsigned int unit;
+
+	/* Chunks still in use when the heap goes away (vita2d_fini) */
+	for (unit = 0; unit < GPU_HEAP_NUM_UNITS; unit++) {
+		if (block->state[unit] != 0 && !(block->state[unit] & GPU_HEAP_CHUNK_FREE))
+			gpu_mem_account_subfree(block->uid, block->category[unit], block->requested[unit],
+				1U << (block->state[unit] - 1 + GPU_HEAP_MIN_ORDER));
+	}
+
+	while (*link != block)
+		link = &(*link)->next;
+	*link = block->next;
+
+	gpu_free(block->uid);
+	free(block);
+}
+
+static void *heap_block_alloc(gpu_heap_block *block, unsigned int order, unsigned int size,
+			      vita2d_mem_category category)
+{
+	unsigned int found = order;
+
+	while (found < GPU_HEAP_NUM_ORDERS && block->free_head[found] == GPU_HEAP_NIL)
+		found++;
+	if (found == GPU_HEAP_NUM_ORDERS)
+		return NULL;
+
+	unsigned int unit = block->free_head[found];
+	heap_list_remove(block, found, unit);
+
+	/* Split it, giving back the upper halves */
+	while (found > order) {
+		found--;
+		heap_list_push(block, found, unit + (1U << found));
+	}
+
+	block->state[unit] = order + 1;
+	block->requested[unit] = size;
+	block->category[unit] = category;
+	block->used_size += 1U << (order + GPU_HEAP_MIN_ORDER);
+	block->requested_size += size;
+	block->num_allocs++;
+
+	gpu_mem_account_suballoc(block->uid, category, size, 1U << (order + GPU_HEAP_MIN_ORDER));
+
+	return block->base + (unit << GPU_HEAP_MIN_ORDER);
+}
+
+static int heap_block_free(gpu_heap_block *block, void *mem)
+{
+	unsigned int offset = (unsigned char *)mem - block->base;
+	unsigned int unit = offset >> GPU_HEAP_MIN_ORDER;
+
+	/* Not the start of a chunk in use: freed twice or never allocated */
+	if (offset >= GPU_HEAP_BLOCK_SIZE || (offset & ((1U << GPU_HEAP_MIN_ORDER) - 1)) ||
+	    block->state[unit] == 0 || (block->state[unit] & GPU_HEAP_CHUNK_FREE))
+		return 0;
+
+	unsigned int order = block->state[unit] - 1;
+
+	block->used_size -= 1U << (order + GPU_HEAP_MIN_ORDER);
+	block->requested_size -= block->requested[unit];
+	block->num_allocs--;
+	block->state[unit] = 0;
+
+	gpu_mem_account_subfree(block->uid, block->category[unit], block->requested[unit],
+		1U << (order + GPU_HEAP_MIN_ORDER));
+
+	/* Merge with the buddy for as long as it's free too */
+	while (order < GPU_HEAP_NUM_ORDERS - 1) {
+		unsigned int buddy = unit ^ (1U << order);
+		if (block->state[buddy] != (GPU_HEAP_CHUNK_FREE | (order + 1)))
+			break;
+		heap_list_remove(block, order, buddy);
+		if (buddy < unit)
+			unit = buddy;
+		order++;
+	}
+
+	heap_list_push(block, order, unit);
+
+	return 1;
+}
+
+int gpu_heap_init()
+{
+	if (heap_initialized)
+		return 1;
+
+	if (sceKernelCreateLwMutex(&heap_mutex, "vita2d_gpu_heap_mutex", 0, 0, NULL) < 0)
+		return 0;
+
+	heap_blocks = NULL;
+	heap_initialized = 1;
+
+	return 1;
+}
+
+void gpu_heap_fini()
+{
+	if (!heap_initialized)
+		return;
+
+	while (heap_blocks)
+		heap_block_destroy(heap_blocks);
+
+	sceKernelDeleteLwMutex(&heap_mutex);
+	heap_initialized = 0;
+}
+
+void *gpu_heap_alloc(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attribs, vita2d_mem_category category, SceUID *uid)
+{
+	gpu_heap_block *block;
+	void *mem = NULL;
+
+	/* Chunks are aligned to their size, and memblocks to at least 4 KiB */
+	if (!heap_initialized || size == 0 ||
+	    size > (1U << GPU_HEAP_MAX_ORDER) || alignment > 4 * 1024)
+		return gpu_alloc(type, size, alignment, attribs, category, uid);
+
+	unsigned int order = heap_size_to_order(size > alignment ? size : alignment);
+
+	sceKernelLockLwMutex(&heap_mutex, 1, NULL);
+
+	for (block = heap_blocks; block; block = block->next) {
+		if (block->type == type && (mem = heap_block_alloc(block, order, size, category)))
+			break;
+	}
+
+	if (!mem && (block = heap_block_create(type)))
+		mem = heap_block_alloc(block, order, size, category);
+
+	if (mem)
+		*uid = block->uid;
+
+	sceKernelUnlockLwMutex(&heap_mutex, 1);
+
+	/* Couldn't get a new memblock for the heap, let gpu_alloc() try the other types */
+	if (!mem)
+		return gpu_alloc(type, size, alignment, attribs, category, uid);
+
+	return mem;
+}
+
+void gpu_heap_free(SceUID uid, void *mem)
+{
+	gpu_heap_block *block = NULL;
+
+	if (heap_initialized) {
+		sceKernelLockLwMutex(&heap_mutex, 1, NULL);
+
+		for (block = heap_blocks; block; block = block->next) {
+			if (block->uid == uid)
+				break;
+		}
+
+		/* A bad pointer (double free) is ignored rather than corrupting the heap */
+		if (block && heap_block_free(block, mem)) {
+			/* Give empty memblocks back, but keep the last one to avoid thrashing */
+			if (block->num_allocs == 0 && (block != heap_blocks || block->next))
+				heap_block_destroy(block);
+		}
+
+		sceKernelUnlockLwMutex(&heap_mutex, 1);
+	}
+
+	if (!block)
+		gpu_free(uid);
+}
+
+void vita2d_gpu_heap_get_stats(vita2d_gpu_heap_stats *stats)
+{
+	gpu_heap_block *block;
+	unsigned int i;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (!heap_initialized)
+		return;
+
+	sceKernelLockLwMutex(&heap_mutex, 1, NULL);
+
+	for (block = heap_blocks; block; block = block->next) {
+		stats->num_blocks++;
+		stats->total_size += GPU_HEAP_BLOCK_SIZE;
+		stats->used_size += block->used_size;
+		stats->requested_size += block->requested_size;
+		stats->num_allocs += block->num_allocs;
+
+		for (i = 0; i < GPU_HEAP_NUM_ORDERS; i++) {
+			unsigned short unit = block->free_head[i];
+			while (unit != GPU_HEAP_NIL) {
+				stats->num_free_chunks++;
+				if ((1U << (i + GPU_HEAP_MIN_ORDER)) > stats->largest_free)
+					stats->largest_free = 1U << (i + GPU_HEAP_MIN_ORDER);
+				unit = block->link_next[unit];
+			}
+		}
+	}
+
+	stats->free_size = stats->total_size - stats->used_size;
+
+	sceKernelUnlockLwMutex(&heap_mutex, 1);
+}
@@ -23,6 +23,10 @@ int_htab *int_htab_create(size_t size)
 	htab->used = 0;
 
 	htab->entries = malloc(htab->size * sizeof(*htab->entries));
+	if (!htab->entries) {
+		free(htab);
+		return NULL;
+	}
 	memset(htab->entries, 0, htab->size * sizeof(*htab->entries));
 
 	return htab;
@@ -35,6 +39,7 @@ void int_htab_free(int_htab *htab)
 		if (htab->entries[i].value != NULL)
 			free(htab->entries[i].value);
 	}
+	free(htab->entries);
 	free(htab);
 }
 
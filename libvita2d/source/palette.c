@@ -0,0 +1,243 @@
+#include <stdlib.h>
+#include <string.h>
+#include "palette.h"
+
+#define HIST_BITS	PALETTE_HIST_BITS
+#define HIST_LEVELS	(1U << HIST_BITS)
+
+static inline unsigned int palette_hash(unsigned int color)
+{
+	return (color * 0x9E3779B1U) >> 22;
+}
+
+void palette_init(palette *pal)
+{
+	pal->num_colors = 0;
+	memset(pal->values, 0, sizeof(pal->values));
+	pal->last_index = PALETTE_MAX_COLORS;
+}
+
+/* Finds the slot of color, which is either its entry or the empty one it would go to */
+static inline unsigned int palette_slot(const palette *pal, unsigned int color)
+{
+	unsigned int slot = palette_hash(color);
+
+	while (pal->values[slot] && pal->keys[slot] != color)
+		slot = (slot + 1) & (PALETTE_HASH_SIZE - 1);
+
+	return slot;
+}
+
+int palette_add_row(palette *pal, const unsigned int *row, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		unsigned int color = row[i];
+
+		/* Runs of the same color are the common case in sprites */
+		if (color == pal->last_color && pal->last_index < PALETTE_MAX_COLORS)
+			continue;
+
+		unsigned int slot = palette_slot(pal, color);
+		if (!pal->values[slot]) {
+			if (pal->num_colors == PALETTE_MAX_COLORS)
+				return 0;
+			pal->keys[slot] = color;
+			pal->colors[pal->num_colors] = color;
+			pal->values[slot] = ++pal->num_colors;
+		}
+
+		pal->last_color = color;
+		pal->last_index = pal->values[slot] - 1;
+	}
+
+	return 1;
+}
+
+void palette_map_row(palette *pal, const unsigned int *row, unsigned char *out, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		unsigned int color = row[i];
+
+		if (color != pal->last_color || pal->last_index >= PALETTE_MAX_COLORS) {
+			pal->last_color = color;
+			pal->last_index = pal->values[palette_slot(pal, color)] - 1;
+		}
+
+		out[i] = pal->last_index;
+	}
+}
+
+/* Bin of a color, with the top bits of each channel */
+static inline unsigned int quantizer_bin(unsigned int color)
+{
+	return ((color >> (8 - HIST_BITS)) & (HIST_LEVELS - 1)) |
+	       ((color >> (16 - 2 * HIST_BITS)) & ((HIST_LEVELS - 1) << HIST_BITS)) |
+	       ((color >> (24 - 3 * HIST_BITS)) & ((HIST_LEVELS - 1) << (2 * HIST_BITS))) |
+	       ((color >> (32 - 4 * HIST_BITS)) & ((HIST_LEVELS - 1) << (3 * HIST_BITS)));
+}
+
+int palette_quantizer_init(palette_quantizer *q)
+{
+	q->histogram = calloc(PALETTE_HIST_SIZE, sizeof(*q->histogram));
+	q->bin_index = malloc(PALETTE_HIST_SIZE);
+
+	if (!q->histogram || !q->bin_index) {
+		palette_quantizer_fini(q);
+		return 0;
+	}
+
+	return 1;
+}
+
+void palette_quantizer_fini(palette_quantizer *q)
+{
+	free(q->histogram);
+	free(q->bin_index);
+	q->histogram = NULL;
+	q->bin_index = NULL;
+}
+
+void palette_quantizer_add_row(palette_quantizer *q, const unsigned int *row, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		q->histogram[quantizer_bin(row[i])]++;
+}
+
+typedef struct quantizer_box {
+	unsigned char lo[4];
+	unsigned char hi[4];
+	unsigned int count;
+} quantizer_box;
+
+#define BOX_FOREACH(box, bin, v) \
+	for (v[3] = (box)->lo[3]; v[3] <= (box)->hi[3]; v[3]++) \
+	for (v[2] = (box)->lo[2]; v[2] <= (box)->hi[2]; v[2]++) \
+	for (v[1] = (box)->lo[1]; v[1] <= (box)->hi[1]; v[1]++) \
+	for (v[0] = (box)->lo[0], bin = v[0] | (v[1] << HIST_BITS) | (v[2] << (2 * HIST_BITS)) | (v[3] << (3 * HIST_BITS)); \
+	     v[0] <= (box)->hi[0]; v[0]++, bin++)
+
+/* Shrinks the box to the bins that have colors in it */
+static void quantizer_box_shrink(const palette_quantizer *q, quantizer_box *box)
+{
+	unsigned int lo[4] = {HIST_LEVELS, HIST_LEVELS, HIST_LEVELS, HIST_LEVELS};
+	unsigned int hi[4] = {0, 0, 0, 0};
+	unsigned int v[4], bin, c;
+
+	box->count = 0;
+
+	BOX_FOREACH(box, bin, v) {
+		if (!q->histogram[bin])
+			continue;
+		box->count += q->histogram[bin];
+		for (c = 0; c < 4; c++) {
+			if (v[c] < lo[c])
+				lo[c] = v[c];
+			if (v[c] > hi[c])
+				hi[c] = v[c];
+		}
+	}
+
+	if (box->count) {
+		for (c = 0; c < 4; c++) {
+			box->lo[c] = lo[c];
+			box->hi[c] = hi[c];
+		}
+	}
+}
+
+/* Splits the box at the median of its longest side, the upper half goes to other */
+static void quantizer_box_split(const palette_quantizer *q, quantizer_box *box, quantizer_box *other)
+{
+	unsigned int counts[HIST_LEVELS] = {0};
+	unsigned int v[4], bin, c, axis = 0, sum = 0, split;
+
+	for (c = 1; c < 4; c++) {
+		if (box->hi[c] - box->lo[c] > box->hi[axis] - box->lo[axis])
+			axis = c;
+	}
+
+	BOX_FOREACH(box, bin, v)
+		counts[v[axis]] += q->histogram[bin];
+
+	/* Both halves need at least one level */
+	for (split = box->lo[axis]; split < box->hi[axis] - 1; split++) {
+		sum += counts[split];
+		if (sum * 2 >= box->count)
+			break;
+	}
+
+	*other = *box;
+	box->hi[axis] = split;
+	other->lo[axis] = split + 1;
+
+	quantizer_box_shrink(q, box);
+	quantizer_box_shrink(q, other);
+}
+
+static int quantizer_box_splittable(const quantizer_box *box)
+{
+	return box->count > 0 && (box->lo[0] != box->hi[0] || box->lo[1] != box->hi[1] ||
+				  box->lo[2] != box->hi[2] || box->lo[3] != box->hi[3]);
+}
+
+unsigned int palette_quantizer_build(palette_quantizer *q, unsigned int *colors, unsigned int max_colors)
+{
+	quantizer_box boxes[PALETTE_MAX_COLORS];
+	unsigned int num_boxes = 1;
+	unsigned int i, c, v[4], bin;
+
+	if (max_colors > PALETTE_MAX_COLORS)
+		max_colors = PALETTE_MAX_COLORS;
+
+	memset(boxes[0].lo, 0, 4);
+	memset(boxes[0].hi, HIST_LEVELS - 1, 4);
+	quantizer_box_shrink(q, &boxes[0]);
+
+	/* Always split the most populated box */
+	while (num_boxes < max_colors) {
+		int best = -1;
+		for (i = 0; i < num_boxes; i++) {
+			if (quantizer_box_splittable(&boxes[i]) &&
+			    (best < 0 || boxes[i].count > boxes[best].count))
+				best = i;
+		}
+		if (best < 0)
+			break;
+		quantizer_box_split(q, &boxes[best], &boxes[num_boxes++]);
+	}
+
+	/* Each color is the weighted average of its box, expanded back to 8 bits */
+	for (i = 0; i < num_boxes; i++) {
+		unsigned int sum[4] = {0, 0, 0, 0};
+		unsigned int color = 0;
+
+		BOX_FOREACH(&boxes[i], bin, v) {
+			unsigned int n = q->histogram[bin];
+			q->bin_index[bin] = i;
+			for (c = 0; c < 4; c++)
+				sum[c] += n * v[c];
+		}
+
+		for (c = 0; c < 4; c++) {
+			unsigned int level = boxes[i].count ? (sum[c] + boxes[i].count / 2) / boxes[i].count : 0;
+			color |= (level * 255 / (HIST_LEVELS - 1)) << (8 * c);
+		}
+		colors[i] = color;
+	}
+
+	return num_boxes;
+}
+
+void palette_quantizer_map_row(const palette_quantizer *q, const unsigned int *row, unsigned char *out, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		out[i] = q->bin_index[quantizer_bin(row[i])];
+}
@@ -0,0 +1,285 @@
+#include "pixel_convert.h"
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+void pixel_convert_bgra8888_to_rgba8888(const void *src, void *dst, unsigned int count)
+{
+	const unsigned char *s = src;
+	unsigned char *d = dst;
+	unsigned int i = 0;
+
+#ifdef __ARM_NEON
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x4_t px = vld4q_u8(s + i * 4);
+		uint8x16_t tmp = px.val[0];
+		px.val[0] = px.val[2];
+		px.val[2] = tmp;
+		vst4q_u8(d + i * 4, px);
+	}
+#endif
+
+	for (; i < count; i++) {
+		d[i * 4 + 0] = s[i * 4 + 2];
+		d[i * 4 + 1] = s[i * 4 + 1];
+		d[i * 4 + 2] = s[i * 4 + 0];
+		d[i * 4 + 3] = s[i * 4 + 3];
+	}
+}
+
+void pixel_convert_bgr888_to_rgba8888(const void *src, void *dst, unsigned int count)
+{
+	const unsigned char *s = src;
+	unsigned char *d = dst;
+	unsigned int i = 0;
+
+#ifdef __ARM_NEON
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x3_t in = vld3q_u8(s + i * 3);
+		uint8x16x4_t out;
+		out.val[0] = in.val[2];
+		out.val[1] = in.val[1];
+		out.val[2] = in.val[0];
+		out.val[3] = vdupq_n_u8(0xFF);
+		vst4q_u8(d + i * 4, out);
+	}
+#endif
+
+	for (; i < count; i++) {
+		d[i * 4 + 0] = s[i * 3 + 2];
+		d[i * 4 + 1] = s[i * 3 + 1];
+		d[i * 4 + 2] = s[i * 3 + 0];
+		d[i * 4 + 3] = 0xFF;
+	}
+}
+
+void pixel_convert_bgr565_to_rgba8888(const void *src, void *dst, unsigned int count)
+{
+	const unsigned char *s = src;
+	unsigned char *d = dst;
+	unsigned int i = 0;
+
+#ifdef __ARM_NEON
+	for (; i + 8 <= count; i += 8) {
+		uint16x8_t px = vreinterpretq_u16_u8(vld1q_u8(s + i * 2));
+		uint8x8_t r = vand_u8(vshrn_n_u16(px, 8), vdup_n_u8(0xF8));
+		uint8x8_t g = vand_u8(vshrn_n_u16(px, 3), vdup_n_u8(0xFC));
+		uint8x8_t b = vmovn_u16(vshlq_n_u16(px, 3));
+		uint8x8x4_t out;
+		out.val[0] = vorr_u8(r, vshr_n_u8(r, 5));
+		out.val[1] = vorr_u8(g, vshr_n_u8(g, 6));
+		out.val[2] = vorr_u8(b, vshr_n_u8(b, 5));
+		out.val[3] = vdup_n_u8(0xFF);
+		vst4_u8(d + i * 4, out);
+	}
+#endif
+
+	for (; i < count; i++) {
+		unsigned int color = s[i * 2] | (s[i * 2 + 1] << 8);
+		unsigned char r = (color >> 8) & 0xF8;
+		unsigned char g = (color >> 3) & 0xFC;
+		unsigned char b = (color << 3) & 0xF8;
+		d[i * 4 + 0] = r | (r >> 5);
+		d[i * 4 + 1] = g | (g >> 6);
+		d[i * 4 + 2] = b | (b >> 5);
+		d[i * 4 + 3] = 0xFF;
+	}
+}
+
+#ifdef __ARM_NEON
+/* Averages the horizontal pairs of 16 bytes of both rows, with rounding */
+static inline uint8x8_t pixel_box_neon(uint8x16_t a, uint8x16_t b)
+{
+	return vrshrn_n_u16(vaddq_u16(vpaddlq_u8(a), vpaddlq_u8(b)), 2);
+}
+#endif
+
+void pixel_downsample_2x2(const void *src0, const void *src1, void *dst, unsigned int src_count, unsigned int bpp)
+{
+	const unsigned char *s0 = src0;
+	const unsigned char *s1 = src1;
+	unsigned char *d = dst;
+	unsigned int count = src_count > 1 ? src_count / 2 : 1;
+	unsigned int i = 0, c;
+
+#ifdef __ARM_NEON
+	if (src_count > 1) {
+		switch (bpp) {
+		case 1:
+			for (; i + 8 <= count; i += 8)
+				vst1_u8(d + i, pixel_box_neon(vld1q_u8(s0 + i * 2), vld1q_u8(s1 + i * 2)));
+			break;
+		case 3:
+			for (; i + 8 <= count; i += 8) {
+				uint8x16x3_t a = vld3q_u8(s0 + i * 6);
+				uint8x16x3_t b = vld3q_u8(s1 + i * 6);
+				uint8x8x3_t out;
+				for (c = 0; c < 3; c++)
+					out.val[c] = pixel_box_neon(a.val[c], b.val[c]);
+				vst3_u8(d + i * 3, out);
+			}
+			break;
+		case 4:
+			for (; i + 8 <= count; i += 8) {
+				uint8x16x4_t a = vld4q_u8(s0 + i * 8);
+				uint8x16x4_t b = vld4q_u8(s1 + i * 8);
+				uint8x8x4_t out;
+				for (c = 0; c < 4; c++)
+					out.val[c] = pixel_box_neon(a.val[c], b.val[c]);
+				vst4_u8(d + i * 4, out);
+			}
+			break;
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		/* A 1 pixel wide source has no right neighbour */
+		unsigned int x0 = i * 2 * bpp;
+		unsigned int x1 = src_count > 1 ? x0 + bpp : x0;
+		for (c = 0; c < bpp; c++)
+			d[i * bpp + c] = (s0[x0 + c] + s0[x1 + c] + s1[x0 + c] + s1[x1 + c] + 2) >> 2;
+	}
+}
+
+/* 4x4 ordered dither thresholds */
+static const unsigned char pixel_bayer4[4][4] = {
+	{ 0,  8,  2, 10},
+	{12,  4, 14,  6},
+	{ 3, 11,  1,  9},
+	{15,  7, 13,  5}
+};
+
+/*
+ * What gets added to each channel before dropping its low bits, for 8
+ * pixels of row y: a dither threshold below one step of the channel, or
+ * half a step to round to the nearest value.
+ *
+ * The channel is first scaled by (2^bits - 1) / 2^bits, since the GPU
+ * expands the top value of a channel to 255 and not to 256 - one step.
+ * Without it the error grows to more than a step near white, and values
+ * the format holds exactly don't come back as themselves.
+ */
+static void pixel_pack_bias(unsigned char bias[4][8], const unsigned char bits[4], unsigned int y, int dither)
+{
+	unsigned int c, x;
+
+	for (c = 0; c < 4; c++) {
+		for (x = 0; x < 8; x++) {
+			if (bits[c] == 0 || bits[c] >= 8)
+				bias[c][x] = 0;
+			else if (dither)
+				bias[c][x] = (pixel_bayer4[y & 3][x & 3] << (8 - bits[c])) >> 4;
+			else
+				bias[c][x] = 1 << (7 - bits[c]);
+		}
+	}
+}
+
+/* The bias is below one step, so this stays within 255 */
+static inline unsigned int pixel_quantize(unsigned int v, unsigned int bias, unsigned int bits)
+{
+	return (v - (v >> bits) + bias) >> (8 - bits);
+}
+
+#ifdef __ARM_NEON
+/* pixel_quantize() without the final shift, which the packing does */
+#define PIXEL_SCALE_BIAS_U8(v, bias, bits)	vadd_u8(vsub_u8((v), vshr_n_u8((v), (bits))), (bias))
+#endif
+
+void pixel_pack_rgba8888_to_bgr565(const void *src, void *dst, unsigned int count, unsigned int y, int dither)
+{
+	static const unsigned char bits[4] = {5, 6, 5, 0};
+	const unsigned char *s = src;
+	unsigned short *d = dst;
+	unsigned char bias[4][8];
+	unsigned int i = 0;
+
+	pixel_pack_bias(bias, bits, y, dither);
+
+#ifdef __ARM_NEON
+	uint8x8_t bias_r = vld1_u8(bias[0]);
+	uint8x8_t bias_g = vld1_u8(bias[1]);
+	uint8x8_t bias_b = vld1_u8(bias[2]);
+	for (; i + 8 <= count; i += 8) {
+		uint8x8x4_t px = vld4_u8(s + i * 4);
+		uint16x8_t out = vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[2], bias_b, 5), 8);
+		out = vsriq_n_u16(out, vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[1], bias_g, 6), 8), 5);
+		out = vsriq_n_u16(out, vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[0], bias_r, 5), 8), 11);
+		vst1q_u16(d + i, out);
+	}
+#endif
+
+	for (; i < count; i++) {
+		d[i] = (pixel_quantize(s[i * 4 + 2], bias[2][i & 7], 5) << 11) |
+		       (pixel_quantize(s[i * 4 + 1], bias[1][i & 7], 6) << 5) |
+			pixel_quantize(s[i * 4 + 0], bias[0][i & 7], 5);
+	}
+}
+
+void pixel_pack_rgba8888_to_abgr4444(const void *src, void *dst, unsigned int count, unsigned int y, int dither)
+{
+	static const unsigned char bits[4] = {4, 4, 4, 4};
+	const unsigned char *s = src;
+	unsigned short *d = dst;
+	unsigned char bias[4][8];
+	unsigned int i = 0;
+
+	pixel_pack_bias(bias, bits, y, dither);
+
+#ifdef __ARM_NEON
+	uint8x8_t bias_r = vld1_u8(bias[0]);
+	uint8x8_t bias_g = vld1_u8(bias[1]);
+	uint8x8_t bias_b = vld1_u8(bias[2]);
+	uint8x8_t bias_a = vld1_u8(bias[3]);
+	for (; i + 8 <= count; i += 8) {
+		uint8x8x4_t px = vld4_u8(s + i * 4);
+		uint16x8_t out = vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[3], bias_a, 4), 8);
+		out = vsriq_n_u16(out, vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[2], bias_b, 4), 8), 4);
+		out = vsriq_n_u16(out, vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[1], bias_g, 4), 8), 8);
+		out = vsriq_n_u16(out, vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[0], bias_r, 4), 8), 12);
+		vst1q_u16(d + i, out);
+	}
+#endif
+
+	for (; i < count; i++) {
+		d[i] = (pixel_quantize(s[i * 4 + 3], bias[3][i & 7], 4) << 12) |
+		       (pixel_quantize(s[i * 4 + 2], bias[2][i & 7], 4) << 8) |
+		       (pixel_quantize(s[i * 4 + 1], bias[1][i & 7], 4) << 4) |
+			pixel_quantize(s[i * 4 + 0], bias[0][i & 7], 4);
+	}
+}
+
+void pixel_pack_rgba8888_to_abgr1555(const void *src, void *dst, unsigned int count, unsigned int y, int dither)
+{
+	static const unsigned char bits[4] = {5, 5, 5, 1};
+	const unsigned char *s = src;
+	unsigned short *d = dst;
+	unsigned char bias[4][8];
+	unsigned int i = 0;
+
+	pixel_pack_bias(bias, bits, y, dither);
+
+#ifdef __ARM_NEON
+	uint8x8_t bias_r = vld1_u8(bias[0]);
+	uint8x8_t bias_g = vld1_u8(bias[1]);
+	uint8x8_t bias_b = vld1_u8(bias[2]);
+	uint8x8_t bias_a = vld1_u8(bias[3]);
+	for (; i + 8 <= count; i += 8) {
+		uint8x8x4_t px = vld4_u8(s + i * 4);
+		uint16x8_t out = vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[3], bias_a, 1), 8);
+		out = vsriq_n_u16(out, vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[2], bias_b, 5), 8), 1);
+		out = vsriq_n_u16(out, vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[1], bias_g, 5), 8), 6);
+		out = vsriq_n_u16(out, vshll_n_u8(PIXEL_SCALE_BIAS_U8(px.val[0], bias_r, 5), 8), 11);
+		vst1q_u16(d + i, out);
+	}
+#endif
+
+	for (; i < count; i++) {
+		d[i] = (pixel_quantize(s[i * 4 + 3], bias[3][i & 7], 1) << 15) |
+		       (pixel_quantize(s[i * 4 + 2], bias[2][i & 7], 5) << 10) |
+		       (pixel_quantize(s[i * 4 + 1], bias[1][i & 7], 5) << 5) |
+			pixel_quantize(s[i * 4 + 0], bias[0][i & 7], 5);
+	}
+}
@@ -1,8 +1,43 @@
 #include <stdlib.h>
 #include <string.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/threadmgr.h>
 #include "texture_atlas.h"
+#include "utils.h"
+#include "shared.h"
 
-texture_atlas *texture_atlas_create(int width, int height, SceGxmTextureFormat format)
+static int shared_atlas_width = 0;
+static int shared_atlas_height = 0;
+static texture_atlas *shared_atlas = NULL;
+static unsigned int shared_atlas_refcount = 0;
+static unsigned char shared_atlas_owners[TEXTURE_ATLAS_MAX_OWNERS];
+static int shared_atlas_mutex_initialized = 0;
+/* Guards the shared atlas, its creation and its refcount */
+static SceKernelLwMutexWork shared_atlas_mutex;
+
+int texture_atlas_init()
+{
+	if (shared_atlas_mutex_initialized)
+		return 1;
+
+	if (sceKernelCreateLwMutex(&shared_atlas_mutex, "vita2d_atlas_mutex", 2, 0, NULL) < 0)
+		return 0;
+
+	shared_atlas_mutex_initialized = 1;
+	return 1;
+}
+
+void texture_atlas_fini()
+{
+	if (!shared_atlas_mutex_initialized)
+		return;
+
+	sceKernelDeleteLwMutex(&shared_atlas_mutex);
+	shared_atlas_mutex_initialized = 0;
+}
+
+texture_atlas *texture_atlas_create(int width, int height, SceGxmTextureFormat format,
+				    vita2d_mem_category category)
 {
 	texture_atlas *atlas = malloc(sizeof(*atlas));
 	if (!atlas)
@@ -14,9 +49,10 @@ texture_atlas *texture_atlas_create(int width, int height, SceGxmTextureFormat f
 	rect.w = width;
 	rect.h = height;
 
-	atlas->texture = vita2d_create_empty_texture_format(width,
-							    height,
-							    format);
+	atlas->texture = _vita2d_create_empty_texture_format_category(width,
+								      height,
+								      format,
+								      category);
 	if (!atlas->texture) {
 		free(atlas);
 		return NULL;
@@ -46,21 +82,32 @@ int texture_atlas_insert(texture_atlas *atlas, unsigned int character,
 			 bp2d_position *inserted_pos)
 {
 	atlas_htab_entry *entry;
-	bp2d_node *new_node;
+	bp2d_node *new_node = NULL;
 
-	if (!bp2d_insert(atlas->bp_root, size, inserted_pos, &new_node))
+	/* Empty glyphs (space) take no room, so they don't get a node of the tree */
+	if (size->w <= 0 || size->h <= 0) {
+		inserted_pos->x = 0;
+		inserted_pos->y = 0;
+	} else if (!bp2d_insert(atlas->bp_root, size, inserted_pos, &new_node)) {
 		return 0;
+	}
 
 	entry = malloc(sizeof(*entry));
+	if (!entry) {
+		bp2d_delete(atlas->bp_root, new_node);
+		return 0;
+	}
 
 	entry->rect.x = inserted_pos->x;
 	entry->rect.y = inserted_pos->y;
 	entry->rect.w = size->w;
 	entry->rect.h = size->h;
 	entry->data = *data;
+	entry->node = new_node;
 
 	if (!int_htab_insert(atlas->htab, character, entry)) {
 		bp2d_delete(atlas->bp_root, new_node);
+		free(entry);
 		return 0;
 	}
 
@@ -84,3 +131,391 @@ int texture_atlas_get(texture_atlas *atlas, unsigned int character,
 
 	return 1;
 }
+
+/*
+ * Snapshot file layout: header, htab entries, bin packing tree nodes
+ * (preorder) and finally the raw texture data, so everything but the
+ * pixels can be validated before the atlas texture is overwritten.
+ */
+
+#define ATLAS_FILE_MAGIC	0x41443256 // "V2DA"
+#define ATLAS_FILE_VERSION	1
+/* Far above what an atlas holds, low enough for the sizes not to overflow */
+#define ATLAS_FILE_MAX_ENTRIES	(1 << 20)
+/* An insertion splits a node in up to four */
+#define ATLAS_FILE_MAX_NODES	(4 * ATLAS_FILE_MAX_ENTRIES + 1)
+
+typedef struct atlas_file_header {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int hash;
+	unsigned int width;
+	unsigned int height;
+	unsigned int format;
+	unsigned int data_size;
+	unsigned int num_entries;
+	unsigned int num_nodes;
+} atlas_file_header;
+
+/* The node pointer of the htab entries isn't saved */
+typedef struct atlas_file_entry {
+	unsigned int key;
+	bp2d_rectangle rect;
+	texture_atlas_entry_data data;
+} atlas_file_entry;
+
+typedef struct atlas_file_node {
+	bp2d_rectangle rect;
+	int filled;
+	int split;
+} atlas_file_node;
+
+static unsigned int atlas_count_nodes(const bp2d_node *node)
+{
+	if (!node)
+		return 0;
+
+	return 1 + atlas_count_nodes(node->left) + atlas_count_nodes(node->right);
+}
+
+static void atlas_write_nodes(const bp2d_node *node, atlas_file_node *nodes,
+			      unsigned int *index)
+{
+	if (!node)
+		return;
+
+	atlas_file_node *out = &nodes[(*index)++];
+	out->rect = node->rect;
+	out->filled = node->filled;
+	out->split = node->left != NULL;
+
+	atlas_write_nodes(node->left, nodes, index);
+	atlas_write_nodes(node->right, nodes, index);
+}
+
+static bp2d_node *atlas_read_nodes(const atlas_file_node *nodes, unsigned int count,
+				   unsigned int *index)
+{
+	if (*index >= count)
+		return NULL;
+
+	const atlas_file_node *in = &nodes[(*index)++];
+	bp2d_node *node = bp2d_create(&in->rect);
+	if (!node)
+		return NULL;
+
+	node->filled = in->filled;
+
+	if (in->split) {
+		node->left = atlas_read_nodes(nodes, count, index);
+		node->right = atlas_read_nodes(nodes, count, index);
+		if (!node->left || !node->right) {
+			bp2d_free(node);
+			return NULL;
+		}
+	}
+
+	return node;
+}
+
+static int atlas_write(SceUID fd, const void *data, unsigned int size)
+{
+	return sceIoWrite(fd, data, size) == size;
+}
+
+static int atlas_read(SceUID fd, void *data, unsigned int size)
+{
+	return sceIoRead(fd, data, size) == size;
+}
+
+int texture_atlas_save(const texture_atlas *atlas, const char *filename, unsigned int hash)
+{
+	atlas_file_header header;
+	atlas_file_entry *entries;
+	atlas_file_node *nodes;
+	unsigned int i, index;
+	int ret = 0;
+	SceUID fd;
+
+	if (texture_atlas_is_shared(atlas))
+		return 0;
+
+	header.magic = ATLAS_FILE_MAGIC;
+	header.version = ATLAS_FILE_VERSION;
+	header.hash = hash;
+	header.width = vita2d_texture_get_width(atlas->texture);
+	header.height = vita2d_texture_get_height(atlas->texture);
+	header.format = vita2d_texture_get_format(atlas->texture);
+	header.data_size = vita2d_texture_get_stride(atlas->texture) * header.height;
+	header.num_entries = atlas->htab->used;
+	header.num_nodes = atlas_count_nodes(atlas->bp_root);
+
+	entries = malloc(header.num_entries * sizeof(*entries));
+	nodes = malloc(header.num_nodes * sizeof(*nodes));
+	if ((header.num_entries && !entries) || !nodes)
+		goto exit_free;
+
+	index = 0;
+	for (i = 0; i < atlas->htab->size; i++) {
+		const int_htab_entry *htab_entry = &atlas->htab->entries[i];
+		if (htab_entry->value == NULL)
+			continue;
+		const atlas_htab_entry *entry = htab_entry->value;
+		entries[index].key = htab_entry->key;
+		entries[index].rect = entry->rect;
+		entries[index].data = entry->data;
+		index++;
+	}
+	header.num_entries = index;
+
+	index = 0;
+	atlas_write_nodes(atlas->bp_root, nodes, &index);
+
+	if ((fd = sceIoOpen(filename, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777)) < 0)
+		goto exit_free;
+
+	ret = atlas_write(fd, &header, sizeof(header)) &&
+	      atlas_write(fd, entries, header.num_entries * sizeof(*entries)) &&
+	      atlas_write(fd, nodes, header.num_nodes * sizeof(*nodes)) &&
+	      atlas_write(fd, vita2d_texture_get_datap(atlas->texture), header.data_size);
+
+	sceIoClose(fd);
+
+exit_free:
+	free(entries);
+	free(nodes);
+	return ret;
+}
+
+int texture_atlas_load(texture_atlas *atlas, const char *filename, unsigned int hash)
+{
+	atlas_file_header header;
+	atlas_file_entry *entries = NULL;
+	atlas_file_node *nodes = NULL;
+	bp2d_node *bp_root = NULL;
+	int_htab *htab = NULL;
+	unsigned int i, index;
+	int ret = 0;
+	SceUID fd;
+
+	if (texture_atlas_is_shared(atlas))
+		return 0;
+
+	if ((fd = sceIoOpen(filename, SCE_O_RDONLY, 0777)) < 0)
+		return 0;
+
+	if (!atlas_read(fd, &header, sizeof(header)))
+		goto exit_close;
+
+	if (header.magic != ATLAS_FILE_MAGIC ||
+	    header.version != ATLAS_FILE_VERSION ||
+	    header.hash != hash ||
+	    header.width != vita2d_texture_get_width(atlas->texture) ||
+	    header.height != vita2d_texture_get_height(atlas->texture) ||
+	    header.format != vita2d_texture_get_format(atlas->texture) ||
+	    header.data_size != vita2d_texture_get_stride(atlas->texture) * header.height ||
+	    header.num_entries > ATLAS_FILE_MAX_ENTRIES ||
+	    header.num_nodes == 0 || header.num_nodes > ATLAS_FILE_MAX_NODES)
+		goto exit_close;
+
+	entries = malloc(header.num_entries * sizeof(*entries));
+	nodes = malloc(header.num_nodes * sizeof(*nodes));
+	if ((header.num_entries && !entries) || !nodes)
+		goto exit_free;
+
+	if (!atlas_read(fd, entries, header.num_entries * sizeof(*entries)) ||
+	    !atlas_read(fd, nodes, header.num_nodes * sizeof(*nodes)))
+		goto exit_free;
+
+	index = 0;
+	bp_root = atlas_read_nodes(nodes, header.num_nodes, &index);
+	if (!bp_root || index != header.num_nodes)
+		goto exit_free;
+
+	htab = int_htab_create(256);
+	if (!htab)
+		goto exit_free;
+
+	for (i = 0; i < header.num_entries; i++) {
+		atlas_htab_entry *entry = malloc(sizeof(*entry));
+		if (!entry)
+			goto exit_free;
+		/* Private atlases never evict glyphs, so their nodes aren't needed */
+		entry->rect = entries[i].rect;
+		entry->data = entries[i].data;
+		entry->node = NULL;
+		int_htab_insert(htab, entries[i].key, entry);
+	}
+
+	if (!atlas_read(fd, vita2d_texture_get_datap(atlas->texture), header.data_size)) {
+		/* The texture is now garbage, so start over with an empty atlas */
+		bp2d_rectangle rect = {0, 0, header.width, header.height};
+		memset(vita2d_texture_get_datap(atlas->texture), 0, header.data_size);
+		bp2d_free(bp_root);
+		int_htab_free(htab);
+		bp_root = bp2d_create(&rect);
+		htab = int_htab_create(256);
+	} else {
+		ret = 1;
+	}
+
+	bp2d_free(atlas->bp_root);
+	int_htab_free(atlas->htab);
+	atlas->bp_root = bp_root;
+	atlas->htab = htab;
+	bp_root = NULL;
+	htab = NULL;
+
+exit_free:
+	if (bp_root)
+		bp2d_free(bp_root);
+	if (htab)
+		int_htab_free(htab);
+	free(entries);
+	free(nodes);
+exit_close:
+	sceIoClose(fd);
+	return ret;
+}
+
+void vita2d_set_shared_font_atlas_size(int width, int height)
+{
+	shared_atlas_width = width;
+	shared_atlas_height = height;
+}
+
+texture_atlas *texture_atlas_acquire(int width, int height, SceGxmTextureFormat format,
+				     unsigned int *owner)
+{
+	unsigned int i;
+
+	*owner = 0;
+
+	if (shared_atlas_width <= 0 || shared_atlas_height <= 0 || !shared_atlas_mutex_initialized)
+		return texture_atlas_create(width, height, format, VITA2D_MEM_FONT_ATLAS);
+
+	sceKernelLockLwMutex(&shared_atlas_mutex, 1, NULL);
+
+	if (!shared_atlas) {
+		shared_atlas = texture_atlas_create(shared_atlas_width,
+						    shared_atlas_height,
+						    format,
+						    VITA2D_MEM_FONT_ATLAS);
+		if (!shared_atlas) {
+			sceKernelUnlockLwMutex(&shared_atlas_mutex, 1);
+			return NULL;
+		}
+
+		memset(shared_atlas_owners, 0, sizeof(shared_atlas_owners));
+	}
+
+	/* Owner 0 is reserved for private atlases */
+	for (i = 1; i < TEXTURE_ATLAS_MAX_OWNERS; i++) {
+		if (!shared_atlas_owners[i])
+			break;
+	}
+
+	if (i < TEXTURE_ATLAS_MAX_OWNERS) {
+		shared_atlas_owners[i] = 1;
+		shared_atlas_refcount++;
+		*owner = i;
+	}
+
+	sceKernelUnlockLwMutex(&shared_atlas_mutex, 1);
+
+	/* Out of owner ids, fall back to a private atlas */
+	if (*owner == 0)
+		return texture_atlas_create(width, height, format, VITA2D_MEM_FONT_ATLAS);
+
+	return shared_atlas;
+}
+
+static void atlas_clear_rect(texture_atlas *atlas, const bp2d_rectangle *rect)
+{
+	int i;
+	unsigned char *data = vita2d_texture_get_datap(atlas->texture);
+	unsigned int stride = vita2d_texture_get_stride(atlas->texture);
+	unsigned int bpp = stride / ALIGN(vita2d_texture_get_width(atlas->texture), 8);
+
+	for (i = 0; i < rect->h; i++)
+		memset(data + (rect->y + i) * stride + rect->x * bpp, 0, rect->w * bpp);
+}
+
+/* 0 if out of memory, the glyphs of the owner are then left in place */
+static int atlas_evict_owner(texture_atlas *atlas, unsigned int owner)
+{
+	unsigned int i;
+	int_htab *htab = int_htab_create(atlas->htab->size);
+	if (!htab)
+		return 0;
+
+	/* Rebuild the htab since int_htab_erase would break the probe chains */
+	for (i = 0; i < atlas->htab->size; i++) {
+		int_htab_entry *htab_entry = &atlas->htab->entries[i];
+		atlas_htab_entry *entry = htab_entry->value;
+		if (entry == NULL)
+			continue;
+
+		if ((htab_entry->key >> TEXTURE_ATLAS_OWNER_SHIFT) == owner) {
+			/* Glyph renderers may not write their whole rectangle */
+			if (entry->node) {
+				bp2d_delete(atlas->bp_root, entry->node);
+				atlas_clear_rect(atlas, &entry->rect);
+			}
+			free(entry);
+		} else {
+			int_htab_insert(htab, htab_entry->key, entry);
+		}
+		htab_entry->value = NULL;
+	}
+
+	int_htab_free(atlas->htab);
+	atlas->htab = htab;
+
+	return 1;
+}
+
+void texture_atlas_release(texture_atlas *atlas, unsigned int owner)
+{
+	if (!atlas)
+		return;
+
+	if (!texture_atlas_is_shared(atlas)) {
+		texture_atlas_free(atlas);
+		return;
+	}
+
+	sceKernelLockLwMutex(&shared_atlas_mutex, 1, NULL);
+
+	/*
+	 * The id can only be reused once its keys are gone, otherwise the next
+	 * font getting it would find the glyphs of this one. It stays taken
+	 * until the atlas is freed.
+	 */
+	if (atlas_evict_owner(atlas, owner))
+		shared_atlas_owners[owner] = 0;
+
+	if (--shared_atlas_refcount == 0) {
+		texture_atlas_free(shared_atlas);
+		shared_atlas = NULL;
+	}
+
+	sceKernelUnlockLwMutex(&shared_atlas_mutex, 1);
+}
+
+int texture_atlas_is_shared(const texture_atlas *atlas)
+{
+	return atlas && atlas == shared_atlas;
+}
+
+void texture_atlas_lock(texture_atlas *atlas)
+{
+	if (texture_atlas_is_shared(atlas))
+		sceKernelLockLwMutex(&shared_atlas_mutex, 1, NULL);
+}
+
+void texture_atlas_unlock(texture_atlas *atlas)
+{
+	if (texture_atlas_is_shared(atlas))
+		sceKernelUnlockLwMutex(&shared_atlas_mutex, 1);
+}
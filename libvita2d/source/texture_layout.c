@@ -0,0 +1,228 @@
+#include <string.h>
+#include "texture_layout.h"
+
+#define TILE_SIZE TEXTURE_LAYOUT_TILE_SIZE
+
+unsigned int texture_layout_pot(unsigned int x)
+{
+	unsigned int pot = 1;
+	while (pot < x)
+		pot <<= 1;
+	return pot;
+}
+
+void texture_layout_dimensions(SceGxmTextureType type, unsigned int w, unsigned int h,
+			       unsigned int *aligned_w, unsigned int *aligned_h)
+{
+	switch (type) {
+	case SCE_GXM_TEXTURE_SWIZZLED:
+	case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+		*aligned_w = texture_layout_pot(w);
+		*aligned_h = texture_layout_pot(h);
+		break;
+	case SCE_GXM_TEXTURE_TILED:
+		*aligned_w = (w + TILE_SIZE - 1) & ~(TILE_SIZE - 1);
+		*aligned_h = (h + TILE_SIZE - 1) & ~(TILE_SIZE - 1);
+		break;
+	default:
+		/* Linear rows are 8 texels aligned */
+		*aligned_w = (w + 7) & ~7;
+		*aligned_h = h;
+		break;
+	}
+}
+
+static unsigned int swizzle_offset(unsigned int pw, unsigned int ph, unsigned int x, unsigned int y)
+{
+	unsigned int offset = 0;
+	unsigned int bit = 0;
+	unsigned int i;
+
+	/* Interleave while both sides still have bits, then append the rest */
+	for (i = 1; i < pw || i < ph; i <<= 1) {
+		if (i < pw) {
+			if (x & i)
+				offset |= 1U << bit;
+			bit++;
+		}
+		if (i < ph) {
+			if (y & i)
+				offset |= 1U << bit;
+			bit++;
+		}
+	}
+
+	return offset;
+}
+
+unsigned int texture_layout_offset(SceGxmTextureType type, unsigned int w, unsigned int h,
+				   unsigned int x, unsigned int y)
+{
+	unsigned int aligned_w, aligned_h;
+
+	texture_layout_dimensions(type, w, h, &aligned_w, &aligned_h);
+
+	switch (type) {
+	case SCE_GXM_TEXTURE_SWIZZLED:
+	case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+		return swizzle_offset(aligned_w, aligned_h, x, y);
+	case SCE_GXM_TEXTURE_TILED:
+		return ((y / TILE_SIZE) * (aligned_w / TILE_SIZE) + x / TILE_SIZE) * TILE_SIZE * TILE_SIZE +
+			(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+	default:
+		return y * aligned_w + x;
+	}
+}
+
+/* Spreads the bits of x to the even positions */
+static unsigned int swizzle_spread(unsigned int x)
+{
+	x &= 0xFFFF;
+	x = (x | (x << 8)) & 0x00FF00FF;
+	x = (x | (x << 4)) & 0x0F0F0F0F;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+/*
+ * Walks the texels of row y of a swizzled texture. The interleaved part of the
+ * x offset is stepped with the masked increment trick, and once it wraps the
+ * high bits (only present when the texture is wider than tall) go up by one.
+ */
+#define SWIZZLE_ROW_LOOP(pw, ph, y, count, body) \
+	do { \
+		unsigned int _min = (pw) < (ph) ? (pw) : (ph); \
+		unsigned int _shift = 0; \
+		while ((1U << _shift) < _min) \
+			_shift++; \
+		unsigned int _x_mask = swizzle_spread(_min - 1); \
+		unsigned int _y_off = (swizzle_spread((y) & (_min - 1)) << 1) | (((y) >> _shift) << (2 * _shift)); \
+		unsigned int _x_lo = 0, _x_hi = 0, _x; \
+		for (_x = 0; _x < (count); _x++) { \
+			unsigned int offset = _y_off | _x_lo | (_x_hi << (2 * _shift)); \
+			body; \
+			_x_lo = (_x_lo - _x_mask) & _x_mask; \
+			if (_x_lo == 0) \
+				_x_hi++; \
+		} \
+	} while (0)
+
+static void swizzle_write_row(void *data, unsigned int pw, unsigned int ph, unsigned int bpp,
+			      unsigned int y, const void *row, unsigned int count)
+{
+	switch (bpp) {
+	case 1: {
+		unsigned char *dst = data;
+		const unsigned char *src = row;
+		SWIZZLE_ROW_LOOP(pw, ph, y, count, dst[offset] = src[_x]);
+		break;
+	}
+	case 2: {
+		unsigned short *dst = data;
+		const unsigned short *src = row;
+		SWIZZLE_ROW_LOOP(pw, ph, y, count, dst[offset] = src[_x]);
+		break;
+	}
+	case 4: {
+		unsigned int *dst = data;
+		const unsigned int *src = row;
+		SWIZZLE_ROW_LOOP(pw, ph, y, count, dst[offset] = src[_x]);
+		break;
+	}
+	default: {
+		unsigned char *dst = data;
+		const unsigned char *src = row;
+		SWIZZLE_ROW_LOOP(pw, ph, y, count, memcpy(dst + offset * bpp, src + _x * bpp, bpp));
+		break;
+	}
+	}
+}
+
+static void swizzle_read_row(const void *data, unsigned int pw, unsigned int ph, unsigned int bpp,
+			     unsigned int y, void *row, unsigned int count)
+{
+	switch (bpp) {
+	case 1: {
+		const unsigned char *src = data;
+		unsigned char *dst = row;
+		SWIZZLE_ROW_LOOP(pw, ph, y, count, dst[_x] = src[offset]);
+		break;
+	}
+	case 2: {
+		const unsigned short *src = data;
+		unsigned short *dst = row;
+		SWIZZLE_ROW_LOOP(pw, ph, y, count, dst[_x] = src[offset]);
+		break;
+	}
+	case 4: {
+		const unsigned int *src = data;
+		unsigned int *dst = row;
+		SWIZZLE_ROW_LOOP(pw, ph, y, count, dst[_x] = src[offset]);
+		break;
+	}
+	default: {
+		const unsigned char *src = data;
+		unsigned char *dst = row;
+		SWIZZLE_ROW_LOOP(pw, ph, y, count, memcpy(dst + _x * bpp, src + offset * bpp, bpp));
+		break;
+	}
+	}
+}
+
+void texture_layout_write_row(SceGxmTextureType type, void *data, unsigned int w, unsigned int h,
+			      unsigned int bpp, unsigned int y, const void *row, unsigned int count)
+{
+	unsigned int aligned_w, aligned_h, x;
+
+	texture_layout_dimensions(type, w, h, &aligned_w, &aligned_h);
+
+	switch (type) {
+	case SCE_GXM_TEXTURE_SWIZZLED:
+	case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+		swizzle_write_row(data, aligned_w, aligned_h, bpp, y, row, count);
+		break;
+	case SCE_GXM_TEXTURE_TILED: {
+		/* Each tile holds a linear run of TILE_SIZE texels of the row */
+		unsigned char *dst = (unsigned char *)data +
+			((y / TILE_SIZE) * aligned_w * TILE_SIZE + (y % TILE_SIZE) * TILE_SIZE) * bpp;
+		const unsigned char *src = row;
+		for (x = 0; x < count; x += TILE_SIZE) {
+			unsigned int n = count - x < TILE_SIZE ? count - x : TILE_SIZE;
+			memcpy(dst + x * TILE_SIZE * bpp, src + x * bpp, n * bpp);
+		}
+		break;
+	}
+	default:
+		memcpy((unsigned char *)data + y * aligned_w * bpp, row, count * bpp);
+		break;
+	}
+}
+
+void texture_layout_read_row(SceGxmTextureType type, const void *data, unsigned int w, unsigned int h,
+			     unsigned int bpp, unsigned int y, void *row, unsigned int count)
+{
+	unsigned int aligned_w, aligned_h, x;
+
+	texture_layout_dimensions(type, w, h, &aligned_w, &aligned_h);
+
+	switch (type) {
+	case SCE_GXM_TEXTURE_SWIZZLED:
+	case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+		swizzle_read_row(data, aligned_w, aligned_h, bpp, y, row, count);
+		break;
+	case SCE_GXM_TEXTURE_TILED: {
+		const unsigned char *src = (const unsigned char *)data +
+			((y / TILE_SIZE) * aligned_w * TILE_SIZE + (y % TILE_SIZE) * TILE_SIZE) * bpp;
+		unsigned char *dst = row;
+		for (x = 0; x < count; x += TILE_SIZE) {
+			unsigned int n = count - x < TILE_SIZE ? count - x : TILE_SIZE;
+			memcpy(dst + x * bpp, src + x * TILE_SIZE * bpp, n * bpp);
+		}
+		break;
+	}
+	default:
+		memcpy(row, (const unsigned char *)data + y * aligned_w * bpp, count * bpp);
+		break;
+	}
+}
@@ -1,6 +1,8 @@
 #include "utils.h"
+#include <psp2/kernel/threadmgr.h>
 #include <math.h>
 #include <string.h>
+#include <stdlib.h>
 
 unsigned int get_aligned_size(SceKernelMemBlockType type, unsigned int size)
 {
@@ -15,34 +17,231 @@ unsigned int get_aligned_size(SceKernelMemBlockType type, unsigned int size)
 	}
 }
 
-void *gpu_alloc(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attribs, SceUID *uid)
+#define GPU_MEM_MAX_TYPES 8
+
+typedef struct gpu_mem_record {
+	SceUID uid;
+	SceKernelMemBlockType type;
+	vita2d_mem_category category;
+	unsigned int requested;
+	unsigned int reserved;
+} gpu_mem_record;
+
+typedef struct gpu_mem_type_info {
+	SceKernelMemBlockType type;
+	unsigned int budget;
+	unsigned int reserved;
+	vita2d_mem_usage usage[VITA2D_MEM_CATEGORY_COUNT];
+} gpu_mem_type_info;
+
+static gpu_mem_type_info mem_types[GPU_MEM_MAX_TYPES];
+static unsigned int mem_num_types = 0;
+static gpu_mem_record *mem_records = NULL;
+static unsigned int mem_num_records = 0;
+static unsigned int mem_max_records = 0;
+static int mem_mutex_initialized = 0;
+static SceKernelLwMutexWork mem_mutex;
+
+static void gpu_mem_lock()
+{
+	if (mem_mutex_initialized)
+		sceKernelLockLwMutex(&mem_mutex, 1, NULL);
+}
+
+static void gpu_mem_unlock()
+{
+	if (mem_mutex_initialized)
+		sceKernelUnlockLwMutex(&mem_mutex, 1);
+}
+
+static gpu_mem_type_info *gpu_mem_get_type(SceKernelMemBlockType type, int create)
+{
+	unsigned int i;
+
+	for (i = 0; i < mem_num_types; i++) {
+		if (mem_types[i].type == type)
+			return &mem_types[i];
+	}
+
+	if (!create || mem_num_types == GPU_MEM_MAX_TYPES)
+		return NULL;
+
+	memset(&mem_types[mem_num_types], 0, sizeof(gpu_mem_type_info));
+	mem_types[mem_num_types].type = type;
+	return &mem_types[mem_num_types++];
+}
+
+static gpu_mem_record *gpu_mem_find_record(SceUID uid)
+{
+	unsigned int i;
+
+	for (i = 0; i < mem_num_records; i++) {
+		if (mem_records[i].uid == uid)
+			return &mem_records[i];
+	}
+
+	return NULL;
+}
+
+static int gpu_mem_budget_allows(SceKernelMemBlockType type, unsigned int size)
+{
+	int ret;
+
+	gpu_mem_lock();
+	gpu_mem_type_info *info = gpu_mem_get_type(type, 0);
+	ret = !info || info->budget == 0 || info->reserved + size <= info->budget;
+	gpu_mem_unlock();
+
+	return ret;
+}
+
+static void gpu_mem_add_record(SceUID uid, SceKernelMemBlockType type, vita2d_mem_category category,
+			       unsigned int requested, unsigned int reserved)
+{
+	gpu_mem_lock();
+
+	gpu_mem_type_info *info = gpu_mem_get_type(type, 1);
+	if (info) {
+		info->reserved += reserved;
+		info->usage[category].requested += requested;
+		info->usage[category].reserved += reserved;
+		info->usage[category].count++;
+	}
+
+	if (mem_num_records == mem_max_records) {
+		unsigned int max_records = mem_max_records ? mem_max_records * 2 : 64;
+		gpu_mem_record *records = realloc(mem_records, max_records * sizeof(gpu_mem_record));
+		if (!records) {
+			gpu_mem_unlock();
+			return;
+		}
+		mem_records = records;
+		mem_max_records = max_records;
+	}
+
+	gpu_mem_record *record = &mem_records[mem_num_records++];
+	record->uid = uid;
+	record->type = type;
+	record->category = category;
+	record->requested = requested;
+	record->reserved = reserved;
+
+	gpu_mem_unlock();
+}
+
+static void gpu_mem_remove_record(SceUID uid)
+{
+	gpu_mem_lock();
+
+	gpu_mem_record *record = gpu_mem_find_record(uid);
+	if (record) {
+		gpu_mem_type_info *info = gpu_mem_get_type(record->type, 0);
+		if (info) {
+			info->reserved -= record->reserved;
+			info->usage[record->category].requested -= record->requested;
+			info->usage[record->category].reserved -= record->reserved;
+			info->usage[record->category].count--;
+		}
+		*record = mem_records[--mem_num_records];
+	}
+
+	gpu_mem_unlock();
+}
+
+/* Heap chunks are accounted for inside the VITA2D_MEM_HEAP_FREE record of their memblock */
+static void gpu_mem_update_suballoc(SceUID uid, vita2d_mem_category category,
+				    unsigned int requested, unsigned int reserved, int alloc)
+{
+	gpu_mem_lock();
+
+	gpu_mem_record *record = gpu_mem_find_record(uid);
+	gpu_mem_type_info *info = record ? gpu_mem_get_type(record->type, 0) : NULL;
+	if (info) {
+		vita2d_mem_usage *heap_free = &info->usage[VITA2D_MEM_HEAP_FREE];
+		vita2d_mem_usage *usage = &info->usage[category];
+		if (alloc) {
+			heap_free->requested -= reserved;
+			heap_free->reserved -= reserved;
+			usage->requested += requested;
+			usage->reserved += reserved;
+			usage->count++;
+		} else {
+			heap_free->requested += reserved;
+			heap_free->reserved += reserved;
+			usage->requested -= requested;
+			usage->reserved -= reserved;
+			usage->count--;
+		}
+	}
+
+	gpu_mem_unlock();
+}
+
+int gpu_mem_init()
+{
+	if (mem_mutex_initialized)
+		return 1;
+
+	if (sceKernelCreateLwMutex(&mem_mutex, "vita2d_gpu_mem_mutex", 0, 0, NULL) < 0)
+		return 0;
+
+	mem_mutex_initialized = 1;
+	return 1;
+}
+
+void gpu_mem_fini()
+{
+	if (!mem_mutex_initialized)
+		return;
+
+	sceKernelDeleteLwMutex(&mem_mutex);
+	mem_mutex_initialized = 0;
+}
+
+void *gpu_alloc(SceKernelMemBlockType type, unsigned int size, unsigned int alignment, unsigned int attribs, vita2d_mem_category category, SceUID *uid)
 {
 	void *mem;
-	unsigned int aligned_size = get_aligned_size(type, size);
+	unsigned int aligned_size = 0;
+	SceKernelMemBlockType types[3];
+	int i, num_types = 1;
+
+	types[0] = type;
+
+	// Fallbacking to other mem types if out of mem, unless there's a budget for this one
+	if (vita2d_get_mem_budget(type) == 0) {
+		types[num_types++] = type == SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW ? SCE_KERNEL_MEMBLOCK_TYPE_USER_RW : SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW;
+		types[num_types++] = SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_PHYCONT_RW;
+	}
 
-	*uid = sceKernelAllocMemBlock("gpu_mem", type, aligned_size, NULL);
-	
-	// Fallbacking to other mem types if out of mem
-	if (*uid < 0) {
-		type = type == SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW ? SCE_KERNEL_MEMBLOCK_TYPE_USER_RW : SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW;
+	*uid = -1;
+
+	for (i = 0; i < num_types; i++) {
+		type = types[i];
 		aligned_size = get_aligned_size(type, size);
+		if (!gpu_mem_budget_allows(type, aligned_size))
+			continue;
 		*uid = sceKernelAllocMemBlock("gpu_mem", type, aligned_size, NULL);
-		if (*uid < 0) {
-			type = SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_PHYCONT_RW;
-			aligned_size = get_aligned_size(type, size);
-			*uid = sceKernelAllocMemBlock("gpu_mem", type, aligned_size, NULL);
-			if (*uid < 0)
-				return NULL;
-		}
+		if (*uid >= 0)
+			break;
 	}
 
-	if (sceKernelGetMemBlockBase(*uid, &mem) < 0)
+	if (*uid < 0)
 		return NULL;
 
+	if (sceKernelGetMemBlockBase(*uid, &mem) < 0)
+		goto err_free;
+
 	if (sceGxmMapMemory(mem, aligned_size, attribs) < 0)
-		return NULL;
+		goto err_free;
+
+	gpu_mem_add_record(*uid, type, category, size, aligned_size);
 
 	return mem;
+
+err_free:
+	sceKernelFreeMemBlock(*uid);
+	*uid = -1;
+	return NULL;
 }
 
 void gpu_free(SceUID uid)
@@ -50,13 +249,15 @@ void gpu_free(SceUID uid)
 	void *mem = NULL;
 	if (sceKernelGetMemBlockBase(uid, &mem) < 0)
 		return;
+	gpu_mem_remove_record(uid);
 	sceGxmUnmapMemory(mem);
 	sceKernelFreeMemBlock(uid);
 }
 
-void *vertex_usse_alloc(unsigned int size, SceUID *uid, unsigned int *usse_offset)
+void *vertex_usse_alloc(unsigned int size, vita2d_mem_category category, SceUID *uid, unsigned int *usse_offset)
 {
 	void *mem = NULL;
+	unsigned int requested = size;
 
 	size = ALIGN(size, 4096);
 	*uid = sceKernelAllocMemBlock("vertex_usse", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, size, NULL);
@@ -66,6 +267,8 @@ void *vertex_usse_alloc(unsigned int size, SceUID *uid, unsigned int *usse_offse
 	if (sceGxmMapVertexUsseMemory(mem, size, usse_offset) < 0)
 		return NULL;
 
+	gpu_mem_add_record(*uid, SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, category, requested, size);
+
 	return mem;
 }
 
@@ -74,13 +277,15 @@ void vertex_usse_free(SceUID uid)
 	void *mem = NULL;
 	if (sceKernelGetMemBlockBase(uid, &mem) < 0)
 		return;
+	gpu_mem_remove_record(uid);
 	sceGxmUnmapVertexUsseMemory(mem);
 	sceKernelFreeMemBlock(uid);
 }
 
-void *fragment_usse_alloc(unsigned int size, SceUID *uid, unsigned int *usse_offset)
+void *fragment_usse_alloc(unsigned int size, vita2d_mem_category category, SceUID *uid, unsigned int *usse_offset)
 {
 	void *mem = NULL;
+	unsigned int requested = size;
 
 	size = ALIGN(size, 4096);
 	*uid = sceKernelAllocMemBlock("fragment_usse", SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, size, NULL);
@@ -90,6 +295,8 @@ void *fragment_usse_alloc(unsigned int size, SceUID *uid, unsigned int *usse_off
 	if (sceGxmMapFragmentUsseMemory(mem, size, usse_offset) < 0)
 		return NULL;
 
+	gpu_mem_add_record(*uid, SCE_KERNEL_MEMBLOCK_TYPE_USER_RW_UNCACHE, category, requested, size);
+
 	return mem;
 }
 
@@ -98,10 +305,68 @@ void fragment_usse_free(SceUID uid)
 	void *mem = NULL;
 	if (sceKernelGetMemBlockBase(uid, &mem) < 0)
 		return;
+	gpu_mem_remove_record(uid);
 	sceGxmUnmapFragmentUsseMemory(mem);
 	sceKernelFreeMemBlock(uid);
 }
 
+void gpu_mem_account_suballoc(SceUID uid, vita2d_mem_category category, unsigned int requested, unsigned int reserved)
+{
+	gpu_mem_update_suballoc(uid, category, requested, reserved, 1);
+}
+
+void gpu_mem_account_subfree(SceUID uid, vita2d_mem_category category, unsigned int requested, unsigned int reserved)
+{
+	gpu_mem_update_suballoc(uid, category, requested, reserved, 0);
+}
+
+void vita2d_get_mem_usage(vita2d_mem_category category, SceKernelMemBlockType type, vita2d_mem_usage *usage)
+{
+	unsigned int i;
+	int j;
+
+	memset(usage, 0, sizeof(*usage));
+
+	gpu_mem_lock();
+
+	for (i = 0; i < mem_num_types; i++) {
+		if (type != 0 && mem_types[i].type != type)
+			continue;
+		for (j = 0; j < VITA2D_MEM_CATEGORY_COUNT; j++) {
+			if (category != VITA2D_MEM_ALL && category != j)
+				continue;
+			usage->requested += mem_types[i].usage[j].requested;
+			usage->reserved += mem_types[i].usage[j].reserved;
+			usage->count += mem_types[i].usage[j].count;
+		}
+	}
+
+	gpu_mem_unlock();
+}
+
+int vita2d_set_mem_budget(SceKernelMemBlockType type, unsigned int budget)
+{
+	gpu_mem_lock();
+	gpu_mem_type_info *info = gpu_mem_get_type(type, 1);
+	if (info)
+		info->budget = budget;
+	gpu_mem_unlock();
+
+	return info != NULL;
+}
+
+unsigned int vita2d_get_mem_budget(SceKernelMemBlockType type)
+{
+	unsigned int budget = 0;
+
+	gpu_mem_lock();
+	gpu_mem_type_info *info = gpu_mem_get_type(type, 0);
+	if (info)
+		budget = info->budget;
+	gpu_mem_unlock();
+
+	return budget;
+}
 
 void matrix_copy(float *dst, const float *src)
 {
@@ -299,4 +564,15 @@ int utf8_to_ucs2(const char *utf8, unsigned int *character)
 		*character = utf8[0];
 		return 1;
 	}
-}
\ No newline at end of file
+}
+
+unsigned int fnv1a_hash(const void *data, unsigned int size, unsigned int hash)
+{
+	const unsigned char *bytes = data;
+	unsigned int i;
+
+	for (i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 16777619U;
+
+	return hash;
+}
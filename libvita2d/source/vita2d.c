@@ -6,10 +6,17 @@
 #include <psp2/message_dialog.h>
 #include <psp2/sysmodule.h>
 #include <psp2/sharedfb.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include "vita2d.h"
 #include "utils.h"
+#include "gpu_heap.h"
+#include "texture_cache.h"
+#include "texture_atlas.h"
+#include "profile.h"
+#include "trace.h"
+#include "clip.h"
 
 #ifdef DEBUG_BUILD
 #  include <stdio.h>
@@ -28,6 +35,7 @@
 #define DISPLAY_BUFFER_COUNT		3
 #define DISPLAY_MAX_PENDING_SWAPS	2
 #define DEFAULT_TEMP_POOL_SIZE		(1 * 1024 * 1024)
+#define REGION_CLIP_MAX			4096	/* render targets are at most 4096x4096 */
 
 typedef struct vita2d_display_data {
 	void *address;
@@ -65,6 +73,9 @@ static int clip_rect_y_max = DISPLAY_HEIGHT;
 static int vblank_wait = 1;
 static int drawing = 0;
 static int clipping_enabled = 0;
+static SceGxmRegionClipMode user_region_clip = SCE_GXM_REGION_CLIP_NONE;	/* from vita2d_set_region_clip() */
+static int clip_region_set = 0;
+static int clip_stencil_set = 0;
 
 static int system_app_mode = 0;
 static SceUID shared_fb;
@@ -124,6 +135,12 @@ const SceGxmProgramParameter *_vita2d_clearClearColorParam = NULL;
 const SceGxmProgramParameter *_vita2d_colorWvpParam = NULL;
 const SceGxmProgramParameter *_vita2d_textureWvpParam = NULL;
 const SceGxmProgramParameter *_vita2d_textureTintColorParam = NULL;
+int _vita2d_clip_quads = 0;
+int _vita2d_clip_stencil_pending = 0;
+float _vita2d_clip_x_min = 0.0f;
+float _vita2d_clip_y_min = 0.0f;
+float _vita2d_clip_x_max = 0.0f;
+float _vita2d_clip_y_max = 0.0f;
 
 typedef struct vita2d_fragment_programs {
 	SceGxmFragmentProgram *color;
@@ -169,7 +186,9 @@ static void display_callback(const void *callback_data)
 	sceDisplaySetFrameBuf(&framebuf, SCE_DISPLAY_SETBUF_NEXTFRAME);
 
 	if (vblank_wait) {
+		PROFILE_BEGIN(start);
 		sceDisplayWaitVblankStart();
+		PROFILE_END(VITA2D_PROFILE_VBLANK_WAIT, start);
 	}
 }
 
@@ -246,6 +265,12 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 	err = system_app_mode ? sceGxmVshInitialize(&initializeParams) : sceGxmInitialize(&initializeParams);
 	DEBUG("sceGxmInitialize(): 0x%08X\n", err);
 	
+	gpu_mem_init();
+	gpu_heap_init();
+	texture_cache_init();
+	texture_atlas_init();
+	trace_init();
+
 	// Since CDRAM memory is unaccessible in system app mode, we force USER_RW usage at init phase
 	if (system_app_mode) vita2d_texture_set_alloc_memblock_type(SCE_KERNEL_MEMBLOCK_TYPE_USER_RW);
 	
@@ -269,6 +294,7 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 		SCE_GXM_DEFAULT_VDM_RING_BUFFER_SIZE,
 		4,
 		SCE_GXM_MEMORY_ATTRIB_READ,
+		VITA2D_MEM_RING_BUFFER,
 		&vdmRingBufferUid);
 
 	void *vertexRingBuffer = gpu_alloc(
@@ -276,6 +302,7 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 		SCE_GXM_DEFAULT_VERTEX_RING_BUFFER_SIZE,
 		4,
 		SCE_GXM_MEMORY_ATTRIB_READ,
+		VITA2D_MEM_RING_BUFFER,
 		&vertexRingBufferUid);
 
 	void *fragmentRingBuffer = gpu_alloc(
@@ -283,11 +310,13 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 		SCE_GXM_DEFAULT_FRAGMENT_RING_BUFFER_SIZE,
 		4,
 		SCE_GXM_MEMORY_ATTRIB_READ,
+		VITA2D_MEM_RING_BUFFER,
 		&fragmentRingBufferUid);
 
 	unsigned int fragmentUsseRingBufferOffset;
 	void *fragmentUsseRingBuffer = fragment_usse_alloc(
 		SCE_GXM_DEFAULT_FRAGMENT_USSE_RING_BUFFER_SIZE,
+		VITA2D_MEM_RING_BUFFER,
 		&fragmentUsseRingBufferUid,
 		&fragmentUsseRingBufferOffset);
 
@@ -332,6 +361,7 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 				4*DISPLAY_STRIDE_IN_PIXELS*DISPLAY_HEIGHT,
 				SCE_GXM_COLOR_SURFACE_ALIGNMENT,
 				SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+				VITA2D_MEM_DISPLAY,
 				&displayBufferUid[i]);
 		
 			// memset the buffer to black
@@ -379,6 +409,7 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 		4*sampleCount,
 		SCE_GXM_DEPTHSTENCIL_SURFACE_ALIGNMENT,
 		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+		VITA2D_MEM_DEPTH_STENCIL,
 		&depthBufferUid);
 
 	// allocate the stencil buffer
@@ -387,6 +418,7 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 		4*sampleCount,
 		SCE_GXM_DEPTHSTENCIL_SURFACE_ALIGNMENT,
 		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+		VITA2D_MEM_DEPTH_STENCIL,
 		&stencilBufferUid);
 
 	// create the SceGxmDepthStencilSurface structure
@@ -421,17 +453,20 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 		patcherBufferSize,
 		4,
 		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+		VITA2D_MEM_SHADER,
 		&patcherBufferUid);
 
 	unsigned int patcherVertexUsseOffset;
 	void *patcherVertexUsse = vertex_usse_alloc(
 		patcherVertexUsseSize,
+		VITA2D_MEM_SHADER,
 		&patcherVertexUsseUid,
 		&patcherVertexUsseOffset);
 
 	unsigned int patcherFragmentUsseOffset;
 	void *patcherFragmentUsse = fragment_usse_alloc(
 		patcherFragmentUsseSize,
+		VITA2D_MEM_SHADER,
 		&patcherFragmentUsseUid,
 		&patcherFragmentUsseOffset);
 
@@ -561,6 +596,7 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 		3*sizeof(vita2d_clear_vertex),
 		4,
 		SCE_GXM_MEMORY_ATTRIB_READ,
+		VITA2D_MEM_GEOMETRY,
 		&clearVerticesUid);
 
 	// Allocate a 64k * 2 bytes = 128 KiB buffer and store all possible
@@ -571,6 +607,7 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 		UINT16_MAX*sizeof(uint16_t),
 		sizeof(uint16_t),
 		SCE_GXM_MEMORY_ATTRIB_READ,
+		VITA2D_MEM_GEOMETRY,
 		&linearIndicesUid);
 
         // Range of i must be greater than uint16_t, this doesn't endless-loop
@@ -687,6 +724,7 @@ static int vita2d_init_internal(unsigned int temp_pool_size, SceGxmMultisampleMo
 		pool_size,
 		sizeof(void *),
 		SCE_GXM_MEMORY_ATTRIB_READ,
+		VITA2D_MEM_POOL,
 		&poolUid);
 		
 
@@ -721,7 +759,9 @@ int vita2d_init_advanced_with_msaa(unsigned int temp_pool_size, SceGxmMultisampl
 
 void vita2d_wait_rendering_done()
 {
+	PROFILE_BEGIN(start);
 	sceGxmFinish(_vita2d_context);
+	PROFILE_END(VITA2D_PROFILE_FINISH, start);
 }
 
 int vita2d_fini()
@@ -795,6 +835,12 @@ int vita2d_fini()
 
 	gpu_free(poolUid);
 
+	trace_fini();
+	texture_atlas_fini();
+	texture_cache_fini();
+	gpu_heap_fini();
+	gpu_mem_fini();
+
 	// terminate libgxm
 	sceGxmTerminate();
 
@@ -814,6 +860,10 @@ int vita2d_fini()
 
 void vita2d_clear_screen()
 {
+	TRACE_CALL_NOARGS(TRACE_OP_CLEAR_SCREEN, NULL);
+
+	clip_prepare_draw();
+
 	// set clear shaders
 	sceGxmSetVertexProgram(_vita2d_context, clearVertexProgram);
 	sceGxmSetFragmentProgram(_vita2d_context, clearFragmentProgram);
@@ -825,11 +875,15 @@ void vita2d_clear_screen()
 
 	// draw the clear triangle
 	sceGxmSetVertexStream(_vita2d_context, 0, clearVertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, linearIndices, 3);
+	profile_draw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, linearIndices, 3);
 }
 
 void vita2d_swap_buffers()
 {
+	TRACE_CALL_NOARGS(TRACE_OP_SWAP_BUFFERS, NULL);
+
+	PROFILE_BEGIN(start);
+
 	if (system_app_mode) sceSharedFbEnd(shared_fb);
 	else {
 		// queue the display swap for this frame
@@ -844,16 +898,113 @@ void vita2d_swap_buffers()
 		frontBufferIndex = backBufferIndex;
 		backBufferIndex = (backBufferIndex + 1) % DISPLAY_BUFFER_COUNT;
 	}
+
+	PROFILE_END(VITA2D_PROFILE_SWAP_BUFFERS, start);
+	PROFILE_END_FRAME();
+}
+
+static void set_stencil_func(SceGxmStencilFunc func, SceGxmStencilOp op)
+{
+	sceGxmSetFrontStencilFunc(_vita2d_context, func, op, op, op, 0xFF, 0xFF);
+}
+
+void _vita2d_clip_draw_stencil()
+{
+	const int clip_quads = _vita2d_clip_quads;
+
+	// the draws of the mask itself mustn't be clipped
+	_vita2d_clip_quads = 0;
+	_vita2d_clip_stencil_pending = 0;
+
+	// clear the stencil buffer to 0
+	set_stencil_func(SCE_GXM_STENCIL_FUNC_NEVER, SCE_GXM_STENCIL_OP_ZERO);
+	vita2d_draw_rectangle(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0);
+	// set the stencil to 1 in the desired region
+	set_stencil_func(SCE_GXM_STENCIL_FUNC_NEVER, SCE_GXM_STENCIL_OP_REPLACE);
+	vita2d_draw_rectangle(clip_rect_x_min, clip_rect_y_min,
+		clip_rect_x_max - clip_rect_x_min, clip_rect_y_max - clip_rect_y_min, 0);
+	// set the stencil function to only accept pixels where the stencil is 1
+	set_stencil_func(SCE_GXM_STENCIL_FUNC_EQUAL, SCE_GXM_STENCIL_OP_KEEP);
+
+	clip_stencil_set = 1;
+	_vita2d_clip_quads = clip_quads;
+}
+
+static void clip_reset()
+{
+	_vita2d_clip_quads = 0;
+	_vita2d_clip_stencil_pending = 0;
+
+	if (clip_stencil_set) {
+		set_stencil_func(SCE_GXM_STENCIL_FUNC_ALWAYS, SCE_GXM_STENCIL_OP_KEEP);
+		clip_stencil_set = 0;
+	}
+	if (clip_region_set) {
+		sceGxmSetRegionClip(_vita2d_context, SCE_GXM_REGION_CLIP_NONE, 0, 0, 0, 0);
+		clip_region_set = 0;
+	}
+}
+
+static inline int clamp_region(int value)
+{
+	return value < 0 ? 0 : (value > REGION_CLIP_MAX ? REGION_CLIP_MAX : value);
+}
+
+/*
+ * Applies the clip rectangle to the scene. The region clip does it alone
+ * when the rectangle is on tile boundaries. Otherwise it only cuts the
+ * draws to the tiles the rectangle touches, and clip.h does the rest.
+ */
+static void clip_apply()
+{
+	clip_reset();
+
+	// the region clip is taken, or the rectangle is flipped
+	if (user_region_clip != SCE_GXM_REGION_CLIP_NONE ||
+	    clip_rect_x_min > clip_rect_x_max || clip_rect_y_min > clip_rect_y_max) {
+		_vita2d_clip_draw_stencil();
+		return;
+	}
+
+	const int x_min = clamp_region(clip_rect_x_min);
+	const int y_min = clamp_region(clip_rect_y_min);
+	const int x_max = clamp_region(clip_rect_x_max);
+	const int y_max = clamp_region(clip_rect_y_max);
+
+	// the region clip bounds are inclusive, so it can't be empty
+	if (x_min == x_max || y_min == y_max) {
+		sceGxmSetRegionClip(_vita2d_context, SCE_GXM_REGION_CLIP_ALL, 0, 0, 0, 0);
+		clip_region_set = 1;
+		return;
+	}
+
+	sceGxmSetRegionClip(_vita2d_context, SCE_GXM_REGION_CLIP_OUTSIDE, x_min, y_min, x_max - 1, y_max - 1);
+	clip_region_set = 1;
+
+	if (((x_min | y_min | x_max | y_max) & (SCE_GXM_TILE_SIZEX - 1)) == 0)
+		return;
+
+	_vita2d_clip_x_min = clip_rect_x_min;
+	_vita2d_clip_y_min = clip_rect_y_min;
+	_vita2d_clip_x_max = clip_rect_x_max;
+	_vita2d_clip_y_max = clip_rect_y_max;
+	_vita2d_clip_quads = 1;
+	_vita2d_clip_stencil_pending = 1;
 }
 
 void vita2d_start_drawing()
 {
+	TRACE_CALL_NOARGS(TRACE_OP_START_DRAWING, NULL);
+
 	vita2d_pool_reset();
 	vita2d_start_drawing_advanced(NULL, 0);
 }
 
 void vita2d_start_drawing_advanced(vita2d_texture *target, unsigned int flags)
 {
+	TRACE_CALL(TRACE_OP_START_DRAWING_ADVANCED, target, TRACE_U(flags));
+
+	PROFILE_BEGIN(start);
 
 	if (target == NULL) {
 		if (system_app_mode) {
@@ -883,36 +1034,46 @@ void vita2d_start_drawing_advanced(vita2d_texture *target, unsigned int flags)
 	}
 
 	drawing = 1;
-	// in the current way, the library keeps the region clip across scenes
+	// in the current way, the library keeps the clip rectangle across scenes
 	if (clipping_enabled) {
-		vita2d_set_clip_rectangle(clip_rect_x_min, clip_rect_y_min, clip_rect_x_max, clip_rect_y_max);
+		clip_apply();
 	}
+
+	PROFILE_END(VITA2D_PROFILE_START_DRAWING, start);
 }
 
 void vita2d_end_drawing()
 {
+	TRACE_CALL_NOARGS(TRACE_OP_END_DRAWING, NULL);
+
+	PROFILE_BEGIN(start);
 	sceGxmEndScene(_vita2d_context, NULL, NULL);
-	if (system_app_mode && vblank_wait) sceDisplayWaitVblankStart();
+	PROFILE_END(VITA2D_PROFILE_END_DRAWING, start);
+	PROFILE_MAX(VITA2D_PROFILE_POOL_BYTES, pool_index);
+
+	if (system_app_mode && vblank_wait) {
+		PROFILE_BEGIN(vblank_start);
+		sceDisplayWaitVblankStart();
+		PROFILE_END(VITA2D_PROFILE_VBLANK_WAIT, vblank_start);
+	}
 	drawing = 0;
 }
 
 void vita2d_enable_clipping()
 {
+	TRACE_CALL_NOARGS(TRACE_OP_ENABLE_CLIPPING, NULL);
+
 	clipping_enabled = 1;
-	vita2d_set_clip_rectangle(clip_rect_x_min, clip_rect_y_min, clip_rect_x_max, clip_rect_y_max);
+	if (drawing)
+		clip_apply();
 }
 
 void vita2d_disable_clipping()
 {
+	TRACE_CALL_NOARGS(TRACE_OP_DISABLE_CLIPPING, NULL);
+
 	clipping_enabled = 0;
-	sceGxmSetFrontStencilFunc(
-			_vita2d_context,
-			SCE_GXM_STENCIL_FUNC_ALWAYS,
-			SCE_GXM_STENCIL_OP_KEEP,
-			SCE_GXM_STENCIL_OP_KEEP,
-			SCE_GXM_STENCIL_OP_KEEP,
-			0xFF,
-			0xFF);
+	clip_reset();
 }
 
 int vita2d_get_clipping_enabled()
@@ -922,53 +1083,15 @@ int vita2d_get_clipping_enabled()
 
 void vita2d_set_clip_rectangle(int x_min, int y_min, int x_max, int y_max)
 {
+	TRACE_CALL(TRACE_OP_SET_CLIP_RECTANGLE, NULL, TRACE_I(x_min), TRACE_I(y_min), TRACE_I(x_max), TRACE_I(y_max));
+
 	clip_rect_x_min = x_min;
 	clip_rect_y_min = y_min;
 	clip_rect_x_max = x_max;
 	clip_rect_y_max = y_max;
 	// we can only draw during a scene, but we can cache the values since they're not going to have any visible effect till the scene starts anyways
-	if(drawing) {
-		// clear the stencil buffer to 0
-		sceGxmSetFrontStencilFunc(
-			_vita2d_context,
-			SCE_GXM_STENCIL_FUNC_NEVER,
-			SCE_GXM_STENCIL_OP_ZERO,
-			SCE_GXM_STENCIL_OP_ZERO,
-			SCE_GXM_STENCIL_OP_ZERO,
-			0xFF,
-			0xFF);
-		vita2d_draw_rectangle(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0);
-		// set the stencil to 1 in the desired region
-		sceGxmSetFrontStencilFunc(
-			_vita2d_context,
-			SCE_GXM_STENCIL_FUNC_NEVER,
-			SCE_GXM_STENCIL_OP_REPLACE,
-			SCE_GXM_STENCIL_OP_REPLACE,
-			SCE_GXM_STENCIL_OP_REPLACE,
-			0xFF,
-			0xFF);
-		vita2d_draw_rectangle(x_min, y_min, x_max - x_min, y_max - y_min, 0);
-		if(clipping_enabled) {
-			// set the stencil function to only accept pixels where the stencil is 1
-			sceGxmSetFrontStencilFunc(
-				_vita2d_context,
-				SCE_GXM_STENCIL_FUNC_EQUAL,
-				SCE_GXM_STENCIL_OP_KEEP,
-				SCE_GXM_STENCIL_OP_KEEP,
-				SCE_GXM_STENCIL_OP_KEEP,
-				0xFF,
-				0xFF);
-		} else {
-			sceGxmSetFrontStencilFunc(
-				_vita2d_context,
-				SCE_GXM_STENCIL_FUNC_ALWAYS,
-				SCE_GXM_STENCIL_OP_KEEP,
-				SCE_GXM_STENCIL_OP_KEEP,
-				SCE_GXM_STENCIL_OP_KEEP,
-				0xFF,
-				0xFF);
-		}
-	}
+	if (drawing && clipping_enabled)
+		clip_apply();
 }
 
 void vita2d_get_clip_rectangle(int *x_min, int *y_min, int *x_max, int *y_max)
@@ -999,6 +1122,8 @@ int vita2d_common_dialog_update()
 
 void vita2d_set_clear_color(unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_SET_CLEAR_COLOR, NULL, TRACE_U(color));
+
 	clear_color[0] = ((color >> 8*0) & 0xFF)/255.0f;
 	clear_color[1] = ((color >> 8*1) & 0xFF)/255.0f;
 	clear_color[2] = ((color >> 8*2) & 0xFF)/255.0f;
@@ -1013,6 +1138,8 @@ unsigned int vita2d_get_clear_color()
 
 void vita2d_set_vblank_wait(int enable)
 {
+	TRACE_CALL(TRACE_OP_SET_VBLANK_WAIT, NULL, TRACE_I(enable));
+
 	vblank_wait = enable;
 }
 
@@ -1038,13 +1165,20 @@ const uint16_t *vita2d_get_linear_indices()
 
 void vita2d_set_region_clip(SceGxmRegionClipMode mode, unsigned int x_min, unsigned int y_min, unsigned int x_max, unsigned int y_max)
 {
+	TRACE_CALL(TRACE_OP_SET_REGION_CLIP, NULL, TRACE_U(mode), TRACE_U(x_min), TRACE_U(y_min), TRACE_U(x_max), TRACE_U(y_max));
+
+	// the clip rectangle goes back to the stencil while the region clip is taken
+	user_region_clip = mode;
+	clip_region_set = 0;
 	sceGxmSetRegionClip(_vita2d_context, mode, x_min, y_min, x_max, y_max);
+	if (drawing && clipping_enabled)
+		clip_apply();
 }
 
 void *vita2d_pool_malloc(unsigned int size)
 {
 	if ((pool_index + size) < pool_size) {
-		void *addr = (void *)((unsigned int)pool_addr + pool_index);
+		void *addr = (void *)((uintptr_t)pool_addr + pool_index);
 		pool_index += size;
 		return addr;
 	}
@@ -1055,7 +1189,7 @@ void *vita2d_pool_memalign(unsigned int size, unsigned int alignment)
 {
 	unsigned int new_index = (pool_index + alignment - 1) & ~(alignment - 1);
 	if ((new_index + size) < pool_size) {
-		void *addr = (void *)((unsigned int)pool_addr + new_index);
+		void *addr = (void *)((uintptr_t)pool_addr + new_index);
 		pool_index = new_index + size;
 		return addr;
 	}
@@ -1069,11 +1203,15 @@ unsigned int vita2d_pool_free_space()
 
 void vita2d_pool_reset()
 {
+	TRACE_CALL_NOARGS(TRACE_OP_POOL_RESET, NULL);
+
 	pool_index = 0;
 }
 
 void vita2d_set_blend_mode_add(int enable)
 {
+	TRACE_CALL(TRACE_OP_SET_BLEND_MODE_ADD, NULL, TRACE_I(enable));
+
 	vita2d_fragment_programs *in = enable ? &_vita2d_fragmentPrograms.blend_mode_add
 	    : &_vita2d_fragmentPrograms.blend_mode_normal;
 
@@ -0,0 +1,409 @@
+#include <psp2/kernel/threadmgr.h>
+#include <string.h>
+#include <stdlib.h>
+#include "vita2d.h"
+
+#define ASYNC_MAX_THREADS	4
+#define ASYNC_THREAD_STACK_SIZE	(128 * 1024)
+/* Slightly below the default user priority so decoding doesn't starve rendering */
+#define ASYNC_THREAD_PRIORITY	(0x10000100 + 16)
+
+typedef enum {
+	ASYNC_LOAD_PNG_FILE,
+	ASYNC_LOAD_PNG_BUFFER,
+	ASYNC_LOAD_JPEG_FILE,
+	ASYNC_LOAD_JPEG_BUFFER,
+	ASYNC_LOAD_BMP_FILE,
+	ASYNC_LOAD_BMP_BUFFER
+} async_load_type;
+
+typedef enum {
+	ASYNC_LOAD_QUEUED,
+	ASYNC_LOAD_RUNNING,
+	ASYNC_LOAD_DONE
+} async_load_state;
+
+typedef struct vita2d_async_load {
+	async_load_type type;
+	char *filename;
+	const void *buffer;
+	unsigned long buffer_size;
+	vita2d_async_load_cb cb;
+	void *user_data;
+	vita2d_texture *texture;
+	async_load_state state;
+	int cancelled;
+	SceUID done_sema;
+	struct vita2d_async_load *next;
+} vita2d_async_load;
+
+typedef struct async_load_list {
+	vita2d_async_load *head;
+	vita2d_async_load *tail;
+} async_load_list;
+
+static int async_num_threads = 0;
+static int async_exiting = 0;
+static SceUID async_threads[ASYNC_MAX_THREADS];
+static SceUID async_job_sema;
+static SceKernelLwMutexWork async_mutex;
+static async_load_list async_pending = {NULL, NULL};
+static async_load_list async_done = {NULL, NULL};
+
+/* Locking is only needed while the worker threads are running */
+static void async_lock()
+{
+	if (async_num_threads > 0)
+		sceKernelLockLwMutex(&async_mutex, 1, NULL);
+}
+
+static void async_unlock()
+{
+	if (async_num_threads > 0)
+		sceKernelUnlockLwMutex(&async_mutex, 1);
+}
+
+static void async_list_push(async_load_list *list, vita2d_async_load *load)
+{
+	load->next = NULL;
+	if (list->tail)
+		list->tail->next = load;
+	else
+		list->head = load;
+	list->tail = load;
+}
+
+static vita2d_async_load *async_list_pop(async_load_list *list)
+{
+	vita2d_async_load *load = list->head;
+	if (load) {
+		list->head = load->next;
+		if (!list->head)
+			list->tail = NULL;
+		load->next = NULL;
+	}
+	return load;
+}
+
+static int async_list_remove(async_load_list *list, vita2d_async_load *load)
+{
+	vita2d_async_load *prev = NULL;
+	vita2d_async_load *tmp = list->head;
+
+	while (tmp) {
+		if (tmp == load) {
+			if (prev)
+				prev->next = tmp->next;
+			else
+				list->head = tmp->next;
+			if (list->tail == tmp)
+				list->tail = prev;
+			tmp->next = NULL;
+			return 1;
+		}
+		prev = tmp;
+		tmp = tmp->next;
+	}
+
+	return 0;
+}
+
+static vita2d_texture *async_decode(const vita2d_async_load *load)
+{
+	switch (load->type) {
+	case ASYNC_LOAD_PNG_FILE:
+		return vita2d_load_PNG_file(load->filename);
+	case ASYNC_LOAD_PNG_BUFFER:
+		return vita2d_load_PNG_buffer(load->buffer);
+	case ASYNC_LOAD_JPEG_FILE:
+		return vita2d_load_JPEG_file(load->filename);
+	case ASYNC_LOAD_JPEG_BUFFER:
+		return vita2d_load_JPEG_buffer(load->buffer, load->buffer_size);
+	case ASYNC_LOAD_BMP_FILE:
+		return vita2d_load_BMP_file(load->filename);
+	case ASYNC_LOAD_BMP_BUFFER:
+		return vita2d_load_BMP_buffer(load->buffer);
+	}
+
+	return NULL;
+}
+
+static void async_free_load(vita2d_async_load *load)
+{
+	if (load->done_sema > 0)
+		sceKernelDeleteSema(load->done_sema);
+	free(load->filename);
+	free(load);
+}
+
+static int async_worker_thread(SceSize args, void *argp)
+{
+	vita2d_async_load *load;
+
+	while (1) {
+		sceKernelWaitSema(async_job_sema, 1, NULL);
+
+		sceKernelLockLwMutex(&async_mutex, 1, NULL);
+		if (async_exiting) {
+			sceKernelUnlockLwMutex(&async_mutex, 1);
+			break;
+		}
+		/* The queue may be empty if the job was finished or cancelled meanwhile */
+		load = async_list_pop(&async_pending);
+		if (load)
+			load->state = ASYNC_LOAD_RUNNING;
+		sceKernelUnlockLwMutex(&async_mutex, 1);
+
+		if (!load)
+			continue;
+
+		vita2d_texture *texture = async_decode(load);
+
+		sceKernelLockLwMutex(&async_mutex, 1, NULL);
+		load->texture = texture;
+		load->state = ASYNC_LOAD_DONE;
+		if (load->cancelled) {
+			vita2d_free_texture(texture);
+			async_free_load(load);
+		} else {
+			if (load->cb)
+				async_list_push(&async_done, load);
+			/* Signal with the lock held, dispatch may free the load right after */
+			sceKernelSignalSema(load->done_sema, 1);
+		}
+		sceKernelUnlockLwMutex(&async_mutex, 1);
+	}
+
+	return 0;
+}
+
+int vita2d_async_init(int num_threads)
+{
+	int i;
+
+	if (async_num_threads > 0)
+		return 0;
+
+	if (num_threads < 1)
+		num_threads = 1;
+	else if (num_threads > ASYNC_MAX_THREADS)
+		num_threads = ASYNC_MAX_THREADS;
+
+	async_job_sema = sceKernelCreateSema("vita2d_async_sema", 0, 0, 0x7FFFFFFF, NULL);
+	if (async_job_sema < 0)
+		return 0;
+
+	sceKernelCreateLwMutex(&async_mutex, "vita2d_async_mutex", 0, 0, NULL);
+	async_exiting = 0;
+
+	for (i = 0; i < num_threads; i++) {
+		async_threads[i] = sceKernelCreateThread("vita2d_async_thread",
+			async_worker_thread, ASYNC_THREAD_PRIORITY, ASYNC_THREAD_STACK_SIZE,
+			0, SCE_KERNEL_THREAD_CPU_AFFINITY_MASK_DEFAULT, NULL);
+		if (async_threads[i] < 0)
+			break;
+		sceKernelStartThread(async_threads[i], 0, NULL);
+	}
+
+	async_num_threads = i;
+
+	if (async_num_threads == 0) {
+		sceKernelDeleteLwMutex(&async_mutex);
+		sceKernelDeleteSema(async_job_sema);
+		return 0;
+	}
+
+	return 1;
+}
+
+void vita2d_async_fini()
+{
+	vita2d_async_load *load;
+	int i;
+
+	if (async_num_threads == 0)
+		return;
+
+	sceKernelLockLwMutex(&async_mutex, 1, NULL);
+	async_exiting = 1;
+	sceKernelUnlockLwMutex(&async_mutex, 1);
+
+	sceKernelSignalSema(async_job_sema, async_num_threads);
+
+	for (i = 0; i < async_num_threads; i++) {
+		sceKernelWaitThreadEnd(async_threads[i], NULL, NULL);
+		sceKernelDeleteThread(async_threads[i]);
+	}
+
+	sceKernelDeleteLwMutex(&async_mutex);
+	sceKernelDeleteSema(async_job_sema);
+	async_num_threads = 0;
+
+	/*
+	 * Loads still queued are decoded synchronously by vita2d_async_load_finish(),
+	 * the ones with a callback are reported as failed by vita2d_async_dispatch().
+	 */
+	while ((load = async_list_pop(&async_pending))) {
+		if (load->cb) {
+			load->state = ASYNC_LOAD_DONE;
+			async_list_push(&async_done, load);
+		}
+	}
+}
+
+static vita2d_async_load *async_submit(async_load_type type, const char *filename,
+				       const void *buffer, unsigned long buffer_size,
+				       vita2d_async_load_cb cb, void *user_data)
+{
+	vita2d_async_load *load = malloc(sizeof(*load));
+	if (!load)
+		return NULL;
+
+	memset(load, 0, sizeof(*load));
+	load->type = type;
+	load->buffer = buffer;
+	load->buffer_size = buffer_size;
+	load->cb = cb;
+	load->user_data = user_data;
+	load->state = ASYNC_LOAD_QUEUED;
+
+	if (filename) {
+		load->filename = strdup(filename);
+		if (!load->filename) {
+			free(load);
+			return NULL;
+		}
+	}
+
+	/* Without worker threads the load completes right away */
+	if (async_num_threads == 0) {
+		load->texture = async_decode(load);
+		load->state = ASYNC_LOAD_DONE;
+		if (load->cb)
+			async_list_push(&async_done, load);
+		return load;
+	}
+
+	load->done_sema = sceKernelCreateSema("vita2d_async_load", 0, 0, 1, NULL);
+	if (load->done_sema < 0) {
+		async_free_load(load);
+		return NULL;
+	}
+
+	sceKernelLockLwMutex(&async_mutex, 1, NULL);
+	async_list_push(&async_pending, load);
+	sceKernelUnlockLwMutex(&async_mutex, 1);
+
+	sceKernelSignalSema(async_job_sema, 1);
+
+	return load;
+}
+
+vita2d_async_load *vita2d_load_PNG_file_async(const char *filename, vita2d_async_load_cb cb, void *user_data)
+{
+	return async_submit(ASYNC_LOAD_PNG_FILE, filename, NULL, 0, cb, user_data);
+}
+
+vita2d_async_load *vita2d_load_PNG_buffer_async(const void *buffer, vita2d_async_load_cb cb, void *user_data)
+{
+	return async_submit(ASYNC_LOAD_PNG_BUFFER, NULL, buffer, 0, cb, user_data);
+}
+
+vita2d_async_load *vita2d_load_JPEG_file_async(const char *filename, vita2d_async_load_cb cb, void *user_data)
+{
+	return async_submit(ASYNC_LOAD_JPEG_FILE, filename, NULL, 0, cb, user_data);
+}
+
+vita2d_async_load *vita2d_load_JPEG_buffer_async(const void *buffer, unsigned long buffer_size, vita2d_async_load_cb cb, void *user_data)
+{
+	return async_submit(ASYNC_LOAD_JPEG_BUFFER, NULL, buffer, buffer_size, cb, user_data);
+}
+
+vita2d_async_load *vita2d_load_BMP_file_async(const char *filename, vita2d_async_load_cb cb, void *user_data)
+{
+	return async_submit(ASYNC_LOAD_BMP_FILE, filename, NULL, 0, cb, user_data);
+}
+
+vita2d_async_load *vita2d_load_BMP_buffer_async(const void *buffer, vita2d_async_load_cb cb, void *user_data)
+{
+	return async_submit(ASYNC_LOAD_BMP_BUFFER, NULL, buffer, 0, cb, user_data);
+}
+
+int vita2d_async_load_done(const vita2d_async_load *load)
+{
+	int done;
+
+	async_lock();
+	done = load->state == ASYNC_LOAD_DONE;
+	async_unlock();
+
+	return done;
+}
+
+vita2d_texture *vita2d_async_load_finish(vita2d_async_load *load)
+{
+	vita2d_texture *texture;
+
+	async_lock();
+	if (load->state == ASYNC_LOAD_QUEUED) {
+		/* Not picked up by a worker yet, decode it here instead of waiting */
+		async_list_remove(&async_pending, load);
+		async_unlock();
+		texture = async_decode(load);
+	} else {
+		if (load->state == ASYNC_LOAD_RUNNING) {
+			async_unlock();
+			sceKernelWaitSema(load->done_sema, 1, NULL);
+			async_lock();
+		}
+		async_list_remove(&async_done, load);
+		texture = load->texture;
+		async_unlock();
+	}
+
+	async_free_load(load);
+
+	return texture;
+}
+
+void vita2d_async_load_cancel(vita2d_async_load *load)
+{
+	async_lock();
+	if (load->state == ASYNC_LOAD_RUNNING) {
+		/* The worker frees it once the decode returns */
+		load->cancelled = 1;
+		async_unlock();
+		return;
+	}
+
+	if (load->state == ASYNC_LOAD_QUEUED)
+		async_list_remove(&async_pending, load);
+	else
+		async_list_remove(&async_done, load);
+	async_unlock();
+
+	if (load->texture)
+		vita2d_free_texture(load->texture);
+	async_free_load(load);
+}
+
+int vita2d_async_dispatch()
+{
+	vita2d_async_load *load;
+	async_load_list done;
+	int count = 0;
+
+	async_lock();
+	done = async_done;
+	async_done.head = NULL;
+	async_done.tail = NULL;
+	async_unlock();
+
+	while ((load = async_list_pop(&done))) {
+		load->cb(load->texture, load->user_data);
+		async_free_load(load);
+		count++;
+	}
+
+	return count;
+}
@@ -0,0 +1,242 @@
+#include <string.h>
+#include <stdlib.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/gxm.h>
+#include "vita2d.h"
+#include "shared.h"
+#include "baked.h"
+
+#define MAX_TEXTURE		4096
+#define MAX_BAKED_TEXTURES	1024
+#define MAX_BAKED_IMAGES	65536
+
+struct vita2d_baked {
+	unsigned int num_textures;
+	vita2d_texture **textures;
+	unsigned int num_images;
+	baked_image *images;
+	char *names;
+};
+
+/* Either an open file or a buffer of size bytes */
+typedef struct baked_source {
+	SceUID fd;
+	const unsigned char *buffer;
+	unsigned long size;
+} baked_source;
+
+static int _vita2d_baked_read(const baked_source *source, unsigned int offset, void *data, unsigned int size)
+{
+	if (source->buffer) {
+		if (offset > source->size || size > source->size - offset)
+			return 0;
+		memcpy(data, source->buffer + offset, size);
+		return 1;
+	}
+
+	sceIoLseek(source->fd, offset, SCE_SEEK_SET);
+	return sceIoRead(source->fd, data, size) == size;
+}
+
+static int _vita2d_baked_check_texture(const baked_texture *info)
+{
+	if (info->width == 0 || info->width > MAX_TEXTURE ||
+	    info->height == 0 || info->height > MAX_TEXTURE)
+		return 0;
+
+	switch (info->type) {
+	case SCE_GXM_TEXTURE_LINEAR:
+	case SCE_GXM_TEXTURE_SWIZZLED:
+	case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+	case SCE_GXM_TEXTURE_TILED:
+		break;
+	default:
+		return 0;
+	}
+
+	/* P8 textures need their palette, the others can't have one */
+	return ((info->format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P8) == (info->palette_offset != 0);
+}
+
+static vita2d_texture *_vita2d_baked_load_texture(const baked_source *source, const baked_texture *info)
+{
+	vita2d_texture *texture = _vita2d_create_empty_texture_type(info->width, info->height,
+		info->format, info->type, 0, info->data_size);
+	if (!texture)
+		return NULL;
+
+	/* The size has to be the one of the texture, or the GPU would read past the data */
+	unsigned int size = _vita2d_texture_get_size(texture);
+	if (info->palette_offset)
+		size -= BAKED_PALETTE_SIZE;
+	if (size != info->data_size)
+		goto exit_free;
+
+	/* Read straight into the GPU memory */
+	if (!_vita2d_baked_read(source, info->data_offset, vita2d_texture_get_datap(texture), info->data_size))
+		goto exit_free;
+
+	if (info->palette_offset &&
+	    !_vita2d_baked_read(source, info->palette_offset, vita2d_texture_get_palette(texture), BAKED_PALETTE_SIZE))
+		goto exit_free;
+
+	return texture;
+
+exit_free:
+	vita2d_free_texture(texture);
+	return NULL;
+}
+
+static vita2d_baked *_vita2d_load_baked_generic(const baked_source *source)
+{
+	baked_header header;
+	baked_texture *textures = NULL;
+	vita2d_baked *baked = NULL;
+	unsigned int i, offset;
+
+	if (!_vita2d_baked_read(source, 0, &header, sizeof(header)))
+		goto exit_error;
+
+	if (header.magic != BAKED_MAGIC || header.version != BAKED_VERSION ||
+	    header.num_textures > MAX_BAKED_TEXTURES || header.num_images > MAX_BAKED_IMAGES ||
+	    (header.num_images && header.names_size == 0))
+		goto exit_error;
+
+	baked = calloc(1, sizeof(*baked));
+	textures = malloc(header.num_textures * sizeof(*textures));
+	if (!baked || (header.num_textures && !textures))
+		goto exit_error;
+
+	baked->textures = calloc(header.num_textures, sizeof(*baked->textures));
+	baked->images = malloc(header.num_images * sizeof(*baked->images));
+	baked->names = malloc(header.names_size);
+	if ((header.num_textures && !baked->textures) ||
+	    (header.num_images && !baked->images) ||
+	    (header.names_size && !baked->names))
+		goto exit_error;
+
+	offset = sizeof(header);
+	if (!_vita2d_baked_read(source, offset, textures, header.num_textures * sizeof(*textures)))
+		goto exit_error;
+
+	offset += header.num_textures * sizeof(*textures);
+	if (!_vita2d_baked_read(source, offset, baked->images, header.num_images * sizeof(*baked->images)))
+		goto exit_error;
+
+	offset += header.num_images * sizeof(*baked->images);
+	if (!_vita2d_baked_read(source, offset, baked->names, header.names_size))
+		goto exit_error;
+
+	/* Validate all the tables before touching the GPU memory */
+	if (header.names_size && baked->names[header.names_size - 1] != '\0')
+		goto exit_error;
+
+	for (i = 0; i < header.num_textures; i++) {
+		if (!_vita2d_baked_check_texture(&textures[i]))
+			goto exit_error;
+	}
+
+	for (i = 0; i < header.num_images; i++) {
+		const baked_image *image = &baked->images[i];
+		if (image->name_offset >= header.names_size || image->texture >= header.num_textures ||
+		    image->x + image->w > textures[image->texture].width ||
+		    image->y + image->h > textures[image->texture].height)
+			goto exit_error;
+	}
+
+	baked->num_textures = header.num_textures;
+	baked->num_images = header.num_images;
+
+	for (i = 0; i < header.num_textures; i++) {
+		baked->textures[i] = _vita2d_baked_load_texture(source, &textures[i]);
+		if (!baked->textures[i])
+			goto exit_error;
+	}
+
+	free(textures);
+	return baked;
+
+exit_error:
+	free(textures);
+	vita2d_free_baked(baked);
+	return NULL;
+}
+
+vita2d_baked *vita2d_load_baked(const char *filename)
+{
+	baked_source source = {0, NULL, 0};
+
+	if ((source.fd = sceIoOpen(filename, SCE_O_RDONLY, 0777)) < 0)
+		return NULL;
+
+	vita2d_baked *baked = _vita2d_load_baked_generic(&source);
+
+	sceIoClose(source.fd);
+	return baked;
+}
+
+vita2d_baked *vita2d_load_baked_buffer(const void *buffer, unsigned long buffer_size)
+{
+	baked_source source = {0, buffer, buffer_size};
+
+	return _vita2d_load_baked_generic(&source);
+}
+
+void vita2d_free_baked(vita2d_baked *baked)
+{
+	unsigned int i;
+
+	if (!baked)
+		return;
+
+	if (baked->textures) {
+		for (i = 0; i < baked->num_textures; i++)
+			vita2d_free_texture(baked->textures[i]);
+	}
+
+	free(baked->textures);
+	free(baked->images);
+	free(baked->names);
+	free(baked);
+}
+
+unsigned int vita2d_baked_get_num_textures(const vita2d_baked *baked)
+{
+	return baked->num_textures;
+}
+
+vita2d_texture *vita2d_baked_get_texture(const vita2d_baked *baked, unsigned int index)
+{
+	if (index >= baked->num_textures)
+		return NULL;
+
+	return baked->textures[index];
+}
+
+int vita2d_baked_get_image(const vita2d_baked *baked, const char *name, vita2d_atlas_image *image)
+{
+	int lo = 0, hi = (int)baked->num_images - 1;
+
+	/* The images are sorted by name */
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		const baked_image *entry = &baked->images[mid];
+		int cmp = strcmp(name, baked->names + entry->name_offset);
+
+		if (cmp == 0) {
+			image->texture = baked->textures[entry->texture];
+			image->x = entry->x;
+			image->y = entry->y;
+			image->w = entry->w;
+			image->h = entry->h;
+			return 1;
+		}
+
+		if (cmp < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+
+	return 0;
+}
@@ -1,9 +1,16 @@
 #include <math.h>
 #include "vita2d.h"
 #include "shared.h"
+#include "profile.h"
+#include "trace.h"
+#include "clip.h"
 
 void vita2d_draw_pixel(float x, float y, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_PIXEL, NULL, TRACE_F(x), TRACE_F(y), TRACE_U(color));
+
+	clip_prepare_draw();
+
 	vita2d_color_vertex *vertex = (vita2d_color_vertex *)vita2d_pool_memalign(
 		1 * sizeof(vita2d_color_vertex), // 1 vertex
 		sizeof(vita2d_color_vertex));
@@ -28,12 +35,16 @@ void vita2d_draw_pixel(float x, float y, unsigned int color)
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertex);
 	sceGxmSetFrontPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_POINT);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_POINTS, SCE_GXM_INDEX_FORMAT_U16, index, 1);
+	profile_draw(_vita2d_context, SCE_GXM_PRIMITIVE_POINTS, SCE_GXM_INDEX_FORMAT_U16, index, 1);
 	sceGxmSetFrontPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
 }
 
 void vita2d_draw_line(float x0, float y0, float x1, float y1, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_LINE, NULL, TRACE_F(x0), TRACE_F(y0), TRACE_F(x1), TRACE_F(y1), TRACE_U(color));
+
+	clip_prepare_draw();
+
 	vita2d_color_vertex *vertices = (vita2d_color_vertex *)vita2d_pool_memalign(
 		2 * sizeof(vita2d_color_vertex), // 2 vertices
 		sizeof(vita2d_color_vertex));
@@ -57,33 +68,41 @@ void vita2d_draw_line(float x0, float y0, float x1, float y1, unsigned int color
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
 	sceGxmSetFrontPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_LINE);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_LINES, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 2);
+	profile_draw(_vita2d_context, SCE_GXM_PRIMITIVE_LINES, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 2);
 	sceGxmSetFrontPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
 }
 
 void vita2d_draw_rectangle(float x, float y, float w, float h, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_RECTANGLE, NULL, TRACE_F(x), TRACE_F(y), TRACE_F(w), TRACE_F(h), TRACE_U(color));
+
+	float x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+	float u0 = 0.0f, v0 = 0.0f, u1 = 0.0f, v1 = 0.0f;
+
+	if (!clip_quad(&x0, &y0, &x1, &y1, &u0, &v0, &u1, &v1))
+		return;
+
 	vita2d_color_vertex *vertices = (vita2d_color_vertex *)vita2d_pool_memalign(
 		4 * sizeof(vita2d_color_vertex), // 4 vertices
 		sizeof(vita2d_color_vertex));
 
-	vertices[0].x = x;
-	vertices[0].y = y;
+	vertices[0].x = x0;
+	vertices[0].y = y0;
 	vertices[0].z = +0.5f;
 	vertices[0].color = color;
 
-	vertices[1].x = x + w;
-	vertices[1].y = y;
+	vertices[1].x = x1;
+	vertices[1].y = y0;
 	vertices[1].z = +0.5f;
 	vertices[1].color = color;
 
-	vertices[2].x = x;
-	vertices[2].y = y + h;
+	vertices[2].x = x0;
+	vertices[2].y = y1;
 	vertices[2].z = +0.5f;
 	vertices[2].color = color;
 
-	vertices[3].x = x + w;
-	vertices[3].y = y + h;
+	vertices[3].x = x1;
+	vertices[3].y = y1;
 	vertices[3].z = +0.5f;
 	vertices[3].color = color;
 
@@ -95,11 +114,15 @@ void vita2d_draw_rectangle(float x, float y, float w, float h, unsigned int colo
 	sceGxmSetUniformDataF(vertexDefaultBuffer, _vita2d_colorWvpParam, 0, 16, _vita2d_ortho_matrix);
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	profile_draw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
 }
 
 void vita2d_draw_fill_circle(float x, float y, float radius, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_FILL_CIRCLE, NULL, TRACE_F(x), TRACE_F(y), TRACE_F(radius), TRACE_U(color));
+
+	clip_prepare_draw();
+
 	static const int num_segments = 100;
 
 	vita2d_color_vertex *vertices = (vita2d_color_vertex *)vita2d_pool_memalign(
@@ -147,11 +170,15 @@ void vita2d_draw_fill_circle(float x, float y, float radius, unsigned int color)
 	sceGxmSetUniformDataF(vertexDefaultBuffer, _vita2d_colorWvpParam, 0, 16, _vita2d_ortho_matrix);
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_FAN, SCE_GXM_INDEX_FORMAT_U16, indices, num_segments + 2);
+	profile_draw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_FAN, SCE_GXM_INDEX_FORMAT_U16, indices, num_segments + 2);
 }
 
 void vita2d_draw_array(SceGxmPrimitiveType mode, const vita2d_color_vertex *vertices, size_t count)
 {
+	TRACE_CALL_DATA(TRACE_OP_DRAW_ARRAY, NULL, vertices, count * sizeof(*vertices), TRACE_U(mode));
+
+	clip_prepare_draw();
+
 	sceGxmSetVertexProgram(_vita2d_context, _vita2d_colorVertexProgram);
 	sceGxmSetFragmentProgram(_vita2d_context, _vita2d_colorFragmentProgram);
 
@@ -162,5 +189,5 @@ void vita2d_draw_array(SceGxmPrimitiveType mode, const vita2d_color_vertex *vert
 	sceGxmSetBackPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, mode, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), count);
+	profile_draw(_vita2d_context, mode, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), count);
 }
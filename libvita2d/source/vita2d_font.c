@@ -1,4 +1,5 @@
 #include <psp2/kernel/sysmem.h>
+#include <psp2/io/stat.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
@@ -10,6 +11,7 @@
 #include "bin_packing_2d.h"
 #include "utils.h"
 #include "shared.h"
+#include "trace.h"
 
 #define ATLAS_DEFAULT_W 512
 #define ATLAS_DEFAULT_H 512
@@ -33,6 +35,7 @@ typedef struct vita2d_font {
 	FTC_CMapCache cmapcache;
 	FTC_ImageCache imagecache;
 	texture_atlas *atlas;
+	unsigned int atlas_owner;
 } vita2d_font;
 
 static FT_Error ftc_face_requester(FTC_FaceID face_id, FT_Library library,
@@ -95,8 +98,8 @@ vita2d_font *vita2d_load_font_file(const char *filename)
 
 	font->load_from = VITA2D_LOAD_FONT_FROM_FILE;
 
-	font->atlas = texture_atlas_create(ATLAS_DEFAULT_W, ATLAS_DEFAULT_H,
-		SCE_GXM_TEXTURE_FORMAT_U8_R111);
+	font->atlas = texture_atlas_acquire(ATLAS_DEFAULT_W, ATLAS_DEFAULT_H,
+		SCE_GXM_TEXTURE_FORMAT_U8_R111, &font->atlas_owner);
 
 	return font;
 }
@@ -138,27 +141,70 @@ vita2d_font *vita2d_load_font_mem(const void *buffer, unsigned int size)
 
 	font->load_from = VITA2D_LOAD_FONT_FROM_MEM;
 
-	font->atlas = texture_atlas_create(ATLAS_DEFAULT_W, ATLAS_DEFAULT_H,
-		SCE_GXM_TEXTURE_FORMAT_U8_R111);
+	font->atlas = texture_atlas_acquire(ATLAS_DEFAULT_W, ATLAS_DEFAULT_H,
+		SCE_GXM_TEXTURE_FORMAT_U8_R111, &font->atlas_owner);
 
 	return font;
 }
 
 void vita2d_free_font(vita2d_font *font)
 {
+	TRACE_FORGET(font);
+
 	if (font) {
 		FTC_FaceID face_id = (FTC_FaceID)font;
 		FTC_Manager_RemoveFaceID(font->ftcmanager, face_id);
 		FTC_Manager_Done(font->ftcmanager);
+		FT_Done_FreeType(font->ftlibrary);
 		if (font->load_from == VITA2D_LOAD_FONT_FROM_FILE) {
 			free(font->filename);
 		}
-		texture_atlas_free(font->atlas);
+		texture_atlas_release(font->atlas, font->atlas_owner);
 		free(font);
 	}
 }
 
-static int atlas_add_glyph(texture_atlas *atlas, unsigned int glyph_index,
+static unsigned int font_hash(const vita2d_font *font)
+{
+	unsigned int hash = FNV1A_INIT;
+
+	if (font->load_from == VITA2D_LOAD_FONT_FROM_FILE) {
+		SceIoStat stat;
+		memset(&stat, 0, sizeof(stat));
+		sceIoGetstat(font->filename, &stat);
+		hash = fnv1a_hash(font->filename, strlen(font->filename), hash);
+		hash = fnv1a_hash(&stat.st_size, sizeof(stat.st_size), hash);
+		hash = fnv1a_hash(&stat.st_mtime, sizeof(stat.st_mtime), hash);
+	} else if (font->load_from == VITA2D_LOAD_FONT_FROM_MEM) {
+		hash = fnv1a_hash(font->font_buffer, font->buffer_size, hash);
+	}
+
+	return hash;
+}
+
+int vita2d_font_save_atlas(vita2d_font *font, const char *filename)
+{
+	int ret;
+
+	texture_atlas_lock(font->atlas);
+	ret = texture_atlas_save(font->atlas, filename, font_hash(font));
+	texture_atlas_unlock(font->atlas);
+
+	return ret;
+}
+
+int vita2d_font_load_atlas(vita2d_font *font, const char *filename)
+{
+	int ret;
+
+	texture_atlas_lock(font->atlas);
+	ret = texture_atlas_load(font->atlas, filename, font_hash(font));
+	texture_atlas_unlock(font->atlas);
+
+	return ret;
+}
+
+static int atlas_add_glyph(texture_atlas *atlas, unsigned int key,
 			   const FT_BitmapGlyph bitmap_glyph, int glyph_size)
 {
 	int ret;
@@ -184,7 +230,7 @@ static int atlas_add_glyph(texture_atlas *atlas, unsigned int glyph_index,
 		glyph_size
 	};
 
-	ret = texture_atlas_insert(atlas, glyph_index, &size, &data,
+	ret = texture_atlas_insert(atlas, key, &size, &data,
 				  &position);
 	if (!ret)
 		return 0;
@@ -227,6 +273,7 @@ static int generic_font_draw_text(vita2d_font *font, int draw,
 	FTC_FaceID face_id = (FTC_FaceID)font;
 	FT_UInt previous = 0;
 	vita2d_texture *tex = font->atlas->texture;
+	unsigned int key;
 
 	int i;
 	unsigned int character;
@@ -243,6 +290,8 @@ static int generic_font_draw_text(vita2d_font *font, int draw,
 	scaler.height = size;
 	scaler.pixel = 1;
 
+	texture_atlas_lock(font->atlas);
+
 	FTC_Manager_LookupFace(font->ftcmanager, face_id, &face);
 	use_kerning = FT_HAS_KERNING(face);
 	charmap_index = FT_Get_Charmap_Index(face->charmap);
@@ -270,7 +319,9 @@ static int generic_font_draw_text(vita2d_font *font, int draw,
 			pen_x += delta.x >> 6;
 		}
 
-		if (!texture_atlas_get(font->atlas, glyph_index, &rect, &data)) {
+		key = TEXTURE_ATLAS_KEY(font->atlas_owner, glyph_index);
+
+		if (!texture_atlas_get(font->atlas, key, &rect, &data)) {
 			FTC_ImageCache_LookupScaler(font->imagecache,
 						    &scaler,
 						    flags,
@@ -278,12 +329,12 @@ static int generic_font_draw_text(vita2d_font *font, int draw,
 						    &glyph,
 						    NULL);
 
-			if (!atlas_add_glyph(font->atlas, glyph_index,
+			if (!atlas_add_glyph(font->atlas, key,
 					     (FT_BitmapGlyph)glyph, size)) {
 				continue;
 			}
 
-			if (!texture_atlas_get(font->atlas, glyph_index, &rect, &data))
+			if (!texture_atlas_get(font->atlas, key, &rect, &data))
 				continue;
 		}
 
@@ -308,12 +359,17 @@ static int generic_font_draw_text(vita2d_font *font, int draw,
 	if (height)
 		*height = pen_y + size - y;
 
+	texture_atlas_unlock(font->atlas);
+
 	return max_x - x;
 }
 
 int vita2d_font_draw_text(vita2d_font *font, int x, int y, unsigned int color,
 			   unsigned int size, const char *text)
 {
+	TRACE_CALL_DATA(TRACE_OP_FONT_DRAW_TEXT, font, text, strlen(text) + 1,
+		TRACE_I(x), TRACE_I(y), TRACE_U(color), TRACE_U(size), TRACE_F(0.0f));
+
 	return generic_font_draw_text(font, 1, NULL, x, y, 0.0f, color, size, text);
 }
 
@@ -333,6 +389,9 @@ int vita2d_font_draw_textf(vita2d_font *font, int x, int y, unsigned int color,
 int vita2d_font_draw_text_ls(vita2d_font *font, int x, int y, float linespace, unsigned int color,
 			   unsigned int size, const char *text)
 {
+	TRACE_CALL_DATA(TRACE_OP_FONT_DRAW_TEXT, font, text, strlen(text) + 1,
+		TRACE_I(x), TRACE_I(y), TRACE_U(color), TRACE_U(size), TRACE_F(linespace));
+
 	return generic_font_draw_text(font, 1, NULL, x, y, linespace, color, size, text);
 }
 
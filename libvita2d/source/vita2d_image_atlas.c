@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+#include <psp2/gxm.h>
+#include "vita2d.h"
+#include "texture_atlas.h"
+
+/* Edge pixels repeated around each image */
+#define IMAGE_ATLAS_BORDER	1
+
+struct vita2d_image_atlas {
+	unsigned int page_width;
+	unsigned int page_height;
+	unsigned int num_pages;
+	texture_atlas **pages;
+	unsigned int next_key;
+};
+
+vita2d_image_atlas *vita2d_image_atlas_create(unsigned int page_width, unsigned int page_height)
+{
+	vita2d_image_atlas *atlas = malloc(sizeof(*atlas));
+	if (!atlas)
+		return NULL;
+
+	atlas->page_width = page_width;
+	atlas->page_height = page_height;
+	atlas->num_pages = 0;
+	atlas->pages = NULL;
+	atlas->next_key = 0;
+
+	return atlas;
+}
+
+void vita2d_image_atlas_free(vita2d_image_atlas *atlas)
+{
+	unsigned int i;
+
+	if (!atlas)
+		return;
+
+	for (i = 0; i < atlas->num_pages; i++)
+		texture_atlas_free(atlas->pages[i]);
+
+	free(atlas->pages);
+	free(atlas);
+}
+
+/* Finds room for a w x h rectangle (border included), in a new page if needed */
+static texture_atlas *image_atlas_insert(vita2d_image_atlas *atlas, unsigned int w, unsigned int h,
+					 bp2d_position *pos)
+{
+	static const texture_atlas_entry_data data = {0};
+	bp2d_size size = {w, h};
+	texture_atlas *page;
+	unsigned int i;
+
+	if (w > atlas->page_width || h > atlas->page_height)
+		return NULL;
+
+	/* The last pages are the least full */
+	for (i = atlas->num_pages; i > 0; i--) {
+		page = atlas->pages[i - 1];
+		if (texture_atlas_insert(page, atlas->next_key, &size, &data, pos))
+			goto exit_inserted;
+	}
+
+	texture_atlas **pages = realloc(atlas->pages, (atlas->num_pages + 1) * sizeof(*pages));
+	if (!pages)
+		return NULL;
+	atlas->pages = pages;
+
+	page = texture_atlas_create(atlas->page_width, atlas->page_height,
+				    SCE_GXM_TEXTURE_FORMAT_A8B8G8R8, VITA2D_MEM_TEXTURE);
+	if (!page)
+		return NULL;
+
+	if (!texture_atlas_insert(page, atlas->next_key, &size, &data, pos)) {
+		texture_atlas_free(page);
+		return NULL;
+	}
+
+	atlas->pages[atlas->num_pages++] = page;
+
+exit_inserted:
+	atlas->next_key++;
+	return page;
+}
+
+/* Copies row y of the image, and the border next to it */
+static void image_atlas_store_row(texture_atlas *page, const bp2d_position *pos,
+				  unsigned int w, unsigned int h, unsigned int y,
+				  const unsigned int *row)
+{
+	unsigned int *data = vita2d_texture_get_datap(page->texture);
+	unsigned int stride = vita2d_texture_get_stride(page->texture) / 4;
+	unsigned int *dst = data + (pos->y + IMAGE_ATLAS_BORDER + y) * stride + pos->x;
+	unsigned int row_w = w + 2 * IMAGE_ATLAS_BORDER;
+	unsigned int i;
+
+	for (i = 0; i < IMAGE_ATLAS_BORDER; i++) {
+		dst[i] = row[0];
+		dst[IMAGE_ATLAS_BORDER + w + i] = row[w - 1];
+	}
+	memcpy(dst + IMAGE_ATLAS_BORDER, row, w * 4);
+
+	if (y == 0) {
+		for (i = 1; i <= IMAGE_ATLAS_BORDER; i++)
+			memcpy(dst - i * stride, dst, row_w * 4);
+	}
+	if (y == h - 1) {
+		for (i = 1; i <= IMAGE_ATLAS_BORDER; i++)
+			memcpy(dst + i * stride, dst, row_w * 4);
+	}
+}
+
+static void image_atlas_set_image(texture_atlas *page, const bp2d_position *pos,
+				  unsigned int w, unsigned int h, vita2d_atlas_image *image)
+{
+	image->texture = page->texture;
+	image->x = pos->x + IMAGE_ATLAS_BORDER;
+	image->y = pos->y + IMAGE_ATLAS_BORDER;
+	image->w = w;
+	image->h = h;
+}
+
+int vita2d_image_atlas_add(vita2d_image_atlas *atlas, const void *rgba, unsigned int w, unsigned int h, unsigned int stride, vita2d_atlas_image *image)
+{
+	bp2d_position pos;
+	unsigned int y;
+
+	if (w == 0 || h == 0)
+		return 0;
+
+	texture_atlas *page = image_atlas_insert(atlas, w + 2 * IMAGE_ATLAS_BORDER,
+						 h + 2 * IMAGE_ATLAS_BORDER, &pos);
+	if (!page)
+		return 0;
+
+	for (y = 0; y < h; y++)
+		image_atlas_store_row(page, &pos, w, h, y, rgba + y * stride);
+
+	image_atlas_set_image(page, &pos, w, h, image);
+
+	return 1;
+}
+
+int vita2d_image_atlas_add_texture(vita2d_image_atlas *atlas, const vita2d_texture *texture, vita2d_atlas_image *image)
+{
+	unsigned int w = vita2d_texture_get_width(texture);
+	unsigned int h = vita2d_texture_get_height(texture);
+	bp2d_position pos;
+	unsigned int y;
+
+	if (vita2d_texture_get_format(texture) != SCE_GXM_TEXTURE_FORMAT_A8B8G8R8)
+		return 0;
+
+	unsigned int *row = malloc(w * 4);
+	if (!row)
+		return 0;
+
+	texture_atlas *page = image_atlas_insert(atlas, w + 2 * IMAGE_ATLAS_BORDER,
+						 h + 2 * IMAGE_ATLAS_BORDER, &pos);
+	if (!page) {
+		free(row);
+		return 0;
+	}
+
+	for (y = 0; y < h; y++) {
+		vita2d_texture_read_row(texture, y, row);
+		image_atlas_store_row(page, &pos, w, h, y, row);
+	}
+
+	free(row);
+
+	image_atlas_set_image(page, &pos, w, h, image);
+
+	return 1;
+}
+
+unsigned int vita2d_image_atlas_get_num_pages(const vita2d_image_atlas *atlas)
+{
+	return atlas->num_pages;
+}
+
+vita2d_texture *vita2d_image_atlas_get_page(const vita2d_image_atlas *atlas, unsigned int index)
+{
+	if (index >= atlas->num_pages)
+		return NULL;
+
+	return atlas->pages[index]->texture;
+}
+
+void vita2d_draw_atlas_image(const vita2d_atlas_image *image, float x, float y)
+{
+	vita2d_draw_texture_part(image->texture, x, y, image->x, image->y, image->w, image->h);
+}
+
+void vita2d_draw_atlas_image_scale(const vita2d_atlas_image *image, float x, float y, float x_scale, float y_scale)
+{
+	vita2d_draw_texture_part_scale(image->texture, x, y, image->x, image->y, image->w, image->h, x_scale, y_scale);
+}
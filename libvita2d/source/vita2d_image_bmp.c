@@ -4,6 +4,8 @@
 #include <psp2/io/fcntl.h>
 #include <psp2/gxm.h>
 #include "vita2d.h"
+#include "shared.h"
+#include "pixel_convert.h"
 
 #define BMP_SIGNATURE (0x4D42)
 
@@ -30,93 +32,79 @@ typedef struct {
 } __attribute__((packed)) BITMAPINFOHEADER;
 
 
-static vita2d_texture *_vita2d_load_BMP_generic(
-	BITMAPFILEHEADER *bmp_fh,
-	BITMAPINFOHEADER *bmp_ih,
-	void *user_data,
-	void (*seek_fn)(void *user_data, unsigned int offset),
-	void (*read_fn)(void *user_data, void *buffer, unsigned int length))
+static unsigned int _vita2d_BMP_row_stride(const BITMAPINFOHEADER *bmp_ih)
 {
 	unsigned int row_stride = bmp_ih->biWidth * (bmp_ih->biBitCount/8);
 	if (row_stride%4 != 0) {
 		row_stride += 4-(row_stride%4);
 	}
+	return row_stride;
+}
+
+static unsigned int _vita2d_BMP_height(const BITMAPINFOHEADER *bmp_ih)
+{
+	/* Negative heights are top-down bitmaps */
+	return bmp_ih->biHeight < 0 ? -bmp_ih->biHeight : bmp_ih->biHeight;
+}
 
-	void *buffer = malloc(row_stride);
-	if (!buffer)
+static vita2d_texture *_vita2d_load_BMP_generic(
+	const BITMAPINFOHEADER *bmp_ih,
+	const void *pixels)
+{
+	pixel_convert_fn convert;
+
+	switch (bmp_ih->biBitCount) {
+	case 32:
+		convert = pixel_convert_bgra8888_to_rgba8888;
+		break;
+	case 24:
+		convert = pixel_convert_bgr888_to_rgba8888;
+		break;
+	case 16:
+		convert = pixel_convert_bgr565_to_rgba8888;
+		break;
+	default:
 		return NULL;
+	}
 
-	vita2d_texture *texture = vita2d_create_empty_texture(
-		bmp_ih->biWidth,
-		bmp_ih->biHeight);
+	unsigned int width = bmp_ih->biWidth;
+	unsigned int height = _vita2d_BMP_height(bmp_ih);
+	unsigned int row_stride = _vita2d_BMP_row_stride(bmp_ih);
 
-	if (!texture) {
-		free(buffer);
+	/* Every row is converted below, no need to clear it first */
+	vita2d_texture *texture = _vita2d_create_empty_texture_load(width, height,
+		vita2d_texture_get_load_format(), 0);
+	if (!texture)
 		return NULL;
-	}
 
 	void *texture_data = vita2d_texture_get_datap(texture);
 	unsigned int tex_stride = vita2d_texture_get_stride(texture);
-
-	int i, x, y;
-
-	seek_fn(user_data, bmp_fh->bfOffBits);
-
-	for (i = 0; i < bmp_ih->biHeight; i++) {
-
-		read_fn(user_data, buffer, row_stride);
-
-		y = bmp_ih->biHeight - 1 - i;
-		unsigned int *tex_ptr = (unsigned int *)(texture_data + y*tex_stride);
-
-		for (x = 0; x < bmp_ih->biWidth; x++) {
-
-			if (bmp_ih->biBitCount == 32) {		//BGRA8888
-				unsigned int color = *(unsigned int *)(buffer + x*4);
-				*tex_ptr = ((color>>24)&0xFF)<<24 | (color&0xFF)<<16 |
-					((color>>8)&0xFF)<<8 | ((color>>16)&0xFF);
-
-			} else if (bmp_ih->biBitCount == 24) {	//BGR888
-				unsigned char *address = buffer + x*3;
-				*tex_ptr = (*address)<<16 | (*(address+1))<<8 |
-					(*(address+2)) | (0xFF<<24);
-
-			} else if (bmp_ih->biBitCount == 16) {	//BGR565
-				unsigned int color = *(unsigned short *)(buffer + x*2);
-				unsigned char r = (color       & 0x1F)  *((float)255/31);
-				unsigned char g = ((color>>5)  & 0x3F)  *((float)255/63);
-				unsigned char b = ((color>>11) & 0x1F)  *((float)255/31);
-				*tex_ptr = ((r<<16) | (g<<8) | b | (0xFF<<24));
-			}
-
-			tex_ptr++;
+	void *row = NULL;
+
+	/* Unless the texture is linear A8B8G8R8, each row is converted first and then stored */
+	if (!_vita2d_texture_load_direct(texture)) {
+		row = malloc(width * 4);
+		if (!row) {
+			vita2d_free_texture(texture);
+			return NULL;
 		}
 	}
 
-	free(buffer);
-
-	return texture;
-}
+	unsigned int i, y;
 
-static void _vita2d_read_bmp_file_seek_fn(void *user_data, unsigned int offset)
-{
-	sceIoLseek(*(SceUID*)user_data, offset, SEEK_SET);
-}
-
-static void _vita2d_read_bmp_file_read_fn(void *user_data, void *buffer, unsigned int length)
-{
-	sceIoRead(*(SceUID*)user_data, buffer, length);
-}
+	for (i = 0; i < height; i++) {
+		y = bmp_ih->biHeight < 0 ? i : height - 1 - i;
+		if (row) {
+			convert(pixels + i*row_stride, row, width);
+			_vita2d_texture_store_rgba_row(texture, y, row, row);
+		} else {
+			convert(pixels + i*row_stride, texture_data + y*tex_stride, width);
+		}
+	}
 
-static void _vita2d_read_bmp_buffer_seek_fn(void *user_data, unsigned int offset)
-{
-	*(unsigned int *)user_data += offset;
-}
+	free(row);
 
-static void _vita2d_read_bmp_buffer_read_fn(void *user_data, void *buffer, unsigned int length)
-{
-	memcpy(buffer, (void *)*(unsigned int *)user_data, length);
-	*(unsigned int *)user_data += length;
+	return _vita2d_texture_load_done(texture);
 }
 
 vita2d_texture *vita2d_load_BMP_file(const char *filename)
@@ -134,16 +122,30 @@ vita2d_texture *vita2d_load_BMP_file(const char *filename)
 
 	BITMAPINFOHEADER bmp_ih;
 	sceIoRead(fd, (void *)&bmp_ih, sizeof(BITMAPINFOHEADER));
+	if (bmp_ih.biWidth <= 0 || bmp_ih.biHeight == 0) {
+		goto exit_close;
+	}
+
+	/* Read the whole pixel region at once */
+	unsigned int size = _vita2d_BMP_row_stride(&bmp_ih) * _vita2d_BMP_height(&bmp_ih);
+	void *pixels = malloc(size);
+	if (!pixels) {
+		goto exit_close;
+	}
+
+	sceIoLseek(fd, bmp_fh.bfOffBits, SCE_SEEK_SET);
+	if (sceIoRead(fd, pixels, size) != size) {
+		goto exit_free;
+	}
 
-	vita2d_texture *texture = _vita2d_load_BMP_generic(&bmp_fh,
-		&bmp_ih,
-		(void *)&fd,
-		_vita2d_read_bmp_file_seek_fn,
-		_vita2d_read_bmp_file_read_fn);
+	vita2d_texture *texture = _vita2d_load_BMP_generic(&bmp_ih, pixels);
 
+	free(pixels);
 	sceIoClose(fd);
 	return texture;
 
+exit_free:
+	free(pixels);
 exit_close:
 	sceIoClose(fd);
 exit_error:
@@ -160,16 +162,13 @@ vita2d_texture *vita2d_load_BMP_buffer(const void *buffer)
 
 	BITMAPINFOHEADER bmp_ih;
 	memcpy(&bmp_ih, buffer + sizeof(BITMAPFILEHEADER), sizeof(BITMAPINFOHEADER));
+	if (bmp_ih.biWidth <= 0 || bmp_ih.biHeight == 0) {
+		goto exit_error;
+	}
 
-	unsigned int buffer_address = (unsigned int)buffer;
-
-	vita2d_texture *texture = _vita2d_load_BMP_generic(&bmp_fh,
-		&bmp_ih,
-		(void *)&buffer_address,
-		_vita2d_read_bmp_buffer_seek_fn,
-		_vita2d_read_bmp_buffer_read_fn);
+	/* The pixels are converted straight from the buffer */
+	return _vita2d_load_BMP_generic(&bmp_ih, buffer + bmp_fh.bfOffBits);
 
-	return texture;
 exit_error:
 	return NULL;
 }
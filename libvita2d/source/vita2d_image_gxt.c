@@ -0,0 +1,184 @@
+#include <string.h>
+#include <stdlib.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/gxm.h>
+#include "vita2d.h"
+#include "shared.h"
+
+#define GXT_MAGIC		(0x00545847) /* "GXT\0" */
+#define GXT_VERSION		(0x10000003)
+#define GXT_P4_PALETTE_SIZE	(16 * 4)
+#define GXT_P8_PALETTE_SIZE	(256 * 4)
+#define MAX_TEXTURE		4096
+
+typedef struct {
+	unsigned int	magic;
+	unsigned int	version;
+	unsigned int	num_textures;
+	unsigned int	data_offset;
+	unsigned int	data_size;
+	unsigned int	num_p4_palettes;
+	unsigned int	num_p8_palettes;
+	unsigned int	reserved;
+} __attribute__((packed)) gxt_header;
+
+typedef struct {
+	unsigned int	data_offset;
+	unsigned int	data_size;
+	int		palette_index;
+	unsigned int	flags;
+	unsigned int	type;
+	unsigned int	format;
+	unsigned short	width;
+	unsigned short	height;
+	unsigned char	mip_count;
+	unsigned char	pad[3];
+} __attribute__((packed)) gxt_texture_info;
+
+static int _vita2d_GXT_check_header(const gxt_header *header, unsigned int index)
+{
+	/* The P8 palettes are at the end of the data region, they have to fit in it */
+	return header->magic == GXT_MAGIC && header->version == GXT_VERSION &&
+	       index < header->num_textures &&
+	       header->num_p8_palettes <= header->data_size / GXT_P8_PALETTE_SIZE;
+}
+
+static int _vita2d_GXT_check_texture(const gxt_header *header, const gxt_texture_info *info)
+{
+	if (info->width == 0 || info->width > MAX_TEXTURE ||
+	    info->height == 0 || info->height > MAX_TEXTURE)
+		return 0;
+
+	/* Only P8 palettes are handled */
+	if ((info->format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P4)
+		return 0;
+	if ((info->format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P8 &&
+	    (info->palette_index < 0 || info->palette_index >= header->num_p8_palettes))
+		return 0;
+
+	/* The texture data has to be inside the data region */
+	return info->data_offset >= header->data_offset &&
+	       info->data_size <= header->data_size &&
+	       info->data_offset - header->data_offset <= header->data_size - info->data_size;
+}
+
+/* Palettes are stored at the end of the data region, P4 ones first */
+static unsigned int _vita2d_GXT_palette_offset(const gxt_header *header, const gxt_texture_info *info)
+{
+	return header->data_offset + header->data_size -
+		header->num_p8_palettes * GXT_P8_PALETTE_SIZE +
+		info->palette_index * GXT_P8_PALETTE_SIZE;
+}
+
+static vita2d_texture *_vita2d_create_GXT_texture(const gxt_texture_info *info)
+{
+	vita2d_texture *texture = _vita2d_create_empty_texture_type(info->width, info->height,
+		info->format, info->type, info->mip_count, info->data_size);
+	if (!texture)
+		return NULL;
+
+	/* The data has to cover the declared format, size and mips, or the GPU would read past it */
+	unsigned int size = _vita2d_texture_get_size(texture);
+	if ((info->format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P8)
+		size -= GXT_P8_PALETTE_SIZE;
+	if (info->data_size < size) {
+		vita2d_free_texture(texture);
+		return NULL;
+	}
+
+	return texture;
+}
+
+vita2d_texture *vita2d_load_GXT_file(const char *filename, unsigned int index)
+{
+	SceUID fd;
+	if ((fd = sceIoOpen(filename, SCE_O_RDONLY, 0777)) < 0) {
+		goto exit_error;
+	}
+
+	gxt_header header;
+	if (sceIoRead(fd, &header, sizeof(header)) != sizeof(header)) {
+		goto exit_close;
+	}
+
+	if (!_vita2d_GXT_check_header(&header, index)) {
+		goto exit_close;
+	}
+
+	gxt_texture_info info;
+	sceIoLseek(fd, sizeof(header) + index * sizeof(info), SCE_SEEK_SET);
+	if (sceIoRead(fd, &info, sizeof(info)) != sizeof(info)) {
+		goto exit_close;
+	}
+
+	if (!_vita2d_GXT_check_texture(&header, &info)) {
+		goto exit_close;
+	}
+
+	vita2d_texture *texture = _vita2d_create_GXT_texture(&info);
+	if (!texture) {
+		goto exit_close;
+	}
+
+	/* The blocks are read straight into the GPU memory, no decoding needed */
+	sceIoLseek(fd, info.data_offset, SCE_SEEK_SET);
+	if (sceIoRead(fd, vita2d_texture_get_datap(texture), info.data_size) != info.data_size) {
+		goto exit_free;
+	}
+
+	if ((info.format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P8) {
+		sceIoLseek(fd, _vita2d_GXT_palette_offset(&header, &info), SCE_SEEK_SET);
+		if (sceIoRead(fd, vita2d_texture_get_palette(texture), GXT_P8_PALETTE_SIZE) != GXT_P8_PALETTE_SIZE) {
+			goto exit_free;
+		}
+	}
+
+	sceIoClose(fd);
+	return texture;
+
+exit_free:
+	vita2d_free_texture(texture);
+exit_close:
+	sceIoClose(fd);
+exit_error:
+	return NULL;
+}
+
+vita2d_texture *vita2d_load_GXT_buffer(const void *buffer, unsigned long buffer_size, unsigned int index)
+{
+	gxt_header header;
+	gxt_texture_info info;
+
+	if (buffer_size < sizeof(header)) {
+		return NULL;
+	}
+
+	memcpy(&header, buffer, sizeof(header));
+	if (!_vita2d_GXT_check_header(&header, index)) {
+		return NULL;
+	}
+
+	if (header.num_textures > (buffer_size - sizeof(header)) / sizeof(info) ||
+	    header.data_offset > buffer_size || header.data_size > buffer_size - header.data_offset) {
+		return NULL;
+	}
+
+	memcpy(&info, buffer + sizeof(header) + index * sizeof(info), sizeof(info));
+	if (!_vita2d_GXT_check_texture(&header, &info)) {
+		return NULL;
+	}
+
+	vita2d_texture *texture = _vita2d_create_GXT_texture(&info);
+	if (!texture) {
+		return NULL;
+	}
+
+	memcpy(vita2d_texture_get_datap(texture), buffer + info.data_offset, info.data_size);
+
+	if ((info.format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P8) {
+		memcpy(vita2d_texture_get_palette(texture),
+		       buffer + _vita2d_GXT_palette_offset(&header, &info), GXT_P8_PALETTE_SIZE);
+	}
+
+	return texture;
+}
@@ -5,30 +5,97 @@
 #include <psp2/gxm.h>
 #include <jpeglib.h>
 #include "vita2d.h"
+#include "shared.h"
 
 // Following official documentation max width or height of the texture is 4096
 #define MAX_TEXTURE 4096
 
-static vita2d_texture *_vita2d_load_JPEG_generic(struct jpeg_decompress_struct *jinfo, struct jpeg_error_mgr *jerr)
+static int output_rgba = 0;
+
+/* Picks the largest DCT scaling factor (M/8) whose output fits in max_width x max_height */
+static void _vita2d_JPEG_set_scale(struct jpeg_decompress_struct *jinfo,
+				   unsigned int max_width, unsigned int max_height)
+{
+	unsigned int num;
+
+	if (max_width > MAX_TEXTURE)
+		max_width = MAX_TEXTURE;
+	if (max_height > MAX_TEXTURE)
+		max_height = MAX_TEXTURE;
+
+	jinfo->scale_denom = 8;
+
+	for (num = 8; num > 1; num--) {
+		jinfo->scale_num = num;
+		jpeg_calc_output_dimensions(jinfo);
+		if (jinfo->output_width <= max_width && jinfo->output_height <= max_height)
+			break;
+	}
+
+	jinfo->scale_num = num;
+}
+
+/* Expands 1 or 3 byte pixels to RGBA in place, back to front so nothing is overwritten before it's read */
+static void _vita2d_JPEG_expand_rgba(unsigned char *row, unsigned int width, int components)
 {
-	unsigned int longer = jinfo->image_width > jinfo->image_height ? jinfo->image_width : jinfo->image_height;
-	float downScale = (float)longer / (float)MAX_TEXTURE;
-	jinfo->scale_denom = ceil(downScale);
+	unsigned char *src = row + width * components;
+	unsigned char *dst = row + width * 4;
+
+	while (dst > row) {
+		src -= components;
+		dst -= 4;
+		if (components == 1) {
+			unsigned char l = src[0];
+			dst[0] = l;
+			dst[1] = l;
+			dst[2] = l;
+		} else {
+			unsigned char r = src[0], g = src[1], b = src[2];
+			dst[0] = r;
+			dst[1] = g;
+			dst[2] = b;
+		}
+		dst[3] = 0xFF;
+	}
+}
+
+static vita2d_texture *_vita2d_load_JPEG_generic(struct jpeg_decompress_struct *jinfo, struct jpeg_error_mgr *jerr,
+						 unsigned int max_width, unsigned int max_height)
+{
+	int i;
+	int rgba = output_rgba;
+
+#ifdef JCS_EXTENSIONS
+	/* libjpeg-turbo can write the RGBA pixels by itself */
+	if (rgba)
+		jinfo->out_color_space = JCS_EXT_RGBA;
+#endif
+
+	_vita2d_JPEG_set_scale(jinfo, max_width, max_height);
+
+	/* Downscaled loads are meant for thumbnails, trade some quality for speed */
+	if (jinfo->scale_num < 8) {
+		jinfo->dct_method = JDCT_IFAST;
+		jinfo->do_fancy_upsampling = FALSE;
+	}
 
 	jpeg_start_decompress(jinfo);
 
 	SceGxmTextureFormat out_format;
 
-	if (jinfo->out_color_space == JCS_GRAYSCALE) {
+	if (rgba) {
+		out_format = SCE_GXM_TEXTURE_FORMAT_A8B8G8R8;
+	} else if (jinfo->out_color_space == JCS_GRAYSCALE) {
 		out_format = SCE_GXM_TEXTURE_FORMAT_U8_R111;
 	} else {
 		out_format = SCE_GXM_TEXTURE_FORMAT_U8U8U8_BGR;
 	}
 
-	vita2d_texture *texture = vita2d_create_empty_texture_format(
+	/* All the rows get decoded, no need to clear the texture */
+	vita2d_texture *texture = _vita2d_create_empty_texture_load(
 			jinfo->output_width,
 			jinfo->output_height,
-			out_format);
+			out_format, 0);
 
 	if (!texture) {
 		jpeg_abort_decompress(jinfo);
@@ -37,20 +104,64 @@ static vita2d_texture *_vita2d_load_JPEG_generic(struct jpeg_decompress_struct *
 
 	void *texture_data = vita2d_texture_get_datap(texture);
 	unsigned int row_stride = vita2d_texture_get_stride(texture);
-	unsigned char *row_pointer = texture_data;
+	unsigned char *row_buf = NULL;
+	JSAMPROW rows[jinfo->rec_outbuf_height];
+
+	/* Swizzled and tiled textures are decoded to a linear buffer and scattered after */
+	if (!vita2d_texture_is_linear(texture)) {
+		row_stride = jinfo->output_width * (rgba ? 4 : jinfo->output_components);
+		row_buf = malloc(row_stride * jinfo->rec_outbuf_height);
+		if (!row_buf) {
+			jpeg_abort_decompress(jinfo);
+			vita2d_free_texture(texture);
+			return NULL;
+		}
+	}
 
+	/* Read as many rows per call as the decoder produces at once */
 	while (jinfo->output_scanline < jinfo->output_height) {
-		jpeg_read_scanlines(jinfo, (JSAMPARRAY)&row_pointer, 1);
-		row_pointer += row_stride;
+		unsigned int first_row = jinfo->output_scanline;
+
+		for (i = 0; i < jinfo->rec_outbuf_height; i++) {
+			if (row_buf)
+				rows[i] = row_buf + i * row_stride;
+			else
+				rows[i] = texture_data + (first_row + i) * row_stride;
+		}
+
+		int num_rows = jpeg_read_scanlines(jinfo, rows, jinfo->rec_outbuf_height);
+
+		if (rgba && jinfo->output_components != 4) {
+			for (i = 0; i < num_rows; i++)
+				_vita2d_JPEG_expand_rgba(rows[i], jinfo->output_width,
+							 jinfo->output_components);
+		}
+
+		if (row_buf) {
+			for (i = 0; i < num_rows; i++)
+				vita2d_texture_write_row(texture, first_row + i, rows[i]);
+		}
 	}
 
 	jpeg_finish_decompress(jinfo);
 
-	return texture;
+	free(row_buf);
+
+	return _vita2d_texture_load_done(texture);
 }
 
+void vita2d_JPEG_set_output_rgba(int enable)
+{
+	output_rgba = enable;
+}
 
-vita2d_texture *vita2d_load_JPEG_file(const char *filename)
+int vita2d_JPEG_get_output_rgba()
+{
+	return output_rgba;
+}
+
+
+vita2d_texture *vita2d_load_JPEG_file_scaled(const char *filename, unsigned int max_width, unsigned int max_height)
 {
 	FILE *fp;
 	if ((fp = fopen(filename, "rb")) <= 0) {
@@ -74,7 +185,7 @@ vita2d_texture *vita2d_load_JPEG_file(const char *filename)
 	jpeg_stdio_src(&jinfo, fp);
 	jpeg_read_header(&jinfo, 1);
 
-	vita2d_texture *texture = _vita2d_load_JPEG_generic(&jinfo, &jerr);
+	vita2d_texture *texture = _vita2d_load_JPEG_generic(&jinfo, &jerr, max_width, max_height);
 
 	jpeg_destroy_decompress(&jinfo);
 
@@ -83,7 +194,8 @@ vita2d_texture *vita2d_load_JPEG_file(const char *filename)
 }
 
 
-vita2d_texture *vita2d_load_JPEG_buffer(const void *buffer, unsigned long buffer_size)
+vita2d_texture *vita2d_load_JPEG_buffer_scaled(const void *buffer, unsigned long buffer_size,
+					       unsigned int max_width, unsigned int max_height)
 {
 	unsigned int magic = *(unsigned int *)buffer;
 	if (magic != 0xE0FFD8FF && magic != 0xE1FFD8FF) {
@@ -99,9 +211,19 @@ vita2d_texture *vita2d_load_JPEG_buffer(const void *buffer, unsigned long buffer
 	jpeg_mem_src(&jinfo, (void *)buffer, buffer_size);
 	jpeg_read_header(&jinfo, 1);
 
-	vita2d_texture *texture = _vita2d_load_JPEG_generic(&jinfo, &jerr);
+	vita2d_texture *texture = _vita2d_load_JPEG_generic(&jinfo, &jerr, max_width, max_height);
 
 	jpeg_destroy_decompress(&jinfo);
 
 	return texture;
 }
+
+vita2d_texture *vita2d_load_JPEG_file(const char *filename)
+{
+	return vita2d_load_JPEG_file_scaled(filename, MAX_TEXTURE, MAX_TEXTURE);
+}
+
+vita2d_texture *vita2d_load_JPEG_buffer(const void *buffer, unsigned long buffer_size)
+{
+	return vita2d_load_JPEG_buffer_scaled(buffer, buffer_size, MAX_TEXTURE, MAX_TEXTURE);
+}
@@ -4,44 +4,114 @@
 #include <psp2/gxm.h>
 #include <png.h>
 #include "vita2d.h"
+#include "shared.h"
 
 #define PNG_SIGSIZE (8)
+#define PNG_READ_AHEAD_SIZE (64 * 1024)
+
+typedef struct vita2d_png_loader {
+	png_structp png_ptr;
+	png_infop info_ptr;
+	vita2d_texture *texture;
+	unsigned int height;
+	unsigned int rows_total;
+	unsigned int rows_done;
+	int error;
+	/*
+	 * Staging for textures rows can't be decoded straight into: one row, or
+	 * the whole image if it's interlaced since later passes build on the
+	 * previous ones. Followed by a scratch row for the conversion.
+	 */
+	unsigned char *row_buf;
+	unsigned char *row_tmp;
+	unsigned int row_size;
+	int interlaced;
+	/* File source, read through a read-ahead buffer */
+	SceUID fd;
+	unsigned char *read_buf;
+	unsigned int read_pos;
+	unsigned int read_len;
+	/* Buffer source */
+	const unsigned char *buffer;
+} vita2d_png_loader;
+
+static unsigned int _vita2d_read_png_file(vita2d_png_loader *loader, void *data, unsigned int length)
+{
+	unsigned int done = 0;
+
+	while (done < length) {
+		if (loader->read_pos == loader->read_len) {
+			/* Big reads skip the read-ahead buffer */
+			if (length - done >= PNG_READ_AHEAD_SIZE) {
+				int ret = sceIoRead(loader->fd, data + done, length - done);
+				if (ret <= 0)
+					break;
+				done += ret;
+				continue;
+			}
+
+			int ret = sceIoRead(loader->fd, loader->read_buf, PNG_READ_AHEAD_SIZE);
+			if (ret <= 0)
+				break;
+			loader->read_pos = 0;
+			loader->read_len = ret;
+		}
+
+		unsigned int count = loader->read_len - loader->read_pos;
+		if (count > length - done)
+			count = length - done;
+
+		memcpy(data + done, loader->read_buf + loader->read_pos, count);
+		loader->read_pos += count;
+		done += count;
+	}
+
+	return done;
+}
 
 static void _vita2d_read_png_file_fn(png_structp png_ptr, png_bytep data, png_size_t length)
 {
-	SceUID fd = *(SceUID*) png_get_io_ptr(png_ptr);
-	sceIoRead(fd, data, length);
+	vita2d_png_loader *loader = png_get_io_ptr(png_ptr);
+	if (_vita2d_read_png_file(loader, data, length) != length)
+		png_error(png_ptr, "unexpected end of file");
 }
 
 static void _vita2d_read_png_buffer_fn(png_structp png_ptr, png_bytep data, png_size_t length)
 {
-	unsigned int *address = png_get_io_ptr(png_ptr);
-	memcpy(data, (void *)*address, length);
-	*address += length;
+	vita2d_png_loader *loader = png_get_io_ptr(png_ptr);
+	memcpy(data, loader->buffer, length);
+	loader->buffer += length;
+}
+
+static void _vita2d_free_png_loader(vita2d_png_loader *loader)
+{
+	if (loader->fd >= 0)
+		sceIoClose(loader->fd);
+	free(loader->read_buf);
+	free(loader->row_buf);
+	free(loader);
 }
 
-static vita2d_texture *_vita2d_load_PNG_generic(const void *io_ptr, png_rw_ptr read_data_fn)
+static vita2d_png_loader *_vita2d_load_PNG_begin_generic(vita2d_png_loader *loader, png_rw_ptr read_data_fn, int clear)
 {
-	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	if (png_ptr == NULL) {
+	loader->png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (loader->png_ptr == NULL) {
 		goto error_create_read;
 	}
 
-	png_infop info_ptr = png_create_info_struct(png_ptr);
-	if (info_ptr == NULL) {
+	loader->info_ptr = png_create_info_struct(loader->png_ptr);
+	if (loader->info_ptr == NULL) {
 		goto error_create_info;
 	}
 
-	png_bytep *row_ptrs = NULL;
+	png_structp png_ptr = loader->png_ptr;
+	png_infop info_ptr = loader->info_ptr;
 
 	if (setjmp(png_jmpbuf(png_ptr))) {
-		png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)0);
-		if (row_ptrs != NULL)
-			free(row_ptrs);
-		return NULL;
+		goto error_create_info;
 	}
 
-	png_set_read_fn(png_ptr, (png_voidp)io_ptr, read_data_fn);
+	png_set_read_fn(png_ptr, (png_voidp)loader, read_data_fn);
 	png_set_sig_bytes(png_ptr, PNG_SIGSIZE);
 	png_read_info(png_ptr, info_ptr);
 
@@ -81,76 +151,184 @@ static vita2d_texture *_vita2d_load_PNG_generic(const void *io_ptr, png_rw_ptr r
 	if (bit_depth == 8 && color_type == PNG_COLOR_TYPE_RGB)
 		png_set_filler(png_ptr, 0xFF, PNG_FILLER_AFTER);
 
-	png_read_update_info(png_ptr, info_ptr);
+	/* Interlaced images are read row by row once per pass */
+	int passes = png_set_interlace_handling(png_ptr);
 
-	row_ptrs = (png_bytep *)malloc(sizeof(png_bytep) * height);
-	if (!row_ptrs)
-		goto error_alloc_rows;
+	png_read_update_info(png_ptr, info_ptr);
 
-	vita2d_texture *texture = vita2d_create_empty_texture(width, height);
-	if (!texture)
-		goto error_create_tex;
+	loader->texture = _vita2d_create_empty_texture_load(width, height,
+		vita2d_texture_get_load_format(), clear);
+	if (!loader->texture)
+		goto error_create_info;
 
-	void *texture_data = vita2d_texture_get_datap(texture);
-	unsigned int stride = vita2d_texture_get_stride(texture);
+	loader->row_size = width * 4;
+	loader->interlaced = passes > 1;
 
-	int i;
-	for (i = 0; i < height; i++) {
-		row_ptrs[i] = (png_bytep)(texture_data + i*stride);
+	if (!_vita2d_texture_load_direct(loader->texture)) {
+		unsigned int staged_rows = loader->interlaced ? height : 1;
+		loader->row_buf = malloc((staged_rows + 1) * loader->row_size);
+		if (!loader->row_buf)
+			goto error_create_texture;
+		loader->row_tmp = loader->row_buf + staged_rows * loader->row_size;
 	}
 
-	png_read_image(png_ptr, row_ptrs);
+	loader->height = height;
+	loader->rows_total = height * passes;
+	loader->rows_done = 0;
 
-	png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)0);
-	free(row_ptrs);
+	return loader;
 
-	return texture;
-
-error_create_tex:
-	free(row_ptrs);
-error_alloc_rows:
-	png_destroy_info_struct(png_ptr, &info_ptr);
+error_create_texture:
+	vita2d_free_texture(loader->texture);
 error_create_info:
-	png_destroy_read_struct(&png_ptr, (png_infopp)0, (png_infopp)0);
+	png_destroy_read_struct(&loader->png_ptr, &loader->info_ptr, (png_infopp)0);
 error_create_read:
+	_vita2d_free_png_loader(loader);
 	return NULL;
 }
 
-
-vita2d_texture *vita2d_load_PNG_file(const char *filename)
+static vita2d_png_loader *_vita2d_load_PNG_file_begin(const char *filename, int clear)
 {
 	png_byte pngsig[PNG_SIGSIZE];
-	SceUID fd;
 
-	if ((fd = sceIoOpen(filename, SCE_O_RDONLY, 0777)) < 0) {
+	vita2d_png_loader *loader = malloc(sizeof(*loader));
+	if (!loader)
+		return NULL;
+
+	memset(loader, 0, sizeof(*loader));
+
+	if ((loader->fd = sceIoOpen(filename, SCE_O_RDONLY, 0777)) < 0) {
 		goto exit_error;
 	}
 
-	if (sceIoRead(fd, pngsig, PNG_SIGSIZE) != PNG_SIGSIZE) {
-		goto exit_close;
+	loader->read_buf = malloc(PNG_READ_AHEAD_SIZE);
+	if (!loader->read_buf) {
+		goto exit_error;
+	}
+
+	if (_vita2d_read_png_file(loader, pngsig, PNG_SIGSIZE) != PNG_SIGSIZE) {
+		goto exit_error;
 	}
 
 	if (png_sig_cmp(pngsig, 0, PNG_SIGSIZE) != 0) {
-		goto exit_close;
+		goto exit_error;
 	}
 
-	vita2d_texture *texture = _vita2d_load_PNG_generic((void *)&fd, _vita2d_read_png_file_fn);
-	sceIoClose(fd);
-	return texture;
+	return _vita2d_load_PNG_begin_generic(loader, _vita2d_read_png_file_fn, clear);
 
-exit_close:
-	sceIoClose(fd);
 exit_error:
+	_vita2d_free_png_loader(loader);
 	return NULL;
 }
 
-vita2d_texture *vita2d_load_PNG_buffer(const void *buffer)
+static vita2d_png_loader *_vita2d_load_PNG_buffer_begin(const void *buffer, int clear)
 {
 	if (png_sig_cmp((png_byte *) buffer, 0, PNG_SIGSIZE) != 0) {
 		return NULL;
 	}
 
-	unsigned int buffer_address = (unsigned int)buffer + PNG_SIGSIZE;
+	vita2d_png_loader *loader = malloc(sizeof(*loader));
+	if (!loader)
+		return NULL;
 
-	return _vita2d_load_PNG_generic((void *)&buffer_address, _vita2d_read_png_buffer_fn);
+	memset(loader, 0, sizeof(*loader));
+	loader->fd = -1;
+	loader->buffer = (const unsigned char *)buffer + PNG_SIGSIZE;
+
+	return _vita2d_load_PNG_begin_generic(loader, _vita2d_read_png_buffer_fn, clear);
+}
+
+/* The texture may be drawn before all the rows are decoded, so it's cleared */
+vita2d_png_loader *vita2d_load_PNG_file_begin(const char *filename)
+{
+	return _vita2d_load_PNG_file_begin(filename, 1);
+}
+
+vita2d_png_loader *vita2d_load_PNG_buffer_begin(const void *buffer)
+{
+	return _vita2d_load_PNG_buffer_begin(buffer, 1);
+}
+
+int vita2d_load_PNG_step(vita2d_png_loader *loader, unsigned int num_rows)
+{
+	if (loader->error)
+		return -1;
+
+	void *texture_data = vita2d_texture_get_datap(loader->texture);
+	unsigned int stride = vita2d_texture_get_stride(loader->texture);
+
+	if (setjmp(png_jmpbuf(loader->png_ptr))) {
+		loader->error = 1;
+		return -1;
+	}
+
+	while (num_rows > 0 && loader->rows_done < loader->rows_total) {
+		unsigned int y = loader->rows_done % loader->height;
+		if (loader->row_buf) {
+			unsigned char *row = loader->row_buf + (loader->interlaced ? y * loader->row_size : 0);
+			png_read_row(loader->png_ptr, row, NULL);
+			_vita2d_texture_store_rgba_row(loader->texture, y, row, loader->row_tmp);
+		} else {
+			png_read_row(loader->png_ptr, (png_bytep)(texture_data + y*stride), NULL);
+		}
+		loader->rows_done++;
+		num_rows--;
+	}
+
+	return loader->rows_done == loader->rows_total;
+}
+
+vita2d_texture *vita2d_png_loader_get_texture(const vita2d_png_loader *loader)
+{
+	return loader->texture;
+}
+
+static vita2d_texture *_vita2d_load_PNG_finish(vita2d_png_loader *loader)
+{
+	vita2d_texture *texture = loader->texture;
+
+	if (loader->error || loader->rows_done != loader->rows_total) {
+		vita2d_free_texture(texture);
+		texture = NULL;
+	}
+
+	png_destroy_read_struct(&loader->png_ptr, &loader->info_ptr, (png_infopp)0);
+	_vita2d_free_png_loader(loader);
+
+	return texture;
+}
+
+/* The texture may already be in use, so it's never swapped for a P8 one here */
+vita2d_texture *vita2d_load_PNG_finish(vita2d_png_loader *loader)
+{
+	vita2d_texture *texture = _vita2d_load_PNG_finish(loader);
+
+	if (texture)
+		vita2d_texture_generate_mipmaps(texture);
+
+	return texture;
+}
+
+static vita2d_texture *_vita2d_load_PNG_whole(vita2d_png_loader *loader)
+{
+	if (!loader)
+		return NULL;
+
+	vita2d_load_PNG_step(loader, loader->rows_total);
+
+	vita2d_texture *texture = _vita2d_load_PNG_finish(loader);
+	if (!texture)
+		return NULL;
+
+	return _vita2d_texture_load_done(texture);
+}
+
+vita2d_texture *vita2d_load_PNG_file(const char *filename)
+{
+	return _vita2d_load_PNG_whole(_vita2d_load_PNG_file_begin(filename, 0));
+}
+
+vita2d_texture *vita2d_load_PNG_buffer(const void *buffer)
+{
+	return _vita2d_load_PNG_whole(_vita2d_load_PNG_buffer_begin(buffer, 0));
 }
@@ -1,6 +1,7 @@
 #include <psp2/pgf.h>
 #include <psp2/kernel/sysmem.h>
 #include <psp2/kernel/threadmgr.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -12,6 +13,7 @@
 #include "bin_packing_2d.h"
 #include "utils.h"
 #include "shared.h"
+#include "trace.h"
 
 #define ATLAS_DEFAULT_W 512
 #define ATLAS_DEFAULT_H 512
@@ -26,6 +28,7 @@ typedef struct vita2d_pgf {
 	SceFontLibHandle lib_handle;
 	vita2d_pgf_font_handle *font_handle_list;
 	texture_atlas *atlas;
+	unsigned int atlas_owner;
 	SceKernelLwMutexWork mutex;
 	float vsize;
 } vita2d_pgf;
@@ -47,8 +50,8 @@ static void vita2d_load_pgf_post(vita2d_pgf *font) {
 	font->vsize = (fontinfo.fontStyle.fontV / fontinfo.fontStyle.fontVRes)
 		* SCREEN_DPI;
 
-	font->atlas = texture_atlas_create(ATLAS_DEFAULT_W, ATLAS_DEFAULT_H,
-		SCE_GXM_TEXTURE_FORMAT_U8_R111);
+	font->atlas = texture_atlas_acquire(ATLAS_DEFAULT_W, ATLAS_DEFAULT_H,
+		SCE_GXM_TEXTURE_FORMAT_U8_R111, &font->atlas_owner);
 
 	sceKernelCreateLwMutex(&font->mutex, "vita2d_pgf_mutex", 2, 0, NULL);
 }
@@ -186,6 +189,8 @@ vita2d_pgf *vita2d_load_custom_pgf(const char *path)
 
 void vita2d_free_pgf(vita2d_pgf *font)
 {
+	TRACE_FORGET(font);
+
 	if (font) {
 		sceKernelDeleteLwMutex(&font->mutex);
 
@@ -197,11 +202,49 @@ void vita2d_free_pgf(vita2d_pgf *font)
 			tmp = next;
 		}
 		sceFontDoneLib(font->lib_handle);
-		texture_atlas_free(font->atlas);
+		texture_atlas_release(font->atlas, font->atlas_owner);
 		free(font);
 	}
 }
 
+static unsigned int pgf_hash(vita2d_pgf *font)
+{
+	unsigned int hash = FNV1A_INIT;
+	vita2d_pgf_font_handle *tmp = font->font_handle_list;
+	SceFontInfo fontinfo;
+
+	while (tmp) {
+		memset(&fontinfo, 0, sizeof(fontinfo));
+		sceFontGetFontInfo(tmp->font_handle, &fontinfo);
+		hash = fnv1a_hash(&fontinfo, sizeof(fontinfo), hash);
+		tmp = tmp->next;
+	}
+
+	return hash;
+}
+
+int vita2d_pgf_save_atlas(vita2d_pgf *font, const char *filename)
+{
+	int ret;
+
+	sceKernelLockLwMutex(&font->mutex, 1, NULL);
+	ret = texture_atlas_save(font->atlas, filename, pgf_hash(font));
+	sceKernelUnlockLwMutex(&font->mutex, 1);
+
+	return ret;
+}
+
+int vita2d_pgf_load_atlas(vita2d_pgf *font, const char *filename)
+{
+	int ret;
+
+	sceKernelLockLwMutex(&font->mutex, 1, NULL);
+	ret = texture_atlas_load(font->atlas, filename, pgf_hash(font));
+	sceKernelUnlockLwMutex(&font->mutex, 1);
+
+	return ret;
+}
+
 static int atlas_add_glyph(vita2d_pgf *font, unsigned int character)
 {
 	SceFontHandle font_handle = font->font_handle_list->font_handle;
@@ -235,7 +278,9 @@ static int atlas_add_glyph(vita2d_pgf *font, unsigned int character)
 		0
 	};
 
-	if (!texture_atlas_insert(font->atlas, character, &size, &data,
+	if (!texture_atlas_insert(font->atlas,
+				  TEXTURE_ATLAS_KEY(font->atlas_owner, character),
+				  &size, &data,
 				  &position))
 			return 0;
 
@@ -249,7 +294,7 @@ static int atlas_add_glyph(vita2d_pgf *font, unsigned int character)
 	glyph_image.bufHeight = vita2d_texture_get_height(tex);
 	glyph_image.bytesPerLine = vita2d_texture_get_stride(tex);
 	glyph_image.pad = 0;
-	glyph_image.bufferPtr = (unsigned int)texture_data;
+	glyph_image.bufferPtr = (uintptr_t)texture_data;
 
 	return sceFontGetCharGlyphImage(font_handle, character, &glyph_image) == 0;
 }
@@ -259,9 +304,11 @@ int generic_pgf_draw_text(vita2d_pgf *font, int draw, int *height,
 			  const char *text)
 {
 	sceKernelLockLwMutex(&font->mutex, 1, NULL);
+	texture_atlas_lock(font->atlas);
 
 	int i;
 	unsigned int character;
+	unsigned int key;
 	bp2d_rectangle rect;
 	texture_atlas_entry_data data;
 	vita2d_texture *tex = font->atlas->texture;
@@ -281,12 +328,14 @@ int generic_pgf_draw_text(vita2d_pgf *font, int draw, int *height,
 			continue;
 		}
 
-		if (!texture_atlas_get(font->atlas, character, &rect, &data)) {
+		key = TEXTURE_ATLAS_KEY(font->atlas_owner, character);
+
+		if (!texture_atlas_get(font->atlas, key, &rect, &data)) {
 			if (!atlas_add_glyph(font, character)) {
 				continue;
 			}
 
-			if (!texture_atlas_get(font->atlas, character,
+			if (!texture_atlas_get(font->atlas, key,
 					       &rect, &data))
 					continue;
 		}
@@ -310,6 +359,7 @@ int generic_pgf_draw_text(vita2d_pgf *font, int draw, int *height,
 	if (height)
 		*height = pen_y + font->vsize * scale - y;
 
+	texture_atlas_unlock(font->atlas);
 	sceKernelUnlockLwMutex(&font->mutex, 1);
 
 	return max_x - x;
@@ -319,6 +369,9 @@ int vita2d_pgf_draw_text(vita2d_pgf *font, int x, int y,
 			 unsigned int color, float scale,
 			 const char *text)
 {
+	TRACE_CALL_DATA(TRACE_OP_PGF_DRAW_TEXT, font, text, strlen(text) + 1,
+		TRACE_I(x), TRACE_I(y), TRACE_U(color), TRACE_F(scale), TRACE_F(0.0f));
+
 	return generic_pgf_draw_text(font, 1, NULL, x, y, 0.0f, color, scale, text);
 }
 
@@ -338,6 +391,9 @@ int vita2d_pgf_draw_text_ls(vita2d_pgf *font, int x, int y, float linespace,
 			 unsigned int color, float scale,
 			 const char *text)
 {
+	TRACE_CALL_DATA(TRACE_OP_PGF_DRAW_TEXT, font, text, strlen(text) + 1,
+		TRACE_I(x), TRACE_I(y), TRACE_U(color), TRACE_F(scale), TRACE_F(linespace));
+
 	return generic_pgf_draw_text(font, 1, NULL, x, y, linespace, color, scale, text);
 }
 
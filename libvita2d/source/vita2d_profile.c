@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vita2d.h"
+#include "profile.h"
+
+/* Frames the stats are computed over */
+#define PROFILE_WINDOW	128
+
+#ifdef VITA2D_PROFILE
+
+/* Added up during the frame, from any thread (the vblank wait is timed in the display queue thread) */
+static unsigned int frame_times[VITA2D_PROFILE_SECTION_COUNT];
+static unsigned int frame_counts[VITA2D_PROFILE_COUNTER_COUNT];
+
+/* The last PROFILE_WINDOW frames */
+static unsigned int time_history[VITA2D_PROFILE_SECTION_COUNT][PROFILE_WINDOW];
+static unsigned int count_history[VITA2D_PROFILE_COUNTER_COUNT][PROFILE_WINDOW];
+static unsigned int history_index = 0;
+static unsigned int history_frames = 0;
+static SceUInt64 last_frame_end = 0;
+
+void profile_add_time(vita2d_profile_section section, unsigned int us)
+{
+	__atomic_fetch_add(&frame_times[section], us, __ATOMIC_RELAXED);
+}
+
+void profile_add_count(vita2d_profile_counter counter, unsigned int n)
+{
+	__atomic_fetch_add(&frame_counts[counter], n, __ATOMIC_RELAXED);
+}
+
+void profile_max_count(vita2d_profile_counter counter, unsigned int n)
+{
+	unsigned int current = __atomic_load_n(&frame_counts[counter], __ATOMIC_RELAXED);
+
+	while (n > current &&
+	       !__atomic_compare_exchange_n(&frame_counts[counter], &current, n, 1,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+void profile_end_frame()
+{
+	SceUInt64 now = sceKernelGetProcessTimeWide();
+	unsigned int i;
+
+	/* The first frame has no start, it's only used to begin the next one */
+	if (last_frame_end)
+		frame_times[VITA2D_PROFILE_FRAME] = now - last_frame_end;
+
+	for (i = 0; i < VITA2D_PROFILE_SECTION_COUNT; i++)
+		time_history[i][history_index] = __atomic_exchange_n(&frame_times[i], 0, __ATOMIC_RELAXED);
+	for (i = 0; i < VITA2D_PROFILE_COUNTER_COUNT; i++)
+		count_history[i][history_index] = __atomic_exchange_n(&frame_counts[i], 0, __ATOMIC_RELAXED);
+
+	if (last_frame_end) {
+		history_index = (history_index + 1) % PROFILE_WINDOW;
+		if (history_frames < PROFILE_WINDOW)
+			history_frames++;
+	}
+
+	last_frame_end = now;
+}
+
+static int compare_uint(const void *a, const void *b)
+{
+	unsigned int ua = *(const unsigned int *)a;
+	unsigned int ub = *(const unsigned int *)b;
+
+	return ua < ub ? -1 : ua > ub;
+}
+
+static int profile_get_stats(const unsigned int *history, vita2d_profile_stats *stats)
+{
+	unsigned int sorted[PROFILE_WINDOW];
+	unsigned long long sum = 0;
+	unsigned int n = history_frames;
+	unsigned int i;
+
+	if (n == 0)
+		return 0;
+
+	/* Until the window is full the frames are at its start */
+	memcpy(sorted, history, n * sizeof(*sorted));
+	qsort(sorted, n, sizeof(*sorted), compare_uint);
+
+	for (i = 0; i < n; i++)
+		sum += sorted[i];
+
+	stats->frames = n;
+	stats->average = (float)sum / n;
+	stats->min = sorted[0];
+	stats->max = sorted[n - 1];
+	stats->p50 = sorted[(n - 1) * 50 / 100];
+	stats->p90 = sorted[(n - 1) * 90 / 100];
+	stats->p99 = sorted[(n - 1) * 99 / 100];
+
+	return 1;
+}
+
+#endif
+
+int vita2d_profile_get_section(vita2d_profile_section section, vita2d_profile_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+#ifdef VITA2D_PROFILE
+	if ((unsigned int)section < VITA2D_PROFILE_SECTION_COUNT)
+		return profile_get_stats(time_history[section], stats);
+#endif
+
+	return 0;
+}
+
+int vita2d_profile_get_counter(vita2d_profile_counter counter, vita2d_profile_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+#ifdef VITA2D_PROFILE
+	if ((unsigned int)counter < VITA2D_PROFILE_COUNTER_COUNT)
+		return profile_get_stats(count_history[counter], stats);
+#endif
+
+	return 0;
+}
+
+void vita2d_profile_reset()
+{
+#ifdef VITA2D_PROFILE
+	memset(frame_times, 0, sizeof(frame_times));
+	memset(frame_counts, 0, sizeof(frame_counts));
+	history_index = 0;
+	history_frames = 0;
+	last_frame_end = 0;
+#endif
+}
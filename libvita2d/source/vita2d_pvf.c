@@ -12,6 +12,7 @@
 #include "bin_packing_2d.h"
 #include "utils.h"
 #include "shared.h"
+#include "trace.h"
 
 #define ATLAS_DEFAULT_W 512
 #define ATLAS_DEFAULT_H 512
@@ -28,6 +29,7 @@ typedef struct vita2d_pvf {
 	ScePvfLibId lib_handle;
 	vita2d_pvf_font_handle *font_handle_list;
 	texture_atlas *atlas;
+	unsigned int atlas_owner;
 	SceKernelLwMutexWork mutex;
 	float vsize;
 } vita2d_pvf;
@@ -56,8 +58,8 @@ static void vita2d_load_pvf_post(vita2d_pvf *font)
 		//* SCREEN_DPI;
 	font->vsize = 10.125f;
 
-	font->atlas = texture_atlas_create(ATLAS_DEFAULT_W, ATLAS_DEFAULT_H,
-		SCE_GXM_TEXTURE_FORMAT_U8_R111);
+	font->atlas = texture_atlas_acquire(ATLAS_DEFAULT_W, ATLAS_DEFAULT_H,
+		SCE_GXM_TEXTURE_FORMAT_U8_R111, &font->atlas_owner);
 
 	sceKernelCreateLwMutex(&font->mutex, "vita2d_pvf_mutex", 2, 0, NULL);
 }
@@ -202,6 +204,8 @@ vita2d_pvf *vita2d_load_custom_pvf(const char *path)
 
 void vita2d_free_pvf(vita2d_pvf *font)
 {
+	TRACE_FORGET(font);
+
 	if (font) {
 		sceKernelDeleteLwMutex(&font->mutex);
 
@@ -213,11 +217,49 @@ void vita2d_free_pvf(vita2d_pvf *font)
 			tmp = next;
 		}
 		scePvfDoneLib(font->lib_handle);
-		texture_atlas_free(font->atlas);
+		texture_atlas_release(font->atlas, font->atlas_owner);
 		free(font);
 	}
 }
 
+static unsigned int pvf_hash(vita2d_pvf *font)
+{
+	unsigned int hash = FNV1A_INIT;
+	vita2d_pvf_font_handle *tmp = font->font_handle_list;
+	ScePvfFontInfo fontinfo;
+
+	while (tmp) {
+		memset(&fontinfo, 0, sizeof(fontinfo));
+		scePvfGetFontInfo(tmp->font_handle, &fontinfo);
+		hash = fnv1a_hash(&fontinfo, sizeof(fontinfo), hash);
+		tmp = tmp->next;
+	}
+
+	return hash;
+}
+
+int vita2d_pvf_save_atlas(vita2d_pvf *font, const char *filename)
+{
+	int ret;
+
+	sceKernelLockLwMutex(&font->mutex, 1, NULL);
+	ret = texture_atlas_save(font->atlas, filename, pvf_hash(font));
+	sceKernelUnlockLwMutex(&font->mutex, 1);
+
+	return ret;
+}
+
+int vita2d_pvf_load_atlas(vita2d_pvf *font, const char *filename)
+{
+	int ret;
+
+	sceKernelLockLwMutex(&font->mutex, 1, NULL);
+	ret = texture_atlas_load(font->atlas, filename, pvf_hash(font));
+	sceKernelUnlockLwMutex(&font->mutex, 1);
+
+	return ret;
+}
+
 ScePvfFontId get_font_for_character(vita2d_pvf *font, unsigned int character)
 {
 	ScePvfFontId font_handle = font->font_handle_list->font_handle;
@@ -261,7 +303,9 @@ static int atlas_add_glyph(vita2d_pvf *font, ScePvfFontId font_handle, unsigned
 		0
 	};
 
-	if (!texture_atlas_insert(font->atlas, character, &size, &data,
+	if (!texture_atlas_insert(font->atlas,
+				  TEXTURE_ATLAS_KEY(font->atlas_owner, character),
+				  &size, &data,
 				  &position))
 			return 0;
 
@@ -285,9 +329,11 @@ int generic_pvf_draw_text(vita2d_pvf *font, int draw, int *height,
 			  const char *text)
 {
 	sceKernelLockLwMutex(&font->mutex, 1, NULL);
+	texture_atlas_lock(font->atlas);
 
 	int i;
 	unsigned int character;
+	unsigned int key;
 	ScePvfFontId fontid;
 	bp2d_rectangle rect;
 	texture_atlas_entry_data data;
@@ -312,11 +358,13 @@ int generic_pvf_draw_text(vita2d_pvf *font, int draw, int *height,
 
 		fontid = get_font_for_character(font, character);
 
-		if (!texture_atlas_get(font->atlas, character, &rect, &data)) {
+		key = TEXTURE_ATLAS_KEY(font->atlas_owner, character);
+
+		if (!texture_atlas_get(font->atlas, key, &rect, &data)) {
 			if (!atlas_add_glyph(font, fontid, character))
 				continue;
 
-			if (!texture_atlas_get(font->atlas, character,
+			if (!texture_atlas_get(font->atlas, key,
 					       &rect, &data))
 					continue;
 		}
@@ -349,6 +397,7 @@ int generic_pvf_draw_text(vita2d_pvf *font, int draw, int *height,
 	if (height)
 		*height = pen_y + font->vsize * scale - y;
 
+	texture_atlas_unlock(font->atlas);
 	sceKernelUnlockLwMutex(&font->mutex, 1);
 
 	return max_x - x;
@@ -358,6 +407,9 @@ int vita2d_pvf_draw_text(vita2d_pvf *font, int x, int y,
 			 unsigned int color, float scale,
 			 const char *text)
 {
+	TRACE_CALL_DATA(TRACE_OP_PVF_DRAW_TEXT, font, text, strlen(text) + 1,
+		TRACE_I(x), TRACE_I(y), TRACE_U(color), TRACE_F(scale), TRACE_F(0.0f));
+
 	return generic_pvf_draw_text(font, 1, NULL, x, y, 0.0f, color, scale, text);
 }
 
@@ -377,6 +429,9 @@ int vita2d_pvf_draw_text_ls(vita2d_pvf *font, int x, int y, float linespace,
 			 unsigned int color, float scale,
 			 const char *text)
 {
+	TRACE_CALL_DATA(TRACE_OP_PVF_DRAW_TEXT, font, text, strlen(text) + 1,
+		TRACE_I(x), TRACE_I(y), TRACE_U(color), TRACE_F(scale), TRACE_F(linespace));
+
 	return generic_pvf_draw_text(font, 1, NULL, x, y, linespace, color, scale, text);
 }
 
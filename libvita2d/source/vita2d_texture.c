@@ -1,13 +1,26 @@
 #include <psp2/kernel/sysmem.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
 #include "vita2d.h"
 #include "utils.h"
+#include "gpu_heap.h"
 #include "shared.h"
+#include "profile.h"
+#include "trace.h"
+#include "clip.h"
+#include "texture_layout.h"
+#include "pixel_convert.h"
+#include "palette.h"
 
 #define GXM_TEX_MAX_SIZE 4096
 static SceKernelMemBlockType MemBlockType = SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW;
+static SceGxmTextureType LoadLayout = SCE_GXM_TEXTURE_LINEAR;
+static int LoadMipmaps = 0;
+static vita2d_palette_mode LoadPalette = VITA2D_PALETTE_NONE;
+static SceGxmTextureFormat LoadFormat = SCE_GXM_TEXTURE_FORMAT_A8B8G8R8;
+static int LoadDither = 0;
 
 static int tex_format_to_bytespp(SceGxmTextureFormat format)
 {
@@ -37,6 +50,146 @@ static int tex_format_to_bytespp(SceGxmTextureFormat format)
 	}
 }
 
+/* Compressed formats are stored as blocks of block_w x block_h pixels */
+static int tex_format_block_info(SceGxmTextureFormat format, unsigned int *block_w, unsigned int *block_h, unsigned int *block_size)
+{
+	switch (format & 0x9f000000U) {
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP:
+		*block_w = 8;
+		*block_h = 4;
+		*block_size = 8;
+		return 1;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT4BPP:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_UBC1:
+		*block_w = 4;
+		*block_h = 4;
+		*block_size = 8;
+		return 1;
+	case SCE_GXM_TEXTURE_BASE_FORMAT_UBC2:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_UBC3:
+		*block_w = 4;
+		*block_h = 4;
+		*block_size = 16;
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static int tex_format_is_pvrt(SceGxmTextureFormat format)
+{
+	switch (format & 0x9f000000U) {
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT2BPP:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRT4BPP:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII2BPP:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_PVRTII4BPP:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static unsigned int tex_format_data_size(SceGxmTextureFormat format, SceGxmTextureType layout, unsigned int w, unsigned int h)
+{
+	unsigned int block_w, block_h, block_size;
+	unsigned int aligned_w, aligned_h;
+
+	if (tex_format_block_info(format, &block_w, &block_h, &block_size)) {
+		/* PVRTC can't be smaller than 2x2 blocks */
+		if (tex_format_is_pvrt(format)) {
+			if (w < 2 * block_w)
+				w = 2 * block_w;
+			if (h < 2 * block_h)
+				h = 2 * block_h;
+		}
+		return ((w + block_w - 1) / block_w) * ((h + block_h - 1) / block_h) * block_size;
+	}
+
+	texture_layout_dimensions(layout, w, h, &aligned_w, &aligned_h);
+
+	return aligned_w * aligned_h * tex_format_to_bytespp(format);
+}
+
+/* Formats whose channels are all unsigned 8 bit, which can be box filtered byte by byte */
+static int tex_format_is_u8_channels(SceGxmTextureFormat format)
+{
+	switch (format & 0x9f000000U) {
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8U8:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8:
+	case SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static unsigned int tex_max_levels(unsigned int w, unsigned int h)
+{
+	unsigned int levels = 1;
+	while ((w >> levels) > 0 || (h >> levels) > 0)
+		levels++;
+	return levels;
+}
+
+/*
+ * Dimensions of a mip level and the bytes it takes. Swizzled levels are
+ * halvings of the padded base level, the others of the real size.
+ */
+static unsigned int tex_level_size(SceGxmTextureFormat format, SceGxmTextureType layout, unsigned int w, unsigned int h,
+				   unsigned int level, unsigned int *level_w, unsigned int *level_h)
+{
+	if (layout == SCE_GXM_TEXTURE_SWIZZLED || layout == SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY) {
+		w = texture_layout_pot(w);
+		h = texture_layout_pot(h);
+	}
+
+	w >>= level;
+	h >>= level;
+	*level_w = w ? w : 1;
+	*level_h = h ? h : 1;
+
+	return tex_format_data_size(format, layout, *level_w, *level_h);
+}
+
+/* The levels are stored one after the other, starting with the biggest */
+static unsigned int tex_levels_size(SceGxmTextureFormat format, SceGxmTextureType layout, unsigned int w, unsigned int h,
+				    unsigned int levels)
+{
+	unsigned int level, level_w, level_h, size = 0;
+
+	for (level = 0; level < levels; level++)
+		size += tex_level_size(format, layout, w, h, level, &level_w, &level_h);
+
+	return size;
+}
+
+static int tex_alloc_palette(vita2d_texture *texture, vita2d_mem_category category)
+{
+	const int pal_size = 256 * sizeof(uint32_t);
+
+	void *texture_palette = gpu_heap_alloc(
+		MemBlockType,
+		pal_size,
+		SCE_GXM_PALETTE_ALIGNMENT,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		category,
+		&texture->palette_UID);
+
+	if (!texture_palette) {
+		texture->palette_UID = 0;
+		return 0;
+	}
+
+	memset(texture_palette, 0, pal_size);
+
+	sceGxmTextureSetPalette(&texture->gxm_tex, texture_palette);
+
+	return 1;
+}
+
 void vita2d_texture_set_alloc_memblock_type(SceKernelMemBlockType type)
 {
 	MemBlockType = (type == 0) ? SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW : type;
@@ -47,28 +200,131 @@ SceKernelMemBlockType vita2d_texture_get_alloc_memblock_type()
 	return MemBlockType;
 }
 
+void vita2d_texture_set_load_layout(SceGxmTextureType layout)
+{
+	LoadLayout = layout;
+}
+
+SceGxmTextureType vita2d_texture_get_load_layout()
+{
+	return LoadLayout;
+}
+
+void vita2d_texture_set_load_mipmaps(int enable)
+{
+	LoadMipmaps = enable;
+}
+
+int vita2d_texture_get_load_mipmaps()
+{
+	return LoadMipmaps;
+}
+
+void vita2d_texture_set_load_palette(vita2d_palette_mode mode)
+{
+	LoadPalette = mode;
+}
+
+vita2d_palette_mode vita2d_texture_get_load_palette()
+{
+	return LoadPalette;
+}
+
+/* Packer from the A8B8G8R8 rows the loaders decode, NULL if there's no conversion */
+static pixel_pack_fn tex_format_pack_fn(SceGxmTextureFormat format)
+{
+	switch (format) {
+	case SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR:
+		return pixel_pack_rgba8888_to_bgr565;
+	case SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR:
+		return pixel_pack_rgba8888_to_abgr4444;
+	case SCE_GXM_TEXTURE_FORMAT_U1U5U5U5_ABGR:
+		return pixel_pack_rgba8888_to_abgr1555;
+	default:
+		return NULL;
+	}
+}
+
+int vita2d_texture_set_load_format(SceGxmTextureFormat format)
+{
+	if (format != SCE_GXM_TEXTURE_FORMAT_A8B8G8R8 && !tex_format_pack_fn(format))
+		return 0;
+
+	LoadFormat = format;
+	return 1;
+}
+
+SceGxmTextureFormat vita2d_texture_get_load_format()
+{
+	return LoadFormat;
+}
+
+void vita2d_texture_set_load_dither(int enable)
+{
+	LoadDither = enable;
+}
+
+int vita2d_texture_get_load_dither()
+{
+	return LoadDither;
+}
+
 vita2d_texture *vita2d_create_empty_texture(unsigned int w, unsigned int h)
 {
 	return vita2d_create_empty_texture_format(w, h, SCE_GXM_TEXTURE_FORMAT_A8B8G8R8);
 }
 
-static vita2d_texture *_vita2d_create_empty_texture_format_advanced(unsigned int w, unsigned int h, SceGxmTextureFormat format, unsigned int isRenderTarget)
+static vita2d_texture *_vita2d_create_empty_texture_format_advanced(unsigned int w, unsigned int h, SceGxmTextureFormat format, SceGxmTextureType layout, unsigned int levels, unsigned int isRenderTarget, unsigned int clearData, vita2d_mem_category category)
 {
+	unsigned int block_w, block_h, block_size;
+
 	if (w > GXM_TEX_MAX_SIZE || h > GXM_TEX_MAX_SIZE)
 		return NULL;
 
+	/* 0 means all the levels down to 1x1, render targets only have one */
+	if (levels == 0 || levels > tex_max_levels(w, h))
+		levels = tex_max_levels(w, h);
+	if (isRenderTarget)
+		levels = 1;
+
+	/* PVRTC data is always twiddled, and render targets are linear */
+	if (tex_format_is_pvrt(format))
+		layout = SCE_GXM_TEXTURE_SWIZZLED;
+	else if (isRenderTarget || tex_format_block_info(format, &block_w, &block_h, &block_size))
+		layout = SCE_GXM_TEXTURE_LINEAR;
+
+	switch (layout) {
+	case SCE_GXM_TEXTURE_SWIZZLED:
+	case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+		/* Plain swizzled textures have to be a power of two on both sides */
+		if (w != texture_layout_pot(w) || h != texture_layout_pot(h))
+			layout = SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY;
+		else
+			layout = SCE_GXM_TEXTURE_SWIZZLED;
+		break;
+	case SCE_GXM_TEXTURE_TILED:
+		break;
+	default:
+		layout = SCE_GXM_TEXTURE_LINEAR;
+		break;
+	}
+
 	vita2d_texture *texture = malloc(sizeof(*texture));
 	if (!texture)
 		return NULL;
 
-	const int tex_size =  ((w + 7) & ~ 7) * h * tex_format_to_bytespp(format);
+	/* So that vita2d_free_texture() can be used on a half built texture */
+	memset(texture, 0, sizeof(*texture));
+
+	const int tex_size = tex_levels_size(format, layout, w, h, levels);
 
 	/* Allocate a GPU buffer for the texture */
-	void *texture_data = gpu_alloc(
+	void *texture_data = gpu_heap_alloc(
 		MemBlockType,
 		tex_size,
 		SCE_GXM_TEXTURE_ALIGNMENT,
 		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+		category,
 		&texture->data_UID);
 
 	if (!texture_data) {
@@ -76,45 +332,47 @@ static vita2d_texture *_vita2d_create_empty_texture_format_advanced(unsigned int
 		return NULL;
 	}
 
-	/* Clear the texture */
-	memset(texture_data, 0, tex_size);
+	/* Clear the texture, unless the caller is going to overwrite all of it */
+	if (clearData)
+		memset(texture_data, 0, tex_size);
 
 	/* Create the gxm texture */
-	sceGxmTextureInitLinear(
-		&texture->gxm_tex,
-		texture_data,
-		format,
-		w,
-		h,
-		0);
-
-	if ((format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P8) {
+	const unsigned int mip_count = levels > 1 ? levels : 0;
+	int err;
+	switch (layout) {
+	case SCE_GXM_TEXTURE_SWIZZLED:
+		err = sceGxmTextureInitSwizzled(&texture->gxm_tex, texture_data, format, w, h, mip_count);
+		break;
+	case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+		err = sceGxmTextureInitSwizzledArbitrary(&texture->gxm_tex, texture_data, format, w, h, mip_count);
+		break;
+	case SCE_GXM_TEXTURE_TILED:
+		err = sceGxmTextureInitTiled(&texture->gxm_tex, texture_data, format, w, h, mip_count);
+		break;
+	default:
+		err = sceGxmTextureInitLinear(&texture->gxm_tex, texture_data, format, w, h, mip_count);
+		break;
+	}
 
-		const int pal_size = 256 * sizeof(uint32_t);
+	if (err < 0) {
+		vita2d_free_texture(texture);
+		return NULL;
+	}
 
-		void *texture_palette = gpu_alloc(
-			MemBlockType,
-			pal_size,
-			SCE_GXM_PALETTE_ALIGNMENT,
-			SCE_GXM_MEMORY_ATTRIB_READ,
-			&texture->palette_UID);
+	/* Blend between the two nearest levels when minifying */
+	if (levels > 1)
+		sceGxmTextureSetMipFilter(&texture->gxm_tex, SCE_GXM_TEXTURE_MIP_FILTER_ENABLED);
 
-		if (!texture_palette) {
-			texture->palette_UID = 0;
+	if ((format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P8) {
+		if (!tex_alloc_palette(texture, category)) {
 			vita2d_free_texture(texture);
 			return NULL;
 		}
-
-		memset(texture_palette, 0, pal_size);
-
-		sceGxmTextureSetPalette(&texture->gxm_tex, texture_palette);
-	} else {
-		texture->palette_UID = 0;
 	}
 
 	if (isRenderTarget) {
 
-		int err = sceGxmColorSurfaceInit(
+		err = sceGxmColorSurfaceInit(
 			&texture->gxm_sfc,
 			SCE_GXM_COLOR_FORMAT_A8B8G8R8,
 			SCE_GXM_COLOR_SURFACE_LINEAR,
@@ -143,6 +401,7 @@ static vita2d_texture *_vita2d_create_empty_texture_format_advanced(unsigned int
 			4*sampleCount,
 			SCE_GXM_DEPTHSTENCIL_SURFACE_ALIGNMENT,
 			SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+			VITA2D_MEM_RENDER_TARGET_DEPTH,
 			&texture->depth_UID);
 
 		// create the SceGxmDepthStencilSurface structure
@@ -189,16 +448,171 @@ static vita2d_texture *_vita2d_create_empty_texture_format_advanced(unsigned int
 
 vita2d_texture * vita2d_create_empty_texture_format(unsigned int w, unsigned int h, SceGxmTextureFormat format)
 {
-	return _vita2d_create_empty_texture_format_advanced(w, h, format, 0);
+	return _vita2d_create_empty_texture_format_advanced(w, h, format, SCE_GXM_TEXTURE_LINEAR, 1, 0, 1, VITA2D_MEM_TEXTURE);
+}
+
+vita2d_texture *_vita2d_create_empty_texture_format_category(unsigned int w, unsigned int h, SceGxmTextureFormat format, vita2d_mem_category category)
+{
+	return _vita2d_create_empty_texture_format_advanced(w, h, format, SCE_GXM_TEXTURE_LINEAR, 1, 0, 1, category);
+}
+
+vita2d_texture *vita2d_create_empty_texture_format_uninitialized(unsigned int w, unsigned int h, SceGxmTextureFormat format)
+{
+	return _vita2d_create_empty_texture_format_advanced(w, h, format, SCE_GXM_TEXTURE_LINEAR, 1, 0, 0, VITA2D_MEM_TEXTURE);
+}
+
+vita2d_texture *vita2d_create_empty_texture_format_layout(unsigned int w, unsigned int h, SceGxmTextureFormat format, SceGxmTextureType layout)
+{
+	return _vita2d_create_empty_texture_format_advanced(w, h, format, layout, 1, 0, 1, VITA2D_MEM_TEXTURE);
+}
+
+vita2d_texture *vita2d_create_empty_texture_mipmapped(unsigned int w, unsigned int h, SceGxmTextureFormat format, SceGxmTextureType layout, unsigned int levels)
+{
+	return _vita2d_create_empty_texture_format_advanced(w, h, format, layout, levels, 0, 1, VITA2D_MEM_TEXTURE);
+}
+
+vita2d_texture *_vita2d_create_empty_texture_load(unsigned int w, unsigned int h, SceGxmTextureFormat format, int clear)
+{
+	/* Only the formats vita2d_texture_generate_mipmaps() can fill get mip levels */
+	unsigned int levels = LoadMipmaps && tex_format_is_u8_channels(format) ? 0 : 1;
+
+	return _vita2d_create_empty_texture_format_advanced(w, h, format, LoadLayout, levels, 0, clear, VITA2D_MEM_TEXTURE);
+}
+
+int _vita2d_texture_load_direct(const vita2d_texture *texture)
+{
+	return vita2d_texture_get_format(texture) == SCE_GXM_TEXTURE_FORMAT_A8B8G8R8 &&
+	       vita2d_texture_is_linear(texture);
+}
+
+void _vita2d_texture_store_rgba_row(vita2d_texture *texture, unsigned int y, const void *rgba, void *tmp)
+{
+	pixel_pack_fn pack = tex_format_pack_fn(vita2d_texture_get_format(texture));
+	unsigned int w = vita2d_texture_get_width(texture);
+
+	if (!pack) {
+		vita2d_texture_write_row(texture, y, rgba);
+	} else if (vita2d_texture_is_linear(texture)) {
+		pack(rgba, vita2d_texture_get_datap(texture) + y * vita2d_texture_get_stride(texture), w, y, LoadDither);
+	} else {
+		pack(rgba, tmp, w, y, LoadDither);
+		vita2d_texture_write_row(texture, y, tmp);
+	}
 }
 
 vita2d_texture * vita2d_create_empty_texture_rendertarget(unsigned int w, unsigned int h, SceGxmTextureFormat format)
 {
-	return _vita2d_create_empty_texture_format_advanced(w, h, format, 1);
+	return _vita2d_create_empty_texture_format_advanced(w, h, format, SCE_GXM_TEXTURE_LINEAR, 1, 1, 1, VITA2D_MEM_TEXTURE);
+}
+
+vita2d_texture *_vita2d_create_empty_texture_type(unsigned int w, unsigned int h, SceGxmTextureFormat format, SceGxmTextureType type, unsigned int mip_count, unsigned int size)
+{
+	if (w > GXM_TEX_MAX_SIZE || h > GXM_TEX_MAX_SIZE)
+		return NULL;
+
+	vita2d_texture *texture = malloc(sizeof(*texture));
+	if (!texture)
+		return NULL;
+
+	memset(texture, 0, sizeof(*texture));
+
+	void *texture_data = gpu_heap_alloc(
+		MemBlockType,
+		size,
+		SCE_GXM_TEXTURE_ALIGNMENT,
+		SCE_GXM_MEMORY_ATTRIB_READ | SCE_GXM_MEMORY_ATTRIB_WRITE,
+		VITA2D_MEM_TEXTURE,
+		&texture->data_UID);
+
+	if (!texture_data) {
+		free(texture);
+		return NULL;
+	}
+
+	int err;
+	switch (type) {
+	case SCE_GXM_TEXTURE_SWIZZLED:
+		err = sceGxmTextureInitSwizzled(&texture->gxm_tex, texture_data, format, w, h, mip_count);
+		break;
+	case SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY:
+		err = sceGxmTextureInitSwizzledArbitrary(&texture->gxm_tex, texture_data, format, w, h, mip_count);
+		break;
+	case SCE_GXM_TEXTURE_LINEAR:
+		err = sceGxmTextureInitLinear(&texture->gxm_tex, texture_data, format, w, h, mip_count);
+		break;
+	case SCE_GXM_TEXTURE_TILED:
+		err = sceGxmTextureInitTiled(&texture->gxm_tex, texture_data, format, w, h, mip_count);
+		break;
+	default:
+		err = -1;
+		break;
+	}
+
+	if (err < 0) {
+		vita2d_free_texture(texture);
+		return NULL;
+	}
+
+	if ((format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P8) {
+		if (!tex_alloc_palette(texture, VITA2D_MEM_TEXTURE)) {
+			vita2d_free_texture(texture);
+			return NULL;
+		}
+	}
+
+	return texture;
+}
+
+vita2d_texture *vita2d_create_texture_from_data(void *data, unsigned int w, unsigned int h, unsigned int stride, SceGxmTextureFormat format, SceUID data_UID)
+{
+	if (w > GXM_TEX_MAX_SIZE || h > GXM_TEX_MAX_SIZE)
+		return NULL;
+
+	if (!data || ((uintptr_t)data & (SCE_GXM_TEXTURE_ALIGNMENT - 1)))
+		return NULL;
+
+	const unsigned int linear_stride = ((w + 7) & ~7) * tex_format_to_bytespp(format);
+
+	if (stride == 0)
+		stride = linear_stride;
+	else if (stride < w * tex_format_to_bytespp(format))
+		return NULL;
+
+	vita2d_texture *texture = malloc(sizeof(*texture));
+	if (!texture)
+		return NULL;
+
+	memset(texture, 0, sizeof(*texture));
+
+	/* The buffer is used as is, it's neither allocated nor cleared here */
+	int err;
+	if (stride == linear_stride)
+		err = sceGxmTextureInitLinear(&texture->gxm_tex, data, format, w, h, 0);
+	else
+		err = sceGxmTextureInitLinearStrided(&texture->gxm_tex, data, format, w, h, stride);
+
+	if (err < 0) {
+		free(texture);
+		return NULL;
+	}
+
+	if ((format & 0x9f000000U) == SCE_GXM_TEXTURE_BASE_FORMAT_P8) {
+		if (!tex_alloc_palette(texture, VITA2D_MEM_TEXTURE)) {
+			free(texture);
+			return NULL;
+		}
+	}
+
+	/* Only take ownership of the buffer once nothing else can fail */
+	texture->data_UID = data_UID;
+
+	return texture;
 }
 
 void vita2d_free_texture(vita2d_texture *texture)
 {
+	TRACE_FORGET(texture);
+
 	if (texture) {
 		if (texture->gxm_rtgt) {
 			sceGxmDestroyRenderTarget(texture->gxm_rtgt);
@@ -207,9 +621,12 @@ void vita2d_free_texture(vita2d_texture *texture)
 			gpu_free(texture->depth_UID);
 		}
 		if (texture->palette_UID) {
-			gpu_free(texture->palette_UID);
+			gpu_heap_free(texture->palette_UID, vita2d_texture_get_palette(texture));
+		}
+		/* Wrapped buffers not owned by the texture have no UID */
+		if (texture->data_UID) {
+			gpu_heap_free(texture->data_UID, vita2d_texture_get_datap(texture));
 		}
-		gpu_free(texture->data_UID);
 		free(texture);
 	}
 }
@@ -226,8 +643,226 @@ unsigned int vita2d_texture_get_height(const vita2d_texture *texture)
 
 unsigned int vita2d_texture_get_stride(const vita2d_texture *texture)
 {
-	return ((vita2d_texture_get_width(texture) + 7) & ~7)
-		* tex_format_to_bytespp(vita2d_texture_get_format(texture));
+	SceGxmTextureFormat format = vita2d_texture_get_format(texture);
+	unsigned int block_w, block_h, block_size;
+
+	unsigned int aligned_w, aligned_h;
+	SceGxmTextureType type = sceGxmTextureGetType(&texture->gxm_tex);
+
+	if (type == SCE_GXM_TEXTURE_LINEAR_STRIDED)
+		return sceGxmTextureGetStride(&texture->gxm_tex);
+
+	/* Bytes per row of blocks */
+	if (tex_format_block_info(format, &block_w, &block_h, &block_size))
+		return ((vita2d_texture_get_width(texture) + block_w - 1) / block_w) * block_size;
+
+	texture_layout_dimensions(type, vita2d_texture_get_width(texture),
+		vita2d_texture_get_height(texture), &aligned_w, &aligned_h);
+
+	return aligned_w * tex_format_to_bytespp(format);
+}
+
+unsigned int _vita2d_texture_get_size(const vita2d_texture *texture)
+{
+	SceGxmTextureFormat format = vita2d_texture_get_format(texture);
+	SceGxmTextureType type = sceGxmTextureGetType(&texture->gxm_tex);
+	unsigned int levels = sceGxmTextureGetMipmapCount(&texture->gxm_tex);
+	unsigned int size;
+
+	if (type == SCE_GXM_TEXTURE_LINEAR_STRIDED)
+		size = vita2d_texture_get_stride(texture) * vita2d_texture_get_height(texture);
+	else
+		size = tex_levels_size(format, type, vita2d_texture_get_width(texture),
+			vita2d_texture_get_height(texture), levels ? levels : 1);
+
+	if (texture->palette_UID)
+		size += 256 * sizeof(uint32_t);
+
+	return size;
+}
+
+int vita2d_texture_is_linear(const vita2d_texture *texture)
+{
+	SceGxmTextureType type = sceGxmTextureGetType(&texture->gxm_tex);
+	return type == SCE_GXM_TEXTURE_LINEAR || type == SCE_GXM_TEXTURE_LINEAR_STRIDED;
+}
+
+void vita2d_texture_write_row(vita2d_texture *texture, unsigned int y, const void *row)
+{
+	SceGxmTextureType type = sceGxmTextureGetType(&texture->gxm_tex);
+	unsigned int w = vita2d_texture_get_width(texture);
+	unsigned int bpp = tex_format_to_bytespp(vita2d_texture_get_format(texture));
+
+	if (type == SCE_GXM_TEXTURE_LINEAR_STRIDED) {
+		memcpy(vita2d_texture_get_datap(texture) + y * vita2d_texture_get_stride(texture), row, w * bpp);
+		return;
+	}
+
+	texture_layout_write_row(type, vita2d_texture_get_datap(texture), w,
+		vita2d_texture_get_height(texture), bpp, y, row, w);
+}
+
+void vita2d_texture_read_row(const vita2d_texture *texture, unsigned int y, void *row)
+{
+	SceGxmTextureType type = sceGxmTextureGetType(&texture->gxm_tex);
+	unsigned int w = vita2d_texture_get_width(texture);
+	unsigned int bpp = tex_format_to_bytespp(vita2d_texture_get_format(texture));
+
+	if (type == SCE_GXM_TEXTURE_LINEAR_STRIDED) {
+		memcpy(row, vita2d_texture_get_datap(texture) + y * vita2d_texture_get_stride(texture), w * bpp);
+		return;
+	}
+
+	texture_layout_read_row(type, vita2d_texture_get_datap(texture), w,
+		vita2d_texture_get_height(texture), bpp, y, row, w);
+}
+
+int vita2d_texture_generate_mipmaps(vita2d_texture *texture)
+{
+	SceGxmTextureFormat format = vita2d_texture_get_format(texture);
+	SceGxmTextureType type = sceGxmTextureGetType(&texture->gxm_tex);
+	unsigned int levels = sceGxmTextureGetMipmapCount(&texture->gxm_tex);
+	unsigned int w = vita2d_texture_get_width(texture);
+	unsigned int h = vita2d_texture_get_height(texture);
+	unsigned int bpp = tex_format_to_bytespp(format);
+	unsigned char *data = vita2d_texture_get_datap(texture);
+	unsigned char *row_buf = NULL;
+	unsigned int level, y;
+
+	if (levels <= 1)
+		return 1;
+
+	if (!tex_format_is_u8_channels(format) || type == SCE_GXM_TEXTURE_LINEAR_STRIDED)
+		return 0;
+
+	/* Rows of non-linear levels go through two source rows and a destination one */
+	if (type != SCE_GXM_TEXTURE_LINEAR) {
+		row_buf = malloc(3 * w * bpp);
+		if (!row_buf)
+			return 0;
+	}
+
+	unsigned int src_w, src_h, src_sw, src_sh;
+	unsigned int src_size = tex_level_size(format, type, w, h, 0, &src_sw, &src_sh);
+	unsigned char *src = data;
+
+	src_w = w;
+	src_h = h;
+
+	for (level = 1; level < levels; level++) {
+		unsigned int dst_sw, dst_sh;
+		unsigned int dst_size = tex_level_size(format, type, w, h, level, &dst_sw, &dst_sh);
+		unsigned char *dst = src + src_size;
+		unsigned int dst_w = src_w > 1 ? src_w / 2 : 1;
+		unsigned int dst_h = src_h > 1 ? src_h / 2 : 1;
+
+		for (y = 0; y < dst_h; y++) {
+			/* A 1 pixel tall source level has no next row */
+			unsigned int y0 = y * 2;
+			unsigned int y1 = src_h > 1 ? y0 + 1 : y0;
+
+			if (!row_buf) {
+				unsigned int src_stride = ((src_sw + 7) & ~7) * bpp;
+				unsigned int dst_stride = ((dst_sw + 7) & ~7) * bpp;
+				pixel_downsample_2x2(src + y0 * src_stride, src + y1 * src_stride,
+					dst + y * dst_stride, src_w, bpp);
+			} else {
+				unsigned char *row0 = row_buf;
+				unsigned char *row1 = row_buf + w * bpp;
+				unsigned char *out = row_buf + 2 * w * bpp;
+				texture_layout_read_row(type, src, src_sw, src_sh, bpp, y0, row0, src_w);
+				texture_layout_read_row(type, src, src_sw, src_sh, bpp, y1, row1, src_w);
+				pixel_downsample_2x2(row0, row1, out, src_w, bpp);
+				texture_layout_write_row(type, dst, dst_sw, dst_sh, bpp, y, out, dst_w);
+			}
+		}
+
+		src = dst;
+		src_size = dst_size;
+		src_sw = dst_sw;
+		src_sh = dst_sh;
+		src_w = dst_w;
+		src_h = dst_h;
+	}
+
+	free(row_buf);
+
+	return 1;
+}
+
+/* P8 copy of an A8B8G8R8 texture, NULL if it has too many colors and quantize isn't set */
+static vita2d_texture *tex_palettize(const vita2d_texture *texture, int quantize)
+{
+	unsigned int w = vita2d_texture_get_width(texture);
+	unsigned int h = vita2d_texture_get_height(texture);
+	vita2d_texture *p8 = NULL;
+	palette_quantizer q = {NULL, NULL};
+	unsigned int y;
+
+	palette *pal = malloc(sizeof(*pal));
+	unsigned int *row = malloc(w * sizeof(*row));
+	unsigned char *indices = malloc(w);
+	if (!pal || !row || !indices)
+		goto exit;
+
+	/* Look for the colors first, giving up as soon as there are too many */
+	palette_init(pal);
+	for (y = 0; y < h; y++) {
+		vita2d_texture_read_row(texture, y, row);
+		if (!palette_add_row(pal, row, w))
+			break;
+	}
+
+	int exact = y == h;
+	if (!exact && (!quantize || !palette_quantizer_init(&q)))
+		goto exit;
+
+	if (!exact) {
+		for (y = 0; y < h; y++) {
+			vita2d_texture_read_row(texture, y, row);
+			palette_quantizer_add_row(&q, row, w);
+		}
+		pal->num_colors = palette_quantizer_build(&q, pal->colors, PALETTE_MAX_COLORS);
+	}
+
+	p8 = _vita2d_create_empty_texture_format_advanced(w, h, SCE_GXM_TEXTURE_FORMAT_P8_ABGR,
+		sceGxmTextureGetType(&texture->gxm_tex), 1, 0, 0, VITA2D_MEM_TEXTURE);
+	if (!p8)
+		goto exit;
+
+	memcpy(vita2d_texture_get_palette(p8), pal->colors, pal->num_colors * sizeof(pal->colors[0]));
+
+	for (y = 0; y < h; y++) {
+		vita2d_texture_read_row(texture, y, row);
+		if (exact)
+			palette_map_row(pal, row, indices, w);
+		else
+			palette_quantizer_map_row(&q, row, indices, w);
+		vita2d_texture_write_row(p8, y, indices);
+	}
+
+exit:
+	palette_quantizer_fini(&q);
+	free(indices);
+	free(row);
+	free(pal);
+	return p8;
+}
+
+vita2d_texture *_vita2d_texture_load_done(vita2d_texture *texture)
+{
+	if (LoadPalette != VITA2D_PALETTE_NONE &&
+	    vita2d_texture_get_format(texture) == SCE_GXM_TEXTURE_FORMAT_A8B8G8R8) {
+		vita2d_texture *p8 = tex_palettize(texture, LoadPalette == VITA2D_PALETTE_QUANTIZE);
+		if (p8) {
+			vita2d_free_texture(texture);
+			return p8;
+		}
+	}
+
+	vita2d_texture_generate_mipmaps(texture);
+
+	return texture;
 }
 
 SceGxmTextureFormat vita2d_texture_get_format(const vita2d_texture *texture)
@@ -257,6 +892,8 @@ SceGxmTextureFilter vita2d_texture_get_mag_filter(const vita2d_texture *texture)
 
 void vita2d_texture_set_filters(vita2d_texture *texture, SceGxmTextureFilter min_filter, SceGxmTextureFilter mag_filter)
 {
+	TRACE_CALL(TRACE_OP_TEXTURE_SET_FILTERS, texture, TRACE_U(min_filter), TRACE_U(mag_filter));
+
 	sceGxmTextureSetMinFilter(&texture->gxm_tex, min_filter);
 	sceGxmTextureSetMagFilter(&texture->gxm_tex, mag_filter);
 }
@@ -297,48 +934,60 @@ static inline void set_texture_tint_color_uniform(unsigned int color)
 	sceGxmSetUniformDataF(texture_tint_color_buffer, _vita2d_textureTintColorParam, 0, 4, tint_color);
 }
 
-static inline void draw_texture_generic(const vita2d_texture *texture, float x, float y)
+/* Axis aligned quad, the draws of it are clipped on the CPU (see clip.h) */
+static inline void draw_texture_quad(const vita2d_texture *texture, float x0, float y0, float x1, float y1,
+				     float u0, float v0, float u1, float v1)
 {
+	if (!clip_quad(&x0, &y0, &x1, &y1, &u0, &v0, &u1, &v1))
+		return;
+
 	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
 		4 * sizeof(vita2d_texture_vertex), // 4 vertices
 		sizeof(vita2d_texture_vertex));
 
-	const float w = vita2d_texture_get_width(texture);
-	const float h = vita2d_texture_get_height(texture);
-
-	vertices[0].x = x;
-	vertices[0].y = y;
+	vertices[0].x = x0;
+	vertices[0].y = y0;
 	vertices[0].z = +0.5f;
-	vertices[0].u = 0.0f;
-	vertices[0].v = 0.0f;
+	vertices[0].u = u0;
+	vertices[0].v = v0;
 
-	vertices[1].x = x + w;
-	vertices[1].y = y;
+	vertices[1].x = x1;
+	vertices[1].y = y0;
 	vertices[1].z = +0.5f;
-	vertices[1].u = 1.0f;
-	vertices[1].v = 0.0f;
+	vertices[1].u = u1;
+	vertices[1].v = v0;
 
-	vertices[2].x = x;
-	vertices[2].y = y + h;
+	vertices[2].x = x0;
+	vertices[2].y = y1;
 	vertices[2].z = +0.5f;
-	vertices[2].u = 0.0f;
-	vertices[2].v = 1.0f;
+	vertices[2].u = u0;
+	vertices[2].v = v1;
 
-	vertices[3].x = x + w;
-	vertices[3].y = y + h;
+	vertices[3].x = x1;
+	vertices[3].y = y1;
 	vertices[3].z = +0.5f;
-	vertices[3].u = 1.0f;
-	vertices[3].v = 1.0f;
+	vertices[3].u = u1;
+	vertices[3].v = v1;
 
 	// Set the texture to the TEXUNIT0
 	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	profile_draw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+}
+
+static inline void draw_texture_generic(const vita2d_texture *texture, float x, float y)
+{
+	const float w = vita2d_texture_get_width(texture);
+	const float h = vita2d_texture_get_height(texture);
+
+	draw_texture_quad(texture, x, y, x + w, y + h, 0.0f, 0.0f, 1.0f, 1.0f);
 }
 
 void vita2d_draw_texture(const vita2d_texture *texture, float x, float y)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE, texture, TRACE_F(x), TRACE_F(y));
+
 	set_texture_program();
 	set_texture_wvp_uniform();
 	draw_texture_generic(texture, x, y);
@@ -346,6 +995,8 @@ void vita2d_draw_texture(const vita2d_texture *texture, float x, float y)
 
 void vita2d_draw_texture_tint(const vita2d_texture *texture, float x, float y, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_TINT, texture, TRACE_F(x), TRACE_F(y), TRACE_U(color));
+
 	set_texture_tint_program();
 	set_texture_wvp_uniform();
 	set_texture_tint_color_uniform(color);
@@ -354,6 +1005,8 @@ void vita2d_draw_texture_tint(const vita2d_texture *texture, float x, float y, u
 
 void vita2d_draw_texture_rotate(const vita2d_texture *texture, float x, float y, float rad)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_ROTATE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(rad));
+
 	vita2d_draw_texture_rotate_hotspot(texture, x, y, rad,
 		vita2d_texture_get_width(texture)/2.0f,
 		vita2d_texture_get_height(texture)/2.0f);
@@ -361,6 +1014,8 @@ void vita2d_draw_texture_rotate(const vita2d_texture *texture, float x, float y,
 
 void vita2d_draw_texture_tint_rotate(const vita2d_texture *texture, float x, float y, float rad, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_TINT_ROTATE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(rad), TRACE_U(color));
+
 	vita2d_draw_texture_tint_rotate_hotspot(texture, x, y, rad,
 		vita2d_texture_get_width(texture)/2.0f,
 		vita2d_texture_get_height(texture)/2.0f,
@@ -414,11 +1069,16 @@ static inline void draw_texture_rotate_hotspot_generic(const vita2d_texture *tex
 	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	profile_draw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
 }
 
 void vita2d_draw_texture_rotate_hotspot(const vita2d_texture *texture, float x, float y, float rad, float center_x, float center_y)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_ROTATE_HOTSPOT, texture, TRACE_F(x), TRACE_F(y), TRACE_F(rad),
+		TRACE_F(center_x), TRACE_F(center_y));
+
+	clip_prepare_draw();
+
 	set_texture_program();
 	set_texture_wvp_uniform();
 	draw_texture_rotate_hotspot_generic(texture, x, y, rad, center_x, center_y);
@@ -426,6 +1086,11 @@ void vita2d_draw_texture_rotate_hotspot(const vita2d_texture *texture, float x,
 
 void vita2d_draw_texture_tint_rotate_hotspot(const vita2d_texture *texture, float x, float y, float rad, float center_x, float center_y, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_TINT_ROTATE_HOTSPOT, texture, TRACE_F(x), TRACE_F(y), TRACE_F(rad),
+		TRACE_F(center_x), TRACE_F(center_y), TRACE_U(color));
+
+	clip_prepare_draw();
+
 	set_texture_tint_program();
 	set_texture_wvp_uniform();
 	set_texture_tint_color_uniform(color);
@@ -434,46 +1099,16 @@ void vita2d_draw_texture_tint_rotate_hotspot(const vita2d_texture *texture, floa
 
 static inline void draw_texture_scale_generic(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
-
 	const float w = x_scale * vita2d_texture_get_width(texture);
 	const float h = y_scale * vita2d_texture_get_height(texture);
 
-	vertices[0].x = x;
-	vertices[0].y = y;
-	vertices[0].z = +0.5f;
-	vertices[0].u = 0.0f;
-	vertices[0].v = 0.0f;
-
-	vertices[1].x = x + w;
-	vertices[1].y = y;
-	vertices[1].z = +0.5f;
-	vertices[1].u = 1.0f;
-	vertices[1].v = 0.0f;
-
-	vertices[2].x = x;
-	vertices[2].y = y + h;
-	vertices[2].z = +0.5f;
-	vertices[2].u = 0.0f;
-	vertices[2].v = 1.0f;
-
-	vertices[3].x = x + w;
-	vertices[3].y = y + h;
-	vertices[3].z = +0.5f;
-	vertices[3].u = 1.0f;
-	vertices[3].v = 1.0f;
-
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
-
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	draw_texture_quad(texture, x, y, x + w, y + h, 0.0f, 0.0f, 1.0f, 1.0f);
 }
 
 void vita2d_draw_texture_scale(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_SCALE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(x_scale), TRACE_F(y_scale));
+
 	set_texture_program();
 	set_texture_wvp_uniform();
 	draw_texture_scale_generic(texture, x, y, x_scale, y_scale);
@@ -481,6 +1116,9 @@ void vita2d_draw_texture_scale(const vita2d_texture *texture, float x, float y,
 
 void vita2d_draw_texture_tint_scale(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_TINT_SCALE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(x_scale), TRACE_F(y_scale),
+		TRACE_U(color));
+
 	set_texture_tint_program();
 	set_texture_wvp_uniform();
 	set_texture_tint_color_uniform(color);
@@ -490,10 +1128,6 @@ void vita2d_draw_texture_tint_scale(const vita2d_texture *texture, float x, floa
 
 static inline void draw_texture_part_generic(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
-
 	const float w = vita2d_texture_get_width(texture);
 	const float h = vita2d_texture_get_height(texture);
 
@@ -502,39 +1136,14 @@ static inline void draw_texture_part_generic(const vita2d_texture *texture, floa
 	const float u1 = (tex_x+tex_w)/w;
 	const float v1 = (tex_y+tex_h)/h;
 
-	vertices[0].x = x;
-	vertices[0].y = y;
-	vertices[0].z = +0.5f;
-	vertices[0].u = u0;
-	vertices[0].v = v0;
-
-	vertices[1].x = x + tex_w;
-	vertices[1].y = y;
-	vertices[1].z = +0.5f;
-	vertices[1].u = u1;
-	vertices[1].v = v0;
-
-	vertices[2].x = x;
-	vertices[2].y = y + tex_h;
-	vertices[2].z = +0.5f;
-	vertices[2].u = u0;
-	vertices[2].v = v1;
-
-	vertices[3].x = x + tex_w;
-	vertices[3].y = y + tex_h;
-	vertices[3].z = +0.5f;
-	vertices[3].u = u1;
-	vertices[3].v = v1;
-
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
-
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	draw_texture_quad(texture, x, y, x + tex_w, y + tex_h, u0, v0, u1, v1);
 }
 
 void vita2d_draw_texture_part(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_PART, texture, TRACE_F(x), TRACE_F(y), TRACE_F(tex_x), TRACE_F(tex_y),
+		TRACE_F(tex_w), TRACE_F(tex_h));
+
 	set_texture_program();
 	set_texture_wvp_uniform();
 	draw_texture_part_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h);
@@ -542,6 +1151,9 @@ void vita2d_draw_texture_part(const vita2d_texture *texture, float x, float y, f
 
 void vita2d_draw_texture_tint_part(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_TINT_PART, texture, TRACE_F(x), TRACE_F(y), TRACE_F(tex_x), TRACE_F(tex_y),
+		TRACE_F(tex_w), TRACE_F(tex_h), TRACE_U(color));
+
 	set_texture_tint_program();
 	set_texture_wvp_uniform();
 	set_texture_tint_color_uniform(color);
@@ -550,10 +1162,6 @@ void vita2d_draw_texture_tint_part(const vita2d_texture *texture, float x, float
 
 static inline void draw_texture_part_scale_generic(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
-
 	const float w = vita2d_texture_get_width(texture);
 	const float h = vita2d_texture_get_height(texture);
 
@@ -565,39 +1173,14 @@ static inline void draw_texture_part_scale_generic(const vita2d_texture *texture
 	tex_w *= x_scale;
 	tex_h *= y_scale;
 
-	vertices[0].x = x;
-	vertices[0].y = y;
-	vertices[0].z = +0.5f;
-	vertices[0].u = u0;
-	vertices[0].v = v0;
-
-	vertices[1].x = x + tex_w;
-	vertices[1].y = y;
-	vertices[1].z = +0.5f;
-	vertices[1].u = u1;
-	vertices[1].v = v0;
-
-	vertices[2].x = x;
-	vertices[2].y = y + tex_h;
-	vertices[2].z = +0.5f;
-	vertices[2].u = u0;
-	vertices[2].v = v1;
-
-	vertices[3].x = x + tex_w;
-	vertices[3].y = y + tex_h;
-	vertices[3].z = +0.5f;
-	vertices[3].u = u1;
-	vertices[3].v = v1;
-
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
-
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	draw_texture_quad(texture, x, y, x + tex_w, y + tex_h, u0, v0, u1, v1);
 }
 
 void vita2d_draw_texture_part_scale(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_PART_SCALE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(tex_x), TRACE_F(tex_y),
+		TRACE_F(tex_w), TRACE_F(tex_h), TRACE_F(x_scale), TRACE_F(y_scale));
+
 	set_texture_program();
 	set_texture_wvp_uniform();
 	draw_texture_part_scale_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h, x_scale, y_scale);
@@ -605,6 +1188,9 @@ void vita2d_draw_texture_part_scale(const vita2d_texture *texture, float x, floa
 
 void vita2d_draw_texture_tint_part_scale(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_TINT_PART_SCALE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(tex_x), TRACE_F(tex_y),
+		TRACE_F(tex_w), TRACE_F(tex_h), TRACE_F(x_scale), TRACE_F(y_scale), TRACE_U(color));
+
 	set_texture_tint_program();
 	set_texture_wvp_uniform();
 	set_texture_tint_color_uniform(color);
@@ -660,11 +1246,16 @@ static inline void draw_texture_scale_rotate_hotspot_generic(const vita2d_textur
 	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	profile_draw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
 }
 
 void vita2d_draw_texture_scale_rotate_hotspot(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad, float center_x, float center_y)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_SCALE_ROTATE_HOTSPOT, texture, TRACE_F(x), TRACE_F(y), TRACE_F(x_scale), TRACE_F(y_scale),
+		TRACE_F(rad), TRACE_F(center_x), TRACE_F(center_y));
+
+	clip_prepare_draw();
+
 	set_texture_program();
 	set_texture_wvp_uniform();
 	draw_texture_scale_rotate_hotspot_generic(texture, x, y, x_scale, y_scale,
@@ -673,6 +1264,9 @@ void vita2d_draw_texture_scale_rotate_hotspot(const vita2d_texture *texture, flo
 
 void vita2d_draw_texture_scale_rotate(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_SCALE_ROTATE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(x_scale), TRACE_F(y_scale),
+		TRACE_F(rad));
+
 	vita2d_draw_texture_scale_rotate_hotspot(texture, x, y, x_scale, y_scale,
 		rad, vita2d_texture_get_width(texture)/2.0f,
 		vita2d_texture_get_height(texture)/2.0f);
@@ -680,6 +1274,11 @@ void vita2d_draw_texture_scale_rotate(const vita2d_texture *texture, float x, fl
 
 void vita2d_draw_texture_tint_scale_rotate_hotspot(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad, float center_x, float center_y, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_TINT_SCALE_ROTATE_HOTSPOT, texture, TRACE_F(x), TRACE_F(y), TRACE_F(x_scale), TRACE_F(y_scale),
+		TRACE_F(rad), TRACE_F(center_x), TRACE_F(center_y), TRACE_U(color));
+
+	clip_prepare_draw();
+
 	set_texture_tint_program();
 	set_texture_wvp_uniform();
 	set_texture_tint_color_uniform(color);
@@ -689,6 +1288,9 @@ void vita2d_draw_texture_tint_scale_rotate_hotspot(const vita2d_texture *texture
 
 void vita2d_draw_texture_tint_scale_rotate(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_TINT_SCALE_ROTATE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(x_scale), TRACE_F(y_scale),
+		TRACE_F(rad), TRACE_U(color));
+
 	vita2d_draw_texture_tint_scale_rotate_hotspot(texture, x, y, x_scale, y_scale,
 		rad, vita2d_texture_get_width(texture)/2.0f,
 		vita2d_texture_get_height(texture)/2.0f, color);
@@ -750,12 +1352,17 @@ static inline void draw_texture_part_scale_rotate_generic(const vita2d_texture *
 	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	profile_draw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
 }
 
 void vita2d_draw_texture_part_scale_rotate(const vita2d_texture *texture, float x, float y,
 	float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, float rad)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_PART_SCALE_ROTATE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(tex_x), TRACE_F(tex_y),
+		TRACE_F(tex_w), TRACE_F(tex_h), TRACE_F(x_scale), TRACE_F(y_scale), TRACE_F(rad));
+
+	clip_prepare_draw();
+
 	set_texture_program();
 	set_texture_wvp_uniform();
 	draw_texture_part_scale_rotate_generic(texture, x, y,
@@ -765,6 +1372,11 @@ void vita2d_draw_texture_part_scale_rotate(const vita2d_texture *texture, float
 void vita2d_draw_texture_part_tint_scale_rotate(const vita2d_texture *texture, float x, float y,
 	float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, float rad, unsigned int color)
 {
+	TRACE_CALL(TRACE_OP_DRAW_TEXTURE_PART_TINT_SCALE_ROTATE, texture, TRACE_F(x), TRACE_F(y), TRACE_F(tex_x), TRACE_F(tex_y),
+		TRACE_F(tex_w), TRACE_F(tex_h), TRACE_F(x_scale), TRACE_F(y_scale), TRACE_F(rad), TRACE_U(color));
+
+	clip_prepare_draw();
+
 	set_texture_tint_program();
 	set_texture_wvp_uniform();
 	set_texture_tint_color_uniform(color);
@@ -774,6 +1386,11 @@ void vita2d_draw_texture_part_tint_scale_rotate(const vita2d_texture *texture, f
 
 void vita2d_draw_array_textured(const vita2d_texture *texture, SceGxmPrimitiveType mode, const vita2d_texture_vertex *vertices, size_t count, unsigned int color)
 {
+	TRACE_CALL_DATA(TRACE_OP_DRAW_ARRAY_TEXTURED, texture, vertices, count * sizeof(*vertices),
+		TRACE_U(mode), TRACE_U(color));
+
+	clip_prepare_draw();
+
 	set_texture_tint_program();
 	set_texture_wvp_uniform();
 	set_texture_tint_color_uniform(color);
@@ -784,5 +1401,5 @@ void vita2d_draw_array_textured(const vita2d_texture *texture, SceGxmPrimitiveTy
 	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
 
 	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, mode, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), count);
+	profile_draw(_vita2d_context, mode, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), count);
 }
@@ -0,0 +1,386 @@
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/io/fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "vita2d.h"
+#include "shared.h"
+#include "utils.h"
+#include "texture_cache.h"
+
+#define CACHE_NUM_BUCKETS	256
+#define CACHE_KEY_PATH		0
+#define CACHE_KEY_CONTENT	1
+
+typedef struct cache_entry {
+	/* Chains of the key and texture hash tables */
+	struct cache_entry *key_next;
+	struct cache_entry *tex_next;
+	/* Unreferenced entries, least recently released first */
+	struct cache_entry *lru_prev;
+	struct cache_entry *lru_next;
+	vita2d_texture *texture;
+	unsigned int size;
+	unsigned int refs;
+	unsigned int hash;
+	unsigned int key_len;
+	unsigned char key[];
+} cache_entry;
+
+static int cache_initialized = 0;
+static SceKernelLwMutexWork cache_mutex;
+static cache_entry *key_buckets[CACHE_NUM_BUCKETS];
+static cache_entry *tex_buckets[CACHE_NUM_BUCKETS];
+static cache_entry *lru_head = NULL;
+static cache_entry *lru_tail = NULL;
+static unsigned int cache_budget = 0;
+static vita2d_texture_cache_stats cache_stats;
+
+/* Load settings that change the texture built from an image, they are part of the keys */
+typedef struct cache_settings {
+	SceGxmTextureType layout;
+	SceGxmTextureFormat format;
+	vita2d_palette_mode palette;
+	int mipmaps;
+	int dither;
+	int jpeg_rgba;
+} cache_settings;
+
+static void cache_get_settings(cache_settings *settings)
+{
+	memset(settings, 0, sizeof(*settings));
+	settings->layout = vita2d_texture_get_load_layout();
+	settings->format = vita2d_texture_get_load_format();
+	settings->palette = vita2d_texture_get_load_palette();
+	settings->mipmaps = vita2d_texture_get_load_mipmaps();
+	settings->dither = vita2d_texture_get_load_dither();
+	settings->jpeg_rgba = vita2d_JPEG_get_output_rgba();
+}
+
+static unsigned int cache_tex_bucket(const vita2d_texture *texture)
+{
+	return ((uintptr_t)texture >> 4) % CACHE_NUM_BUCKETS;
+}
+
+static void cache_lru_remove(cache_entry *entry)
+{
+	if (entry->lru_prev)
+		entry->lru_prev->lru_next = entry->lru_next;
+	else
+		lru_head = entry->lru_next;
+	if (entry->lru_next)
+		entry->lru_next->lru_prev = entry->lru_prev;
+	else
+		lru_tail = entry->lru_prev;
+	entry->lru_prev = entry->lru_next = NULL;
+	cache_stats.num_unreferenced--;
+}
+
+static void cache_lru_push(cache_entry *entry)
+{
+	entry->lru_next = NULL;
+	entry->lru_prev = lru_tail;
+	if (lru_tail)
+		lru_tail->lru_next = entry;
+	else
+		lru_head = entry;
+	lru_tail = entry;
+	cache_stats.num_unreferenced++;
+}
+
+static cache_entry *cache_find_key(const unsigned char *key, unsigned int key_len, unsigned int hash)
+{
+	cache_entry *entry;
+
+	for (entry = key_buckets[hash % CACHE_NUM_BUCKETS]; entry; entry = entry->key_next) {
+		if (entry->hash == hash && entry->key_len == key_len && !memcmp(entry->key, key, key_len))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static cache_entry *cache_find_texture(const vita2d_texture *texture)
+{
+	cache_entry *entry;
+
+	for (entry = tex_buckets[cache_tex_bucket(texture)]; entry; entry = entry->tex_next) {
+		if (entry->texture == texture)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void cache_unlink(cache_entry *entry)
+{
+	cache_entry **link;
+
+	for (link = &key_buckets[entry->hash % CACHE_NUM_BUCKETS]; *link != entry; link = &(*link)->key_next)
+		;
+	*link = entry->key_next;
+
+	for (link = &tex_buckets[cache_tex_bucket(entry->texture)]; *link != entry; link = &(*link)->tex_next)
+		;
+	*link = entry->tex_next;
+
+	if (entry->refs == 0)
+		cache_lru_remove(entry);
+
+	cache_stats.num_textures--;
+	cache_stats.size -= entry->size;
+}
+
+static void cache_destroy(cache_entry *entry)
+{
+	cache_unlink(entry);
+	vita2d_free_texture(entry->texture);
+	free(entry);
+}
+
+/* Frees unreferenced textures, oldest first, until the cache fits in the budget */
+static void cache_trim(unsigned int budget)
+{
+	while (lru_head && cache_stats.size > budget) {
+		cache_destroy(lru_head);
+		cache_stats.evictions++;
+	}
+}
+
+int texture_cache_init()
+{
+	if (cache_initialized)
+		return 1;
+
+	if (sceKernelCreateLwMutex(&cache_mutex, "vita2d_texture_cache_mutex", 0, 0, NULL) < 0)
+		return 0;
+
+	memset(key_buckets, 0, sizeof(key_buckets));
+	memset(tex_buckets, 0, sizeof(tex_buckets));
+	memset(&cache_stats, 0, sizeof(cache_stats));
+	lru_head = lru_tail = NULL;
+	cache_initialized = 1;
+
+	return 1;
+}
+
+void texture_cache_fini()
+{
+	unsigned int i;
+
+	if (!cache_initialized)
+		return;
+
+	/* Textures still referenced go away with the rest of the GPU memory */
+	for (i = 0; i < CACHE_NUM_BUCKETS; i++) {
+		while (key_buckets[i])
+			cache_destroy(key_buckets[i]);
+	}
+
+	sceKernelDeleteLwMutex(&cache_mutex);
+	cache_initialized = 0;
+}
+
+typedef vita2d_texture *(*cache_load_fn)(const void *source, unsigned long size);
+
+static vita2d_texture *cache_load_file(const void *source, unsigned long size)
+{
+	const char *path = source;
+	unsigned char magic[8];
+
+	SceUID fd = sceIoOpen(path, SCE_O_RDONLY, 0777);
+	if (fd < 0)
+		return NULL;
+
+	int read = sceIoRead(fd, magic, sizeof(magic));
+	sceIoClose(fd);
+
+	if (read >= 8 && !memcmp(magic, "\x89PNG\r\n\x1a\n", 8))
+		return vita2d_load_PNG_file(path);
+	if (read >= 2 && magic[0] == 0xFF && magic[1] == 0xD8)
+		return vita2d_load_JPEG_file(path);
+	if (read >= 2 && magic[0] == 'B' && magic[1] == 'M')
+		return vita2d_load_BMP_file(path);
+	if (read >= 4 && !memcmp(magic, "GXT\0", 4))
+		return vita2d_load_GXT_file(path, 0);
+
+	return NULL;
+}
+
+static vita2d_texture *cache_load_buffer(const void *source, unsigned long size)
+{
+	const unsigned char *magic = source;
+
+	if (size >= 8 && !memcmp(magic, "\x89PNG\r\n\x1a\n", 8))
+		return vita2d_load_PNG_buffer(source);
+	if (size >= 4 && magic[0] == 0xFF && magic[1] == 0xD8)
+		return vita2d_load_JPEG_buffer(source, size);
+	if (size >= 2 && magic[0] == 'B' && magic[1] == 'M')
+		return vita2d_load_BMP_buffer(source);
+	if (size >= 4 && !memcmp(magic, "GXT\0", 4))
+		return vita2d_load_GXT_buffer(source, size, 0);
+
+	return NULL;
+}
+
+static vita2d_texture *cache_get(const unsigned char *key, unsigned int key_len,
+				 cache_load_fn load, const void *source, unsigned long size)
+{
+	unsigned int hash = fnv1a_hash(key, key_len, FNV1A_INIT);
+	cache_entry *entry;
+
+	if (!cache_initialized)
+		return NULL;
+
+	sceKernelLockLwMutex(&cache_mutex, 1, NULL);
+
+	entry = cache_find_key(key, key_len, hash);
+	if (entry) {
+		if (entry->refs++ == 0)
+			cache_lru_remove(entry);
+		cache_stats.hits++;
+		sceKernelUnlockLwMutex(&cache_mutex, 1);
+		return entry->texture;
+	}
+
+	cache_stats.misses++;
+
+	/* Decode without holding the lock, other threads may be loading other textures */
+	sceKernelUnlockLwMutex(&cache_mutex, 1);
+
+	vita2d_texture *texture = load(source, size);
+	if (!texture)
+		return NULL;
+
+	entry = malloc(sizeof(*entry) + key_len);
+	if (!entry) {
+		vita2d_free_texture(texture);
+		return NULL;
+	}
+
+	entry->texture = texture;
+	entry->size = _vita2d_texture_get_size(texture);
+	entry->refs = 1;
+	entry->hash = hash;
+	entry->key_len = key_len;
+	entry->lru_prev = entry->lru_next = NULL;
+	memcpy(entry->key, key, key_len);
+
+	sceKernelLockLwMutex(&cache_mutex, 1, NULL);
+
+	/* Another thread may have loaded the same texture in the meantime */
+	cache_entry *other = cache_find_key(key, key_len, hash);
+	if (other) {
+		if (other->refs++ == 0)
+			cache_lru_remove(other);
+		sceKernelUnlockLwMutex(&cache_mutex, 1);
+		vita2d_free_texture(texture);
+		free(entry);
+		return other->texture;
+	}
+
+	entry->key_next = key_buckets[hash % CACHE_NUM_BUCKETS];
+	key_buckets[hash % CACHE_NUM_BUCKETS] = entry;
+	entry->tex_next = tex_buckets[cache_tex_bucket(texture)];
+	tex_buckets[cache_tex_bucket(texture)] = entry;
+
+	cache_stats.num_textures++;
+	cache_stats.size += entry->size;
+
+	/* Make room for the new texture among the unreferenced ones */
+	cache_trim(cache_budget);
+
+	sceKernelUnlockLwMutex(&cache_mutex, 1);
+
+	return texture;
+}
+
+vita2d_texture *vita2d_texture_cache_load_file(const char *path)
+{
+	unsigned int len = strlen(path);
+	unsigned char key[1 + sizeof(cache_settings) + len];
+	cache_settings settings;
+
+	cache_get_settings(&settings);
+
+	key[0] = CACHE_KEY_PATH;
+	memcpy(key + 1, &settings, sizeof(settings));
+	memcpy(key + 1 + sizeof(settings), path, len);
+
+	return cache_get(key, sizeof(key), cache_load_file, path, 0);
+}
+
+vita2d_texture *vita2d_texture_cache_load_buffer(const void *buffer, unsigned long size)
+{
+	unsigned char key[1 + sizeof(cache_settings) + 2 * sizeof(unsigned int) + sizeof(unsigned long)];
+	cache_settings settings;
+	unsigned int hash[2];
+
+	cache_get_settings(&settings);
+
+	/* Two different hashes of the contents, plus the size, make collisions unlikely */
+	hash[0] = fnv1a_hash(buffer, size, FNV1A_INIT);
+	hash[1] = fnv1a_hash(buffer, size, FNV1A_INIT_ALT);
+
+	key[0] = CACHE_KEY_CONTENT;
+	memcpy(key + 1, &settings, sizeof(settings));
+	memcpy(key + 1 + sizeof(settings), hash, sizeof(hash));
+	memcpy(key + 1 + sizeof(settings) + sizeof(hash), &size, sizeof(size));
+
+	return cache_get(key, sizeof(key), cache_load_buffer, buffer, size);
+}
+
+void vita2d_texture_cache_release(vita2d_texture *texture)
+{
+	if (!texture || !cache_initialized)
+		return;
+
+	sceKernelLockLwMutex(&cache_mutex, 1, NULL);
+
+	cache_entry *entry = cache_find_texture(texture);
+	if (entry && entry->refs > 0 && --entry->refs == 0) {
+		cache_lru_push(entry);
+		cache_trim(cache_budget);
+	}
+
+	sceKernelUnlockLwMutex(&cache_mutex, 1);
+}
+
+void vita2d_texture_cache_set_budget(unsigned int budget)
+{
+	cache_budget = budget;
+
+	if (!cache_initialized)
+		return;
+
+	sceKernelLockLwMutex(&cache_mutex, 1, NULL);
+	cache_trim(cache_budget);
+	sceKernelUnlockLwMutex(&cache_mutex, 1);
+}
+
+unsigned int vita2d_texture_cache_get_budget()
+{
+	return cache_budget;
+}
+
+void vita2d_texture_cache_purge()
+{
+	if (!cache_initialized)
+		return;
+
+	sceKernelLockLwMutex(&cache_mutex, 1, NULL);
+	cache_trim(0);
+	sceKernelUnlockLwMutex(&cache_mutex, 1);
+}
+
+void vita2d_texture_cache_get_stats(vita2d_texture_cache_stats *stats)
+{
+	if (!cache_initialized) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	sceKernelLockLwMutex(&cache_mutex, 1, NULL);
+	*stats = cache_stats;
+	sceKernelUnlockLwMutex(&cache_mutex, 1);
+}
@@ -0,0 +1,808 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <psp2/io/fcntl.h>
+#include <psp2/kernel/threadmgr.h>
+#include <psp2/gxm.h>
+#include "vita2d.h"
+#include "trace.h"
+
+#define TRACE_MAX_WORDS		16
+#define TRACE_MAX_OBJECTS	0xFFFF
+#define TRACE_MAX_DATA		(1024 * 1024)
+
+/* Number of argument words of each op */
+static const unsigned char trace_op_words[TRACE_OP_COUNT] = {
+	[TRACE_OP_TEXTURE] = 5,
+	[TRACE_OP_TEXTURE_FREE] = 0,
+	[TRACE_OP_FONT] = 1,
+	[TRACE_OP_FONT_FREE] = 0,
+	[TRACE_OP_START_DRAWING] = 0,
+	[TRACE_OP_START_DRAWING_ADVANCED] = 1,
+	[TRACE_OP_END_DRAWING] = 0,
+	[TRACE_OP_CLEAR_SCREEN] = 0,
+	[TRACE_OP_SWAP_BUFFERS] = 0,
+	[TRACE_OP_SET_CLEAR_COLOR] = 1,
+	[TRACE_OP_SET_VBLANK_WAIT] = 1,
+	[TRACE_OP_SET_REGION_CLIP] = 5,
+	[TRACE_OP_ENABLE_CLIPPING] = 0,
+	[TRACE_OP_DISABLE_CLIPPING] = 0,
+	[TRACE_OP_SET_CLIP_RECTANGLE] = 4,
+	[TRACE_OP_SET_BLEND_MODE_ADD] = 1,
+	[TRACE_OP_POOL_RESET] = 0,
+	[TRACE_OP_TEXTURE_SET_FILTERS] = 2,
+	[TRACE_OP_DRAW_PIXEL] = 3,
+	[TRACE_OP_DRAW_LINE] = 5,
+	[TRACE_OP_DRAW_RECTANGLE] = 5,
+	[TRACE_OP_DRAW_FILL_CIRCLE] = 4,
+	[TRACE_OP_DRAW_ARRAY] = 1,
+	[TRACE_OP_DRAW_TEXTURE] = 2,
+	[TRACE_OP_DRAW_TEXTURE_ROTATE] = 3,
+	[TRACE_OP_DRAW_TEXTURE_ROTATE_HOTSPOT] = 5,
+	[TRACE_OP_DRAW_TEXTURE_SCALE] = 4,
+	[TRACE_OP_DRAW_TEXTURE_PART] = 6,
+	[TRACE_OP_DRAW_TEXTURE_PART_SCALE] = 8,
+	[TRACE_OP_DRAW_TEXTURE_SCALE_ROTATE_HOTSPOT] = 7,
+	[TRACE_OP_DRAW_TEXTURE_SCALE_ROTATE] = 5,
+	[TRACE_OP_DRAW_TEXTURE_PART_SCALE_ROTATE] = 9,
+	[TRACE_OP_DRAW_TEXTURE_TINT] = 3,
+	[TRACE_OP_DRAW_TEXTURE_TINT_ROTATE] = 4,
+	[TRACE_OP_DRAW_TEXTURE_TINT_ROTATE_HOTSPOT] = 6,
+	[TRACE_OP_DRAW_TEXTURE_TINT_SCALE] = 5,
+	[TRACE_OP_DRAW_TEXTURE_TINT_PART] = 7,
+	[TRACE_OP_DRAW_TEXTURE_TINT_PART_SCALE] = 9,
+	[TRACE_OP_DRAW_TEXTURE_TINT_SCALE_ROTATE_HOTSPOT] = 8,
+	[TRACE_OP_DRAW_TEXTURE_TINT_SCALE_ROTATE] = 6,
+	[TRACE_OP_DRAW_TEXTURE_PART_TINT_SCALE_ROTATE] = 10,
+	[TRACE_OP_DRAW_ARRAY_TEXTURED] = 2,
+	[TRACE_OP_FONT_DRAW_TEXT] = 5,
+	[TRACE_OP_PGF_DRAW_TEXT] = 5,
+	[TRACE_OP_PVF_DRAW_TEXT] = 5,
+};
+
+static int trace_op_has_data(trace_op op)
+{
+	switch (op) {
+	case TRACE_OP_DRAW_ARRAY:
+	case TRACE_OP_DRAW_ARRAY_TEXTURED:
+	case TRACE_OP_FONT_DRAW_TEXT:
+	case TRACE_OP_PGF_DRAW_TEXT:
+	case TRACE_OP_PVF_DRAW_TEXT:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static int trace_op_font_kind(trace_op op)
+{
+	switch (op) {
+	case TRACE_OP_FONT_DRAW_TEXT:
+		return TRACE_FONT_FREETYPE;
+	case TRACE_OP_PGF_DRAW_TEXT:
+		return TRACE_FONT_PGF;
+	case TRACE_OP_PVF_DRAW_TEXT:
+		return TRACE_FONT_PVF;
+	default:
+		return -1;
+	}
+}
+
+/*
+ * Nesting depth of the traced calls of each thread, also raised by the
+ * replay so it isn't recorded
+ */
+static __thread unsigned int trace_depth = 0;
+
+#ifdef VITA2D_TRACE
+
+#define TRACE_BUFFER_SIZE	(64 * 1024)
+#define TRACE_TOMBSTONE		((const void *)1)
+
+typedef struct trace_object {
+	const void *ptr;	/* NULL: empty, TRACE_TOMBSTONE: removed */
+	unsigned short id;
+	unsigned char is_font;
+} trace_object;
+
+/*
+ * Guards everything below: textures can be freed (trace_forget()) from
+ * other threads, like the async loading ones, while the trace is recorded.
+ */
+static int trace_mutex_initialized = 0;
+static SceKernelLwMutexWork trace_mutex;
+
+static SceUID trace_fd = -1;
+static unsigned int trace_frames_left = 0;
+static int trace_stop_pending = 0;
+
+static unsigned char trace_buffer[TRACE_BUFFER_SIZE];
+static unsigned int trace_buffer_used = 0;
+
+/* Open addressing on the object addresses */
+static trace_object *trace_objects = NULL;
+static unsigned int trace_objects_size = 0;
+static unsigned int trace_objects_used = 0;	/* including the tombstones */
+static unsigned int trace_next_id = 1;
+
+static void trace_flush()
+{
+	if (trace_buffer_used && sceIoWrite(trace_fd, trace_buffer, trace_buffer_used) != trace_buffer_used) {
+		/* Out of space or similar, what's recorded so far is still usable */
+		sceIoClose(trace_fd);
+		trace_fd = -1;
+	}
+
+	trace_buffer_used = 0;
+}
+
+static void trace_write(const void *data, unsigned int size)
+{
+	if (trace_buffer_used + size > TRACE_BUFFER_SIZE)
+		trace_flush();
+
+	if (trace_fd < 0)
+		return;
+
+	if (size > TRACE_BUFFER_SIZE) {
+		if (sceIoWrite(trace_fd, data, size) != size) {
+			sceIoClose(trace_fd);
+			trace_fd = -1;
+		}
+		return;
+	}
+
+	memcpy(trace_buffer + trace_buffer_used, data, size);
+	trace_buffer_used += size;
+}
+
+static void trace_emit(trace_op op, unsigned int id, const void *data, unsigned int size,
+		       const trace_word *words, unsigned int num_words)
+{
+	static const unsigned char padding[3] = {0};
+	unsigned char header[4] = {op, num_words, id & 0xFF, id >> 8};
+
+	trace_write(header, sizeof(header));
+	trace_write(words, num_words * sizeof(*words));
+
+	if (trace_op_has_data(op)) {
+		trace_write(&size, sizeof(size));
+		trace_write(data, size);
+		trace_write(padding, -size & 3);
+	}
+}
+
+static unsigned int trace_object_hash(const void *ptr)
+{
+	uintptr_t v = (uintptr_t)ptr;
+
+	/* The objects are at least 8 byte aligned, and come from few pages */
+	v = (v >> 3) * 2654435761U;
+	return (unsigned int)(v ^ (v >> 16));
+}
+
+static trace_object *trace_object_find(const void *ptr)
+{
+	unsigned int mask = trace_objects_size - 1;
+	unsigned int i;
+
+	if (!trace_objects_size)
+		return NULL;
+
+	for (i = trace_object_hash(ptr) & mask; trace_objects[i].ptr; i = (i + 1) & mask) {
+		if (trace_objects[i].ptr == ptr)
+			return &trace_objects[i];
+	}
+
+	return NULL;
+}
+
+static int trace_object_insert(const void *ptr, unsigned int id, int is_font)
+{
+	unsigned int mask, i;
+
+	/* Keep at least a quarter of the slots empty so the probing ends */
+	if ((trace_objects_used + 1) * 4 > trace_objects_size * 3) {
+		trace_object *old = trace_objects;
+		unsigned int old_size = trace_objects_size;
+		unsigned int size = old_size ? old_size * 2 : 64;
+
+		trace_objects = calloc(size, sizeof(*trace_objects));
+		if (!trace_objects) {
+			trace_objects = old;
+			return 0;
+		}
+
+		trace_objects_size = size;
+		trace_objects_used = 0;
+
+		for (i = 0; i < old_size; i++) {
+			if (old[i].ptr && old[i].ptr != TRACE_TOMBSTONE)
+				trace_object_insert(old[i].ptr, old[i].id, old[i].is_font);
+		}
+
+		free(old);
+	}
+
+	mask = trace_objects_size - 1;
+	for (i = trace_object_hash(ptr) & mask; trace_objects[i].ptr; i = (i + 1) & mask)
+		;
+
+	trace_objects[i].ptr = ptr;
+	trace_objects[i].id = id;
+	trace_objects[i].is_font = is_font;
+	trace_objects_used++;
+	return 1;
+}
+
+/* Returns the id of the object, defining it in the trace on its first use */
+static unsigned int trace_object_id(const void *object, trace_op op)
+{
+	trace_object *entry;
+	int kind;
+
+	if (!object)
+		return 0;
+
+	if ((entry = trace_object_find(object)))
+		return entry->id;
+
+	if (trace_next_id > TRACE_MAX_OBJECTS)
+		return 0;
+
+	kind = trace_op_font_kind(op);
+	if (!trace_object_insert(object, trace_next_id, kind >= 0))
+		return 0;
+
+	if (kind >= 0) {
+		trace_word words[] = {TRACE_I(kind)};
+		trace_emit(TRACE_OP_FONT, trace_next_id, NULL, 0, words, 1);
+	} else {
+		const vita2d_texture *texture = object;
+		trace_word words[] = {
+			TRACE_U(vita2d_texture_get_width(texture)),
+			TRACE_U(vita2d_texture_get_height(texture)),
+			TRACE_U(vita2d_texture_get_format(texture)),
+			TRACE_U(sceGxmTextureGetType(&texture->gxm_tex)),
+			TRACE_U(texture->gxm_rtgt != NULL)
+		};
+		trace_emit(TRACE_OP_TEXTURE, trace_next_id, NULL, 0, words, 5);
+	}
+
+	return trace_next_id++;
+}
+
+int trace_init()
+{
+	if (trace_mutex_initialized)
+		return 1;
+
+	if (sceKernelCreateLwMutex(&trace_mutex, "vita2d_trace_mutex", 2, 0, NULL) < 0)
+		return 0;
+
+	trace_mutex_initialized = 1;
+	return 1;
+}
+
+void trace_fini()
+{
+	if (!trace_mutex_initialized)
+		return;
+
+	vita2d_trace_stop();
+
+	sceKernelDeleteLwMutex(&trace_mutex);
+	trace_mutex_initialized = 0;
+}
+
+int trace_enter(trace_op op, const void *object, const void *data, unsigned int size,
+		const trace_word *words, unsigned int num_words)
+{
+	/* Only started once the mutex exists, checked again under it */
+	if (trace_depth++ == 0 && trace_fd >= 0) {
+		sceKernelLockLwMutex(&trace_mutex, 1, NULL);
+
+		if (trace_fd >= 0) {
+			trace_emit(op, trace_object_id(object, op), data, size, words, num_words);
+
+			if (op == TRACE_OP_SWAP_BUFFERS && trace_frames_left && --trace_frames_left == 0)
+				trace_stop_pending = 1;
+		}
+
+		sceKernelUnlockLwMutex(&trace_mutex, 1);
+	}
+
+	return 0;
+}
+
+void trace_leave(int *scope)
+{
+	/* Stop once the last frame's vita2d_swap_buffers() has returned */
+	if (--trace_depth == 0 && trace_stop_pending)
+		vita2d_trace_stop();
+}
+
+void trace_forget(const void *object)
+{
+	trace_object *entry;
+
+	if (trace_fd < 0)
+		return;
+
+	sceKernelLockLwMutex(&trace_mutex, 1, NULL);
+
+	if (trace_fd >= 0 && (entry = trace_object_find(object))) {
+		trace_emit(entry->is_font ? TRACE_OP_FONT_FREE : TRACE_OP_TEXTURE_FREE, entry->id, NULL, 0, NULL, 0);
+		entry->ptr = TRACE_TOMBSTONE;
+	}
+
+	sceKernelUnlockLwMutex(&trace_mutex, 1);
+}
+
+#else
+
+int trace_init()
+{
+	return 1;
+}
+
+void trace_fini()
+{
+}
+
+#endif
+
+int vita2d_trace_start(const char *filename, unsigned int frames)
+{
+#ifdef VITA2D_TRACE
+	trace_header header = {TRACE_MAGIC, TRACE_VERSION};
+
+	if (!trace_mutex_initialized)
+		return 0;
+
+	sceKernelLockLwMutex(&trace_mutex, 1, NULL);
+
+	vita2d_trace_stop();
+
+	trace_fd = sceIoOpen(filename, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+	if (trace_fd >= 0) {
+		trace_frames_left = frames;
+		trace_stop_pending = 0;
+		trace_next_id = 1;
+
+		trace_write(&header, sizeof(header));
+	}
+
+	sceKernelUnlockLwMutex(&trace_mutex, 1);
+
+	return trace_fd >= 0;
+#else
+	return 0;
+#endif
+}
+
+void vita2d_trace_stop()
+{
+#ifdef VITA2D_TRACE
+	if (!trace_mutex_initialized)
+		return;
+
+	sceKernelLockLwMutex(&trace_mutex, 1, NULL);
+
+	if (trace_fd >= 0) {
+		trace_flush();
+		if (trace_fd >= 0)
+			sceIoClose(trace_fd);
+		trace_fd = -1;
+	}
+
+	free(trace_objects);
+	trace_objects = NULL;
+	trace_objects_size = 0;
+	trace_objects_used = 0;
+	trace_stop_pending = 0;
+
+	sceKernelUnlockLwMutex(&trace_mutex, 1);
+#endif
+}
+
+int vita2d_trace_is_active()
+{
+#ifdef VITA2D_TRACE
+	return trace_fd >= 0;
+#else
+	return 0;
+#endif
+}
+
+typedef enum replay_kind {
+	REPLAY_NONE,
+	REPLAY_TEXTURE,
+	REPLAY_FONT,
+	REPLAY_PGF,
+	REPLAY_PVF
+} replay_kind;
+
+typedef struct replay_object {
+	void *ptr;
+	replay_kind kind;
+} replay_object;
+
+typedef struct replay_state {
+	replay_object *objects;
+	unsigned int num_objects;
+	vita2d_font *font;
+	vita2d_pgf *pgf;
+	vita2d_pvf *pvf;
+} replay_state;
+
+static replay_object *_vita2d_replay_get_object(replay_state *state, unsigned int id)
+{
+	if (id >= state->num_objects) {
+		unsigned int num = id + 64;
+		replay_object *objects = realloc(state->objects, num * sizeof(*objects));
+		if (!objects)
+			return NULL;
+
+		memset(objects + state->num_objects, 0, (num - state->num_objects) * sizeof(*objects));
+		state->objects = objects;
+		state->num_objects = num;
+	}
+
+	return &state->objects[id];
+}
+
+static void _vita2d_replay_free_object(replay_object *object)
+{
+	/* The fonts are shared or the caller's */
+	if (object->kind == REPLAY_TEXTURE)
+		vita2d_free_texture(object->ptr);
+
+	object->ptr = NULL;
+	object->kind = REPLAY_NONE;
+}
+
+static void _vita2d_replay_define_texture(replay_object *object, const trace_word *w)
+{
+	unsigned int width = w[0].u, height = w[1].u;
+
+	if (width == 0 || width > 4096 || height == 0 || height > 4096)
+		return;
+
+	/* Stand-in with the same size, format and layout; its contents don't matter for timing */
+	if (w[4].u)
+		object->ptr = vita2d_create_empty_texture_rendertarget(width, height, w[2].u);
+	else
+		object->ptr = vita2d_create_empty_texture_format_layout(width, height, w[2].u, w[3].u);
+
+	if (object->ptr)
+		object->kind = REPLAY_TEXTURE;
+}
+
+static void _vita2d_replay_define_font(replay_state *state, replay_object *object, int kind)
+{
+	switch (kind) {
+	case TRACE_FONT_FREETYPE:
+		object->ptr = state->font;
+		object->kind = REPLAY_FONT;
+		break;
+	case TRACE_FONT_PGF:
+		if (!state->pgf)
+			state->pgf = vita2d_load_default_pgf();
+		object->ptr = state->pgf;
+		object->kind = REPLAY_PGF;
+		break;
+	case TRACE_FONT_PVF:
+		if (!state->pvf)
+			state->pvf = vita2d_load_default_pvf();
+		object->ptr = state->pvf;
+		object->kind = REPLAY_PVF;
+		break;
+	}
+
+	if (!object->ptr)
+		object->kind = REPLAY_NONE;
+}
+
+/* Copies vertices into the pool, as the draws keep pointing to them until the GPU is done */
+static void *_vita2d_replay_vertices(const void *data, unsigned int size, unsigned int vertex_size, size_t *count)
+{
+	void *vertices;
+
+	*count = size / vertex_size;
+	if (*count == 0 || !(vertices = vita2d_pool_memalign(size, sizeof(float))))
+		return NULL;
+
+	memcpy(vertices, data, size);
+	return vertices;
+}
+
+static void _vita2d_replay_call(replay_state *state, trace_op op, replay_object *object,
+				const trace_word *w, const void *data, unsigned int size)
+{
+	const vita2d_texture *tex = NULL;
+	void *font = NULL;
+	const char *text = data;
+	size_t count;
+	void *vertices;
+
+	/* Skip the calls on objects the replay couldn't create */
+	if (op >= TRACE_OP_DRAW_TEXTURE && op <= TRACE_OP_DRAW_ARRAY_TEXTURED) {
+		if (object->kind != REPLAY_TEXTURE)
+			return;
+		tex = object->ptr;
+	} else if (op == TRACE_OP_TEXTURE_SET_FILTERS) {
+		if (object->kind != REPLAY_TEXTURE)
+			return;
+	} else if (trace_op_font_kind(op) >= 0) {
+		if (object->kind != REPLAY_FONT + trace_op_font_kind(op) || size == 0 || text[size - 1] != '\0')
+			return;
+		font = object->ptr;
+	}
+
+	switch (op) {
+	case TRACE_OP_START_DRAWING:
+		vita2d_start_drawing();
+		break;
+	case TRACE_OP_START_DRAWING_ADVANCED:
+		if (object->kind == REPLAY_TEXTURE || object->kind == REPLAY_NONE)
+			vita2d_start_drawing_advanced(object->ptr, w[0].u);
+		break;
+	case TRACE_OP_END_DRAWING:
+		vita2d_end_drawing();
+		break;
+	case TRACE_OP_CLEAR_SCREEN:
+		vita2d_clear_screen();
+		break;
+	case TRACE_OP_SWAP_BUFFERS:
+		vita2d_swap_buffers();
+		break;
+	case TRACE_OP_SET_CLEAR_COLOR:
+		vita2d_set_clear_color(w[0].u);
+		break;
+	case TRACE_OP_SET_VBLANK_WAIT:
+		vita2d_set_vblank_wait(w[0].i);
+		break;
+	case TRACE_OP_SET_REGION_CLIP:
+		vita2d_set_region_clip(w[0].u, w[1].u, w[2].u, w[3].u, w[4].u);
+		break;
+	case TRACE_OP_ENABLE_CLIPPING:
+		vita2d_enable_clipping();
+		break;
+	case TRACE_OP_DISABLE_CLIPPING:
+		vita2d_disable_clipping();
+		break;
+	case TRACE_OP_SET_CLIP_RECTANGLE:
+		vita2d_set_clip_rectangle(w[0].i, w[1].i, w[2].i, w[3].i);
+		break;
+	case TRACE_OP_SET_BLEND_MODE_ADD:
+		vita2d_set_blend_mode_add(w[0].i);
+		break;
+	case TRACE_OP_POOL_RESET:
+		vita2d_pool_reset();
+		break;
+	case TRACE_OP_TEXTURE_SET_FILTERS:
+		vita2d_texture_set_filters(object->ptr, w[0].u, w[1].u);
+		break;
+	case TRACE_OP_DRAW_PIXEL:
+		vita2d_draw_pixel(w[0].f, w[1].f, w[2].u);
+		break;
+	case TRACE_OP_DRAW_LINE:
+		vita2d_draw_line(w[0].f, w[1].f, w[2].f, w[3].f, w[4].u);
+		break;
+	case TRACE_OP_DRAW_RECTANGLE:
+		vita2d_draw_rectangle(w[0].f, w[1].f, w[2].f, w[3].f, w[4].u);
+		break;
+	case TRACE_OP_DRAW_FILL_CIRCLE:
+		vita2d_draw_fill_circle(w[0].f, w[1].f, w[2].f, w[3].u);
+		break;
+	case TRACE_OP_DRAW_ARRAY:
+		if ((vertices = _vita2d_replay_vertices(data, size, sizeof(vita2d_color_vertex), &count)))
+			vita2d_draw_array(w[0].u, vertices, count);
+		break;
+	case TRACE_OP_DRAW_TEXTURE:
+		vita2d_draw_texture(tex, w[0].f, w[1].f);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_ROTATE:
+		vita2d_draw_texture_rotate(tex, w[0].f, w[1].f, w[2].f);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_ROTATE_HOTSPOT:
+		vita2d_draw_texture_rotate_hotspot(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_SCALE:
+		vita2d_draw_texture_scale(tex, w[0].f, w[1].f, w[2].f, w[3].f);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_PART:
+		vita2d_draw_texture_part(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f, w[5].f);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_PART_SCALE:
+		vita2d_draw_texture_part_scale(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f, w[5].f,
+			w[6].f, w[7].f);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_SCALE_ROTATE_HOTSPOT:
+		vita2d_draw_texture_scale_rotate_hotspot(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f,
+			w[5].f, w[6].f);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_SCALE_ROTATE:
+		vita2d_draw_texture_scale_rotate(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_PART_SCALE_ROTATE:
+		vita2d_draw_texture_part_scale_rotate(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f,
+			w[5].f, w[6].f, w[7].f, w[8].f);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_TINT:
+		vita2d_draw_texture_tint(tex, w[0].f, w[1].f, w[2].u);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_TINT_ROTATE:
+		vita2d_draw_texture_tint_rotate(tex, w[0].f, w[1].f, w[2].f, w[3].u);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_TINT_ROTATE_HOTSPOT:
+		vita2d_draw_texture_tint_rotate_hotspot(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f,
+			w[5].u);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_TINT_SCALE:
+		vita2d_draw_texture_tint_scale(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].u);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_TINT_PART:
+		vita2d_draw_texture_tint_part(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f, w[5].f,
+			w[6].u);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_TINT_PART_SCALE:
+		vita2d_draw_texture_tint_part_scale(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f, w[5].f,
+			w[6].f, w[7].f, w[8].u);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_TINT_SCALE_ROTATE_HOTSPOT:
+		vita2d_draw_texture_tint_scale_rotate_hotspot(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f,
+			w[5].f, w[6].f, w[7].u);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_TINT_SCALE_ROTATE:
+		vita2d_draw_texture_tint_scale_rotate(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f,
+			w[5].u);
+		break;
+	case TRACE_OP_DRAW_TEXTURE_PART_TINT_SCALE_ROTATE:
+		vita2d_draw_texture_part_tint_scale_rotate(tex, w[0].f, w[1].f, w[2].f, w[3].f, w[4].f,
+			w[5].f, w[6].f, w[7].f, w[8].f, w[9].u);
+		break;
+	case TRACE_OP_DRAW_ARRAY_TEXTURED:
+		if ((vertices = _vita2d_replay_vertices(data, size, sizeof(vita2d_texture_vertex), &count)))
+			vita2d_draw_array_textured(tex, w[0].u, vertices, count, w[1].u);
+		break;
+	case TRACE_OP_FONT_DRAW_TEXT:
+		vita2d_font_draw_text_ls(font, w[0].i, w[1].i, w[4].f, w[2].u, w[3].u, text);
+		break;
+	case TRACE_OP_PGF_DRAW_TEXT:
+		vita2d_pgf_draw_text_ls(font, w[0].i, w[1].i, w[4].f, w[2].u, w[3].f, text);
+		break;
+	case TRACE_OP_PVF_DRAW_TEXT:
+		vita2d_pvf_draw_text_ls(font, w[0].i, w[1].i, w[4].f, w[2].u, w[3].f, text);
+		break;
+	default:
+		break;
+	}
+}
+
+static int _vita2d_replay(replay_state *state, const unsigned char *p, unsigned long size)
+{
+	const unsigned char *end = p + size;
+	trace_header header;
+	trace_word words[TRACE_MAX_WORDS];
+
+	if (size < sizeof(header))
+		return 0;
+
+	memcpy(&header, p, sizeof(header));
+	if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION)
+		return 0;
+
+	p += sizeof(header);
+
+	while (p < end) {
+		trace_op op;
+		unsigned int num_words, id, data_size = 0;
+		const void *data = NULL;
+		replay_object *object;
+
+		if (end - p < 4)
+			return 0;
+
+		op = p[0];
+		num_words = p[1];
+		id = p[2] | (p[3] << 8);
+		p += 4;
+
+		if (op == 0 || op >= TRACE_OP_COUNT || num_words != trace_op_words[op] ||
+		    (unsigned long)(end - p) < num_words * sizeof(trace_word))
+			return 0;
+
+		memcpy(words, p, num_words * sizeof(trace_word));
+		p += num_words * sizeof(trace_word);
+
+		if (trace_op_has_data(op)) {
+			if (end - p < 4)
+				return 0;
+			memcpy(&data_size, p, sizeof(data_size));
+			p += 4;
+
+			if (data_size > TRACE_MAX_DATA || (unsigned long)(end - p) < ((data_size + 3) & ~3))
+				return 0;
+			data = p;
+			p += (data_size + 3) & ~3;
+		}
+
+		if (!(object = _vita2d_replay_get_object(state, id)))
+			return 0;
+
+		switch (op) {
+		case TRACE_OP_TEXTURE:
+			_vita2d_replay_free_object(object);
+			_vita2d_replay_define_texture(object, words);
+			break;
+		case TRACE_OP_FONT:
+			_vita2d_replay_free_object(object);
+			_vita2d_replay_define_font(state, object, words[0].i);
+			break;
+		case TRACE_OP_TEXTURE_FREE:
+		case TRACE_OP_FONT_FREE:
+			_vita2d_replay_free_object(object);
+			break;
+		default:
+			_vita2d_replay_call(state, op, object, words, data, data_size);
+			break;
+		}
+	}
+
+	return 1;
+}
+
+int vita2d_trace_replay_buffer(const void *buffer, unsigned long buffer_size, vita2d_font *font)
+{
+	replay_state state = {NULL, 0, font, NULL, NULL};
+	unsigned int i;
+	int ret;
+
+	/* The replayed calls must not end up in a trace being recorded */
+	trace_depth++;
+	ret = _vita2d_replay(&state, buffer, buffer_size);
+	trace_depth--;
+
+	/* The GPU may still be using the textures of the last frame */
+	vita2d_wait_rendering_done();
+
+	for (i = 0; i < state.num_objects; i++)
+		_vita2d_replay_free_object(&state.objects[i]);
+	free(state.objects);
+
+	if (state.pgf)
+		vita2d_free_pgf(state.pgf);
+	if (state.pvf)
+		vita2d_free_pvf(state.pvf);
+
+	return ret;
+}
+
+int vita2d_trace_replay_file(const char *filename, vita2d_font *font)
+{
+	SceUID fd;
+	long size;
+	void *buffer;
+	int ret;
+
+	if ((fd = sceIoOpen(filename, SCE_O_RDONLY, 0777)) < 0)
+		return 0;
+
+	size = sceIoLseek(fd, 0, SCE_SEEK_END);
+	sceIoLseek(fd, 0, SCE_SEEK_SET);
+
+	buffer = size > 0 ? malloc(size) : NULL;
+	if (!buffer || sceIoRead(fd, buffer, size) != size) {
+		free(buffer);
+		sceIoClose(fd);
+		return 0;
+	}
+
+	sceIoClose(fd);
+
+	ret = vita2d_trace_replay_buffer(buffer, size, font);
+	free(buffer);
+	return ret;
+}
@@ -0,0 +1,530 @@
+/*
+ * Bakes PNG images into a file vita2d_load_baked() can read without any
+ * decoding: the images are packed into atlas pages, converted to the GXM
+ * texture format and stored in the texture layout the GPU samples from.
+ *
+ * Usage: vita2d_bake [options] -o output image.png...
+ *   -f format   rgba8888 (default), rgb565, rgba4444, rgba5551 or p8
+ *   -l layout   linear (default), swizzled or tiled
+ *   -s WxH      atlas page size, 1024x1024 by default. Bigger images get
+ *               a texture of their own
+ *   -d          dither the 16 bit formats
+ *   -v          print where each image went
+ *
+ * Images are looked up by the path given on the command line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <png.h>
+#include <psp2/gxm.h>
+#include "baked.h"
+#include "bin_packing_2d.h"
+#include "pixel_convert.h"
+#include "texture_layout.h"
+#include "palette.h"
+
+/* Edge pixels repeated around each atlas image, as vita2d_image_atlas does */
+#define BORDER	1
+
+typedef struct bake_image {
+	const char *name;
+	unsigned int w;
+	unsigned int h;
+	unsigned int *rgba;
+	unsigned int texture;
+	int x;
+	int y;
+} bake_image;
+
+typedef struct bake_texture {
+	unsigned int w;
+	unsigned int h;
+	bp2d_node *bp_root;	/* NULL if the texture holds a single image */
+	unsigned int *rgba;
+	baked_texture info;
+	unsigned char *data;
+	unsigned int palette[PALETTE_MAX_COLORS];
+} bake_texture;
+
+typedef struct bake_options {
+	SceGxmTextureFormat format;
+	SceGxmTextureType layout;
+	unsigned int page_w;
+	unsigned int page_h;
+	int dither;
+	int verbose;
+} bake_options;
+
+static unsigned int format_bpp(SceGxmTextureFormat format)
+{
+	switch (format) {
+	case SCE_GXM_TEXTURE_FORMAT_P8_ABGR:
+		return 1;
+	case SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR:
+	case SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR:
+	case SCE_GXM_TEXTURE_FORMAT_U1U5U5U5_ABGR:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+static pixel_pack_fn format_packer(SceGxmTextureFormat format)
+{
+	switch (format) {
+	case SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR:
+		return pixel_pack_rgba8888_to_bgr565;
+	case SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR:
+		return pixel_pack_rgba8888_to_abgr4444;
+	case SCE_GXM_TEXTURE_FORMAT_U1U5U5U5_ABGR:
+		return pixel_pack_rgba8888_to_abgr1555;
+	default:
+		return NULL;
+	}
+}
+
+static int parse_options(int argc, char *argv[], bake_options *options, const char **output)
+{
+	int opt;
+
+	options->format = SCE_GXM_TEXTURE_FORMAT_A8B8G8R8;
+	options->layout = SCE_GXM_TEXTURE_LINEAR;
+	options->page_w = 1024;
+	options->page_h = 1024;
+	options->dither = 0;
+	options->verbose = 0;
+	*output = NULL;
+
+	while ((opt = getopt(argc, argv, "f:l:s:o:dv")) != -1) {
+		switch (opt) {
+		case 'f':
+			if (!strcmp(optarg, "rgba8888"))
+				options->format = SCE_GXM_TEXTURE_FORMAT_A8B8G8R8;
+			else if (!strcmp(optarg, "rgb565"))
+				options->format = SCE_GXM_TEXTURE_FORMAT_U5U6U5_BGR;
+			else if (!strcmp(optarg, "rgba4444"))
+				options->format = SCE_GXM_TEXTURE_FORMAT_U4U4U4U4_ABGR;
+			else if (!strcmp(optarg, "rgba5551"))
+				options->format = SCE_GXM_TEXTURE_FORMAT_U1U5U5U5_ABGR;
+			else if (!strcmp(optarg, "p8"))
+				options->format = SCE_GXM_TEXTURE_FORMAT_P8_ABGR;
+			else
+				return 0;
+			break;
+		case 'l':
+			if (!strcmp(optarg, "linear"))
+				options->layout = SCE_GXM_TEXTURE_LINEAR;
+			else if (!strcmp(optarg, "swizzled"))
+				options->layout = SCE_GXM_TEXTURE_SWIZZLED;
+			else if (!strcmp(optarg, "tiled"))
+				options->layout = SCE_GXM_TEXTURE_TILED;
+			else
+				return 0;
+			break;
+		case 's':
+			if (sscanf(optarg, "%ux%u", &options->page_w, &options->page_h) != 2 ||
+			    options->page_w == 0 || options->page_w > 4096 ||
+			    options->page_h == 0 || options->page_h > 4096)
+				return 0;
+			break;
+		case 'o':
+			*output = optarg;
+			break;
+		case 'd':
+			options->dither = 1;
+			break;
+		case 'v':
+			options->verbose = 1;
+			break;
+		default:
+			return 0;
+		}
+	}
+
+	return *output != NULL && optind < argc;
+}
+
+static int load_png(bake_image *image)
+{
+	png_image png;
+
+	memset(&png, 0, sizeof(png));
+	png.version = PNG_IMAGE_VERSION;
+
+	if (!png_image_begin_read_from_file(&png, image->name))
+		goto exit_error;
+
+	/* A8B8G8R8 in memory is R, G, B, A bytes */
+	png.format = PNG_FORMAT_RGBA;
+	image->w = png.width;
+	image->h = png.height;
+	image->rgba = malloc(PNG_IMAGE_SIZE(png));
+	if (!image->rgba) {
+		png_image_free(&png);
+		goto exit_error;
+	}
+
+	if (!png_image_finish_read(&png, NULL, image->rgba, 0, NULL))
+		goto exit_error;
+
+	return 1;
+
+exit_error:
+	fprintf(stderr, "%s: %s\n", image->name, png.message[0] ? png.message : "out of memory");
+	return 0;
+}
+
+/* Tallest images first, the packer wastes less space that way */
+static int compare_height(const void *a, const void *b)
+{
+	const bake_image *ia = *(const bake_image **)a;
+	const bake_image *ib = *(const bake_image **)b;
+
+	if (ia->h != ib->h)
+		return ib->h - ia->h;
+	return ib->w - ia->w;
+}
+
+static int compare_name(const void *a, const void *b)
+{
+	return strcmp(((const bake_image *)a)->name, ((const bake_image *)b)->name);
+}
+
+static bake_texture *add_texture(bake_texture **textures, unsigned int *num_textures,
+				 unsigned int w, unsigned int h, int atlas)
+{
+	bake_texture *t = realloc(*textures, (*num_textures + 1) * sizeof(**textures));
+	if (!t)
+		return NULL;
+	*textures = t;
+
+	t = &t[(*num_textures)++];
+	memset(t, 0, sizeof(*t));
+	t->w = w;
+	t->h = h;
+
+	if (atlas) {
+		bp2d_rectangle rect = {0, 0, w, h};
+		t->bp_root = bp2d_create(&rect);
+		t->rgba = calloc(w * h, sizeof(*t->rgba));
+		if (!t->bp_root || !t->rgba)
+			return NULL;
+	}
+
+	return t;
+}
+
+static void blit_image(bake_texture *texture, const bake_image *image)
+{
+	int stride = texture->w;
+	int w = image->w, h = image->h;
+	int x, y, i;
+
+	for (y = 0; y < h; y++) {
+		unsigned int *dst = texture->rgba + (image->y + y) * stride + image->x;
+		const unsigned int *src = image->rgba + y * w;
+
+		for (i = 1; i <= BORDER; i++) {
+			dst[-i] = src[0];
+			dst[w - 1 + i] = src[w - 1];
+		}
+		memcpy(dst, src, w * 4);
+	}
+
+	/* Top and bottom borders, corners included */
+	for (i = 1; i <= BORDER; i++) {
+		unsigned int *top = texture->rgba + (image->y - i) * stride + image->x - BORDER;
+		unsigned int *bottom = texture->rgba + (image->y + h - 1 + i) * stride + image->x - BORDER;
+		for (x = 0; x < w + 2 * BORDER; x++) {
+			top[x] = top[x + i * stride];
+			bottom[x] = bottom[x - i * stride];
+		}
+	}
+}
+
+static int pack_images(bake_image *images, unsigned int num_images, const bake_options *options,
+		       bake_texture **textures, unsigned int *num_textures)
+{
+	bake_image **order = malloc(num_images * sizeof(*order));
+	unsigned int i, j;
+	int ret = 0;
+
+	if (!order)
+		return 0;
+
+	for (i = 0; i < num_images; i++)
+		order[i] = &images[i];
+	qsort(order, num_images, sizeof(*order), compare_height);
+
+	for (i = 0; i < num_images; i++) {
+		bake_image *image = order[i];
+		bp2d_size size = {image->w + 2 * BORDER, image->h + 2 * BORDER};
+		bp2d_position pos;
+		bp2d_node *node;
+		bake_texture *texture;
+
+		/* Too big for a page, it gets a texture of its exact size */
+		if (size.w > options->page_w || size.h > options->page_h) {
+			if (image->w > 4096 || image->h > 4096) {
+				fprintf(stderr, "%s: too big (%ux%u)\n", image->name, image->w, image->h);
+				goto exit;
+			}
+			texture = add_texture(textures, num_textures, image->w, image->h, 0);
+			if (!texture)
+				goto exit;
+			texture->rgba = image->rgba;
+			image->rgba = NULL;
+			image->texture = *num_textures - 1;
+			image->x = 0;
+			image->y = 0;
+			continue;
+		}
+
+		for (j = 0; j < *num_textures; j++) {
+			texture = &(*textures)[j];
+			if (texture->bp_root && bp2d_insert(texture->bp_root, &size, &pos, &node))
+				break;
+		}
+
+		if (j == *num_textures) {
+			texture = add_texture(textures, num_textures, options->page_w, options->page_h, 1);
+			if (!texture || !bp2d_insert(texture->bp_root, &size, &pos, &node))
+				goto exit;
+		}
+
+		image->texture = j;
+		image->x = pos.x + BORDER;
+		image->y = pos.y + BORDER;
+		blit_image(texture, image);
+	}
+
+	ret = 1;
+
+exit:
+	free(order);
+	return ret;
+}
+
+/* Palette of the texture, exact if it has at most 256 colors, and its indices over rgba */
+static int palettize(bake_texture *texture)
+{
+	unsigned int n = texture->w * texture->h;
+	palette_quantizer q = {NULL, NULL};
+	unsigned char *indices = (unsigned char *)texture->rgba;
+
+	palette *pal = malloc(sizeof(*pal));
+	if (!pal)
+		return 0;
+
+	/* Each color is read before its index is written, so the mapping can be done in place */
+	palette_init(pal);
+	if (palette_add_row(pal, texture->rgba, n)) {
+		palette_map_row(pal, texture->rgba, indices, n);
+	} else {
+		if (!palette_quantizer_init(&q)) {
+			free(pal);
+			return 0;
+		}
+		palette_quantizer_add_row(&q, texture->rgba, n);
+		pal->num_colors = palette_quantizer_build(&q, pal->colors, PALETTE_MAX_COLORS);
+		palette_quantizer_map_row(&q, texture->rgba, indices, n);
+		palette_quantizer_fini(&q);
+	}
+
+	memcpy(texture->palette, pal->colors, pal->num_colors * sizeof(pal->colors[0]));
+	free(pal);
+	return 1;
+}
+
+/* Converts the texture to the output format and stores it in the output layout */
+static int convert_texture(bake_texture *texture, const bake_options *options)
+{
+	SceGxmTextureFormat format = options->format;
+	SceGxmTextureType layout = options->layout;
+	unsigned int bpp = format_bpp(format);
+	pixel_pack_fn pack = format_packer(format);
+	unsigned int aligned_w, aligned_h, y;
+
+	/* Same as vita2d_create_empty_texture_format_layout() */
+	if (layout == SCE_GXM_TEXTURE_SWIZZLED &&
+	    (texture_layout_pot(texture->w) != texture->w || texture_layout_pot(texture->h) != texture->h))
+		layout = SCE_GXM_TEXTURE_SWIZZLED_ARBITRARY;
+
+	texture_layout_dimensions(layout, texture->w, texture->h, &aligned_w, &aligned_h);
+
+	texture->info.format = format;
+	texture->info.type = layout;
+	texture->info.width = texture->w;
+	texture->info.height = texture->h;
+	texture->info.data_size = aligned_w * aligned_h * bpp;
+	texture->data = calloc(1, texture->info.data_size);
+	if (!texture->data)
+		return 0;
+
+	if (format == SCE_GXM_TEXTURE_FORMAT_P8_ABGR && !palettize(texture))
+		return 0;
+
+	unsigned char *packed = NULL;
+	if (pack && !(packed = malloc(texture->w * bpp)))
+		return 0;
+
+	for (y = 0; y < texture->h; y++) {
+		const void *row;
+
+		if (format == SCE_GXM_TEXTURE_FORMAT_P8_ABGR) {
+			row = (unsigned char *)texture->rgba + y * texture->w;
+		} else if (pack) {
+			pack(texture->rgba + y * texture->w, packed, texture->w, y, options->dither);
+			row = packed;
+		} else {
+			row = texture->rgba + y * texture->w;
+		}
+
+		texture_layout_write_row(layout, texture->data, texture->w, texture->h, bpp, y, row, texture->w);
+	}
+
+	free(packed);
+	return 1;
+}
+
+static int write_all(FILE *fp, const void *data, unsigned int size)
+{
+	return fwrite(data, 1, size, fp) == size;
+}
+
+static int write_baked(const char *filename, bake_image *images, unsigned int num_images,
+		       bake_texture *textures, unsigned int num_textures)
+{
+	baked_header header;
+	baked_image *entries;
+	unsigned int i, offset;
+	int ret = 0;
+	FILE *fp;
+
+	entries = malloc(num_images * sizeof(*entries));
+	if (!entries)
+		return 0;
+
+	/* Sorted by name so the loader can binary search them */
+	qsort(images, num_images, sizeof(*images), compare_name);
+
+	header.magic = BAKED_MAGIC;
+	header.version = BAKED_VERSION;
+	header.num_textures = num_textures;
+	header.num_images = num_images;
+	header.names_size = 0;
+
+	for (i = 0; i < num_images; i++) {
+		entries[i].name_offset = header.names_size;
+		entries[i].texture = images[i].texture;
+		entries[i].x = images[i].x;
+		entries[i].y = images[i].y;
+		entries[i].w = images[i].w;
+		entries[i].h = images[i].h;
+		header.names_size += strlen(images[i].name) + 1;
+	}
+
+	offset = sizeof(header) + num_textures * sizeof(baked_texture) +
+		 num_images * sizeof(baked_image) + header.names_size;
+
+	for (i = 0; i < num_textures; i++) {
+		baked_texture *info = &textures[i].info;
+		info->data_offset = offset;
+		offset += info->data_size;
+		if (info->format == SCE_GXM_TEXTURE_FORMAT_P8_ABGR) {
+			info->palette_offset = offset;
+			offset += BAKED_PALETTE_SIZE;
+		} else {
+			info->palette_offset = 0;
+		}
+	}
+
+	if (!(fp = fopen(filename, "wb")))
+		goto exit_free;
+
+	ret = write_all(fp, &header, sizeof(header));
+	for (i = 0; ret && i < num_textures; i++)
+		ret = write_all(fp, &textures[i].info, sizeof(baked_texture));
+	ret = ret && write_all(fp, entries, num_images * sizeof(*entries));
+	for (i = 0; ret && i < num_images; i++)
+		ret = write_all(fp, images[i].name, strlen(images[i].name) + 1);
+	for (i = 0; ret && i < num_textures; i++) {
+		ret = write_all(fp, textures[i].data, textures[i].info.data_size);
+		if (ret && textures[i].info.palette_offset)
+			ret = write_all(fp, textures[i].palette, BAKED_PALETTE_SIZE);
+	}
+
+	if (fclose(fp) != 0)
+		ret = 0;
+
+exit_free:
+	free(entries);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	bake_options options;
+	const char *output;
+	bake_image *images = NULL;
+	bake_texture *textures = NULL;
+	unsigned int num_images, num_textures = 0, i;
+	int ret = 1;
+
+	if (!parse_options(argc, argv, &options, &output)) {
+		fprintf(stderr, "usage: %s [-f rgba8888|rgb565|rgba4444|rgba5551|p8] "
+			"[-l linear|swizzled|tiled] [-s WxH] [-d] [-v] -o output image.png...\n", argv[0]);
+		return 1;
+	}
+
+	num_images = argc - optind;
+	images = calloc(num_images, sizeof(*images));
+	if (!images)
+		goto exit;
+
+	for (i = 0; i < num_images; i++) {
+		images[i].name = argv[optind + i];
+		if (!load_png(&images[i]))
+			goto exit;
+	}
+
+	if (!pack_images(images, num_images, &options, &textures, &num_textures))
+		goto exit;
+
+	for (i = 0; i < num_textures; i++) {
+		if (!convert_texture(&textures[i], &options)) {
+			fprintf(stderr, "out of memory\n");
+			goto exit;
+		}
+	}
+
+	if (options.verbose) {
+		for (i = 0; i < num_images; i++)
+			printf("%s: texture %u at %d,%d (%ux%u)\n", images[i].name,
+			       images[i].texture, images[i].x, images[i].y, images[i].w, images[i].h);
+	}
+
+	if (!write_baked(output, images, num_images, textures, num_textures)) {
+		fprintf(stderr, "%s: can't write\n", output);
+		goto exit;
+	}
+
+	printf("%s: %u images in %u textures\n", output, num_images, num_textures);
+	ret = 0;
+
+exit:
+	for (i = 0; i < num_textures; i++) {
+		if (textures[i].bp_root)
+			bp2d_free(textures[i].bp_root);
+		free(textures[i].rgba);
+		free(textures[i].data);
+	}
+	for (i = 0; images && i < num_images; i++)
+		free(images[i].rgba);
+	free(textures);
+	free(images);
+	return ret;
+}